@@ -0,0 +1,270 @@
+#include "alertengine.h"
+#include "jsondecoder.h"
+#include "tracing.h"
+
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QStandardPaths>
+#include <QTextStream>
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+bool assignRuleKind(AlertRule& rule, const QJsonValue& value)
+{
+    const QString kind = value.toString();
+    if (kind == QLatin1String("instant")) rule.kind = AlertRule::Kind::Instant;
+    else if (kind == QLatin1String("average")) rule.kind = AlertRule::Kind::RollingAverage;
+    else if (kind == QLatin1String("consecutive")) rule.kind = AlertRule::Kind::ConsecutiveHours;
+    else return false;
+    return true;
+}
+
+/** @brief Indeks ostatniego odczytu z wartością lub -1 (końcowe null GIOŚ uzupełnia później). */
+int lastValueIndex(const QList<Measurement>& values)
+{
+    for (int i = int(values.size()) - 1; i >= 0; --i) {
+        if (!values.at(i).value.isNull() && values.at(i).date.isValid()) return i;
+    }
+    return -1;
+}
+
+} // namespace
+
+template<>
+struct JsonSchema<AlertRule> {
+    static constexpr const char* name = "reguła alarmowa";
+    static constexpr std::array<JsonField<AlertRule>, 6> fields = {{
+        JsonField<AlertRule>::required("kind", &assignRuleKind),
+        JsonField<AlertRule>::required("threshold", &JsonAssign::number<AlertRule, &AlertRule::threshold>),
+        JsonField<AlertRule>::optional("param", &JsonAssign::string<AlertRule, &AlertRule::paramCode>),
+        JsonField<AlertRule>::optional("station", &JsonAssign::integer<AlertRule, &AlertRule::stationId>,
+                                       [](AlertRule& r) { r.stationId = -1; }),
+        JsonField<AlertRule>::optional("hours", &JsonAssign::integer<AlertRule, &AlertRule::hours>,
+                                       [](AlertRule& r) { r.hours = 1; }),
+        // Ostatnie - domyślna nazwa korzysta z pozostałych pól
+        JsonField<AlertRule>::optional("name", &JsonAssign::string<AlertRule, &AlertRule::name>,
+                                       [](AlertRule& r) { r.name = QString("%1 >= %2").arg(r.paramCode.isEmpty() ? "*" : r.paramCode).arg(r.threshold); }),
+    }};
+};
+
+bool AlertRule::appliesTo(const QString& code, int station) const
+{
+    return (paramCode.isEmpty() || paramCode.compare(code, Qt::CaseInsensitive) == 0)
+           && (stationId < 0 || stationId == station);
+}
+
+AlertEngine::AlertEngine(QObject *parent)
+    : QObject(parent)
+{
+}
+
+AlertEngine::~AlertEngine()
+{
+    delete logFile;
+}
+
+QList<AlertRule> AlertEngine::defaultRules()
+{
+    // Poziomy informowania i alarmowe wg rozporządzenia w sprawie poziomów niektórych substancji w powietrzu
+    return {
+        {"PM10 - poziom informowania", "PM10", -1, AlertRule::Kind::RollingAverage, 100.0, 24},
+        {"PM10 - poziom alarmowy", "PM10", -1, AlertRule::Kind::RollingAverage, 150.0, 24},
+        {"O3 - poziom informowania", "O3", -1, AlertRule::Kind::Instant, 180.0, 1},
+        {"O3 - poziom alarmowy", "O3", -1, AlertRule::Kind::Instant, 240.0, 1},
+        {"NO2 - poziom alarmowy", "NO2", -1, AlertRule::Kind::ConsecutiveHours, 400.0, 3},
+        {"SO2 - poziom alarmowy", "SO2", -1, AlertRule::Kind::ConsecutiveHours, 500.0, 3},
+    };
+}
+
+bool AlertEngine::loadRules(const QString& fileName, QList<AlertRule>& rules, QString* errorString)
+{
+    rules.clear();
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        if (errorString) *errorString = file.errorString();
+        return false;
+    }
+    QJsonParseError parseError;
+    const QJsonDocument doc = QJsonDocument::fromJson(file.readAll(), &parseError);
+    if (parseError.error != QJsonParseError::NoError || !doc.isArray()) {
+        if (errorString) *errorString = "Plik reguł musi zawierać tablicę JSON: " + parseError.errorString();
+        return false;
+    }
+    const int skipped = JsonDecoder::decodeArray(doc.array(), rules);
+    for (AlertRule& rule : rules) rule.hours = qMax(1, rule.hours);
+    if (skipped > 0) qWarning() << "AlertEngine: Pominięto" << skipped << "niepoprawnych reguł z" << fileName;
+    return true;
+}
+
+void AlertEngine::setRules(const QList<AlertRule>& newRules)
+{
+    ruleList = newRules;
+    reset();
+}
+
+QString AlertEngine::defaultLogFileName()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/alerts.log";
+}
+
+bool AlertEngine::setLogFile(const QString& fileName, QString* errorString)
+{
+    delete logFile;
+    logFile = nullptr;
+    if (fileName.isEmpty()) return true;
+
+    QDir().mkpath(QFileInfo(fileName).absolutePath());
+    logFile = new QFile(fileName);
+    if (!logFile->open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text)) {
+        if (errorString) *errorString = logFile->errorString();
+        qWarning() << "AlertEngine: Nie można otworzyć dziennika alarmów:" << fileName << logFile->errorString();
+        delete logFile;
+        logFile = nullptr;
+        return false;
+    }
+    return true;
+}
+
+void AlertEngine::reset()
+{
+    sensors.clear();
+    evaluated = 0;
+}
+
+int AlertEngine::activeAlertCount() const
+{
+    int count = 0;
+    for (const SensorState& sensor : sensors) {
+        for (const RuleState& state : sensor.rules) count += state.active ? 1 : 0;
+    }
+    return count;
+}
+
+bool AlertEngine::evaluate(RuleState& state, const AlertRule& rule, qint64 timeSecs, double value, double& compared)
+{
+    switch (rule.kind) {
+    case AlertRule::Kind::Instant:
+        compared = value;
+        return value >= rule.threshold;
+
+    case AlertRule::Kind::ConsecutiveHours:
+        // Przerwa w danych przerywa ciąg kolejnych godzin
+        if (state.lastHour > 0 && timeSecs - state.lastHour > 3600) state.consecutive = 0;
+        state.lastHour = timeSecs;
+        state.consecutive = value >= rule.threshold ? state.consecutive + 1 : 0;
+        compared = value;
+        return state.consecutive >= rule.hours;
+
+    case AlertRule::Kind::RollingAverage: {
+        state.windowTimes.append(timeSecs);
+        state.windowValues.append(value);
+        state.windowSum += value;
+        const qint64 windowStart = timeSecs - qint64(rule.hours) * 3600;
+        while (state.windowTimes.at(state.windowHead) <= windowStart) {
+            state.windowSum -= state.windowValues.at(state.windowHead);
+            ++state.windowHead;
+        }
+        // Zwolnienie usuniętych elementów co jakiś czas (koszt zamortyzowany O(1))
+        if (state.windowHead > 64 && state.windowHead * 2 > state.windowTimes.size()) {
+            state.windowTimes.remove(0, state.windowHead);
+            state.windowValues.remove(0, state.windowHead);
+            state.windowHead = 0;
+        }
+        const int count = int(state.windowTimes.size()) - state.windowHead;
+        compared = state.windowSum / count;
+        // Średnia uznawana, gdy okno zawiera co najmniej 75% odczytów godzinnych
+        return count * 4 >= rule.hours * 3 && compared >= rule.threshold;
+    }
+    }
+    return false;
+}
+
+int AlertEngine::ingest(const MeasurementData& data, int stationId)
+{
+    if (data.sensorId < 0 || ruleList.isEmpty()) return 0;
+    AQM_TRACE_SCOPE("AlertEngine::ingest", "analysis");
+
+    auto sensorIt = sensors.find(data.sensorId);
+    if (sensorIt == sensors.end()) {
+        SensorState created;
+        for (int i = 0; i < ruleList.size(); ++i) {
+            if (!ruleList.at(i).appliesTo(data.key, stationId)) continue;
+            RuleState state;
+            state.rule = i;
+            created.rules.append(state);
+        }
+        sensorIt = sensors.insert(data.sensorId, created);
+    }
+    SensorState& sensor = sensorIt.value();
+    if (sensor.rules.isEmpty()) return 0; // Żadna reguła nie dotyczy tego parametru
+
+    // Tylko odczyty nowsze niż ostatnio oceniony, bez końcowych null (mogą zostać uzupełnione)
+    const int last = lastValueIndex(data.values);
+    if (last < 0) return 0;
+    auto begin = data.values.cbegin();
+    const auto end = data.values.cbegin() + last + 1;
+    if (sensor.lastTime.isValid()) {
+        begin = std::upper_bound(begin, end, sensor.lastTime,
+                                 [](const QDateTime& date, const Measurement& m) { return date < m.date; });
+    }
+    if (begin == end) return 0;
+
+    const bool silent = !sensor.primed; // Historia przy pierwszym przyjęciu buduje tylko stan
+    int events = 0;
+    for (auto it = begin; it != end; ++it) {
+        if (!it->date.isValid()) continue;
+        const qint64 timeSecs = it->date.toSecsSinceEpoch();
+        ++evaluated;
+        const bool hasValue = it->isUsable(); // Odczyty oznaczone przez FaultDetector nie wywołują alarmów
+        const double value = hasValue ? it->value.toDouble() : 0.0;
+        for (RuleState& state : sensor.rules) {
+            const AlertRule& rule = ruleList.at(state.rule);
+            if (!hasValue) {
+                if (rule.kind == AlertRule::Kind::ConsecutiveHours) { state.consecutive = 0; state.lastHour = timeSecs; }
+                continue;
+            }
+            double compared = value;
+            const bool holds = evaluate(state, rule, timeSecs, value, compared);
+            if (holds == state.active) continue;
+            state.active = holds;
+            if (holds) { state.activeSince = it->date; state.activeValue = compared; }
+            if (silent) continue;
+            emitAlert(Alert{rule.name, data.sensorId, stationId, data.key, it->date, compared, rule.threshold, !holds});
+            ++events;
+        }
+    }
+    sensor.lastTime = data.values.at(last).date;
+
+    if (silent) {
+        sensor.primed = true;
+        for (const RuleState& state : sensor.rules) {
+            if (!state.active) continue;
+            const AlertRule& rule = ruleList.at(state.rule);
+            emitAlert(Alert{rule.name, data.sensorId, stationId, data.key, state.activeSince, state.activeValue, rule.threshold, false});
+            ++events;
+        }
+    }
+    if (events > 0 && logFile) logFile->flush();
+    return events;
+}
+
+void AlertEngine::emitAlert(const Alert& alert)
+{
+    if (logFile) {
+        QTextStream out(logFile);
+        out << QDateTime::currentDateTime().toString(Qt::ISODate) << '\t'
+            << (alert.cleared ? "USTĄPIENIE" : "ALARM") << '\t' << alert.ruleName << '\t'
+            << "stacja=" << alert.stationId << '\t' << "sensor=" << alert.sensorId << '\t' << alert.paramCode << '\t'
+            << alert.time.toString(Qt::ISODate) << '\t' << QString::number(alert.value, 'f', 1) << '\t'
+            << QString::number(alert.threshold, 'f', 1) << '\n';
+    }
+    qInfo() << "AlertEngine:" << (alert.cleared ? "Ustąpienie" : "Alarm") << alert.ruleName << "sensor" << alert.sensorId
+            << alert.time.toString(Qt::ISODate) << alert.value;
+    emit alertRaised(alert);
+}
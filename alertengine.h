@@ -0,0 +1,159 @@
+#ifndef ALERTENGINE_H
+#define ALERTENGINE_H
+
+#include <QObject>
+#include <QDateTime>
+#include <QHash>
+#include <QList>
+#include <QString>
+#include <QVector>
+#include "giosapiclient.h" // MeasurementData
+
+class QFile;
+
+/**
+ * @file alertengine.h
+ * @brief Definicja klasy AlertEngine - przyrostowej oceny progów alarmowych i informowania.
+ */
+
+/**
+ * @struct AlertRule
+ * @brief Reguła alarmowa dla parametru i/lub stacji.
+ */
+struct AlertRule {
+    /** @brief Rodzaj warunku. */
+    enum class Kind {
+        Instant,          ///< Pojedynczy odczyt >= progu.
+        RollingAverage,   ///< Średnia krocząca z ostatnich `hours` godzin >= progu (min. 75% odczytów).
+        ConsecutiveHours  ///< `hours` kolejnych godzinnych odczytów >= progu.
+    };
+
+    QString name;               ///< Nazwa reguły (np. "PM10 - poziom alarmowy").
+    QString paramCode;          ///< Kod parametru ("PM10"); pusty = każdy parametr.
+    int stationId = -1;         ///< ID stacji; -1 = każda stacja.
+    Kind kind = Kind::Instant;
+    double threshold = 0.0;     ///< Próg w jednostkach pomiaru (µg/m³).
+    int hours = 1;              ///< Okno średniej lub liczba kolejnych godzin.
+
+    /** @brief Czy reguła dotyczy sensora danego parametru na danej stacji. */
+    bool appliesTo(const QString& code, int station) const;
+};
+
+/**
+ * @struct Alert
+ * @brief Zdarzenie przekroczenia progu (lub jego ustąpienia).
+ */
+struct Alert {
+    QString ruleName;
+    int sensorId = -1;
+    int stationId = -1;
+    QString paramCode;
+    QDateTime time;             ///< Czas odczytu, który zmienił stan reguły.
+    double value = 0.0;         ///< Wartość porównywana z progiem (odczyt lub średnia).
+    double threshold = 0.0;
+    bool cleared = false;       ///< true = warunek przestał być spełniony.
+};
+
+/**
+ * @class AlertEngine
+ * @brief Ocenia reguły alarmowe przyrostowo, w miarę napływu nowych odczytów.
+ *
+ * Dla każdego sensora przechowywany jest czas ostatniego ocenionego odczytu oraz stan
+ * każdej pasującej reguły (okno średniej z bieżącą sumą, licznik kolejnych godzin,
+ * flaga aktywnego alarmu). ingest() pomija już ocenione odczyty wyszukiwaniem binarnym,
+ * więc koszt jest proporcjonalny do liczby nowych odczytów, a nie długości serii.
+ *
+ * Alarm jest zgłaszany przy przejściu reguły w stan przekroczenia, a jego ustąpienie
+ * przy powrocie poniżej progu. Przy pierwszym przyjęciu serii sensora historia buduje
+ * tylko stan - zgłaszany jest wyłącznie alarm aktywny na końcu serii.
+ *
+ * Zdarzenia trafiają do sygnału alertRaised() oraz (opcjonalnie) do pliku dziennika
+ * w formacie tekstowym rozdzielanym tabulatorami.
+ */
+class AlertEngine : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit AlertEngine(QObject *parent = nullptr);
+    ~AlertEngine();
+
+    /**
+     * @brief Progi informowania i alarmowe obowiązujące w Polsce (PM10, O3, NO2, SO2).
+     */
+    static QList<AlertRule> defaultRules();
+
+    /**
+     * @brief Wczytuje reguły z pliku JSON (tablica obiektów: name, param, station, kind, threshold, hours;
+     * kind: "instant" | "average" | "consecutive").
+     * @return true, jeśli plik miał poprawny format.
+     */
+    static bool loadRules(const QString& fileName, QList<AlertRule>& rules, QString* errorString = nullptr);
+
+    /** @brief Zastępuje reguły; stan wszystkich sensorów jest zerowany. */
+    void setRules(const QList<AlertRule>& newRules);
+    const QList<AlertRule>& rules() const { return ruleList; }
+
+    /**
+     * @brief Ustawia plik dziennika alarmów (dopisywanie). Pusta nazwa wyłącza zapis.
+     * @return false, jeśli pliku nie udało się otworzyć.
+     */
+    bool setLogFile(const QString& fileName, QString* errorString = nullptr);
+    /** @brief Domyślny plik dziennika w katalogu danych aplikacji (AppDataLocation). */
+    static QString defaultLogFileName();
+
+    /**
+     * @brief Ocenia odczyty sensora nowsze niż ostatnio ocenione.
+     * @param data Seria posortowana rosnąco po dacie (z ustawionym sensorId; serie bez ID są pomijane).
+     * @param stationId ID stacji sensora (-1, jeśli nieznane - pasują wtedy tylko reguły bez stacji).
+     * @return Liczba zgłoszonych zdarzeń.
+     */
+    int ingest(const MeasurementData& data, int stationId = -1);
+
+    /** @brief Zeruje stan wszystkich sensorów (np. po zmianie źródła danych). */
+    void reset();
+
+    /** @brief Liczba aktywnych alarmów we wszystkich sensorach. */
+    int activeAlertCount() const;
+    /** @brief Łączna liczba odczytów ocenionych od utworzenia/wyzerowania. */
+    quint64 evaluatedReadings() const { return evaluated; }
+
+signals:
+    /** @brief Emitowany dla każdego przekroczenia progu i jego ustąpienia. */
+    void alertRaised(const Alert& alert);
+
+private:
+    /** @brief Stan jednej reguły dla jednego sensora. */
+    struct RuleState {
+        int rule = -1;                     ///< Indeks w ruleList.
+        QVector<qint64> windowTimes;       ///< Czasy (s od epoki) odczytów w oknie średniej (bufor FIFO).
+        QVector<double> windowValues;
+        int windowHead = 0;                ///< Indeks najstarszego elementu okna.
+        double windowSum = 0.0;
+        int consecutive = 0;               ///< Kolejne godziny >= progu.
+        qint64 lastHour = 0;               ///< Czas ostatniego odczytu (s) dla ciągłości godzin.
+        bool active = false;               ///< Czy alarm jest aktywny.
+        QDateTime activeSince;             ///< Odczyt, który uaktywnił alarm.
+        double activeValue = 0.0;
+    };
+    struct SensorState {
+        QDateTime lastTime;                ///< Ostatni oceniony odczyt.
+        QVector<RuleState> rules;          ///< Stany reguł pasujących do sensora.
+        bool primed = false;               ///< Czy historia sensora została już przyjęta.
+    };
+
+    /**
+     * @brief Aktualizuje stan reguły odczytem.
+     * @param compared Wartość porównana z progiem (odczyt lub średnia).
+     * @return Czy warunek reguły jest spełniony.
+     */
+    static bool evaluate(RuleState& state, const AlertRule& rule, qint64 timeSecs, double value, double& compared);
+    void emitAlert(const Alert& alert);
+
+    QList<AlertRule> ruleList;
+    QHash<int, SensorState> sensors;       ///< ID sensora -> stan.
+    QFile *logFile = nullptr;
+    quint64 evaluated = 0;
+};
+
+#endif // ALERTENGINE_H
@@ -2,8 +2,6 @@
 #include <QNetworkRequest>
 #include <QThread> // Potrzebne dla QThread::currentThreadId()
 #include <QDebug>
-#include <algorithm> // Dla std::sort
-#include <QTimeZone>   // Potrzebne do parsowania daty
 
 ApiWorker::ApiWorker(QObject *parent) : QObject(parent)
 {
@@ -162,59 +160,16 @@ void ApiWorker::onFetchMeasurementDataFinished(QNetworkReply *reply)
     parseMeasurementDataJson(jsonData);
 }
 
-// --- Metody parsowania (kod przeniesiony z GiosApiClient) ---
+// --- Metody parsowania (wspólne dekodery GiosApiClient) ---
 
 void ApiWorker::parseStationsJson(const QByteArray& jsonData)
 {
     qDebug() << "ApiWorker: parseStationsJson in thread:" << QThread::currentThreadId();
-    QJsonParseError parseError;
-    QJsonDocument jsonDoc = QJsonDocument::fromJson(jsonData, &parseError);
-
-    if (parseError.error != QJsonParseError::NoError) {
-        QString errorMsg = "Błąd parsowania JSON stacji (Worker): " + parseError.errorString();
-        qWarning() << errorMsg; emit errorOccurred(errorMsg); return;
-    }
-    if (!jsonDoc.isArray()) {
-        QString errorMsg = "Błąd formatu JSON stacji (Worker): Oczekiwano tablicy.";
-        qWarning() << errorMsg; emit errorOccurred(errorMsg); return;
-    }
-
     QList<StationInfo> stationsList;
-    QJsonArray stationsArray = jsonDoc.array();
-    stationsList.reserve(stationsArray.count()); // Prealokacja
-
-    for (const QJsonValue &value : stationsArray) {
-        if (value.isObject()) {
-            QJsonObject stationObj = value.toObject();
-            StationInfo station;
-
-            if (stationObj.contains("id") && stationObj["id"].isDouble()) {
-                station.id = static_cast<int>(stationObj["id"].toDouble());
-            } else {
-                qWarning() << "ApiWorker: Skipping station due to missing/invalid 'id'"; continue;
-            }
-
-            if (stationObj.contains("stationName") && stationObj["stationName"].isString()) {
-                station.stationName = stationObj["stationName"].toString();
-            } else {
-                qWarning() << "ApiWorker: Missing/invalid 'stationName' for station id:" << station.id;
-                station.stationName = QString("Stacja bez nazwy (ID: %1)").arg(station.id);
-            }
-
-            // Odczytaj cityName (zakładając, że pole dodano do StationInfo)
-            if (stationObj.contains("city") && stationObj["city"].isObject()) {
-                QJsonObject cityObj = stationObj["city"].toObject();
-                if (cityObj.contains("name") && cityObj["name"].isString()) {
-                    station.cityName = cityObj["name"].toString();
-                } else { station.cityName = "Nieznane"; }
-            } else { station.cityName = "Nieznane"; }
-
-            stationsList.append(station);
-        } else {
-            qWarning() << "ApiWorker: Skipping non-object item in stations array.";
-        }
+    QString errorMsg;
+    if (!GiosApiClient::decodeStations(jsonData, stationsList, &errorMsg)) {
+        qWarning() << errorMsg; emit errorOccurred(errorMsg + " (Worker)"); return;
     }
-
     qDebug() << "ApiWorker: Emitting stationsReady signal with" << stationsList.count() << "stations.";
     emit stationsReady(stationsList); // Emituj wynik
 }
@@ -222,55 +177,11 @@ void ApiWorker::parseStationsJson(const QByteArray& jsonData)
 void ApiWorker::parseSensorsJson(const QByteArray& jsonData, int stationId)
 {
     qDebug() << "ApiWorker: parseSensorsJson for station" << stationId << "in thread:" << QThread::currentThreadId();
-    QJsonParseError parseError;
-    QJsonDocument jsonDoc = QJsonDocument::fromJson(jsonData, &parseError);
-
-    if (parseError.error != QJsonParseError::NoError) {
-        QString errorMsg = "Błąd parsowania JSON sensorów (Worker): " + parseError.errorString();
-        qWarning() << errorMsg; emit errorOccurred(errorMsg); return;
-    }
-    if (!jsonDoc.isArray()) {
-        if (jsonDoc.isNull() || (jsonDoc.isArray() && jsonDoc.array().isEmpty())) {
-            qDebug() << "ApiWorker: Emitting sensorsReady signal with 0 sensors (empty array) for station" << stationId;
-            emit sensorsReady({}); return;
-        } else {
-            QString errorMsg = "Błąd formatu JSON sensorów (Worker): Oczekiwano tablicy.";
-            qWarning() << errorMsg << "Received:" << jsonData.left(100); emit errorOccurred(errorMsg); return;
-        }
-    }
-
     QList<SensorInfo> sensorsList;
-    QJsonArray sensorsArray = jsonDoc.array();
-    sensorsList.reserve(sensorsArray.count());
-
-    for (const QJsonValue &value : sensorsArray) {
-        if (value.isObject()) {
-            QJsonObject sensorObj = value.toObject();
-            SensorInfo sensor;
-            sensor.stationId = stationId;
-
-            if (sensorObj.contains("id") && sensorObj["id"].isDouble()) {
-                sensor.id = static_cast<int>(sensorObj["id"].toDouble());
-            } else {
-                qWarning() << "ApiWorker: Skipping sensor due to missing/invalid 'id' for station" << stationId; continue;
-            }
-
-            if (sensorObj.contains("param") && sensorObj["param"].isObject()) {
-                QJsonObject paramObj = sensorObj["param"].toObject();
-                sensor.paramName = paramObj.value("paramName").toString("Brak nazwy");
-                sensor.paramFormula = paramObj.value("paramFormula").toString("?");
-                sensor.paramCode = paramObj.value("paramCode").toString("Brak kodu");
-                sensor.idParam = static_cast<int>(paramObj.value("idParam").toDouble(-1.0)); // Domyślnie -1
-            } else {
-                qWarning() << "ApiWorker: Missing/invalid 'param' object for sensor id:" << sensor.id;
-                sensor.paramName = "Brak danych"; sensor.paramFormula = "?"; sensor.paramCode = "ERROR"; sensor.idParam = -1;
-            }
-            sensorsList.append(sensor);
-        } else {
-            qWarning() << "ApiWorker: Skipping non-object item in sensors array for station" << stationId;
-        }
+    QString errorMsg;
+    if (!GiosApiClient::decodeSensors(jsonData, stationId, sensorsList, &errorMsg)) {
+        qWarning() << errorMsg; emit errorOccurred(errorMsg + " (Worker)"); return;
     }
-
     qDebug() << "ApiWorker: Emitting sensorsReady signal with" << sensorsList.count() << "sensors for station" << stationId;
     emit sensorsReady(sensorsList); // Emituj wynik
 }
@@ -278,66 +189,11 @@ void ApiWorker::parseSensorsJson(const QByteArray& jsonData, int stationId)
 void ApiWorker::parseMeasurementDataJson(const QByteArray& jsonData)
 {
     qDebug() << "ApiWorker: parseMeasurementDataJson in thread:" << QThread::currentThreadId();
-    QJsonParseError parseError;
-    QJsonDocument jsonDoc = QJsonDocument::fromJson(jsonData, &parseError);
-
-    if (parseError.error != QJsonParseError::NoError) {
-        QString errorMsg = "Błąd parsowania JSON danych (Worker): " + parseError.errorString();
-        qWarning() << errorMsg; emit errorOccurred(errorMsg); return;
-    }
-    if (!jsonDoc.isObject()) {
-        QString errorMsg = "Błąd formatu JSON danych (Worker): Oczekiwano obiektu.";
-        qWarning() << errorMsg; emit errorOccurred(errorMsg); return;
-    }
-
-    QJsonObject mainObj = jsonDoc.object();
-    MeasurementData measurementData;
-
-    measurementData.key = mainObj.value("key").toString("Nieznany");
-    if (measurementData.key == "Nieznany") {
-        qWarning() << "ApiWorker: Missing/invalid 'key' in measurement data.";
-    }
-
-    if (mainObj.contains("values") && mainObj["values"].isArray()) {
-        QJsonArray valuesArray = mainObj["values"].toArray();
-        measurementData.values.reserve(valuesArray.count());
-
-        for (const QJsonValue &value : valuesArray) {
-            if (value.isObject()) {
-                QJsonObject mObj = value.toObject();
-                Measurement m;
-
-                if (mObj.contains("date") && mObj["date"].isString()) {
-                    // Użyj formatu oczekiwanego przez API
-                    m.date = QDateTime::fromString(mObj["date"].toString(), "yyyy-MM-dd HH:mm:ss");
-                    if (!m.date.isValid()) {
-                        qWarning() << "ApiWorker: Skipping measurement due to invalid date format:" << mObj["date"].toString(); continue;
-                    }
-                } else { continue; }
-
-                if (mObj.contains("value")) {
-                    if (mObj["value"].isNull()) { m.value = QVariant(); }
-                    else if (mObj["value"].isDouble()) { m.value = mObj["value"].toDouble(); }
-                    else { m.value = QVariant(); } // Traktuj inne typy jako null
-                } else { continue; }
-
-                measurementData.values.append(m);
-            } else {
-                qWarning() << "ApiWorker: Skipping non-object item in 'values' array for key" << measurementData.key;
-            }
-        }
-
-        if (!measurementData.values.isEmpty()) {
-            qDebug() << "ApiWorker: Sorting" << measurementData.values.count() << "measurements by date for key" << measurementData.key;
-            std::sort(measurementData.values.begin(), measurementData.values.end(),
-                      [](const Measurement& a, const Measurement& b) { return a.date < b.date; });
-        }
-
-    } else {
-        qWarning() << "ApiWorker: Missing or invalid 'values' array in measurement data for key" << measurementData.key;
-        // Emituj puste dane, jeśli nie ma tablicy 'values'
+    const QSharedPointer<MeasurementData> measurementData = QSharedPointer<MeasurementData>::create();
+    QString errorMsg;
+    if (!GiosApiClient::decodeMeasurementData(jsonData, *measurementData, &errorMsg)) {
+        qWarning() << errorMsg; emit errorOccurred(errorMsg + " (Worker)"); return;
     }
-
-    qDebug() << "ApiWorker: Emitting measurementDataReady signal for key" << measurementData.key << "with" << measurementData.values.count() << "values.";
-    emit measurementDataReady(measurementData); // Emituj wynik (nawet jeśli pusty)
+    qDebug() << "ApiWorker: Emitting measurementDataReady signal for key" << measurementData->key << "with" << measurementData->values.count() << "values.";
+    emit measurementDataReady(measurementData); // Emituj wynik
 }
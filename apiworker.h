@@ -13,31 +13,7 @@
 #include <QJsonParseError>
 #include <QVariant>
 #include <QDateTime>
-
-struct StationInfo {
-    int id;
-    QString stationName;
-    QString cityName;
-};
-
-struct SensorInfo {
-    int id;
-    int stationId;
-    QString paramName;
-    QString paramFormula;
-    QString paramCode;
-    int idParam;
-};
-
-struct Measurement {
-    QDateTime date;
-    QVariant value;
-};
-
-struct MeasurementData {
-    QString key;
-    QList<Measurement> values;
-};
+#include "giosapiclient.h" // Wspólne struktury danych i dekodery JSON
 
 class ApiWorker : public QObject
 {
@@ -57,7 +33,7 @@ signals:
     // Sygnały emitowane z wątku pracownika do wątku głównego z wynikami
     void stationsReady(const QList<StationInfo>& stations);
     void sensorsReady(const QList<SensorInfo>& sensors);
-    void measurementDataReady(const MeasurementData& data);
+    void measurementDataReady(const MeasurementDataPtr& data); // Połączenie kolejkowane kopiuje tylko wskaźnik
     void errorOccurred(const QString& errorString); // Sygnał błędu
 
 private slots:
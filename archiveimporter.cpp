@@ -0,0 +1,508 @@
+#include "archiveimporter.h"
+#include "giosapiclient.h"
+#include "historystore.h"
+#include "stationcatalog.h"
+#include "tracing.h"
+
+#include <QDate>
+#include <QDebug>
+#include <QFile>
+#include <QFileInfo>
+#include <QRegularExpression>
+#include <QSet>
+#include <QThreadPool>
+#include <QVarLengthArray>
+#include <QtConcurrent/QtConcurrentMap>
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+/** @brief Pole wiersza CSV - wskazanie do treści pliku (bez kopiowania). */
+struct Field {
+    const char* text = nullptr;
+    qsizetype length = 0;
+};
+using Fields = QVarLengthArray<Field, 256>;
+
+/** @brief Fragment danych [begin, end), zaczynający się i kończący na granicy wiersza. */
+struct Chunk {
+    const char* begin = nullptr;
+    const char* end = nullptr;
+};
+
+/** @brief Wynik parsowania fragmentu; indeksy wierszy liczone od początku fragmentu. */
+struct ChunkResult {
+    QVector<qint64> times;
+    QVector<QVector<ArchiveImporter::Reading>> readings;
+    int skippedRows = 0;
+};
+
+/** @brief Rodzaj wiersza nagłówka, rozpoznany po etykiecie w pierwszej kolumnie. */
+enum class HeaderRow { Other, StationCode, Param, Averaging, PositionCode };
+
+const char* lineEnd(const char* p, const char* end)
+{
+    const char* eol = static_cast<const char*>(std::memchr(p, '\n', size_t(end - p)));
+    return eol ? eol : end;
+}
+
+Field trimmed(Field field)
+{
+    while (field.length > 0 && (*field.text == ' ' || *field.text == '\t')) { ++field.text; --field.length; }
+    while (field.length > 0 && (field.text[field.length - 1] == ' ' || field.text[field.length - 1] == '\t')) --field.length;
+    return field;
+}
+
+/**
+ * @brief Dzieli wiersz [begin, end) na pola. Cudzysłowy otaczające pole są pomijane
+ * (separator wewnątrz cudzysłowu nie dzieli pola, np. "12,5" przy separatorze ',').
+ */
+void splitFields(const char* begin, const char* end, char separator, Fields& fields)
+{
+    fields.clear();
+    if (end > begin && end[-1] == '\r') --end;
+    const char* p = begin;
+    for (;;) {
+        Field field;
+        if (p < end && *p == '"') {
+            const char* close = p + 1;
+            while (close < end && !(*close == '"' && (close + 1 == end || close[1] == separator))) ++close;
+            field.text = p + 1;
+            field.length = close - field.text;
+            p = close < end ? close + 1 : end;
+        } else {
+            const char* stop = static_cast<const char*>(std::memchr(p, separator, size_t(end - p)));
+            if (!stop) stop = end;
+            field.text = p;
+            field.length = stop - p;
+            p = stop;
+        }
+        fields.append(field);
+        if (p >= end) break;
+        ++p; // Separator
+    }
+}
+
+bool readInt(const char*& p, const char* end, int maxDigits, int& value)
+{
+    value = 0;
+    int digits = 0;
+    while (p < end && digits < maxDigits && *p >= '0' && *p <= '9') {
+        value = value * 10 + (*p - '0');
+        ++p;
+        ++digits;
+    }
+    return digits > 0;
+}
+
+/** @brief Liczba z kropką lub przecinkiem dziesiętnym; pusta komórka = brak odczytu. */
+bool parseValue(Field field, double& value)
+{
+    static const double powers[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9,
+                                     1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18};
+    field = trimmed(field);
+    if (field.length == 0) return false;
+    const char* p = field.text;
+    const char* end = p + field.length;
+    const bool negative = *p == '-';
+    if (*p == '-' || *p == '+') ++p;
+
+    qint64 mantissa = 0;
+    int digits = 0;
+    int scale = 0;
+    bool fraction = false;
+    for (; p < end; ++p) {
+        if (*p >= '0' && *p <= '9') {
+            if (digits == 18) break; // Zbyt długa liczba - ścieżka ogólna
+            mantissa = mantissa * 10 + (*p - '0');
+            ++digits;
+            if (fraction) ++scale;
+        } else if ((*p == '.' || *p == ',') && !fraction) {
+            fraction = true;
+        } else {
+            break;
+        }
+    }
+    if (p != end) {
+        // Zapis wykładniczy i inne rzadkie postacie
+        bool ok = false;
+        value = QByteArray(field.text, field.length).replace(',', '.').toDouble(&ok);
+        return ok;
+    }
+    if (digits == 0) return false;
+    value = double(mantissa) / powers[scale];
+    if (negative) value = -value;
+    return true;
+}
+
+HeaderRow headerKind(Field label)
+{
+    const QByteArray text = QByteArray(label.text, label.length).trimmed().toLower();
+    // Porównanie tylko części ASCII etykiet - arkusze bywają zapisane w UTF-8 lub Windows-1250
+    if (text.startsWith("kod stacji")) return HeaderRow::StationCode;
+    if (text.startsWith("kod stanowiska")) return HeaderRow::PositionCode;
+    if (text.startsWith("wska")) return HeaderRow::Param;
+    if (text.startsWith("czas u")) return HeaderRow::Averaging;
+    return HeaderRow::Other;
+}
+
+char detectSeparator(const char* begin, const char* end)
+{
+    const qsizetype semicolons = std::count(begin, end, ';');
+    const qsizetype tabs = std::count(begin, end, '\t');
+    if (semicolons > 0 && semicolons >= tabs) return ';';
+    return tabs > 0 ? '\t' : ',';
+}
+
+const char* skipBom(const char* data, qsizetype size)
+{
+    return size >= 3 && std::memcmp(data, "\xEF\xBB\xBF", 3) == 0 ? data + 3 : data;
+}
+
+ChunkResult parseChunk(const Chunk& chunk, char separator, int columnCount)
+{
+    ChunkResult result;
+    result.readings.resize(columnCount);
+    Fields fields;
+    for (const char* p = chunk.begin; p < chunk.end;) {
+        const char* eol = lineEnd(p, chunk.end);
+        splitFields(p, eol, separator, fields);
+        p = eol < chunk.end ? eol + 1 : chunk.end;
+
+        qint64 time = 0;
+        const Field first = trimmed(fields.at(0));
+        if (first.length == 0) continue; // Pusty wiersz (także same separatory)
+        if (!ArchiveImporter::parseArchiveTime(first.text, first.length, time)) {
+            ++result.skippedRows;
+            continue;
+        }
+        const qint32 row = qint32(result.times.size());
+        result.times.append(time);
+        const int count = qMin(columnCount, int(fields.size()) - 1);
+        for (int c = 0; c < count; ++c) {
+            double value = 0.0;
+            if (parseValue(fields.at(c + 1), value)) result.readings[c].append(ArchiveImporter::Reading{row, value});
+        }
+    }
+    return result;
+}
+
+/** @brief Nazwa stacji do porównań: małe litery i cyfry, bez interpunkcji i skrótów "ul.", "al." itp. */
+QString normalizedStationName(const QString& name)
+{
+    static const QRegularExpression separators("[^\\p{L}\\p{N}]+");
+    static const QSet<QString> skipped = {"ul", "al", "os", "pl"};
+    QString result;
+    const QStringList tokens = name.toLower().split(separators, Qt::SkipEmptyParts);
+    for (const QString& token : tokens) {
+        if (!skipped.contains(token)) result += token;
+    }
+    return result;
+}
+
+QStringList fieldStrings(const Fields& fields, int from)
+{
+    QStringList values;
+    values.reserve(fields.size());
+    for (int i = from; i < fields.size(); ++i) values.append(QString::fromUtf8(fields.at(i).text, fields.at(i).length).trimmed());
+    return values;
+}
+
+} // namespace
+
+bool ArchiveImporter::parseArchiveTime(const char* text, qsizetype length, qint64& msecs)
+{
+    const Field field = trimmed(Field{text, length});
+    const char* p = field.text;
+    const char* end = p + field.length;
+    int first = 0, month = 0, last = 0, hour = 0, minute = 0, second = 0;
+    if (!readInt(p, end, 4, first) || p == end) return false;
+    const char dateSeparator = *p++;
+    if (dateSeparator != '-' && dateSeparator != '.') return false;
+    if (!readInt(p, end, 2, month) || p == end || *p++ != dateSeparator) return false;
+    if (!readInt(p, end, 4, last) || p == end || (*p != ' ' && *p != 'T')) return false;
+    ++p;
+    if (!readInt(p, end, 2, hour) || p == end || *p++ != ':' || !readInt(p, end, 2, minute)) return false;
+    if (p < end && *p == ':') {
+        ++p;
+        if (!readInt(p, end, 2, second)) return false;
+    }
+
+    // "yyyy-MM-dd" lub "dd.MM.yyyy"
+    const QDate date = dateSeparator == '-' ? QDate(first, month, last) : QDate(last, month, first);
+    if (!date.isValid() || hour > 24 || minute > 59 || second > 59) return false;
+    constexpr qint64 unixEpochJulianDay = 2440588;
+    constexpr qint64 archiveUtcOffsetSecs = 3600;
+    msecs = ((date.toJulianDay() - unixEpochJulianDay) * 86400 + hour * 3600 + minute * 60 + second - archiveUtcOffsetSecs) * 1000;
+    return true;
+}
+
+bool ArchiveImporter::parseTable(const char* data, qsizetype size, const QString& nameHint, Table& table, QString* errorString)
+{
+    AQM_TRACE_SCOPE("ArchiveImporter::parseTable", "parse");
+    table = Table();
+    const char* end = data + size;
+    const char* p = skipBom(data, size);
+    const char separator = detectSeparator(p, lineEnd(p, end));
+
+    // Nagłówek: wiersze do pierwszego wiersza z datą w pierwszej kolumnie
+    QStringList codes, params, averagings, positions, firstRow;
+    const char* dataStart = nullptr;
+    Fields fields;
+    while (p < end) {
+        const char* eol = lineEnd(p, end);
+        splitFields(p, eol, separator, fields);
+        const Field label = trimmed(fields.at(0));
+        qint64 time = 0;
+        if (fields.size() > 1 && parseArchiveTime(label.text, label.length, time)) {
+            dataStart = p;
+            break;
+        }
+        switch (headerKind(label)) {
+        case HeaderRow::StationCode: codes = fieldStrings(fields, 1); break;
+        case HeaderRow::Param: params = fieldStrings(fields, 1); break;
+        case HeaderRow::Averaging: averagings = fieldStrings(fields, 1); break;
+        case HeaderRow::PositionCode: positions = fieldStrings(fields, 1); break;
+        case HeaderRow::Other:
+            if (firstRow.isEmpty() && fields.size() > 1) firstRow = fieldStrings(fields, 1);
+            break;
+        }
+        p = eol < end ? eol + 1 : end;
+    }
+    if (!dataStart) {
+        if (errorString) *errorString = "Nie znaleziono wierszy danych (data w pierwszej kolumnie).";
+        return false;
+    }
+    if (codes.isEmpty()) codes = positions.isEmpty() ? firstRow : positions;
+    while (!codes.isEmpty() && codes.last().isEmpty()) codes.removeLast();
+    if (codes.isEmpty()) {
+        if (errorString) *errorString = "Nie rozpoznano nagłówka z kodami stacji.";
+        return false;
+    }
+
+    // Nazwa pliku archiwum: rok_wskaźnik_czas (np. "2019_PM2.5_1g")
+    const QStringList nameParts = QFileInfo(nameHint).completeBaseName().split('_');
+    const QString nameParam = nameParts.value(1);
+    const QString nameAveraging = nameParts.value(2);
+    for (int c = 0; c < codes.size(); ++c) {
+        Column column;
+        column.stationCode = codes.at(c);
+        column.paramCode = params.value(c);
+        column.averaging = averagings.value(c);
+        // Kod stanowiska: stacja-wskaźnik-czas (np. "DsWrocAlWisn-PM10-1g")
+        const QStringList position = positions.value(c).split('-');
+        if (position.size() >= 3) {
+            if (column.stationCode == positions.value(c)) column.stationCode = position.first();
+            if (column.paramCode.isEmpty()) column.paramCode = position.mid(1, position.size() - 2).join('-');
+            if (column.averaging.isEmpty()) column.averaging = position.last();
+        }
+        if (column.paramCode.isEmpty()) column.paramCode = nameParam;
+        if (column.averaging.isEmpty()) column.averaging = nameAveraging;
+        table.columns.append(column);
+    }
+
+    // Fragmenty na granicach wierszy, kilka na wątek (wyrównanie nierównych fragmentów)
+    const int threads = qMax(1, QThreadPool::globalInstance()->maxThreadCount());
+    const qsizetype chunkSize = qMax<qsizetype>(256 * 1024, (end - dataStart) / (threads * 4) + 1);
+    QVector<Chunk> chunks;
+    for (const char* begin = dataStart; begin < end;) {
+        const char* chunkEnd = begin + qMin(chunkSize, qsizetype(end - begin));
+        if (chunkEnd < end) {
+            const char* eol = lineEnd(chunkEnd, end);
+            chunkEnd = eol < end ? eol + 1 : end;
+        }
+        chunks.append(Chunk{begin, chunkEnd});
+        begin = chunkEnd;
+    }
+    const int columnCount = int(codes.size());
+    const QList<ChunkResult> parts = QtConcurrent::blockingMapped<QList<ChunkResult>>(
+        chunks, [separator, columnCount](const Chunk& chunk) { return parseChunk(chunk, separator, columnCount); });
+
+    // Łączenie fragmentów w kolejności pliku (przesunięcie indeksów wierszy)
+    qsizetype rows = 0;
+    QVector<qsizetype> readingCounts(columnCount, 0);
+    for (const ChunkResult& part : parts) {
+        rows += part.times.size();
+        for (int c = 0; c < columnCount; ++c) readingCounts[c] += part.readings.at(c).size();
+    }
+    table.times.reserve(rows);
+    table.readings.resize(columnCount);
+    for (int c = 0; c < columnCount; ++c) table.readings[c].reserve(readingCounts.at(c));
+    for (const ChunkResult& part : parts) {
+        const qint32 offset = qint32(table.times.size());
+        table.times.append(part.times);
+        table.skippedRows += part.skippedRows;
+        for (int c = 0; c < columnCount; ++c) {
+            QVector<Reading>& target = table.readings[c];
+            for (const Reading& reading : part.readings.at(c)) target.append(Reading{reading.row + offset, reading.value});
+        }
+    }
+    if (errorString) errorString->clear();
+    return true;
+}
+
+bool ArchiveImporter::parseFile(const QString& fileName, Table& table, QString* errorString)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        if (errorString) *errorString = file.errorString();
+        return false;
+    }
+    const qint64 size = file.size();
+    if (size <= 0) {
+        if (errorString) *errorString = "Pusty plik.";
+        return false;
+    }
+    if (uchar* mapped = file.map(0, size)) {
+        const bool ok = parseTable(reinterpret_cast<const char*>(mapped), size, fileName, table, errorString);
+        file.unmap(mapped);
+        return ok;
+    }
+    const QByteArray content = file.readAll(); // System plików bez mapowania
+    return parseTable(content.constData(), content.size(), fileName, table, errorString);
+}
+
+int ArchiveImporter::loadStationCodes(const QString& fileName, const StationCatalog& catalog, QString* errorString)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        if (errorString) *errorString = file.errorString();
+        return -1;
+    }
+    const QByteArray content = file.readAll();
+    const char* end = content.constData() + content.size();
+    const char* p = skipBom(content.constData(), content.size());
+    const char separator = detectSeparator(p, lineEnd(p, end));
+
+    QHash<QString, int> stationsByName;
+    for (int i = 0; i < catalog.stationCount(); ++i) stationsByName.insert(normalizedStationName(catalog.stationName(i)), catalog.stationId(i));
+
+    static const QRegularExpression codeSeparators("[,\\s]+");
+    int codeColumn = -1, nameColumn = -1, oldCodeColumn = -1;
+    int mapped = 0;
+    Fields fields;
+    while (p < end) {
+        const char* eol = lineEnd(p, end);
+        splitFields(p, eol, separator, fields);
+        p = eol < end ? eol + 1 : end;
+        const QStringList values = fieldStrings(fields, 0);
+
+        if (codeColumn < 0 || nameColumn < 0) {
+            for (int i = 0; i < values.size(); ++i) {
+                const QString label = values.at(i).toLower();
+                if (label == QLatin1String("kod stacji")) codeColumn = i;
+                else if (label == QLatin1String("nazwa stacji")) nameColumn = i;
+                else if (label.startsWith(QLatin1String("stary kod"))) oldCodeColumn = i;
+            }
+            if (codeColumn >= 0 && nameColumn >= 0) continue; // Wiersz nagłówka metadanych
+            codeColumn = nameColumn = oldCodeColumn = -1;
+
+            // Plik "kod;ID stacji"
+            bool isId = false;
+            const int stationId = values.value(1).toInt(&isId);
+            if (isId && !values.first().isEmpty() && catalog.indexOfStation(stationId) >= 0) {
+                stationCodes.insert(values.first(), stationId);
+                ++mapped;
+            }
+            continue;
+        }
+
+        const int stationId = stationsByName.value(normalizedStationName(values.value(nameColumn)), -1);
+        if (stationId < 0 || values.value(codeColumn).isEmpty()) continue;
+        stationCodes.insert(values.value(codeColumn), stationId);
+        ++mapped;
+        // Archiwa z wcześniejszych lat używają starych kodów stacji
+        for (const QString& oldCode : values.value(oldCodeColumn).split(codeSeparators, Qt::SkipEmptyParts))
+            stationCodes.insert(oldCode, stationId);
+    }
+    if (errorString) errorString->clear();
+    qDebug() << "ArchiveImporter: Zmapowano" << mapped << "kodów stacji z" << fileName;
+    return mapped;
+}
+
+ArchiveImporter::Result ArchiveImporter::importFiles(const QStringList& fileNames, const StationCatalog& catalog,
+                                                     HistoryStore& history) const
+{
+    AQM_TRACE_SCOPE("ArchiveImporter::importFiles", "io");
+    struct SensorMatch {
+        int id = -1;
+        QString paramCode;
+    };
+    QHash<QString, SensorMatch> sensorCache; // "ID stacji/wskaźnik" -> sensor katalogu
+    QSet<QString> unmapped;
+    Result result;
+
+    for (const QString& fileName : fileNames) {
+        Table table;
+        QString error;
+        if (!parseFile(fileName, table, &error)) {
+            result.errors.append(QString("%1: %2").arg(QFileInfo(fileName).fileName(), error));
+            continue;
+        }
+        ++result.files;
+        result.columns += int(table.columns.size());
+        const bool sorted = std::is_sorted(table.times.cbegin(), table.times.cend());
+
+        QVector<QDateTime> rowDates; // Tworzone raz na plik, wspólne dla wszystkich kolumn
+        bool skippedFile = false;
+        for (int c = 0; c < table.columns.size(); ++c) {
+            const Column& column = table.columns.at(c);
+            if (!column.averaging.isEmpty() && column.averaging.compare(QLatin1String("1g"), Qt::CaseInsensitive) != 0) {
+                skippedFile = true; // Średnie dobowe itp. nie pasują do serii godzinnych API
+                continue;
+            }
+            const QVector<Reading>& readings = table.readings.at(c);
+            if (column.stationCode.isEmpty() || readings.isEmpty()) continue;
+            const int stationId = stationCodes.value(column.stationCode, -1);
+            if (stationId < 0) {
+                unmapped.insert(column.stationCode);
+                continue;
+            }
+
+            const QString cacheKey = QString("%1/%2").arg(stationId).arg(column.paramCode.toUpper());
+            auto match = sensorCache.find(cacheKey);
+            if (match == sensorCache.end()) {
+                SensorMatch found;
+                for (const SensorInfo& sensor : catalog.sensorsForStation(stationId)) {
+                    if (sensor.paramCode.compare(column.paramCode, Qt::CaseInsensitive) == 0
+                        || sensor.paramFormula.compare(column.paramCode, Qt::CaseInsensitive) == 0) {
+                        found = SensorMatch{sensor.id, sensor.paramCode};
+                        break;
+                    }
+                }
+                match = sensorCache.insert(cacheKey, found);
+            }
+            if (match->id < 0) {
+                unmapped.insert(column.stationCode + '/' + column.paramCode);
+                continue;
+            }
+
+            if (rowDates.isEmpty()) {
+                rowDates.reserve(table.times.size());
+                for (qint64 time : table.times) rowDates.append(QDateTime::fromMSecsSinceEpoch(time));
+            }
+            QSharedPointer<MeasurementData> data = QSharedPointer<MeasurementData>::create();
+            data->key = match->paramCode;
+            data->sensorId = match->id;
+            data->values.reserve(readings.size());
+            for (const Reading& reading : readings) data->values.append(Measurement{rowDates.at(reading.row), reading.value});
+            if (!sorted) {
+                std::stable_sort(data->values.begin(), data->values.end(),
+                                 [](const Measurement& a, const Measurement& b) { return a.date < b.date; });
+            }
+            history.merge(data);
+            if (!result.sensorIds.contains(data->sensorId)) result.sensorIds.append(data->sensorId);
+            ++result.importedSeries;
+            result.readings += readings.size();
+        }
+        if (skippedFile) result.skippedFiles.append(QFileInfo(fileName).fileName());
+    }
+
+    result.unmappedColumns = QStringList(unmapped.cbegin(), unmapped.cend());
+    result.unmappedColumns.sort();
+    qDebug() << "ArchiveImporter: Plików:" << result.files << "serii:" << result.importedSeries << "/" << result.columns
+             << "odczytów:" << result.readings << "bez sensora:" << result.unmappedColumns.size();
+    return result;
+}
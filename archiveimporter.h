@@ -0,0 +1,120 @@
+#ifndef ARCHIVEIMPORTER_H
+#define ARCHIVEIMPORTER_H
+
+#include <QHash>
+#include <QList>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+class HistoryStore;
+class StationCatalog;
+
+/**
+ * @file archiveimporter.h
+ * @brief Definicja klasy ArchiveImporter - importu rocznych archiwów pomiarów GIOŚ.
+ */
+
+/**
+ * @class ArchiveImporter
+ * @brief Wczytuje roczne tabele archiwalne GIOŚ (jeden plik na wskaźnik i czas uśredniania,
+ * jedna kolumna na stację) i dołącza je do historii jako serie sensorów aplikacji.
+ *
+ * Obsługiwane są arkusze archiwum zapisane jako CSV (separator `;`, `,` lub tabulator,
+ * przecinek lub kropka dziesiętna). Nagłówek rozpoznawany jest po etykietach w pierwszej
+ * kolumnie ("Kod stacji", "Wskaźnik", "Czas uśredniania", "Kod stanowiska"); brakujący
+ * wskaźnik i czas uśredniania są odczytywane z nazwy pliku (np. `2019_PM10_1g.csv`).
+ *
+ * Plik jest mapowany do pamięci i dzielony na fragmenty na granicach wierszy, które
+ * są parsowane równolegle (QtConcurrent) do zwartych tablic (czas wiersza + wartości
+ * kolumn); tekst pliku nie jest kopiowany ani zamieniany na napisy.
+ *
+ * Kody stacji archiwum są mapowane na ID stacji API przez plik metadanych stacji GIOŚ
+ * (kolumny "Kod stacji", "Nazwa stacji", opcjonalnie "Stary Kod stacji" - dopasowanie po nazwie)
+ * lub prosty plik `kod;ID stacji`. Sensor wybierany jest spośród znanych sensorów stacji
+ * po kodzie parametru. Importowane są tylko serie godzinne ("1g").
+ */
+class ArchiveImporter
+{
+public:
+    /** @brief Opis kolumny tabeli archiwum. */
+    struct Column {
+        QString stationCode;        ///< Kod stacji (np. "DsWrocAlWisn").
+        QString paramCode;          ///< Wskaźnik (np. "PM10").
+        QString averaging;          ///< Czas uśredniania (np. "1g", "24g"); pusty = nieznany.
+    };
+
+    /** @brief Odczyt jednej kolumny: indeks wiersza tabeli i wartość. */
+    struct Reading {
+        qint32 row = 0;
+        double value = 0.0;
+    };
+
+    /** @brief Sparsowana tabela: czasy wierszy i odczyty każdej kolumny (puste komórki pominięte). */
+    struct Table {
+        QList<Column> columns;
+        QVector<qint64> times;                  ///< Czas wiersza (ms od epoki, UTC).
+        QVector<QVector<Reading>> readings;     ///< Odczyty kolumn, rosnąco po wierszu.
+        int skippedRows = 0;                    ///< Wiersze danych bez poprawnej daty.
+    };
+
+    /** @brief Podsumowanie importu. */
+    struct Result {
+        int files = 0;                  ///< Wczytane pliki.
+        int columns = 0;                ///< Kolumny we wszystkich plikach.
+        int importedSeries = 0;         ///< Kolumny dołączone do historii.
+        QList<int> sensorIds;           ///< Sensory, których historia została uzupełniona (bez powtórzeń).
+        qint64 readings = 0;            ///< Dołączone odczyty.
+        QStringList unmappedColumns;    ///< Kolumny bez sensora w katalogu: kod stacji lub "kod/wskaźnik".
+        QStringList skippedFiles;       ///< Pliki z innym czasem uśredniania niż godzinny.
+        QStringList errors;             ///< Błędy odczytu plików.
+    };
+
+    /**
+     * @brief Wczytuje mapowanie kodów stacji archiwum na ID stacji katalogu.
+     * @param fileName Metadane stacji GIOŚ jako CSV lub plik `kod;ID stacji`.
+     * @param catalog Katalog stacji (nazwy do dopasowania metadanych).
+     * @param errorString Opcjonalny komunikat błędu.
+     * @return Liczba zmapowanych kodów lub -1 przy błędzie odczytu.
+     */
+    int loadStationCodes(const QString& fileName, const StationCatalog& catalog, QString* errorString = nullptr);
+
+    /** @brief Ustawia mapowanie pojedynczego kodu stacji. */
+    void setStationCode(const QString& code, int stationId) { stationCodes.insert(code, stationId); }
+    /** @brief Liczba zmapowanych kodów stacji. */
+    int stationCodeCount() const { return int(stationCodes.size()); }
+
+    /**
+     * @brief Importuje pliki archiwum do historii (istniejące odczyty z zakresu pliku są zastępowane).
+     * @param fileNames Pliki CSV archiwum.
+     * @param catalog Katalog stacji i sensorów (identyfikacja sensorów).
+     * @param history Historia, do której dołączane są serie.
+     */
+    Result importFiles(const QStringList& fileNames, const StationCatalog& catalog, HistoryStore& history) const;
+
+    /** @brief Mapuje i parsuje plik archiwum (wariant parseTable() dla pliku). */
+    static bool parseFile(const QString& fileName, Table& table, QString* errorString = nullptr);
+
+    /**
+     * @brief Parsuje tabelę archiwum z bufora.
+     * @param data Treść pliku.
+     * @param size Rozmiar treści.
+     * @param nameHint Nazwa pliku (wskaźnik i czas uśredniania, gdy brak ich w nagłówku).
+     * @param table Wynik.
+     * @param errorString Opcjonalny komunikat błędu.
+     * @return false, jeśli nie rozpoznano nagłówka.
+     */
+    static bool parseTable(const char* data, qsizetype size, const QString& nameHint, Table& table, QString* errorString = nullptr);
+
+    /**
+     * @brief Parsuje czas archiwum ("yyyy-MM-dd HH:mm[:ss]" lub "dd.MM.yyyy HH:mm[:ss]").
+     * Archiwa GIOŚ podają czas środkowoeuropejski bez zmiany na letni (UTC+1).
+     * @param msecs Wynik w ms od epoki (UTC).
+     */
+    static bool parseArchiveTime(const char* text, qsizetype length, qint64& msecs);
+
+private:
+    QHash<QString, int> stationCodes;   ///< Kod stacji archiwum -> ID stacji katalogu.
+};
+
+#endif // ARCHIVEIMPORTER_H
@@ -0,0 +1,800 @@
+/**
+ * @file benchmark.cpp
+ * @brief Offline benchmark etapów przetwarzania danych aplikacji AirQualityMonitoring.
+ *
+ * Generuje syntetyczne odpowiedzi w formacie API GIOŚ (od jednego sensora z 3 dni
+ * do całej sieci z wielu lat) i mierzy czas kolejnych etapów: dekodowanie JSON,
+ * parsowanie dat, sortowanie, pełne dekodowanie odpowiedzi, wypełnianie wykresu,
+ * filtrowanie listy stacji przy każdym naciśnięciu klawisza, analizę danych
+ * oraz kodek serii. Wyniki zapisywane są w formacie JSON, aby dało się
+ * porównywać kolejne uruchomienia.
+ *
+ * Tryb --load-test mierzy przepustowość i opóźnienia masowego pobierania danych
+ * z serwera pod podanym adresem (np. lokalnego AirQualityMockServer) oraz raportuje
+ * wynegocjowany protokół i ponowne użycie połączeń. AirQualityMockServer obsługuje tylko
+ * HTTP/1.1 bez TLS - efekt HTTP/2 i rozgrzania połączenia widać tylko przy prawdziwym API
+ * (z --sensor-ids, bo syntetyczne ID sensorów nie istnieją w API GIOŚ).
+ *
+ * Użycie: AirQualityBenchmark [--output plik.json] [--scenario nazwa]... [--full] [--min-time ms]
+ *         AirQualityBenchmark --load-test http://127.0.0.1:8080/pjp-api/rest/ [--requests N]
+ *         AirQualityBenchmark --load-test https://api.gios.gov.pl/pjp-api/rest/ --requests 50 --sensor-ids 92,88 --warm-up 2000
+ */
+
+#include "giosapiclient.h"
+#include "mainwindow.h"
+#include "seriescodec.h"
+#include "catalogsnapshot.h"
+#include "stationcatalog.h"
+#include "liverefresh.h"
+#include "alertengine.h"
+#include "csvexporter.h"
+#include "archiveimporter.h"
+#include "reportrenderer.h"
+#include "seriesindex.h"
+#include "seriesrollup.h"
+#include "historystore.h"
+#include "correlationmatrix.h"
+#include "faultdetector.h"
+#include "seriesforecaster.h"
+#include "spatialinterpolator.h"
+#include "jsondecoder.h"
+
+#include <QApplication>
+#include <QCommandLineParser>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QLineEdit>
+#include <QPushButton>
+#include <QRandomGenerator>
+#include <QSysInfo>
+#include <QTemporaryDir>
+#include <QTimer>
+#include <QTextStream>
+#include <QtCharts/QChart>
+#include <QtCharts/QLineSeries>
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+
+namespace {
+
+using StationList = QList<StationInfo>;
+
+constexpr double Pi = 3.14159265358979323846;
+
+/** @brief Opis scenariusza: ile sensorów i ile godzin danych na sensor. */
+struct Scenario {
+    QString name;
+    int sensors;
+    int hours;
+    bool heavy; ///< Uruchamiany tylko z opcją --full.
+};
+
+/** @brief Wynik pomiaru jednego etapu w jednym scenariuszu. */
+struct StageResult {
+    QString scenario;
+    QString stage;
+    qint64 items = 0;
+    int iterations = 0;
+    qint64 minNs = 0;
+    qint64 medianNs = 0;
+    double meanNs = 0.0;
+};
+
+const QStringList Cities = {
+    "Warszawa", "Kraków", "Wrocław", "Łódź", "Poznań", "Gdańsk", "Szczecin", "Bydgoszcz",
+    "Lublin", "Białystok", "Katowice", "Gdynia", "Częstochowa", "Radom", "Toruń", "Kielce",
+    "Rzeszów", "Gliwice", "Zabrze", "Olsztyn", "Bielsko-Biała", "Bytom", "Zielona Góra", "Rybnik",
+    "Ruda Śląska", "Opole", "Tychy", "Gorzów Wielkopolski", "Elbląg", "Płock", "Wałbrzych", "Tarnów"
+};
+
+/** @brief Generuje odpowiedź station/findAll dla podanej liczby stacji. */
+QByteArray makeStationsPayload(int count)
+{
+    QJsonArray stations;
+    for (int i = 0; i < count; ++i) {
+        const QString city = i < Cities.size() ? Cities.at(i) : QString("%1 %2").arg(Cities.at(i % Cities.size())).arg(i / Cities.size());
+        QJsonObject cityObj{{"id", 1000 + i}, {"name", city},
+                            {"commune", QJsonObject{{"communeName", city}, {"districtName", city}, {"provinceName", "MAZOWIECKIE"}}}};
+        stations.append(QJsonObject{{"id", 100 + i},
+                                    {"stationName", QString("%1 - ul. Testowa %2").arg(city).arg(i)},
+                                    {"gegrLat", QString::number(49.0 + (i % 50) * 0.1, 'f', 6)},
+                                    {"gegrLon", QString::number(14.1 + (i % 80) * 0.1, 'f', 6)},
+                                    {"city", cityObj},
+                                    {"addressStreet", QString("ul. Testowa %1").arg(i)}});
+    }
+    return QJsonDocument(stations).toJson(QJsonDocument::Compact);
+}
+
+/**
+ * @brief Generuje odpowiedź data/getData: odczyty godzinowe od najnowszego (jak w API),
+ * z około 3% wartości null.
+ */
+QByteArray makeMeasurementPayload(int hours, quint32 seed)
+{
+    QRandomGenerator rng(seed);
+    const QDateTime newest(QDate(2025, 5, 4), QTime(12, 0));
+    QJsonArray values;
+    for (int i = 0; i < hours; ++i) {
+        QJsonObject v;
+        v["date"] = newest.addSecs(-3600LL * i).toString("yyyy-MM-dd HH:mm:ss");
+        if (rng.bounded(100) < 3) {
+            v["value"] = QJsonValue::Null;
+        } else {
+            const double base = 25.0 + 15.0 * std::sin(i * 2.0 * Pi / 24.0);
+            v["value"] = std::round((base + rng.generateDouble() * 10.0) * 10000.0) / 10000.0;
+        }
+        values.append(v);
+    }
+    return QJsonDocument(QJsonObject{{"key", "PM10"}, {"values", values}}).toJson(QJsonDocument::Compact);
+}
+
+/**
+ * @brief Dekoder danych pomiarowych w postaci sprzed JsonDecoder (contains() + operator[] dla każdego pola).
+ * Pozostawiony wyłącznie jako punkt odniesienia dla etapu decode_measurements.
+ */
+void legacyDecodeMeasurementData(const QByteArray& jsonData, MeasurementData& data)
+{
+    const QJsonObject mainObj = QJsonDocument::fromJson(jsonData).object();
+    data.key = mainObj.value("key").toString("Nieznany");
+    if (!(mainObj.contains("values") && mainObj["values"].isArray())) return;
+    const QJsonArray valuesArray = mainObj["values"].toArray();
+    data.values.reserve(valuesArray.count());
+    for (const QJsonValue& value : valuesArray) {
+        if (!value.isObject()) continue;
+        QJsonObject mObj = value.toObject();
+        Measurement m;
+        if (!(mObj.contains("date") && mObj["date"].isString())) continue;
+        m.date = QDateTime::fromString(mObj["date"].toString(), "yyyy-MM-dd HH:mm:ss");
+        if (!m.date.isValid() || !mObj.contains("value")) continue;
+        if (mObj["value"].isDouble()) m.value = mObj["value"].toDouble();
+        data.values.append(m);
+    }
+    std::sort(data.values.begin(), data.values.end(), [](const Measurement& a, const Measurement& b) { return a.date < b.date; });
+}
+
+/**
+ * @brief Mierzy funkcję wielokrotnie, aż upłynie minTimeMs (co najmniej 3 iteracje).
+ */
+StageResult measure(const QString& scenario, const QString& stage, qint64 items, int minTimeMs,
+                    const std::function<void()>& body)
+{
+    QList<qint64> samples;
+    QElapsedTimer total;
+    total.start();
+    while (samples.size() < 3 || (total.elapsed() < minTimeMs && samples.size() < 1000)) {
+        QElapsedTimer t;
+        t.start();
+        body();
+        samples.append(t.nsecsElapsed());
+    }
+    std::sort(samples.begin(), samples.end());
+
+    StageResult r;
+    r.scenario = scenario;
+    r.stage = stage;
+    r.items = items;
+    r.iterations = int(samples.size());
+    r.minNs = samples.first();
+    r.medianNs = samples.at(samples.size() / 2);
+    double sum = 0.0;
+    for (qint64 s : samples) sum += double(s);
+    r.meanNs = sum / samples.size();
+
+    QTextStream(stdout) << QString("%1 %2 %3 elem. mediana %4 ms (%5 ns/elem., %6 iter.)\n")
+                               .arg(scenario, -14).arg(stage, -22).arg(items, 10)
+                               .arg(r.medianNs / 1e6, 0, 'f', 3)
+                               .arg(items > 0 ? double(r.medianNs) / items : 0.0, 0, 'f', 1)
+                               .arg(r.iterations);
+    return r;
+}
+
+/** @brief Etapy dekodowania i przetwarzania danych pomiarowych dla jednego scenariusza. */
+void runMeasurementStages(const Scenario& sc, int minTimeMs, mainWindow& window, QList<StageResult>& results)
+{
+    QList<QByteArray> payloads;
+    payloads.reserve(sc.sensors);
+    for (int s = 0; s < sc.sensors; ++s) payloads.append(makeMeasurementPayload(sc.hours, quint32(s + 1)));
+    const qint64 points = qint64(sc.sensors) * sc.hours;
+
+    // 1. Samo dekodowanie JSON (QJsonDocument::fromJson)
+    results.append(measure(sc.name, "json_decode", points, minTimeMs, [&]() {
+        for (const QByteArray& p : payloads) {
+            QJsonDocument doc = QJsonDocument::fromJson(p);
+            Q_UNUSED(doc);
+        }
+    }));
+
+    // Przygotowanie wejścia dla etapów dat i sortowania
+    QStringList dateStrings;
+    dateStrings.reserve(sc.hours);
+    const QJsonArray firstValues = QJsonDocument::fromJson(payloads.first()).object().value("values").toArray();
+    for (const QJsonValue& v : firstValues) dateStrings.append(v.toObject().value("date").toString());
+
+    // 2. Parsowanie dat (format API)
+    results.append(measure(sc.name, "date_parse", points, minTimeMs, [&]() {
+        for (int s = 0; s < sc.sensors; ++s) {
+            for (const QString& d : dateStrings) {
+                QDateTime dt = QDateTime::fromString(d, "yyyy-MM-dd HH:mm:ss");
+                Q_UNUSED(dt);
+            }
+        }
+    }));
+    results.append(measure(sc.name, "date_parse_fast", points, minTimeMs, [&]() {
+        for (int s = 0; s < sc.sensors; ++s) {
+            for (const QString& d : dateStrings) {
+                QDateTime dt = JsonAssign::parseDateTime(d);
+                Q_UNUSED(dt);
+            }
+        }
+    }));
+
+    // 3. Sortowanie odczytów (API zwraca dane od najnowszych)
+    MeasurementData decoded;
+    GiosApiClient::decodeMeasurementData(payloads.first(), decoded);
+    QList<Measurement> reversed(decoded.values.crbegin(), decoded.values.crend());
+    results.append(measure(sc.name, "sort", points, minTimeMs, [&]() {
+        for (int s = 0; s < sc.sensors; ++s) {
+            QList<Measurement> copy = reversed;
+            std::sort(copy.begin(), copy.end(), [](const Measurement& a, const Measurement& b) { return a.date < b.date; });
+        }
+    }));
+
+    // 4. Pełne dekodowanie odpowiedzi tak jak w GiosApiClient (oraz ręczny parser sprzed JsonDecoder dla porównania)
+    results.append(measure(sc.name, "decode_measurements_legacy", points, minTimeMs, [&]() {
+        for (const QByteArray& p : payloads) {
+            MeasurementData data;
+            legacyDecodeMeasurementData(p, data);
+        }
+    }));
+    results.append(measure(sc.name, "decode_measurements", points, minTimeMs, [&]() {
+        for (const QByteArray& p : payloads) {
+            MeasurementData data;
+            GiosApiClient::decodeMeasurementData(p, data);
+        }
+    }));
+
+    // 4b. Reguły alarmowe: pełna ocena historii wszystkich sensorów oraz ocena przyrostowa jednej nowej godziny
+    QList<MeasurementData> decodedAll;
+    decodedAll.reserve(sc.sensors);
+    for (int s = 0; s < sc.sensors; ++s) {
+        MeasurementData data;
+        GiosApiClient::decodeMeasurementData(payloads.at(s), data);
+        data.sensorId = s;
+        decodedAll.append(data);
+    }
+    results.append(measure(sc.name, "alert_full_scan", points, minTimeMs, [&]() {
+        AlertEngine engine;
+        engine.setRules(AlertEngine::defaultRules());
+        for (const MeasurementData& data : decodedAll) engine.ingest(data);
+    }));
+    AlertEngine hourlyEngine;
+    hourlyEngine.setRules(AlertEngine::defaultRules());
+    for (const MeasurementData& data : decodedAll) hourlyEngine.ingest(data);
+    int hour = 0;
+    results.append(measure(sc.name, "alert_ingest_hour", sc.sensors, minTimeMs, [&]() {
+        ++hour;
+        for (const MeasurementData& data : decodedAll) {
+            MeasurementData delta;
+            delta.key = data.key;
+            delta.sensorId = data.sensorId;
+            delta.values.append(Measurement{data.values.last().date.addSecs(3600LL * hour), 40.0 + (hour % 100)});
+            hourlyEngine.ingest(delta);
+        }
+    }));
+
+    // 4b''. Prognozy: inicjalizacja modeli z pełnej historii oraz aktualizacja jedną nową godziną
+    results.append(measure(sc.name, "forecast_ingest_history", points, minTimeMs, [&]() {
+        SeriesForecaster model;
+        for (const MeasurementData& data : decodedAll) model.ingest(data);
+    }));
+    SeriesForecaster hourlyForecaster;
+    for (const MeasurementData& data : decodedAll) hourlyForecaster.ingest(data);
+    int forecastHour = 0;
+    results.append(measure(sc.name, "forecast_update_hour", sc.sensors, minTimeMs, [&]() {
+        ++forecastHour;
+        for (const MeasurementData& data : decodedAll) {
+            MeasurementData delta;
+            delta.key = data.key;
+            delta.sensorId = data.sensorId;
+            delta.values.append(Measurement{data.values.last().date.addSecs(3600LL * forecastHour), 40.0 + (forecastHour % 100)});
+            hourlyForecaster.ingest(delta);
+        }
+    }));
+
+    // 4c. Eksport zbiorczy CSV (układ długi i szeroki) do pliku tymczasowego
+    QList<MeasurementDataPtr> exportSeries;
+    for (const MeasurementData& data : decodedAll) exportSeries.append(QSharedPointer<MeasurementData>::create(data));
+    decodedAll.clear();
+
+    // 4b'. Wykrywanie błędów sensorów: pełna historia przy pierwszym przyjęciu (nowy detektor w każdej iteracji)
+    results.append(measure(sc.name, "fault_detect", points, minTimeMs, [&]() {
+        FaultDetector detector;
+        for (const MeasurementDataPtr& data : exportSeries) detector.apply(data);
+    }));
+    QTemporaryDir exportDir;
+    if (exportDir.isValid()) {
+        const QString exportFile = exportDir.filePath("export.csv");
+        CsvExporter::Options exportOptions;
+        results.append(measure(sc.name, "csv_export_long", points, minTimeMs, [&]() {
+            CsvExporter::exportToFile(exportSeries, exportFile, exportOptions);
+        }));
+        exportOptions.layout = CsvExporter::Layout::Wide;
+        results.append(measure(sc.name, "csv_export_wide", points, minTimeMs, [&]() {
+            CsvExporter::exportToFile(exportSeries, exportFile, exportOptions);
+        }));
+
+        // 4c'. Raport z wykresami: rysowanie w jednym wątku vs. równoległe renderowanie z zapisem PNG
+        ReportRenderer::Options reportOptions;
+        results.append(measure(sc.name, "report_paint_serial", sc.sensors, minTimeMs, [&]() {
+            for (const MeasurementDataPtr& data : exportSeries) ReportRenderer::renderImage(*data, reportOptions);
+        }));
+        results.append(measure(sc.name, "report_render_png", sc.sensors, minTimeMs, [&]() {
+            ReportRenderer::renderPngs(exportSeries, exportDir.filePath("report"), reportOptions);
+        }));
+    }
+    exportSeries.clear();
+
+    // 4d. Parsowanie tabeli archiwum GIOŚ (kolumna na sensor, przecinek dziesiętny, ~5% pustych komórek)
+    QByteArray archive = "Kod stacji";
+    for (int s = 0; s < sc.sensors; ++s) archive += ";Stacja" + QByteArray::number(s);
+    archive += "\nWskaźnik";
+    for (int s = 0; s < sc.sensors; ++s) archive += ";PM10";
+    archive += "\nCzas uśredniania";
+    for (int s = 0; s < sc.sensors; ++s) archive += ";1g";
+    archive += '\n';
+    QRandomGenerator archiveRng(7);
+    const QDateTime archiveStart(QDate(2019, 1, 1), QTime(1, 0));
+    for (int h = 0; h < sc.hours; ++h) {
+        archive += archiveStart.addSecs(3600LL * h).toString("yyyy-MM-dd HH:mm:ss").toLatin1();
+        for (int s = 0; s < sc.sensors; ++s) {
+            archive += ';';
+            if (archiveRng.bounded(100) >= 5) archive += QByteArray::number(20.0 + archiveRng.generateDouble() * 40.0, 'f', 4).replace('.', ',');
+        }
+        archive += '\n';
+    }
+    results.append(measure(sc.name, "archive_parse", points, minTimeMs, [&]() {
+        ArchiveImporter::Table table;
+        ArchiveImporter::parseTable(archive.constData(), archive.size(), "2019_PM10_1g.csv", table);
+    }));
+    archive.clear();
+
+    // 4e. Zapytania o zakres czasu w długiej historii (10 lat odczytów godzinnych na sensor)
+    QSharedPointer<MeasurementData> longSeries = QSharedPointer<MeasurementData>::create();
+    longSeries->key = "PM10";
+    longSeries->sensorId = 1;
+    const QDateTime longStart(QDate(2015, 1, 1), QTime(0, 0));
+    const int longHours = 24 * 3652;
+    longSeries->values.reserve(longHours);
+    for (int h = 0; h < longHours; ++h)
+        longSeries->values.append(Measurement{longStart.addSecs(3600LL * h), 30.0 + 20.0 * std::sin(h * 2.0 * Pi / 24.0)});
+    const SeriesIndex longIndex(longSeries);
+    const qint64 rangeTo = longIndex.lastTime();
+    const qint64 rangeFrom = rangeTo - 30LL * 24 * 3600 * 1000;
+    results.append(measure(sc.name, "range_scan_30d", sc.sensors, minTimeMs, [&]() {
+        for (int s = 0; s < sc.sensors; ++s) {
+            double sum = 0.0;
+            for (const Measurement& m : longSeries->values) {
+                const qint64 t = m.date.toMSecsSinceEpoch();
+                if (t >= rangeFrom && t <= rangeTo) sum += m.value.toDouble();
+            }
+            Q_UNUSED(sum);
+        }
+    }));
+    results.append(measure(sc.name, "range_index_30d", sc.sensors, minTimeMs, [&]() {
+        for (int s = 0; s < sc.sensors; ++s) longIndex.summarize(rangeFrom, rangeTo);
+    }));
+
+    // 4f. Agregaty dobowe/miesięczne: pełna budowa, przyrostowa aktualizacja po dobie nowych odczytów, widok dekady
+    results.append(measure(sc.name, "rollup_build", longHours, minTimeMs, [&]() {
+        SeriesRollup rollup(longSeries);
+    }));
+    const SeriesRollup longRollup(longSeries);
+    QSharedPointer<MeasurementData> extended = QSharedPointer<MeasurementData>::create(*longSeries);
+    for (int h = 0; h < 24; ++h)
+        extended->values.append(Measurement{longStart.addSecs(3600LL * (longHours + h)), 35.0});
+    results.append(measure(sc.name, "rollup_append_day", 24, minTimeMs, [&]() {
+        SeriesRollup rollup(extended, longRollup, longSeries->values.size());
+    }));
+    results.append(measure(sc.name, "rollup_decade_view", sc.sensors, minTimeMs, [&]() {
+        for (int s = 0; s < sc.sensors; ++s) {
+            QList<QPointF> pts;
+            for (const SeriesRollup::Bucket& bucket : longRollup.buckets(SeriesRollup::Tier::Monthly, longIndex.firstTime(), longIndex.lastTime()))
+                pts.append(QPointF(bucket.start, bucket.average()));
+        }
+    }));
+
+    // 4g. Budżet pamięci historii: dwie dekady serii przy budżecie na jedną - każdy dostęp przywraca skompresowaną serię
+    HistoryStore budgetStore;
+    budgetStore.setMemoryBudget(HistoryStore::estimateBytes(*longSeries) * 3 / 2);
+    QWeakPointer<const MeasurementData> evictedSeries;
+    for (int id = 1; id <= 2; ++id) {
+        QSharedPointer<MeasurementData> copy = QSharedPointer<MeasurementData>::create(*longSeries);
+        copy->sensorId = id;
+        const MeasurementDataPtr stored = budgetStore.put(copy);
+        if (id == 1) evictedSeries = stored;
+    }
+    // Seria skompresowana przez budżet nie może być już trzymana (np. przez indeks lub agregaty)
+    if (!evictedSeries.isNull()) qWarning() << "history_reload: Seria usunięta przez budżet nadal jest w pamięci";
+    int budgetTurn = 0;
+    results.append(measure(sc.name, "history_reload", longHours, minTimeMs, [&]() {
+        budgetStore.index(1 + (++budgetTurn % 2));
+    }));
+
+    // 4h. Macierz korelacji Pearsona (najwyżej 500 sensorów, skorelowane przebiegi dobowe z szumem i ~5% braków)
+    {
+        const int corrSensors = qMin(sc.sensors, 500);
+        QList<MeasurementDataPtr> corrSeries;
+        QRandomGenerator corrRng(11);
+        for (int s = 0; s < qMax(2, corrSensors); ++s) {
+            QSharedPointer<MeasurementData> data = QSharedPointer<MeasurementData>::create();
+            data->key = "PM10";
+            data->sensorId = s;
+            data->values.reserve(sc.hours);
+            for (int h = 0; h < sc.hours; ++h) {
+                const QVariant value = corrRng.bounded(100) < 5 ? QVariant()
+                                                                : QVariant(30.0 + 15.0 * std::sin((h + s % 6) * 2.0 * Pi / 24.0) + corrRng.generateDouble() * 10.0);
+                data->values.append(Measurement{longStart.addSecs(3600LL * h), value});
+            }
+            corrSeries.append(data);
+        }
+        const qint64 pairs = qint64(corrSeries.size()) * (corrSeries.size() + 1) / 2;
+        CorrelationMatrix::Options corrOptions;
+        results.append(measure(sc.name, "correlation_matrix", pairs, minTimeMs, [&]() {
+            CorrelationMatrix::compute(corrSeries, corrOptions);
+        }));
+    }
+
+    // 4i. Mapa stężeń IDW na siatce 1 km nad Polską: pełne przeliczenie i aktualizacja trzech stacji
+    {
+        const int mapStations = qBound(50, sc.sensors, 2000);
+        QVector<SpatialInterpolator::Point> mapPoints;
+        QRandomGenerator mapRng(13);
+        for (int i = 0; i < mapStations; ++i) {
+            SpatialInterpolator::Point point;
+            point.stationId = i;
+            point.latitude = 49.0 + mapRng.generateDouble() * 5.8;
+            point.longitude = 14.2 + mapRng.generateDouble() * 9.9;
+            point.value = 10.0 + mapRng.generateDouble() * 60.0;
+            mapPoints.append(point);
+        }
+        SpatialInterpolator probe;
+        probe.update(mapPoints);
+        const qint64 cells = qint64(probe.width()) * probe.height();
+        results.append(measure(sc.name, "idw_grid_full", cells, minTimeMs, [&]() {
+            SpatialInterpolator grid;
+            grid.update(mapPoints);
+        }));
+        int round = 0;
+        results.append(measure(sc.name, "idw_grid_update_3", cells, minTimeMs, [&]() {
+            ++round;
+            for (int k = 0; k < 3; ++k) mapPoints[(round * 3 + k) % mapStations].value += 1.0;
+            probe.update(mapPoints);
+        }));
+    }
+
+    // 5. Kodek serii (zapis/odczyt .aqs)
+    QByteArray encoded = SeriesCodec::encode(decoded);
+    results.append(measure(sc.name, "codec_encode", points, minTimeMs, [&]() {
+        for (int s = 0; s < sc.sensors; ++s) encoded = SeriesCodec::encode(decoded);
+    }));
+    results.append(measure(sc.name, "codec_decode_points", points, minTimeMs, [&]() {
+        QList<QPointF> pts;
+        for (int s = 0; s < sc.sensors; ++s) SeriesCodec::decodePoints(encoded, pts);
+    }));
+
+    // Pozostałe etapy dotyczą widoku jednego sensora
+    if (sc.sensors != 1) return;
+
+    // 6. Wypełnianie serii wykresu (jak w mainWindow::displayChart)
+    results.append(measure(sc.name, "chart_population", sc.hours, minTimeMs, [&]() {
+        QChart chart;
+        QLineSeries *series = new QLineSeries();
+        for (const Measurement& m : decoded.values) {
+            if (m.date.isValid() && !m.value.isNull()) series->append(m.date.toMSecsSinceEpoch(), m.value.toDouble());
+        }
+        chart.addSeries(series);
+    }));
+
+    // 7. Pełna aktualizacja UI po otrzymaniu danych (wykres + pole tekstowe); migawka współdzielona, bez kopii
+    const MeasurementDataPtr snapshot = QSharedPointer<MeasurementData>::create(decoded);
+    results.append(measure(sc.name, "ui_update", sc.hours, minTimeMs, [&]() {
+        QMetaObject::invokeMethod(&window, "handleMeasurementDataFetched", Qt::DirectConnection,
+                                  Q_ARG(MeasurementDataPtr, snapshot));
+    }));
+
+    // 7a. Seria odpowiedzi z jednej klatki (ResultBatcher): przyjęcie wszystkich, widok przebudowany raz
+    const QList<MeasurementDataPtr> burst(qMax(1, sc.sensors), snapshot);
+    results.append(measure(sc.name, "ui_update_burst", burst.size(), minTimeMs, [&]() {
+        QMetaObject::invokeMethod(&window, "handleMeasurementBatch", Qt::DirectConnection,
+                                  Q_ARG(QList<MeasurementDataPtr>, burst));
+    }));
+
+    // 7b. Tryb na żywo: scalenie odpowiedzi z jednym nowym odczytem zamiast pełnej aktualizacji UI
+    if (decoded.values.size() > 1) {
+        const MeasurementDataPtr previousHour = QSharedPointer<MeasurementData>::create(
+            MeasurementData{decoded.key, decoded.values.mid(0, decoded.values.size() - 1), decoded.sensorId});
+        results.append(measure(sc.name, "live_merge", 1, minTimeMs, [&]() {
+            MeasurementDataPtr merged;
+            int firstNewIndex = 0;
+            LiveRefresh::appendNewer(previousHour, decoded, merged, firstNewIndex);
+        }));
+    }
+
+    // 8. Analiza danych (przycisk "Analizuj dane")
+    QPushButton *analyzeButton = window.findChild<QPushButton*>("analyzeButton");
+    if (analyzeButton) {
+        results.append(measure(sc.name, "stats", sc.hours, minTimeMs, [&]() { analyzeButton->click(); }));
+    }
+}
+
+/** @brief Mierzy filtrowanie listy stacji przy wpisywaniu nazwy miasta znak po znaku. */
+void runFilterStage(const QString& name, int stationCount, int minTimeMs, mainWindow& window, QList<StageResult>& results)
+{
+    StationList stations;
+    GiosApiClient::decodeStations(makeStationsPayload(stationCount), stations);
+
+    results.append(measure(name, "decode_stations", stationCount, minTimeMs, [&]() {
+        StationList decodedStations;
+        GiosApiClient::decodeStations(makeStationsPayload(stationCount), decodedStations);
+    }));
+
+    // Katalog z internowanymi napisami; syntetyczne sensory (~5 na stację z 10 parametrów)
+    static const char* const paramCodes[] = {"PM10", "PM2.5", "NO2", "SO2", "O3", "CO", "C6H6", "NH3", "NOx", "NO"};
+    QHash<int, QList<SensorInfo>> sensorLists;
+    for (const StationInfo& station : stations) {
+        QList<SensorInfo>& list = sensorLists[station.id];
+        for (int p = 0; p < 5; ++p) {
+            const int param = (station.id + p * 3) % 10;
+            SensorInfo sensor;
+            sensor.id = station.id * 10 + p;
+            sensor.stationId = station.id;
+            sensor.idParam = param + 1;
+            sensor.paramCode = QString::fromLatin1(paramCodes[param]);
+            sensor.paramFormula = sensor.paramCode;
+            sensor.paramName = QString("Parametr %1").arg(sensor.paramCode);
+            list.append(sensor);
+        }
+    }
+    StationCatalog catalog;
+    results.append(measure(name, "catalog_build", stationCount, minTimeMs, [&]() {
+        catalog.setStations(stations);
+        for (auto it = sensorLists.cbegin(); it != sensorLists.cend(); ++it) catalog.setSensors(it.key(), it.value());
+    }));
+    results.append(measure(name, "catalog_city_filter", stationCount, minTimeMs, [&]() {
+        catalog.stationsMatchingCity("Wrocł");
+    }));
+    results.append(measure(name, "catalog_param_join", stationCount, minTimeMs, [&]() {
+        catalog.stationsMeasuring("PM2.5");
+    }));
+    QTextStream(stdout) << QString("%1 pamięć katalogu: %2 kB (listy struktur: %3 kB), %4 unikalnych napisów\n")
+                               .arg(name, -14)
+                               .arg(catalog.memoryUsage() / 1024.0, 0, 'f', 1)
+                               .arg(StationCatalog::memoryUsage(stations, sensorLists) / 1024.0, 0, 'f', 1)
+                               .arg(catalog.stringCount());
+
+    // Start z migawki katalogu zamiast z sieci
+    QTemporaryDir snapshotDir;
+    CatalogSnapshot snapshot;
+    snapshot.catalog = catalog;
+    const QString snapshotFile = snapshotDir.filePath("catalog.snapshot");
+    if (snapshotDir.isValid() && snapshot.save(snapshotFile)) {
+        results.append(measure(name, "snapshot_load", stationCount, minTimeMs, [&]() {
+            CatalogSnapshot loaded;
+            CatalogSnapshot::load(snapshotFile, loaded);
+        }));
+    }
+
+    QMetaObject::invokeMethod(&window, "handleStationsFetched", Qt::DirectConnection, Q_ARG(StationList, stations));
+
+    // Rewalidacja: ~1% stacji ze zmienioną nazwą, nanoszona różnicowo na wyświetloną listę
+    StationList revalidated = stations;
+    for (int i = 0; i < revalidated.size(); i += 100) revalidated[i].stationName += " (nowa)";
+    bool toggle = false;
+    results.append(measure(name, "apply_station_diff", stationCount, minTimeMs, [&]() {
+        toggle = !toggle;
+        QMetaObject::invokeMethod(&window, "handleStationsFetched", Qt::DirectConnection,
+                                  Q_ARG(StationList, toggle ? revalidated : stations));
+    }));
+    QLineEdit *filterEdit = window.findChild<QLineEdit*>("cityFilterLineEdit");
+    if (!filterEdit) return;
+
+    const QString typed = "Wrocł";
+    results.append(measure(name, "filter_keystroke", stationCount, minTimeMs, [&]() {
+        for (int i = 1; i <= typed.size(); ++i) filterEdit->setText(typed.left(i));
+        filterEdit->clear();
+    }));
+    // Wynik na jedno naciśnięcie klawisza (wpisanie znaków + wyczyszczenie)
+    StageResult& last = results.last();
+    const int keystrokes = int(typed.size()) + 1;
+    last.minNs /= keystrokes;
+    last.medianNs /= keystrokes;
+    last.meanNs /= keystrokes;
+}
+
+/**
+ * @brief Wysyła serię żądań getData przez GiosApiClient i mierzy czas od startu serii
+ * do zakończenia każdego żądania (wraz z kolejkowaniem w QNetworkAccessManager).
+ * @param sensorIds Sensory odpytywane cyklicznie (pusta lista = katalog syntetyczny serwera testowego).
+ */
+QJsonObject runLoadTest(const QUrl& baseUrl, int requests, int timeoutMs, int warmUpMs, int maxAttempts, const QList<int>& sensorIds)
+{
+    GiosApiClient client;
+    client.setBaseUrl(baseUrl);
+    RetryPolicy policy = client.retryPolicy();
+    policy.maxAttempts = qMax(1, maxAttempts);
+    client.setRetryPolicy(policy);
+    if (warmUpMs > 0) {
+        // Rozgrzanie połączenia i odczekanie na jego nawiązanie przed serią żądań
+        client.warmUpConnection();
+        QEventLoop warmUpLoop;
+        QTimer::singleShot(warmUpMs, &warmUpLoop, &QEventLoop::quit);
+        warmUpLoop.exec();
+    }
+
+    QList<qint64> latencies;
+    latencies.reserve(requests);
+    int errors = 0, finished = 0;
+    qint64 bytesParsed = 0;
+    QEventLoop loop;
+    QElapsedTimer clock;
+
+    auto finishOne = [&]() {
+        latencies.append(clock.nsecsElapsed());
+        if (++finished == requests) loop.quit();
+    };
+    QObject::connect(&client, &GiosApiClient::measurementDataFetched, &loop, [&](const MeasurementDataPtr& data) {
+        bytesParsed += data->values.size();
+        finishOne();
+    });
+    QObject::connect(&client, &GiosApiClient::networkError, &loop, [&](const QString&) {
+        ++errors;
+        finishOne();
+    });
+    QTimer::singleShot(timeoutMs, &loop, &QEventLoop::quit);
+
+    clock.start();
+    for (int i = 0; i < requests; ++i) {
+        // Bez listy - identyfikatory zgodne z katalogiem syntetycznym serwera testowego (270 stacji x 5 sensorów)
+        client.fetchMeasurementData(sensorIds.isEmpty() ? (100 + i % 270) * 100 + (i / 270) % 5
+                                                        : sensorIds.at(i % sensorIds.size()));
+    }
+    loop.exec();
+    const qint64 totalNs = clock.nsecsElapsed();
+
+    std::sort(latencies.begin(), latencies.end());
+    auto percentile = [&latencies](double p) -> double {
+        if (latencies.isEmpty()) return 0.0;
+        return latencies.at(qMin(latencies.size() - 1, qsizetype(p * latencies.size()))) / 1e6;
+    };
+
+    QJsonObject result{{"base_url", baseUrl.toString()}, {"requests", requests}, {"warm_up_ms", warmUpMs}, {"max_attempts", policy.maxAttempts}, {"completed", finished},
+                       {"errors", errors}, {"timed_out", requests - finished}, {"values_parsed", double(bytesParsed)},
+                       {"total_ms", totalNs / 1e6},
+                       {"throughput_rps", totalNs > 0 ? finished / (totalNs / 1e9) : 0.0},
+                       {"p50_ms", percentile(0.50)}, {"p90_ms", percentile(0.90)},
+                       {"p99_ms", percentile(0.99)}, {"max_ms", percentile(1.0)}};
+
+    // Protokół i połączenia: HTTP/2 z Http2WasUsedAttribute, nowe połączenia z socketStartedConnecting (Qt >= 6.3)
+    const RequestMetrics::ConnectionTotals connections = client.metrics().connectionTotals();
+    result["protocol"] = connections.http2 == 0 ? "http/1.1" : connections.http2 >= connections.requests ? "h2" : "mixed";
+    result["http2_requests"] = double(connections.http2);
+#if QT_VERSION >= QT_VERSION_CHECK(6, 3, 0)
+    result["new_connections"] = double(connections.newConnections);
+    result["reused_connection_requests"] = double(connections.requests - qMin(connections.requests, connections.newConnections));
+#else
+    result["new_connections"] = QJsonValue::Null; // Brak sygnału socketStartedConnecting - nie da się policzyć
+    result["reused_connection_requests"] = QJsonValue::Null;
+#endif
+    QTextStream(stdout) << QJsonDocument(result).toJson() << client.metrics().summaryText();
+    return result;
+}
+
+bool writeResults(const QString& fileName, const QList<StageResult>& results, const QJsonObject& loadTest = QJsonObject())
+{
+    QJsonArray arr;
+    for (const StageResult& r : results) {
+        arr.append(QJsonObject{{"scenario", r.scenario}, {"stage", r.stage}, {"items", double(r.items)},
+                               {"iterations", r.iterations}, {"min_ns", double(r.minNs)},
+                               {"median_ns", double(r.medianNs)}, {"mean_ns", r.meanNs},
+                               {"median_ns_per_item", r.items > 0 ? double(r.medianNs) / r.items : 0.0}});
+    }
+    QJsonObject root{{"timestamp", QDateTime::currentDateTimeUtc().toString(Qt::ISODate)},
+                     {"qt_version", QString(qVersion())},
+                     {"cpu", QSysInfo::currentCpuArchitecture()},
+                     {"kernel", QSysInfo::kernelType() + " " + QSysInfo::kernelVersion()},
+                     {"results", arr}};
+    if (!loadTest.isEmpty()) root["load_test"] = loadTest;
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly)) return false;
+    return file.write(QJsonDocument(root).toJson()) != -1;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    // Benchmark działa bez wyświetlacza
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) qputenv("QT_QPA_PLATFORM", "offscreen");
+    QApplication app(argc, argv);
+    QApplication::setApplicationName("AirQualityBenchmark");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Offline benchmark etapów przetwarzania danych AirQualityMonitoring.");
+    parser.addHelpOption();
+    QCommandLineOption outputOption("output", "Plik wynikowy JSON.", "plik", "benchmark_results.json");
+    QCommandLineOption scenarioOption("scenario", "Uruchom tylko wybrany scenariusz (można powtarzać).", "nazwa");
+    QCommandLineOption fullOption("full", "Uruchom także najcięższe scenariusze (cała sieć, wiele lat).");
+    QCommandLineOption minTimeOption("min-time", "Minimalny czas pomiaru etapu w ms.", "ms", "300");
+    QCommandLineOption loadTestOption("load-test", "Test obciążeniowy pobierania danych z podanego adresu bazowego.", "url");
+    QCommandLineOption requestsOption("requests", "Liczba żądań w teście obciążeniowym.", "n", "1000");
+    QCommandLineOption timeoutOption("timeout", "Limit czasu testu obciążeniowego w ms.", "ms", "120000");
+    QCommandLineOption warmUpOption("warm-up", "Rozgrzej połączenie i odczekaj podaną liczbę ms przed testem obciążeniowym.", "ms", "0");
+    QCommandLineOption attemptsOption("max-attempts", "Liczba prób jednego żądania w teście obciążeniowym (1 = bez ponawiania).", "n", "4");
+    QCommandLineOption sensorIdsOption("sensor-ids", "ID sensorów odpytywanych w teście obciążeniowym, po przecinku (np. dla prawdziwego API).", "lista");
+    parser.addOptions({outputOption, scenarioOption, fullOption, minTimeOption, loadTestOption, requestsOption, timeoutOption, warmUpOption, attemptsOption,
+                       sensorIdsOption});
+    parser.process(app);
+
+    const QString outputFile = parser.value(outputOption);
+    if (parser.isSet(loadTestOption)) {
+        QList<int> sensorIds;
+        for (const QString& id : parser.value(sensorIdsOption).split(',', Qt::SkipEmptyParts)) {
+            bool ok = false;
+            const int sensorId = id.trimmed().toInt(&ok);
+            if (ok) sensorIds.append(sensorId);
+        }
+        const QJsonObject loadTest = runLoadTest(QUrl(parser.value(loadTestOption)),
+                                                 parser.value(requestsOption).toInt(),
+                                                 parser.value(timeoutOption).toInt(),
+                                                 parser.value(warmUpOption).toInt(),
+                                                 parser.value(attemptsOption).toInt(),
+                                                 sensorIds);
+        if (!writeResults(outputFile, {}, loadTest)) {
+            qWarning() << "Nie można zapisać wyników do" << outputFile;
+            return 1;
+        }
+        return 0;
+    }
+
+    const int minTimeMs = parser.value(minTimeOption).toInt();
+    const QStringList selected = parser.values(scenarioOption);
+
+    // Sieć GIOŚ to ok. 270 stacji i ok. 1500 sensorów
+    const QList<Scenario> scenarios = {
+        {"sensor-3d", 1, 72, false},
+        {"sensor-1y", 1, 24 * 365, false},
+        {"sensor-5y", 1, 24 * 365 * 5, false},
+        {"station-1y", 8, 24 * 365, false},
+        {"network-3d", 1500, 72, false},
+        {"network-1y", 1500, 24 * 365, true},
+        {"network-5y", 1500, 24 * 365 * 5, true},
+    };
+
+    mainWindow window;
+    QList<StageResult> results;
+
+    for (const Scenario& sc : scenarios) {
+        if (!selected.isEmpty() ? !selected.contains(sc.name) : (sc.heavy && !parser.isSet(fullOption))) continue;
+        runMeasurementStages(sc, minTimeMs, window, results);
+    }
+
+    const QList<QPair<QString, int>> stationScenarios = {{"stations-270", 270}, {"stations-3000", 3000}};
+    for (const auto& st : stationScenarios) {
+        if (!selected.isEmpty() && !selected.contains(st.first)) continue;
+        runFilterStage(st.first, st.second, minTimeMs, window, results);
+    }
+
+    if (!writeResults(outputFile, results)) {
+        qWarning() << "Nie można zapisać wyników do" << outputFile;
+        return 1;
+    }
+    QTextStream(stdout) << "Wyniki zapisano do: " << outputFile << "\n";
+    return 0;
+}
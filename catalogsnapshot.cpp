@@ -0,0 +1,78 @@
+#include "catalogsnapshot.h"
+
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+namespace {
+
+const quint32 SnapshotMagic = 0x41514331; // "AQC1"
+const quint16 SnapshotVersion = 3; // 2: internowane napisy (StationCatalog), 3: współrzędne stacji
+// Qt_6_0 nie istnieje w Qt 5 (CMake dopuszcza obie wersje); plik jest czytany tą samą wersją Qt, która go zapisała
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+constexpr QDataStream::Version StreamVersion = QDataStream::Qt_6_0;
+#else
+constexpr QDataStream::Version StreamVersion = QDataStream::Qt_5_15;
+#endif
+
+} // namespace
+
+QString CatalogSnapshot::defaultFileName()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/catalog.snapshot";
+}
+
+bool CatalogSnapshot::load(const QString& fileName, CatalogSnapshot& snapshot, QString* errorString)
+{
+    snapshot = CatalogSnapshot();
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        if (errorString) *errorString = file.errorString();
+        return false;
+    }
+
+    QDataStream in(&file);
+    in.setVersion(StreamVersion);
+    quint32 magic = 0;
+    quint16 version = 0;
+    in >> magic >> version;
+    if (magic != SnapshotMagic || version != SnapshotVersion) {
+        if (errorString) *errorString = "Nieobsługiwany format migawki katalogu.";
+        return false;
+    }
+
+    in >> snapshot.sourceUrl >> snapshot.savedAt;
+    if (in.status() == QDataStream::Ok) snapshot.catalog.read(in);
+
+    if (in.status() != QDataStream::Ok) {
+        if (errorString) *errorString = "Uszkodzony plik migawki katalogu.";
+        snapshot = CatalogSnapshot();
+        return false;
+    }
+    return true;
+}
+
+bool CatalogSnapshot::save(const QString& fileName, QString* errorString) const
+{
+    QDir().mkpath(QFileInfo(fileName).absolutePath());
+    // QSaveFile - przerwany zapis nie zostawi uszkodzonej migawki
+    QSaveFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly)) {
+        if (errorString) *errorString = file.errorString();
+        return false;
+    }
+
+    QDataStream out(&file);
+    out.setVersion(StreamVersion);
+    out << SnapshotMagic << SnapshotVersion << sourceUrl << savedAt;
+    catalog.write(out);
+
+    if (!file.commit()) {
+        if (errorString) *errorString = file.errorString();
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,50 @@
+#ifndef CATALOGSNAPSHOT_H
+#define CATALOGSNAPSHOT_H
+
+#include <QDateTime>
+#include <QString>
+#include <QUrl>
+#include "stationcatalog.h"
+
+/**
+ * @file catalogsnapshot.h
+ * @brief Definicja struktury CatalogSnapshot - lokalnej kopii katalogu stacji i sensorów.
+ */
+
+/**
+ * @struct CatalogSnapshot
+ * @brief Ostatnio pobrany katalog stacji i sensorów zapisany w zwartym pliku binarnym.
+ *
+ * Plik (QDataStream, magia "AQC1") zawiera katalog w postaci tablicy napisów
+ * i płaskich tablic rekordów (patrz StationCatalog). Jest wczytywany synchronicznie przy starcie,
+ * dzięki czemu lista stacji jest dostępna od razu, a świeża kopia z API
+ * pobierana jest w tle. Migawka pamięta adres bazowy API, z którego pochodzi,
+ * aby dane z serwera testowego nie trafiły do widoku danych produkcyjnych.
+ */
+struct CatalogSnapshot {
+    QUrl sourceUrl;                            ///< Adres bazowy API, z którego pochodzi katalog.
+    QDateTime savedAt;                         ///< Czas zapisu migawki (UTC).
+    StationCatalog catalog;                    ///< Stacje (w kolejności z API) i pobrane dotąd sensory.
+
+    /** @brief Domyślna ścieżka pliku migawki w katalogu danych aplikacji (AppDataLocation). */
+    static QString defaultFileName();
+
+    /**
+     * @brief Wczytuje migawkę z pliku.
+     * @param fileName Ścieżka pliku.
+     * @param snapshot Struktura docelowa (nadpisywana).
+     * @param errorString Opcjonalny wskaźnik na komunikat błędu.
+     * @return true, jeśli plik istniał i miał poprawny format.
+     */
+    static bool load(const QString& fileName, CatalogSnapshot& snapshot, QString* errorString = nullptr);
+
+    /**
+     * @brief Zapisuje migawkę do pliku (atomowo, przez QSaveFile).
+     * @param fileName Ścieżka pliku; brakujący katalog zostanie utworzony.
+     * @param errorString Opcjonalny wskaźnik na komunikat błędu.
+     * @return true, jeśli zapis się powiódł.
+     */
+    bool save(const QString& fileName, QString* errorString = nullptr) const;
+};
+
+#endif // CATALOGSNAPSHOT_H
@@ -0,0 +1,60 @@
+#include "circuitbreaker.h"
+
+CircuitBreaker::CircuitBreaker(int failureThreshold, int openDurationMs)
+    : threshold(qMax(1, failureThreshold))
+    , openMs(qMax(0, openDurationMs))
+{
+}
+
+bool CircuitBreaker::allowRequest(qint64 nowMs)
+{
+    switch (current) {
+    case State::Closed:
+        return true;
+    case State::Open:
+        if (nowMs - openedAtMs < openMs) return false;
+        current = State::HalfOpen;
+        probeInFlight = true;
+        return true;
+    case State::HalfOpen:
+        // Tylko jedno żądanie próbne naraz
+        if (probeInFlight) return false;
+        probeInFlight = true;
+        return true;
+    }
+    return true;
+}
+
+bool CircuitBreaker::recordSuccess()
+{
+    const bool wasOpen = current != State::Closed;
+    current = State::Closed;
+    consecutiveFailures = 0;
+    probeInFlight = false;
+    return wasOpen;
+}
+
+bool CircuitBreaker::recordFailure(qint64 nowMs)
+{
+    probeInFlight = false;
+    if (current == State::HalfOpen) {
+        // Próba nieudana - ponowne wstrzymanie
+        current = State::Open;
+        openedAtMs = nowMs;
+        return false;
+    }
+    if (current == State::Open) return false;
+
+    if (++consecutiveFailures >= threshold) {
+        current = State::Open;
+        openedAtMs = nowMs;
+        return true;
+    }
+    return false;
+}
+
+qint64 CircuitBreaker::remainingOpenMs(qint64 nowMs) const
+{
+    if (current != State::Open) return 0;
+    return qMax<qint64>(0, openMs - (nowMs - openedAtMs));
+}
@@ -0,0 +1,71 @@
+#ifndef CIRCUITBREAKER_H
+#define CIRCUITBREAKER_H
+
+#include <QtGlobal>
+
+/**
+ * @file circuitbreaker.h
+ * @brief Definicja klasy CircuitBreaker - wyłącznika chroniącego niedziałający endpoint.
+ */
+
+/**
+ * @class CircuitBreaker
+ * @brief Prosty wyłącznik (circuit breaker) dla jednego endpointu API.
+ *
+ * Stany:
+ * - Closed - żądania przechodzą; kolejne błędy przejściowe są zliczane,
+ * - Open - po przekroczeniu progu błędów żądania są odrzucane bez wysyłania,
+ * - HalfOpen - po upływie czasu wstrzymania przepuszczane jest jedno żądanie próbne;
+ *   jego sukces zamyka obwód, a błąd ponownie go otwiera.
+ *
+ * Czas podawany jest z zewnątrz (ms zegara monotonicznego), co ułatwia testowanie.
+ */
+class CircuitBreaker
+{
+public:
+    /** @brief Stan wyłącznika. */
+    enum class State { Closed, Open, HalfOpen };
+
+    /**
+     * @brief Konstruktor.
+     * @param failureThreshold Liczba kolejnych błędów przejściowych otwierająca obwód.
+     * @param openDurationMs Czas wstrzymania żądań po otwarciu obwodu.
+     */
+    explicit CircuitBreaker(int failureThreshold = 5, int openDurationMs = 15000);
+
+    /**
+     * @brief Sprawdza, czy żądanie może zostać wysłane.
+     * W stanie Open po upływie czasu wstrzymania przechodzi w HalfOpen i przepuszcza jedno żądanie próbne.
+     * @param nowMs Bieżący czas w ms.
+     */
+    bool allowRequest(qint64 nowMs);
+
+    /**
+     * @brief Rejestruje odpowiedź serwera (także błąd nieprzejściowy, np. 404 - serwer działa).
+     * @return true, jeśli obwód został właśnie zamknięty.
+     */
+    bool recordSuccess();
+
+    /**
+     * @brief Rejestruje błąd przejściowy (timeout, 5xx, zerwane połączenie).
+     * @param nowMs Bieżący czas w ms.
+     * @return true, jeśli obwód został właśnie otwarty.
+     */
+    bool recordFailure(qint64 nowMs);
+
+    /** @brief Zwraca bieżący stan. */
+    State state() const { return current; }
+
+    /** @brief Czas w ms pozostały do przepuszczenia żądania próbnego (0 poza stanem Open). */
+    qint64 remainingOpenMs(qint64 nowMs) const;
+
+private:
+    int threshold;
+    int openMs;
+    State current = State::Closed;
+    int consecutiveFailures = 0;
+    qint64 openedAtMs = 0;
+    bool probeInFlight = false;
+};
+
+#endif // CIRCUITBREAKER_H
@@ -0,0 +1,302 @@
+#include "correlationmatrix.h"
+#include "tracing.h"
+
+#include <QFontMetrics>
+#include <QPainter>
+#include <QtConcurrent/QtConcurrentMap>
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+namespace {
+
+constexpr qint64 HourMs = 3600LL * 1000;
+
+/** @brief Seria na wspólnej siatce godzin: wartości (0 dla braków) i bajtowa maska obecności (5 B na godzinę). */
+struct AlignedSeries {
+    QVector<float> value;
+    QVector<quint8> mask;
+};
+
+/** @brief Sumy potrzebne do współczynnika Pearsona dla pary po uwzględnieniu braków. */
+struct PairSums {
+    double n = 0.0, sx = 0.0, sy = 0.0, sxx = 0.0, syy = 0.0, sxy = 0.0;
+
+    double correlation() const
+    {
+        const double vx = n * sxx - sx * sx;
+        const double vy = n * syy - sy * sy;
+        if (vx <= 0.0 || vy <= 0.0) return std::numeric_limits<double>::quiet_NaN();
+        return qBound(-1.0, (n * sxy - sx * sy) / std::sqrt(vx * vy), 1.0);
+    }
+};
+
+/**
+ * @brief Sumy pary (Pearson): wartość a w chwili t z wartością b w chwili t+lag.
+ * Wartości są przechowywane jako float, sumowane w double. Cztery niezależne tory akumulatorów
+ * bez rozgałęzień (maska pary to iloczyn bitowy bajtów) - kompilator łączy je w instrukcje
+ * wektorowe bez zmiany kolejności dodawania (nie wymaga -ffast-math).
+ */
+PairSums pairSums(const AlignedSeries& a, const AlignedSeries& b, int lag, int hours)
+{
+    const int begin = qMax(0, -lag);
+    const int end = qMin(hours, hours - lag);
+    const float* va = a.value.constData();
+    const quint8* ma = a.mask.constData();
+    const float* vb = b.value.constData() + lag;
+    const quint8* mb = b.mask.constData() + lag;
+
+    constexpr int Lanes = 4;
+    double n[Lanes] = {}, sx[Lanes] = {}, sy[Lanes] = {}, sxx[Lanes] = {}, syy[Lanes] = {}, sxy[Lanes] = {};
+    int t = begin;
+    for (; t + Lanes <= end; t += Lanes) {
+        for (int l = 0; l < Lanes; ++l) {
+            const double x = va[t + l], y = vb[t + l];
+            const double m = ma[t + l] & mb[t + l];
+            n[l] += m;
+            sx[l] += x * m;
+            sy[l] += y * m;
+            sxx[l] += x * x * m;
+            syy[l] += y * y * m;
+            sxy[l] += x * y; // Braki mają wartość 0
+        }
+    }
+    PairSums sums;
+    for (; t < end; ++t) {
+        const double x = va[t], y = vb[t];
+        const double m = ma[t] & mb[t];
+        sums.n += m;
+        sums.sx += x * m;
+        sums.sy += y * m;
+        sums.sxx += x * x * m;
+        sums.syy += y * y * m;
+        sums.sxy += x * y;
+    }
+    for (int l = 0; l < Lanes; ++l) {
+        sums.n += n[l];
+        sums.sx += sx[l];
+        sums.sy += sy[l];
+        sums.sxx += sxx[l];
+        sums.syy += syy[l];
+        sums.sxy += sxy[l];
+    }
+    return sums;
+}
+
+/** @brief Bufory robocze rang jednego zadania (wielokrotnie używane dla kolejnych par). */
+struct RankScratch {
+    QVector<float> x, y;
+    QVector<int> order;
+    QVector<double> rx, ry;
+};
+
+/** @brief Rangi wartości (1..k, średnie rangi dla remisów). */
+void averageRanks(const QVector<float>& values, QVector<int>& order, QVector<double>& ranks)
+{
+    const int k = int(values.size());
+    order.resize(k);
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&values](int a, int b) { return values.at(a) < values.at(b); });
+    ranks.resize(k);
+    for (int i = 0; i < k;) {
+        int end = i + 1;
+        while (end < k && values.at(order.at(end)) == values.at(order.at(i))) ++end;
+        const double rank = (i + end + 1) / 2.0; // Średnia rang i+1..end
+        for (int m = i; m < end; ++m) ranks[order.at(m)] = rank;
+        i = end;
+    }
+}
+
+/**
+ * @brief Sumy pary (Spearman): rangi liczone tylko w podzbiorze godzin, w których obie serie
+ * (b przesunięta o lag) mają odczyt. Poniżej minOverlap wspólnych godzin zwraca samo n.
+ */
+PairSums rankedPairSums(const AlignedSeries& a, const AlignedSeries& b, int lag, int hours, int minOverlap, RankScratch& s)
+{
+    const int begin = qMax(0, -lag);
+    const int end = qMin(hours, hours - lag);
+    s.x.clear();
+    s.y.clear();
+    for (int t = begin; t < end; ++t) {
+        if (!(a.mask.at(t) & b.mask.at(t + lag))) continue;
+        s.x.append(a.value.at(t));
+        s.y.append(b.value.at(t + lag));
+    }
+    PairSums sums;
+    sums.n = double(s.x.size());
+    if (s.x.size() < minOverlap) return sums;
+    averageRanks(s.x, s.order, s.rx);
+    averageRanks(s.y, s.order, s.ry);
+    for (int i = 0; i < s.rx.size(); ++i) {
+        const double x = s.rx.at(i), y = s.ry.at(i);
+        sums.sx += x;
+        sums.sy += y;
+        sums.sxx += x * x;
+        sums.syy += y * y;
+        sums.sxy += x * y;
+    }
+    return sums;
+}
+
+} // namespace
+
+CorrelationMatrix::Result CorrelationMatrix::compute(const QList<MeasurementDataPtr>& series, const Options& options)
+{
+    AQM_TRACE_SCOPE("CorrelationMatrix::compute", "analysis");
+    QList<MeasurementDataPtr> used;
+    for (const MeasurementDataPtr& data : series) {
+        if (data) used.append(data);
+    }
+    const int n = int(used.size());
+    Result result;
+    result.size = n;
+    for (const MeasurementDataPtr& data : used) {
+        result.sensorIds.append(data->sensorId);
+        result.keys.append(data->key);
+    }
+    result.r.fill(std::numeric_limits<double>::quiet_NaN(), n * n);
+    result.lag.fill(0, n * n);
+    result.overlap.fill(0, n * n);
+
+    // Wspólna siatka godzin: od pierwszego do ostatniego odczytu wszystkich serii w zakresie
+    auto inRange = [&options](const MeasurementData& data, QList<Measurement>::const_iterator& begin,
+                              QList<Measurement>::const_iterator& end) {
+        begin = std::lower_bound(data.values.cbegin(), data.values.cend(), options.from,
+                                 [](const Measurement& m, qint64 t) { return m.date.toMSecsSinceEpoch() < t; });
+        end = std::upper_bound(begin, data.values.cend(), options.to,
+                               [](qint64 t, const Measurement& m) { return t < m.date.toMSecsSinceEpoch(); });
+    };
+    qint64 first = std::numeric_limits<qint64>::max();
+    qint64 last = std::numeric_limits<qint64>::min();
+    for (const MeasurementDataPtr& data : used) {
+        QList<Measurement>::const_iterator begin, end;
+        inRange(*data, begin, end);
+        if (begin == end) continue;
+        first = qMin(first, begin->date.toMSecsSinceEpoch());
+        last = qMax(last, (end - 1)->date.toMSecsSinceEpoch());
+    }
+    if (n == 0 || first > last) return result;
+    const qint64 start = first - first % HourMs;
+    const int hours = int((last - start) / HourMs) + 1;
+    result.hours = hours;
+
+    // Wyrównanie - niezależnie dla każdej serii
+    QVector<AlignedSeries> aligned(n);
+    AlignedSeries* alignedData = aligned.data();
+    QVector<int> rows(n);
+    std::iota(rows.begin(), rows.end(), 0);
+    QtConcurrent::blockingMap(rows, [&](const int& i) {
+        AlignedSeries& s = alignedData[i];
+        s.value.fill(0.0f, hours);
+        s.mask.fill(0, hours);
+        QList<Measurement>::const_iterator begin, end;
+        inRange(*used.at(i), begin, end);
+        for (auto it = begin; it != end; ++it) {
+            if (!it->date.isValid() || !it->isUsable()) continue;
+            const int slot = int((it->date.toMSecsSinceEpoch() - start) / HourMs);
+            s.value[slot] = float(it->value.toDouble());
+            s.mask[slot] = 1;
+        }
+    });
+
+    // Pary (i, j >= i) - wiersz na zadanie; pula wątków wyrównuje różną długość wierszy
+    const int maxLag = qBound(0, options.maxLag, hours - 1);
+    double* r = result.r.data();
+    int* lags = result.lag.data();
+    int* overlaps = result.overlap.data();
+    const bool ranked = options.method == Method::Spearman;
+    QtConcurrent::blockingMap(rows, [&](const int& i) {
+        RankScratch scratch;
+        for (int j = i; j < n; ++j) {
+            double bestR = std::numeric_limits<double>::quiet_NaN();
+            int bestLag = 0, bestOverlap = 0;
+            const int lagLimit = i == j ? 0 : maxLag;
+            for (int lag = -lagLimit; lag <= lagLimit; ++lag) {
+                const PairSums sums = ranked ? rankedPairSums(aligned.at(i), aligned.at(j), lag, hours, options.minOverlap, scratch)
+                                             : pairSums(aligned.at(i), aligned.at(j), lag, hours);
+                if (sums.n < options.minOverlap) continue;
+                const double pairR = sums.correlation();
+                if (std::isnan(pairR)) continue;
+                if (std::isnan(bestR) || std::abs(pairR) > std::abs(bestR)) {
+                    bestR = pairR;
+                    bestLag = lag;
+                    bestOverlap = int(sums.n);
+                }
+            }
+            // Każde zadanie pisze tylko do komórek własnego wiersza i ich odbić
+            r[i * n + j] = r[j * n + i] = bestR;
+            lags[i * n + j] = bestLag;
+            lags[j * n + i] = -bestLag;
+            overlaps[i * n + j] = overlaps[j * n + i] = bestOverlap;
+        }
+    });
+    return result;
+}
+
+QRgb CorrelationMatrix::colorFor(double r)
+{
+    if (std::isnan(r)) return qRgb(200, 200, 200);
+    const double t = qBound(-1.0, r, 1.0);
+    const int fade = int(255 * (1.0 - std::abs(t)));
+    return t >= 0 ? qRgb(255, fade, fade) : qRgb(fade, fade, 255);
+}
+
+QImage CorrelationMatrix::heatmap(const Result& result, const QStringList& labels, int maxSide)
+{
+    const int n = result.size;
+    if (n == 0) return QImage();
+
+    // Komórki jako piksele małego obrazu, skalowanego bez wygładzania
+    QImage cells(n, n, QImage::Format_RGB32);
+    for (int i = 0; i < n; ++i) {
+        QRgb* line = reinterpret_cast<QRgb*>(cells.scanLine(i));
+        for (int j = 0; j < n; ++j) line[j] = colorFor(result.at(i, j));
+    }
+    const int cell = qMax(1, maxSide / n);
+    const int side = cell * n;
+    const bool showLabels = cell >= 12 && labels.size() == n;
+
+    QFont font;
+    font.setPixelSize(qBound(9, cell - 3, 13));
+    const QFontMetrics metrics(font);
+    int labelWidth = 0;
+    if (showLabels) {
+        for (const QString& label : labels) labelWidth = qMax(labelWidth, metrics.horizontalAdvance(label));
+        labelWidth += 8;
+    }
+    const int legendHeight = 40;
+    QImage image(labelWidth + side + 10, labelWidth + side + legendHeight + 10, QImage::Format_RGB32);
+    image.fill(Qt::white);
+    QPainter painter(&image);
+    painter.setFont(font);
+    const QRect area(labelWidth, labelWidth, side, side);
+    painter.drawImage(area, cells);
+
+    if (showLabels) {
+        painter.setPen(Qt::black);
+        for (int i = 0; i < n; ++i) {
+            painter.drawText(QRect(0, labelWidth + i * cell, labelWidth - 4, cell), Qt::AlignRight | Qt::AlignVCenter, labels.at(i));
+            painter.save();
+            painter.translate(labelWidth + i * cell, labelWidth - 4);
+            painter.rotate(-90);
+            painter.drawText(QRect(0, 0, labelWidth - 4, cell), Qt::AlignLeft | Qt::AlignVCenter, labels.at(i));
+            painter.restore();
+        }
+    }
+    painter.setPen(Qt::darkGray);
+    painter.drawRect(area.adjusted(0, 0, -1, -1));
+
+    // Legenda: skala -1..+1
+    const QRect legend(labelWidth, labelWidth + side + 8, qMin(side, 300), 12);
+    for (int x = 0; x < legend.width(); ++x) {
+        painter.setPen(QColor(colorFor(-1.0 + 2.0 * x / qMax(1, legend.width() - 1))));
+        painter.drawLine(legend.left() + x, legend.top(), legend.left() + x, legend.bottom());
+    }
+    painter.setPen(Qt::black);
+    painter.drawText(QRect(legend.left(), legend.bottom() + 2, legend.width(), metrics.height()), Qt::AlignLeft, "-1");
+    painter.drawText(QRect(legend.left(), legend.bottom() + 2, legend.width(), metrics.height()), Qt::AlignHCenter, "0");
+    painter.drawText(QRect(legend.left(), legend.bottom() + 2, legend.width(), metrics.height()), Qt::AlignRight, "+1");
+    painter.end();
+    return image;
+}
@@ -0,0 +1,77 @@
+#ifndef CORRELATIONMATRIX_H
+#define CORRELATIONMATRIX_H
+
+#include <QImage>
+#include <QList>
+#include <QStringList>
+#include <QVector>
+#include <limits>
+#include "giosapiclient.h" // MeasurementData, MeasurementDataPtr
+
+/**
+ * @file correlationmatrix.h
+ * @brief Definicja klasy CorrelationMatrix - macierzy korelacji wielu serii pomiarowych.
+ */
+
+/**
+ * @class CorrelationMatrix
+ * @brief Liczy macierz korelacji (Pearsona lub Spearmana) serii wyrównanych do siatki godzinowej.
+ *
+ * Każda seria jest rzutowana na wspólną siatkę godzin zakresu: tablica wartości float (0 dla
+ * braków) i bajtowa maska obecności. Suma dla pary to wtedy kilka iloczynów tablic bez rozgałęzień,
+ * które kompilator wektoryzuje; braki są pomijane parami (pairwise complete). Dla Spearmana rangi
+ * (średnie rangi dla remisów) są liczone osobno dla każdej pary i opóźnienia, tylko w podzbiorze
+ * godzin, w których obie serie mają odczyt.
+ *
+ * Opóźnienie: dla maxLag > 0 para jest liczona dla przesunięć -maxLag..maxLag godzin
+ * (kolumna j przesunięta względem wiersza i) i zapamiętywana jest korelacja o największym |r|.
+ * Wiersze macierzy są liczone równolegle (QtConcurrent). compute() blokuje do końca obliczeń,
+ * więc interfejs wywołuje je w tle (QtConcurrent::run).
+ */
+class CorrelationMatrix
+{
+public:
+    /** @brief Rodzaj korelacji. */
+    enum class Method { Pearson, Spearman };
+
+    /** @brief Parametry obliczeń. */
+    struct Options {
+        Method method = Method::Pearson;
+        qint64 from = std::numeric_limits<qint64>::min();   ///< Początek zakresu (ms od epoki, włącznie).
+        qint64 to = std::numeric_limits<qint64>::max();     ///< Koniec zakresu (ms od epoki, włącznie).
+        int maxLag = 0;                                     ///< Największe sprawdzane opóźnienie (godziny).
+        int minOverlap = 24;                                ///< Minimalna liczba wspólnych godzin pary.
+    };
+
+    /** @brief Wynik: macierze N x N w układzie wierszowym. */
+    struct Result {
+        int size = 0;                   ///< Liczba serii (N).
+        QList<int> sensorIds;           ///< ID sensorów w kolejności wierszy.
+        QStringList keys;               ///< Klucze parametrów w kolejności wierszy.
+        int hours = 0;                  ///< Długość wspólnej siatki (godziny).
+        QVector<double> r;              ///< Współczynniki korelacji (NaN - za mało wspólnych godzin).
+        QVector<int> lag;               ///< Opóźnienie (godziny) z największym |r|: wartość j z chwili t+lag względem i z chwili t.
+        QVector<int> overlap;           ///< Liczba wspólnych godzin dla wybranego opóźnienia.
+        double at(int i, int j) const { return r.at(i * size + j); }
+    };
+
+    /**
+     * @brief Liczy macierz korelacji serii.
+     * @param series Serie posortowane rosnąco po dacie (puste wskaźniki są pomijane).
+     * @param options Metoda, zakres i opóźnienia.
+     */
+    static Result compute(const QList<MeasurementDataPtr>& series, const Options& options);
+
+    /**
+     * @brief Rysuje macierz jako mapę cieplną (niebieski -1, biały 0, czerwony +1, szary - brak).
+     * @param result Wynik compute().
+     * @param labels Etykiety wierszy/kolumn (pomijane, gdy komórki są zbyt małe).
+     * @param maxSide Największy rozmiar obszaru komórek (px).
+     */
+    static QImage heatmap(const Result& result, const QStringList& labels, int maxSide = 900);
+
+    /** @brief Kolor współczynnika korelacji w skali mapy cieplnej. */
+    static QRgb colorFor(double r);
+};
+
+#endif // CORRELATIONMATRIX_H
@@ -0,0 +1,282 @@
+#include "csvexporter.h"
+#include "tracing.h"
+
+#include <QDebug>
+#include <QDir>
+#include <QFileInfo>
+#include <QFuture>
+#include <QIODevice>
+#include <QSaveFile>
+#include <QThreadPool>
+#include <QVector>
+#include <QtConcurrent/QtConcurrentMap>
+
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+
+namespace {
+
+/** @brief Fragment układu Long: zakres odczytów jednej serii. */
+struct LongTask {
+    int series = 0;
+    qsizetype begin = 0;
+    qsizetype end = 0;
+};
+
+/** @brief Fragment układu Wide: zakres wierszy (indeksów osi czasu). */
+struct WideTask {
+    qsizetype begin = 0;
+    qsizetype end = 0;
+};
+
+/** @brief Zakres [first, last) odczytów serii mieszczących się w przedziale [from, to]. */
+void rangeOf(const QList<Measurement>& values, const QDateTime& from, const QDateTime& to, qsizetype& first, qsizetype& last)
+{
+    auto begin = values.cbegin();
+    auto end = values.cend();
+    if (from.isValid())
+        begin = std::lower_bound(begin, end, from, [](const Measurement& m, const QDateTime& d) { return m.date < d; });
+    if (to.isValid())
+        end = std::upper_bound(begin, end, to, [](const QDateTime& d, const Measurement& m) { return d < m.date; });
+    first = begin - values.cbegin();
+    last = end - values.cbegin();
+}
+
+/** @brief Pole CSV - w cudzysłowie, jeśli zawiera przecinek, cudzysłów lub znak nowej linii. */
+QByteArray csvField(const QString& text)
+{
+    QByteArray utf8 = text.toUtf8();
+    if (!utf8.contains(',') && !utf8.contains('"') && !utf8.contains('\n')) return utf8;
+    utf8.replace("\"", "\"\"");
+    return '"' + utf8 + '"';
+}
+
+/**
+ * @brief Formatuje zadania równolegle i zapisuje wyniki w kolejności.
+ * Następna fala jest formatowana w trakcie zapisu bieżącej; w pamięci są najwyżej dwie fale.
+ */
+template<typename Task, typename Format>
+bool writeInWaves(const QVector<Task>& tasks, Format format, QIODevice* device, qint64& bytes, QString* errorString)
+{
+    const int waveSize = qMax(1, QThreadPool::globalInstance()->maxThreadCount() * 4);
+    auto startWave = [&tasks, &format, waveSize](qsizetype first) {
+        return QtConcurrent::mapped(tasks.mid(first, waveSize), format);
+    };
+
+    QFuture<QByteArray> current = startWave(0);
+    bool ok = true;
+    for (qsizetype first = 0; first < tasks.size() && ok; first += waveSize) {
+        QFuture<QByteArray> next;
+        if (first + waveSize < tasks.size()) next = startWave(first + waveSize);
+        const int count = int(qMin<qsizetype>(waveSize, tasks.size() - first));
+        for (int i = 0; i < count && ok; ++i) {
+            const QByteArray chunk = current.resultAt(i); // Czeka na fragment i (wyniki w kolejności zadań)
+            if (device->write(chunk) != chunk.size()) {
+                if (errorString) *errorString = device->errorString();
+                ok = false;
+            }
+            bytes += chunk.size();
+        }
+        current.waitForFinished();
+        current = next;
+    }
+    current.waitForFinished(); // Funkcja formatująca korzysta z danych wywołującego
+    return ok;
+}
+
+} // namespace
+
+void CsvExporter::appendNumber(QByteArray& out, double value)
+{
+    if (!std::isfinite(value) || std::fabs(value) >= 1e12) {
+        out += QByteArray::number(value, 'g', 15);
+        return;
+    }
+    qint64 scaled = qint64(std::llround(value * 1e6));
+    if (scaled < 0) {
+        out += '-';
+        scaled = -scaled;
+    }
+    qint64 integral = scaled / 1000000;
+    int fraction = int(scaled % 1000000);
+
+    char buffer[32];
+    int n = 0;
+    do {
+        buffer[n++] = char('0' + integral % 10);
+        integral /= 10;
+    } while (integral > 0);
+    std::reverse(buffer, buffer + n);
+    if (fraction > 0) {
+        int digits = 6;
+        while (fraction % 10 == 0) { fraction /= 10; --digits; }
+        buffer[n++] = '.';
+        for (int i = digits - 1; i >= 0; --i) {
+            buffer[n + i] = char('0' + fraction % 10);
+            fraction /= 10;
+        }
+        n += digits;
+    }
+    out.append(buffer, n);
+}
+
+void CsvExporter::appendDateTime(QByteArray& out, const QDateTime& dateTime)
+{
+    const QDate date = dateTime.date();
+    const QTime time = dateTime.time();
+    const int year = date.year();
+    char buffer[19] = {
+        char('0' + year / 1000 % 10), char('0' + year / 100 % 10), char('0' + year / 10 % 10), char('0' + year % 10), '-',
+        char('0' + date.month() / 10), char('0' + date.month() % 10), '-',
+        char('0' + date.day() / 10), char('0' + date.day() % 10), ' ',
+        char('0' + time.hour() / 10), char('0' + time.hour() % 10), ':',
+        char('0' + time.minute() / 10), char('0' + time.minute() % 10), ':',
+        char('0' + time.second() / 10), char('0' + time.second() % 10),
+    };
+    out.append(buffer, 19);
+}
+
+bool CsvExporter::exportToFile(const QList<MeasurementDataPtr>& series, const QString& fileName, const Options& options,
+                               Result* result, QString* errorString)
+{
+    QDir().mkpath(QFileInfo(fileName).absolutePath());
+    QSaveFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly)) {
+        if (errorString) *errorString = file.errorString();
+        return false;
+    }
+    if (!exportToDevice(series, &file, options, result, errorString)) {
+        file.cancelWriting();
+        return false;
+    }
+    if (!file.commit()) {
+        if (errorString) *errorString = file.errorString();
+        return false;
+    }
+    return true;
+}
+
+bool CsvExporter::exportToDevice(const QList<MeasurementDataPtr>& series, QIODevice* device, const Options& options,
+                                 Result* result, QString* errorString)
+{
+    AQM_TRACE_SCOPE("CsvExporter::export", "io");
+    Result summary;
+    const int rowsPerChunk = qMax(256, options.rowsPerChunk);
+
+    // Zakres odczytów każdej serii (wyszukiwanie binarne - serie są posortowane)
+    QList<MeasurementDataPtr> used;
+    QVector<qsizetype> firsts, lasts;
+    for (const MeasurementDataPtr& data : series) {
+        if (!data) continue;
+        qsizetype first = 0, last = 0;
+        rangeOf(data->values, options.from, options.to, first, last);
+        used.append(data);
+        firsts.append(first);
+        lasts.append(last);
+    }
+    summary.sensors = int(used.size());
+
+    QByteArray header;
+    bool ok = true;
+    auto writeHeader = [device, errorString, &summary](const QByteArray& text) {
+        if (device->write(text) != text.size()) {
+            if (errorString) *errorString = device->errorString();
+            return false;
+        }
+        summary.bytes += text.size();
+        return true;
+    };
+    if (options.layout == Layout::Long) {
+        header = "date,sensor,key,value\n";
+        ok = writeHeader(header);
+
+        QVector<LongTask> tasks;
+        QVector<QByteArray> keys;
+        for (int s = 0; s < used.size(); ++s) {
+            keys.append(csvField(used.at(s)->key));
+            for (qsizetype b = firsts.at(s); b < lasts.at(s); b += rowsPerChunk)
+                tasks.append(LongTask{s, b, qMin<qsizetype>(b + rowsPerChunk, lasts.at(s))});
+            summary.rows += lasts.at(s) - firsts.at(s);
+        }
+        auto format = [&used, &keys](const LongTask& task) {
+            const MeasurementData& data = *used.at(task.series);
+            QByteArray prefix = QByteArray::number(data.sensorId);
+            prefix += ',';
+            prefix += keys.at(task.series);
+            prefix += ',';
+            QByteArray out;
+            out.reserve((task.end - task.begin) * (32 + prefix.size()));
+            for (qsizetype i = task.begin; i < task.end; ++i) {
+                const Measurement& m = data.values.at(i);
+                appendDateTime(out, m.date);
+                out += ',';
+                out += prefix;
+                if (!m.value.isNull()) appendNumber(out, m.value.toDouble());
+                out += '\n';
+            }
+            return out;
+        };
+        ok = ok && writeInWaves(tasks, format, device, summary.bytes, errorString);
+    } else {
+        // Wspólna oś czasu: suma zbiorów znaczników wszystkich serii (scalanie posortowanych ciągów)
+        QVector<qint64> timeline, times, merged;
+        for (int s = 0; s < used.size(); ++s) {
+            times.clear();
+            times.reserve(lasts.at(s) - firsts.at(s));
+            for (qsizetype i = firsts.at(s); i < lasts.at(s); ++i) {
+                const qint64 t = used.at(s)->values.at(i).date.toMSecsSinceEpoch();
+                if (times.isEmpty() || times.last() != t) times.append(t);
+            }
+            merged.clear();
+            merged.reserve(timeline.size() + times.size());
+            std::set_union(timeline.cbegin(), timeline.cend(), times.cbegin(), times.cend(), std::back_inserter(merged));
+            timeline.swap(merged);
+        }
+        summary.rows = timeline.size();
+
+        header = "date";
+        for (const MeasurementDataPtr& data : used) header += ',' + csvField(QString("%1_%2").arg(data->key).arg(data->sensorId));
+        header += '\n';
+        ok = writeHeader(header);
+
+        QVector<WideTask> tasks;
+        for (qsizetype b = 0; b < timeline.size(); b += rowsPerChunk)
+            tasks.append(WideTask{b, qMin<qsizetype>(b + rowsPerChunk, timeline.size())});
+        auto format = [&used, &firsts, &lasts, &timeline](const WideTask& task) {
+            // Kursor w każdej serii ustawiany binarnie na początek fragmentu, dalej przesuwany liniowo
+            const qint64 startTime = timeline.at(task.begin);
+            QVector<qsizetype> cursor(used.size());
+            for (int s = 0; s < used.size(); ++s) {
+                const QList<Measurement>& values = used.at(s)->values;
+                cursor[s] = std::lower_bound(values.cbegin() + firsts.at(s), values.cbegin() + lasts.at(s), startTime,
+                                             [](const Measurement& m, qint64 t) { return m.date.toMSecsSinceEpoch() < t; })
+                            - values.cbegin();
+            }
+            QByteArray out;
+            out.reserve((task.end - task.begin) * (20 + 8 * used.size()));
+            for (qsizetype row = task.begin; row < task.end; ++row) {
+                const qint64 t = timeline.at(row);
+                appendDateTime(out, QDateTime::fromMSecsSinceEpoch(t));
+                for (int s = 0; s < used.size(); ++s) {
+                    out += ',';
+                    const QList<Measurement>& values = used.at(s)->values;
+                    qsizetype& c = cursor[s];
+                    while (c < lasts.at(s) && values.at(c).date.toMSecsSinceEpoch() < t) ++c;
+                    if (c < lasts.at(s) && values.at(c).date.toMSecsSinceEpoch() == t) {
+                        if (!values.at(c).value.isNull()) appendNumber(out, values.at(c).value.toDouble());
+                        ++c;
+                    }
+                }
+                out += '\n';
+            }
+            return out;
+        };
+        ok = ok && writeInWaves(tasks, format, device, summary.bytes, errorString);
+    }
+
+    if (ok && errorString) errorString->clear();
+    if (result) *result = summary;
+    qDebug() << "CsvExporter: Zapisano" << summary.rows << "wierszy," << summary.sensors << "serii," << summary.bytes / 1024 << "kB";
+    return ok;
+}
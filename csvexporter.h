@@ -0,0 +1,74 @@
+#ifndef CSVEXPORTER_H
+#define CSVEXPORTER_H
+
+#include <QByteArray>
+#include <QDateTime>
+#include <QList>
+#include <QString>
+#include "giosapiclient.h" // MeasurementData, MeasurementDataPtr
+
+class QIODevice;
+
+/**
+ * @file csvexporter.h
+ * @brief Definicja klasy CsvExporter - zbiorczego eksportu wielu serii do CSV.
+ */
+
+/**
+ * @class CsvExporter
+ * @brief Eksportuje serie wielu sensorów z zadanego zakresu czasu do pliku CSV.
+ *
+ * Układy:
+ * - Long - jeden wiersz na odczyt: `date,sensor,key,value`,
+ * - Wide - jeden wiersz na chwilę czasu, jedna kolumna na sensor (wartości wyrównane po czasie;
+ *   brak odczytu lub null = puste pole).
+ *
+ * Formatowanie liczb i dat (dominujący koszt eksportu) jest dzielone na fragmenty
+ * formatowane równolegle (QtConcurrent), a gotowe fragmenty są zapisywane w kolejności
+ * dużymi blokami. Fragmenty przetwarzane są falami, więc w pamięci znajdują się
+ * najwyżej dwie fale, a zapis kolejnej fali pokrywa się z formatowaniem następnej.
+ */
+class CsvExporter
+{
+public:
+    /** @brief Układ pliku CSV. */
+    enum class Layout { Long, Wide };
+
+    /** @brief Parametry eksportu. */
+    struct Options {
+        Layout layout = Layout::Long;
+        QDateTime from;              ///< Początek zakresu (włącznie); niepoprawny = bez ograniczenia.
+        QDateTime to;                ///< Koniec zakresu (włącznie); niepoprawny = bez ograniczenia.
+        int rowsPerChunk = 16384;    ///< Liczba wierszy formatowanych w jednym zadaniu.
+    };
+
+    /** @brief Podsumowanie eksportu. */
+    struct Result {
+        qint64 rows = 0;             ///< Liczba wierszy danych (bez nagłówka).
+        qint64 bytes = 0;            ///< Rozmiar zapisanych danych.
+        int sensors = 0;             ///< Liczba wyeksportowanych serii.
+    };
+
+    /**
+     * @brief Eksportuje serie do pliku (zapis atomowy przez QSaveFile).
+     * @param series Serie posortowane rosnąco po dacie (puste wskaźniki są pomijane).
+     * @param fileName Plik docelowy.
+     * @param options Układ i zakres czasu.
+     * @param result Opcjonalne podsumowanie.
+     * @param errorString Opcjonalny komunikat błędu.
+     * @return true, jeśli zapis się powiódł.
+     */
+    static bool exportToFile(const QList<MeasurementDataPtr>& series, const QString& fileName, const Options& options,
+                             Result* result = nullptr, QString* errorString = nullptr);
+
+    /** @brief Wariant exportToFile() zapisujący do otwartego urządzenia. */
+    static bool exportToDevice(const QList<MeasurementDataPtr>& series, QIODevice* device, const Options& options,
+                               Result* result = nullptr, QString* errorString = nullptr);
+
+    /** @brief Dopisuje liczbę w zapisie dziesiętnym (do 6 miejsc po przecinku, bez zbędnych zer). */
+    static void appendNumber(QByteArray& out, double value);
+    /** @brief Dopisuje datę w formacie "yyyy-MM-dd HH:mm:ss" (jak w API GIOŚ). */
+    static void appendDateTime(QByteArray& out, const QDateTime& dateTime);
+};
+
+#endif // CSVEXPORTER_H
@@ -0,0 +1,163 @@
+#include "faultdetector.h"
+#include "tracing.h"
+
+#include <QStringList>
+#include <QVarLengthArray>
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+constexpr qint64 HourMs = 3600LL * 1000;
+/** @brief Jak długo pamiętane są oznaczenia (API zwraca ok. 3 ostatnich dni). */
+constexpr qint64 RecentMs = 7 * 24 * HourMs;
+
+/** @brief Mediana wartości (niszczy kolejność w buforze). */
+double median(QVarLengthArray<double, 64>& values)
+{
+    const auto middle = values.begin() + values.size() / 2;
+    std::nth_element(values.begin(), middle, values.end());
+    return *middle;
+}
+
+} // namespace
+
+FaultDetector::FaultDetector()
+    : ranges(defaultRanges())
+{
+}
+
+QHash<QString, FaultDetector::Range> FaultDetector::defaultRanges()
+{
+    // Górne granice wielokrotnie przekraczają najwyższe stężenia notowane w Polsce
+    return {
+        {"PM10", {0.0, 2000.0}},
+        {"PM2.5", {0.0, 1500.0}},
+        {"NO2", {0.0, 1000.0}},
+        {"NO", {0.0, 2000.0}},
+        {"NOx", {0.0, 3000.0}},
+        {"SO2", {0.0, 2000.0}},
+        {"O3", {0.0, 800.0}},
+        {"CO", {0.0, 50000.0}},
+        {"C6H6", {0.0, 300.0}},
+    };
+}
+
+void FaultDetector::setOptions(const Options& newOptions)
+{
+    opts = newOptions;
+    opts.flatlineHours = qMax(2, opts.flatlineHours);
+    opts.window = qBound(4, opts.window, 64);
+    opts.minWindow = qBound(3, opts.minWindow, opts.window);
+    reset(); // Okna mają inną długość
+}
+
+QString FaultDetector::describe(quint8 flags)
+{
+    QStringList parts;
+    if (flags & OutOfRange) parts << "poza zakresem";
+    if (flags & Flatline) parts << "płaski przebieg";
+    if (flags & Spike) parts << "skok";
+    return parts.join(", ");
+}
+
+void FaultDetector::addRange(SensorState& state, qint64 from, qint64 to, quint8 flags)
+{
+    // Kolejne oznaczenia tego samego rodzaju (np. trwający płaski przebieg) wydłużają ostatni przedział
+    if (!state.recent.isEmpty()) {
+        FlagRange& last = state.recent.last();
+        if (last.flags == flags && from <= last.to + 2 * HourMs && to >= last.from) {
+            last.from = qMin(last.from, from);
+            last.to = qMax(last.to, to);
+            return;
+        }
+    }
+    if (state.recent.size() >= MaxRecentRanges) state.recent.removeFirst();
+    state.recent.append(FlagRange{from, to, flags});
+}
+
+void FaultDetector::evaluate(SensorState& state, const Range& range, qint64 time, double value)
+{
+    ++evaluated;
+    // Wartość niemożliwa fizycznie nie wchodzi do okna ani do płaskiego przebiegu
+    if (value < range.min || value > range.max) {
+        addRange(state, time, time, OutOfRange);
+        ++flagged;
+        return;
+    }
+
+    // Płaski przebieg: identyczne wartości w kolejnych godzinach (przerwa > 2 h zaczyna nowy przebieg)
+    if (state.runLength > 0 && value == state.runValue && time - state.runLast <= 2 * HourMs) {
+        ++state.runLength;
+        state.runLast = time;
+        if (state.runLength >= opts.flatlineHours) {
+            addRange(state, state.runStart, time, Flatline);
+            flagged += state.runLength == opts.flatlineHours ? opts.flatlineHours : 1;
+        }
+    } else {
+        state.runValue = value;
+        state.runLength = 1;
+        state.runStart = state.runLast = time;
+    }
+
+    // Skok: odporny z-score względem mediany i MAD okna (przed dopisaniem bieżącej wartości)
+    if (state.window.size() >= opts.minWindow) {
+        QVarLengthArray<double, 64> scratch(state.window.cbegin(), state.window.cend());
+        const double center = median(scratch);
+        for (double& x : scratch) x = std::abs(x - center);
+        const double mad = qMax(median(scratch), opts.minMad);
+        if (std::abs(value - center) / (1.4826 * mad) > opts.spikeZ) {
+            addRange(state, time, time, Spike);
+            ++flagged;
+        }
+    }
+    if (state.window.size() < opts.window) {
+        state.window.append(value);
+    } else {
+        state.window[state.windowHead] = value;
+        state.windowHead = (state.windowHead + 1) % opts.window;
+    }
+}
+
+MeasurementDataPtr FaultDetector::apply(const MeasurementDataPtr& data)
+{
+    if (!data || data->sensorId < 0 || data->values.isEmpty()) return data;
+    AQM_TRACE_SCOPE("FaultDetector::apply", "analysis");
+    SensorState& state = sensors[data->sensorId];
+    const Range range = ranges.value(data->key, Range());
+    const QList<Measurement>& values = data->values;
+
+    // Tylko odczyty nowsze niż ostatnio oceniony, do ostatniej wartości (końcowe null GIOŚ uzupełnia później)
+    auto begin = values.cbegin();
+    if (state.lastTime != 0) {
+        begin = std::upper_bound(values.cbegin(), values.cend(), state.lastTime,
+                                 [](qint64 t, const Measurement& m) { return t < m.date.toMSecsSinceEpoch(); });
+    }
+    for (auto it = begin; it != values.cend(); ++it) {
+        if (!it->date.isValid() || it->value.isNull()) continue;
+        const qint64 time = it->date.toMSecsSinceEpoch();
+        evaluate(state, range, time, it->value.toDouble());
+        state.lastTime = time;
+    }
+    while (!state.recent.isEmpty() && state.recent.first().to < state.lastTime - RecentMs) state.recent.removeFirst();
+
+    // Nałożenie oznaczeń z zakresu migawki (kopia tylko wtedy, gdy coś jest oznaczone)
+    const qint64 first = values.first().date.toMSecsSinceEpoch();
+    const qint64 last = values.last().date.toMSecsSinceEpoch();
+    const bool overlaps = std::any_of(state.recent.cbegin(), state.recent.cend(),
+                                      [first, last](const FlagRange& r) { return r.to >= first && r.from <= last; });
+    if (!overlaps) return data;
+
+    QSharedPointer<MeasurementData> marked = QSharedPointer<MeasurementData>::create(*data);
+    QList<Measurement>& out = marked->values;
+    for (const FlagRange& r : state.recent) {
+        if (r.to < first || r.from > last) continue;
+        auto it = std::lower_bound(out.begin(), out.end(), r.from,
+                                   [](const Measurement& m, qint64 t) { return m.date.toMSecsSinceEpoch() < t; });
+        for (; it != out.end() && it->date.toMSecsSinceEpoch() <= r.to; ++it) {
+            if (!it->value.isNull()) it->flags |= r.flags;
+        }
+    }
+    return marked;
+}
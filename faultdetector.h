@@ -0,0 +1,113 @@
+#ifndef FAULTDETECTOR_H
+#define FAULTDETECTOR_H
+
+#include <QHash>
+#include <QString>
+#include <QVector>
+#include "giosapiclient.h" // MeasurementData, MeasurementDataPtr
+
+/**
+ * @file faultdetector.h
+ * @brief Definicja klasy FaultDetector - strumieniowego wykrywania błędów sensorów.
+ */
+
+/**
+ * @class FaultDetector
+ * @brief Oznacza podejrzane odczyty (Measurement::flags) w miarę napływu danych każdego sensora.
+ *
+ * Trzy testy, każdy ze stałą pamięcią na sensor:
+ * - zakres: wartość ujemna lub większa niż fizycznie możliwa dla parametru (Flag::OutOfRange),
+ * - płaski przebieg: co najmniej `flatlineHours` kolejnych godzin z identyczną wartością
+ *   (licznik długości serii; oznaczana jest cała seria, także odczyty sprzed przekroczenia progu),
+ * - skok: odporny z-score |x - mediana| / (1,4826 * MAD) z ostatnich `window` wartości (bufor cykliczny).
+ *
+ * Podobnie jak AlertEngine detektor ocenia tylko odczyty nowsze niż ostatnio ocenione. API zwraca
+ * jednak za każdym razem kilka ostatnich dni, więc oznaczenia z tego okresu są pamiętane jako
+ * krótka lista przedziałów czasu (najwyżej MaxRecentRanges) i nakładane ponownie na przesłane
+ * jeszcze raz odczyty. Seria bez żadnego oznaczenia w swoim zakresie jest przekazywana bez kopii.
+ */
+class FaultDetector
+{
+public:
+    /** @brief Flagi jakości odczytu (bity Measurement::flags). */
+    enum Flag : quint8 {
+        OutOfRange = 0x01,  ///< Wartość poza zakresem fizycznym parametru.
+        Flatline = 0x02,    ///< Wartość stała przez wiele godzin.
+        Spike = 0x04        ///< Nagły skok względem mediany okna.
+    };
+
+    /** @brief Dopuszczalny zakres wartości parametru (µg/m³). */
+    struct Range {
+        double min = 0.0;
+        double max = 100000.0;
+    };
+
+    /** @brief Parametry testów. */
+    struct Options {
+        int flatlineHours = 6;          ///< Minimalna długość płaskiego przebiegu (kolejne odczyty).
+        int window = 24;                ///< Długość okna mediany/MAD (odczyty).
+        int minWindow = 12;             ///< Minimalna liczba wartości w oknie przed oceną skoków.
+        double spikeZ = 6.0;            ///< Próg odpornego z-score.
+        double minMad = 2.0;            ///< Dolne ograniczenie MAD (chroni przed dzieleniem przez ~0 przy spokojnym przebiegu).
+    };
+
+    FaultDetector();
+
+    /** @brief Zakresy fizyczne parametrów monitorowanych przez GIOŚ (klucz = kod parametru). */
+    static QHash<QString, Range> defaultRanges();
+
+    void setOptions(const Options& newOptions);
+    const Options& options() const { return opts; }
+    void setRanges(const QHash<QString, Range>& newRanges) { ranges = newRanges; }
+
+    /**
+     * @brief Ocenia nowe odczyty sensora i zwraca migawkę z ustawionymi flagami.
+     * @param data Seria posortowana rosnąco po dacie (serie bez ID sensora są zwracane bez zmian).
+     * @return Ta sama migawka, jeśli w jej zakresie nic nie oznaczono, w przeciwnym razie kopia z flagami.
+     */
+    MeasurementDataPtr apply(const MeasurementDataPtr& data);
+
+    /** @brief Zeruje stan wszystkich sensorów. */
+    void reset() { sensors.clear(); }
+
+    /** @brief Liczba odczytów ocenionych od utworzenia/wyzerowania. */
+    quint64 evaluatedReadings() const { return evaluated; }
+    /** @brief Liczba oznaczonych odczytów (nowych; ponowne nałożenie nie jest liczone). */
+    quint64 flaggedReadings() const { return flagged; }
+
+    /** @brief Opis flag do wyświetlenia (np. "płaski przebieg, skok"). */
+    static QString describe(quint8 flags);
+
+    /** @brief Najwięcej pamiętanych przedziałów oznaczeń na sensor. */
+    static constexpr int MaxRecentRanges = 64;
+
+private:
+    /** @brief Oznaczony przedział czasu [from, to] (ms od epoki). */
+    struct FlagRange {
+        qint64 from = 0;
+        qint64 to = 0;
+        quint8 flags = 0;
+    };
+    struct SensorState {
+        qint64 lastTime = 0;            ///< Ostatni oceniony odczyt (ms; 0 = brak).
+        double runValue = 0.0;          ///< Wartość bieżącego płaskiego przebiegu.
+        int runLength = 0;
+        qint64 runStart = 0;            ///< Czas pierwszego odczytu przebiegu (ms).
+        qint64 runLast = 0;             ///< Czas ostatniego odczytu przebiegu (ms).
+        QVector<double> window;         ///< Bufor cykliczny ostatnich wartości.
+        int windowHead = 0;
+        QVector<FlagRange> recent;      ///< Ostatnie oznaczenia (do ponownego nałożenia).
+    };
+
+    /** @brief Ocenia jeden odczyt i dopisuje oznaczenia do state.recent. */
+    void evaluate(SensorState& state, const Range& range, qint64 time, double value);
+    void addRange(SensorState& state, qint64 from, qint64 to, quint8 flags);
+
+    Options opts;
+    QHash<QString, Range> ranges;
+    QHash<int, SensorState> sensors;    ///< ID sensora -> stan.
+    quint64 evaluated = 0;
+    quint64 flagged = 0;
+};
+
+#endif // FAULTDETECTOR_H
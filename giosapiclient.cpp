@@ -1,4 +1,6 @@
 #include "giosapiclient.h"
+#include "tracing.h"
+#include "jsondecoder.h"
 
 // Includy Qt
 #include <QNetworkAccessManager>
@@ -9,75 +11,477 @@
 #include <QJsonArray>
 #include <QJsonParseError>
 #include <QUrl>
+#include <QUrlQuery>
 #include <QDebug>        // Dla qWarning
 #include <algorithm>     // Dla std::sort
 #include <QScopedPointer> // Dla bezpiecznego zarządzania QNetworkReply
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QRandomGenerator>
+#include <QTimer>
+#ifndef QT_NO_SSL
+#include <QSslConfiguration>
+#endif
+
+// === Schematy JSON odpowiedzi API (wspólne dla klienta, plików zapisu i benchmarku) ===
+
+template<>
+struct JsonSchema<StationInfo> {
+    static constexpr const char* name = "stacja";
+    static constexpr std::array<JsonField<StationInfo>, 5> fields = {{
+        JsonField<StationInfo>::required("id", &JsonAssign::integer<StationInfo, &StationInfo::id>),
+        JsonField<StationInfo>::optional("stationName", &JsonAssign::string<StationInfo, &StationInfo::stationName>,
+                                         [](StationInfo& s) { s.stationName = QString("Stacja bez nazwy (ID: %1)").arg(s.id); }),
+        JsonField<StationInfo>::optional("city.name", &JsonAssign::string<StationInfo, &StationInfo::cityName>,
+                                         [](StationInfo& s) { s.cityName = "Nieznane"; }),
+        // Współrzędne API podaje jako tekst (np. "50.972167")
+        JsonField<StationInfo>::optional("gegrLat", &JsonAssign::numberOrText<StationInfo, &StationInfo::latitude>),
+        JsonField<StationInfo>::optional("gegrLon", &JsonAssign::numberOrText<StationInfo, &StationInfo::longitude>),
+    }};
+};
+
+template<>
+struct JsonSchema<SensorInfo> {
+    static constexpr const char* name = "sensor";
+    static constexpr std::array<JsonField<SensorInfo>, 6> fields = {{
+        JsonField<SensorInfo>::required("id", &JsonAssign::integer<SensorInfo, &SensorInfo::id>),
+        JsonField<SensorInfo>::optional("param.paramName", &JsonAssign::string<SensorInfo, &SensorInfo::paramName>,
+                                        [](SensorInfo& s) { s.paramName = "Brak nazwy"; }),
+        JsonField<SensorInfo>::optional("param.paramFormula", &JsonAssign::string<SensorInfo, &SensorInfo::paramFormula>,
+                                        [](SensorInfo& s) { s.paramFormula = "?"; }),
+        JsonField<SensorInfo>::optional("param.paramCode", &JsonAssign::string<SensorInfo, &SensorInfo::paramCode>,
+                                        [](SensorInfo& s) { s.paramCode = "Brak kodu"; }),
+        JsonField<SensorInfo>::optional("param.idParam", &JsonAssign::integer<SensorInfo, &SensorInfo::idParam>,
+                                        [](SensorInfo& s) { s.idParam = -1; }),
+        // Bez obiektu 'param' (a nie tylko bez jego pól) sensor jest oznaczany jak dotychczas: "Brak danych"/"ERROR"
+        JsonField<SensorInfo>::optional("param", [](SensorInfo&, const QJsonValue& v) { return v.isObject(); },
+                                        [](SensorInfo& s) {
+                                            qWarning() << "GiosApiClient: Brak obiektu 'param' dla sensora id:" << s.id;
+                                            s.paramName = "Brak danych"; s.paramFormula = "?"; s.paramCode = "ERROR"; s.idParam = -1;
+                                        }),
+    }};
+};
+
+template<>
+struct JsonSchema<Measurement> {
+    static constexpr const char* name = "pomiar";
+    static constexpr std::array<JsonField<Measurement>, 2> fields = {{
+        JsonField<Measurement>::required("date", &JsonAssign::dateTime<Measurement, &Measurement::date>),
+        JsonField<Measurement>::required("value", &JsonAssign::nullableDouble<Measurement, &Measurement::value>),
+    }};
+};
+
+namespace {
+
+bool assignMeasurementValues(MeasurementData& data, const QJsonValue& value)
+{
+    if (!value.isArray()) return false;
+    JsonDecoder::decodeArray(value.toArray(), data.values);
+    return true;
+}
+
+/** @brief Brak tablicy 'values' nie jest błędem odpowiedzi API - seria jest pusta (ostrzeżenie w logu). */
+void warnMissingValues(MeasurementData& data)
+{
+    qWarning() << "GiosApiClient: Brak tablicy 'values' w danych pomiarowych dla klucza" << data.key;
+}
+
+/** @brief Liczba stron odpowiedzi stronicowanej: pole totalPages lub numer strony z links.last (0 = odpowiedź bez stron). */
+int pageCountOf(const QJsonDocument& jsonDoc)
+{
+    if (!jsonDoc.isObject()) return 0;
+    const QJsonObject object = jsonDoc.object();
+    const QJsonValue total = object.value(QLatin1String("totalPages"));
+    if (total.isDouble()) return total.toInt();
+    const QString last = object.value(QLatin1String("links")).toObject().value(QLatin1String("last")).toString();
+    bool ok = false;
+    const int lastPage = QUrlQuery(QUrl(last)).queryItemValue("page").toInt(&ok);
+    return ok ? lastPage + 1 : 0;
+}
+
+/** @brief Tablica rekordów strony: pierwsze pole obiektu będące tablicą. */
+bool pageItems(const QJsonObject& object, QJsonArray& items)
+{
+    for (auto it = object.constBegin(); it != object.constEnd(); ++it) {
+        if (it.value().isArray()) {
+            items = it.value().toArray();
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace
+
+template<>
+struct JsonSchema<MeasurementData> {
+    static constexpr const char* name = "dane pomiarowe";
+    static constexpr std::array<JsonField<MeasurementData>, 2> fields = {{
+        JsonField<MeasurementData>::optional("key", &JsonAssign::string<MeasurementData, &MeasurementData::key>,
+                                             [](MeasurementData& d) { d.key = "Nieznany"; }),
+        JsonField<MeasurementData>::optional("values", &assignMeasurementValues, &warnMissingValues),
+    }};
+};
 
 // Konstruktor
 GiosApiClient::GiosApiClient(QObject *parent)
     : QObject(parent)
+    , apiBaseUrl(QString::fromLatin1(DefaultBaseUrl))
 {
     // Inicjalizujemy managera sieciowego, ustawiając rodzica,
     // aby Qt zarządzało jego pamięcią.
     networkManager = new QNetworkAccessManager(this);
+    clock.start(); // Wspólny zegar monotoniczny dla pomiaru faz żądań
 }
 
-// === Metody publiczne inicjujące żądania ===
+// === Konfiguracja ===
 
-void GiosApiClient::fetchAllStations()
+void GiosApiClient::setBaseUrl(const QUrl& baseUrl)
 {
-    QUrl url("https://api.gios.gov.pl/pjp-api/rest/station/findAll");
+    QUrl url = baseUrl;
+    // Bez końcowego ukośnika QUrl::resolved() zastąpiłby ostatni segment ścieżki
+    if (!url.path().endsWith('/')) url.setPath(url.path() + '/');
+    apiBaseUrl = url;
+    qDebug() << "GiosApiClient: Adres bazowy API:" << apiBaseUrl.toString();
+}
+
+void GiosApiClient::setRecordDirectory(const QString& directory)
+{
+    recordDir = directory;
+    if (!recordDir.isEmpty()) qDebug() << "GiosApiClient: Nagrywanie odpowiedzi do:" << recordDir;
+}
+
+void GiosApiClient::warmUpConnection()
+{
+    AQM_TRACE_SCOPE("warmUpConnection", "net");
+    const QString host = apiBaseUrl.host();
+    if (host.isEmpty()) return;
+
+    if (apiBaseUrl.scheme() == "https") {
+#ifndef QT_NO_SSL
+        // ALPN z h2 - serwer obsługujący HTTP/2 wynegocjuje je już przy rozgrzewaniu
+        QSslConfiguration sslConfig = QSslConfiguration::defaultConfiguration();
+        sslConfig.setAllowedNextProtocols({QSslConfiguration::ALPNProtocolHTTP2, QSslConfiguration::NextProtocolHttp1_1});
+        networkManager->connectToHostEncrypted(host, quint16(apiBaseUrl.port(443)), sslConfig);
+#endif
+    } else {
+        networkManager->connectToHost(host, quint16(apiBaseUrl.port(80)));
+    }
+    qDebug() << "GiosApiClient: Rozgrzewanie połączenia z" << host;
+}
+
+QUrl GiosApiClient::endpointUrl(const QString& path) const
+{
+    QUrl url = apiBaseUrl.resolved(QUrl(path));
+    if (requestedPageSize > 0) {
+        QUrlQuery query;
+        query.addQueryItem("page", "0");
+        query.addQueryItem("size", QString::number(requestedPageSize));
+        url.setQuery(query);
+    }
+    return url;
+}
+
+int GiosApiClient::pageOf(const QUrl& url)
+{
+    return qMax(0, QUrlQuery(url).queryItemValue("page").toInt());
+}
+
+GiosApiClient::PagedFetch* GiosApiClient::acceptPage(const QUrl& url, quint64 fetchId, int pageCount, const QString& endpoint, FinishHandler handler)
+{
+    const int page = pageOf(url);
+    if (page == 0) {
+        // Pierwsza strona podaje liczbę stron - pozostałe są pobierane naraz (HTTP/2 multipleksuje je w jednym połączeniu)
+        PagedFetch fetch;
+        fetch.pageCount = qBound(1, pageCount, int(MaxPages));
+        fetch.done.fill(false, fetch.pageCount);
+        fetch.stations.resize(fetch.pageCount);
+        fetch.sensors.resize(fetch.pageCount);
+        fetch.values.resize(fetch.pageCount);
+        pagedFetches.insert(fetchId, fetch);
+        for (int p = 1; p < fetch.pageCount; ++p) {
+            QUrlQuery query(url);
+            query.removeAllQueryItems("page");
+            query.addQueryItem("page", QString::number(p));
+            QUrl pageUrl = url;
+            pageUrl.setQuery(query);
+            sendRequest(pageUrl, endpoint, handler, 1, fetchId);
+        }
+    }
+    auto it = pagedFetches.find(fetchId);
+    if (it == pagedFetches.end() || page >= it->pageCount || it->done.at(page)) return nullptr;
+    it->done[page] = true;
+    ++it->received;
+    return &it.value();
+}
+
+bool GiosApiClient::abandonPagedFetch(const QUrl& url, quint64 fetchId)
+{
+    if (!QUrlQuery(url).hasQueryItem("page")) return true;
+    // Strona 0 nie założyła jeszcze stanu - jej błąd jest jedynym sygnałem pobierania
+    return pagedFetches.remove(fetchId) > 0 || pageOf(url) == 0;
+}
+
+void GiosApiClient::recordResponse(const QUrl& url, const QByteArray& body) const
+{
+    if (recordDir.isEmpty()) return;
+    // Ścieżka względem adresu bazowego, np. "station/sensors/114"
+    QString relative = url.path();
+    if (relative.startsWith(apiBaseUrl.path())) relative = relative.mid(apiBaseUrl.path().size());
+    if (QUrlQuery(url).hasQueryItem("page")) relative += QString(".page%1").arg(pageOf(url)); // np. "station/findAll.page2"
+    QFileInfo target(QDir(recordDir).filePath(relative + ".json"));
+    if (!QDir().mkpath(target.absolutePath())) {
+        qWarning() << "GiosApiClient: Nie można utworzyć katalogu nagrania:" << target.absolutePath();
+        return;
+    }
+    QFile file(target.absoluteFilePath());
+    if (!file.open(QIODevice::WriteOnly) || file.write(body) == -1) {
+        qWarning() << "GiosApiClient: Nie można zapisać nagrania:" << target.absoluteFilePath() << file.errorString();
+    }
+}
+
+// === Wysyłanie żądań i pomiar faz ===
+
+void GiosApiClient::setRetryPolicy(const RetryPolicy& newPolicy)
+{
+    policy = newPolicy;
+    breakers.clear(); // Nowe progi obowiązują od następnego żądania
+}
+
+CircuitBreaker& GiosApiClient::breakerFor(const QString& endpoint)
+{
+    auto it = breakers.find(endpoint);
+    if (it == breakers.end())
+        it = breakers.insert(endpoint, CircuitBreaker(policy.breakerFailureThreshold, policy.breakerOpenMs));
+    return it.value();
+}
+
+quint64 GiosApiClient::sendRequest(const QUrl& url, const QString& endpoint, FinishHandler handler, int attempt, quint64 fetchId)
+{
+    if (fetchId == 0) fetchId = ++lastFetchId;
+    CircuitBreaker& breaker = breakerFor(endpoint);
+    if (!breaker.allowRequest(clock.elapsed())) {
+        // Obwód otwarty - nie obciążamy serwera, błąd zgłaszamy asynchronicznie jak odpowiedź sieciową
+        RequestTiming rejected;
+        rejected.endpoint = endpoint;
+        rejected.attempt = attempt;
+        requestMetrics.record(rejected);
+        const QString errorMsg = QString("Endpoint %1 chwilowo niedostępny - wstrzymano żądania na %2 s (URL: %3)")
+                                     .arg(endpoint).arg((breaker.remainingOpenMs(clock.elapsed()) + 999) / 1000)
+                                     .arg(url.toString());
+        QMetaObject::invokeMethod(this, [this, url, fetchId, errorMsg]() {
+            if (abandonPagedFetch(url, fetchId)) emit networkError(errorMsg); // Jeden błąd na pobieranie, nie na stronę
+        }, Qt::QueuedConnection);
+        return fetchId;
+    }
+
     QNetworkRequest request(url);
-    qDebug() << "GiosApiClient: Wysyłanie żądania stacji...";
+    // HTTP/2 pozwala zmultipleksować serię żądań w jednym połączeniu zamiast do 6 połączeń HTTP/1.1
+    request.setAttribute(QNetworkRequest::Http2AllowedAttribute, true);
+
+    PendingRequest pending;
+    pending.url = url;
+    pending.endpoint = endpoint;
+    pending.handler = handler;
+    pending.attempt = attempt;
+    pending.fetchId = fetchId;
+    pending.timing.endpoint = endpoint;
+    pending.timing.attempt = attempt;
+    pending.timing.startNs = clock.nsecsElapsed();
     QNetworkReply *reply = networkManager->get(request);
+    inFlight.insert(reply, pending);
+
+#if QT_VERSION >= QT_VERSION_CHECK(6, 3, 0)
+    // Emitowany tylko wtedy, gdy trzeba nawiązać nowe połączenie (DNS + TCP + TLS)
+    connect(reply, &QNetworkReply::socketStartedConnecting, this, [this, reply]() { markPhase(reply, &RequestTiming::connectStartNs); });
+    connect(reply, &QNetworkReply::requestSent, this, [this, reply]() { markPhase(reply, &RequestTiming::requestSentNs); });
+#endif
+    connect(reply, &QNetworkReply::metaDataChanged, this, [this, reply]() { markPhase(reply, &RequestTiming::headersNs); });
+    if (policy.transferTimeoutMs > 0) {
+        // Własny licznik bezczynności zamiast setTransferTimeout(): oba przerywają żądanie z OperationCanceledError,
+        // ale tylko tu wiadomo, że przyczyną był limit czasu (jawne abort() nie jest ponawiane)
+        QTimer *idleTimer = new QTimer(reply);
+        idleTimer->setSingleShot(true);
+        idleTimer->setInterval(policy.transferTimeoutMs);
+        connect(reply, &QNetworkReply::downloadProgress, idleTimer, [idleTimer]() { idleTimer->start(); });
+        connect(reply, &QNetworkReply::finished, idleTimer, &QTimer::stop);
+        connect(idleTimer, &QTimer::timeout, this, [this, reply]() {
+            auto it = inFlight.find(reply);
+            if (it == inFlight.end()) return;
+            it->timedOut = true;
+            reply->abort();
+        });
+        idleTimer->start();
+    }
     // Łączymy sygnał finished z odpowiednim slotem obsługującym
-    connect(reply, &QNetworkReply::finished, this, [this, reply]() { this->onFetchStationsFinished(reply); });
+    connect(reply, &QNetworkReply::finished, this, [this, reply, handler]() { (this->*handler)(reply); });
+    return fetchId;
+}
+
+void GiosApiClient::markPhase(QNetworkReply *reply, qint64 RequestTiming::*phase)
+{
+    auto it = inFlight.find(reply);
+    if (it != inFlight.end() && it->timing.*phase == 0) it->timing.*phase = clock.nsecsElapsed();
+}
+
+GiosApiClient::PendingRequest GiosApiClient::takeRequest(QNetworkReply *reply)
+{
+    PendingRequest pending = inFlight.take(reply);
+    RequestTiming& timing = pending.timing;
+    timing.finishedNs = clock.nsecsElapsed();
+    timing.http2 = reply->attribute(QNetworkRequest::Http2WasUsedAttribute).toBool();
+    if (Tracer::isEnabled() && timing.startNs > 0) {
+        // Część sieciowa nie jest zakresem w kodzie - odtwarzamy ją ze znaczników żądania
+        const qint64 durationUs = (timing.finishedNs - timing.startNs) / 1000;
+        Tracer::addCompleteEvent("network", "net", Tracer::nowUs() - durationUs, durationUs, reply->url().path());
+    }
+    return pending;
+}
+
+bool GiosApiClient::isTransientError(QNetworkReply *reply, bool timedOut)
+{
+    const int status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    if (status >= 500 || status == 429) return true;
+    switch (reply->error()) {
+    case QNetworkReply::TimeoutError:
+    case QNetworkReply::OperationCanceledError:
+        return timedOut; // Ponawiamy tylko przerwanie przez limit czasu, nie jawne abort()
+    case QNetworkReply::RemoteHostClosedError:
+    case QNetworkReply::ConnectionRefusedError:
+    case QNetworkReply::TemporaryNetworkFailureError:
+    case QNetworkReply::NetworkSessionFailedError:
+    case QNetworkReply::ProxyTimeoutError:
+    case QNetworkReply::UnknownNetworkError:
+    case QNetworkReply::InternalServerError:
+    case QNetworkReply::ServiceUnavailableError:
+    case QNetworkReply::UnknownServerError:
+        return true;
+    default:
+        return false;
+    }
+}
+
+int GiosApiClient::retryDelayMs(QNetworkReply *reply, int attempt) const
+{
+    // Wykładniczo: base * 2^(attempt-1), z rozrzutem w przedziale [50%, 100%],
+    // aby ponowienia wielu żądań nie trafiały w serwer jednocześnie
+    const qint64 exponential = qint64(policy.baseDelayMs) << qMin(attempt - 1, 20);
+    const int capped = int(qMin<qint64>(policy.maxDelayMs, exponential));
+    int delay = capped / 2 + int(QRandomGenerator::global()->bounded(capped / 2 + 1));
+
+    // Serwer może wskazać minimalny czas oczekiwania (503/429 z nagłówkiem Retry-After w sekundach)
+    bool ok = false;
+    const int retryAfterSec = reply->rawHeader("Retry-After").trimmed().toInt(&ok);
+    if (ok && retryAfterSec > 0) delay = qMax(delay, qMin(policy.maxDelayMs, retryAfterSec * 1000));
+    return delay;
+}
+
+void GiosApiClient::markEndpointHealthy(const QString& endpoint)
+{
+    if (breakerFor(endpoint).recordSuccess()) {
+        qDebug() << "GiosApiClient: Endpoint" << endpoint << "znów odpowiada - wznowiono żądania.";
+        emit circuitStateChanged(endpoint, false);
+    }
+}
+
+void GiosApiClient::handleFailedReply(QNetworkReply *reply, const PendingRequest& request, const QString& errorMsg)
+{
+    requestMetrics.record(request.timing);
+
+    if (!isTransientError(reply, request.timedOut)) {
+        markEndpointHealthy(request.endpoint); // Serwer odpowiedział (np. 404) - to nie jest awaria
+        if (!abandonPagedFetch(request.url, request.fetchId)) return;
+        emit networkError(errorMsg);
+        return;
+    }
+
+    if (breakerFor(request.endpoint).recordFailure(clock.elapsed())) {
+        qWarning() << "GiosApiClient: Otwarto obwód dla endpointu" << request.endpoint << "na" << policy.breakerOpenMs << "ms";
+        emit circuitStateChanged(request.endpoint, true);
+    }
+
+    if (request.attempt >= policy.maxAttempts) {
+        if (!abandonPagedFetch(request.url, request.fetchId)) return;
+        emit networkError(request.attempt > 1 ? QString("%1 (po %2 próbach)").arg(errorMsg).arg(request.attempt) : errorMsg);
+        return;
+    }
+
+    // Strona porzuconego pobierania (inna strona już zgłosiła błąd) nie jest ponawiana
+    if (pageOf(request.url) > 0 && !pagedFetches.contains(request.fetchId)) return;
+
+    const int delay = retryDelayMs(reply, request.attempt);
+    const int nextAttempt = request.attempt + 1;
+    qDebug() << "GiosApiClient: Ponowienie" << request.endpoint << "za" << delay << "ms, próba" << nextAttempt;
+    if (Tracer::isEnabled()) Tracer::addInstantEvent("retry", "net", QString("%1 attempt=%2 delay=%3ms").arg(request.url.path()).arg(nextAttempt).arg(delay));
+    emit requestRetrying(request.endpoint, nextAttempt, delay);
+    ++scheduledRetries;
+    QTimer::singleShot(delay, this, [this, request, nextAttempt]() {
+        --scheduledRetries;
+        sendRequest(request.url, request.endpoint, request.handler, nextAttempt, request.fetchId);
+    });
+}
+
+// === Metody publiczne inicjujące żądania ===
+
+void GiosApiClient::fetchAllStations()
+{
+    AQM_TRACE_SCOPE("fetchAllStations", "net");
+    QUrl url = endpointUrl("station/findAll");
+    qDebug() << "GiosApiClient: Wysyłanie żądania stacji...";
+    sendRequest(url, "stations", &GiosApiClient::onFetchStationsFinished);
 }
 
 void GiosApiClient::fetchSensorsForStation(int stationId)
 {
-    QUrl url(QString("https://api.gios.gov.pl/pjp-api/rest/station/sensors/%1").arg(stationId));
-    QNetworkRequest request(url);
+    AQM_TRACE_SCOPE_DETAIL("fetchSensorsForStation", "net", QString("stationId=%1").arg(stationId));
+    QUrl url = endpointUrl(QString("station/sensors/%1").arg(stationId));
     qDebug() << "GiosApiClient: Wysyłanie żądania sensorów dla stacji ID:" << stationId;
-    QNetworkReply *reply = networkManager->get(request);
-    connect(reply, &QNetworkReply::finished, this, [this, reply]() { this->onFetchSensorsFinished(reply); });
+    sendRequest(url, "sensors", &GiosApiClient::onFetchSensorsFinished);
 }
 
-void GiosApiClient::fetchMeasurementData(int sensorId)
+quint64 GiosApiClient::fetchMeasurementData(int sensorId)
 {
-    QUrl url(QString("https://api.gios.gov.pl/pjp-api/rest/data/getData/%1").arg(sensorId));
-    QNetworkRequest request(url);
+    AQM_TRACE_SCOPE_DETAIL("fetchMeasurementData", "net", QString("sensorId=%1").arg(sensorId));
+    QUrl url = endpointUrl(QString("data/getData/%1").arg(sensorId));
     qDebug() << "GiosApiClient: Wysyłanie żądania danych dla sensora ID:" << sensorId;
-    QNetworkReply *reply = networkManager->get(request);
-    connect(reply, &QNetworkReply::finished, this, [this, reply]() { this->onFetchMeasurementDataFinished(reply); });
+    return sendRequest(url, "data", &GiosApiClient::onFetchMeasurementDataFinished);
 }
 
 // === Sloty prywatne obsługujące odpowiedzi sieciowe ===
 
 void GiosApiClient::onFetchStationsFinished(QNetworkReply *reply)
 {
+    AQM_TRACE_SCOPE("onFetchStationsFinished", "net");
     // Używamy QScopedPointer, aby zapewnić automatyczne wywołanie deleteLater()
     QScopedPointer<QNetworkReply, QScopedPointerDeleteLater> replyGuard(reply);
     if (!reply) {
         qWarning() << "GiosApiClient: onFetchStationsFinished - pusty reply!";
         return;
     }
+    PendingRequest request = takeRequest(reply);
+    RequestTiming& timing = request.timing;
 
     // Sprawdzamy błąd sieciowy
     if (reply->error() != QNetworkReply::NoError) {
         QString errorMsg = "Błąd sieciowy (stacje): " + reply->errorString();
         qWarning() << errorMsg << "URL:" << reply->url().toString();
-        emit networkError(errorMsg);
+        handleFailedReply(reply, request, errorMsg);
         return;
     }
+    markEndpointHealthy(request.endpoint);
 
     // Odczyt i parsowanie danych
     QByteArray jsonData = reply->readAll();
-    parseStationsJson(jsonData);
+    timing.bytes = jsonData.size();
+    recordResponse(reply->url(), jsonData);
+    parseStationsJson(jsonData, reply->url(), request.fetchId, timing);
+    requestMetrics.record(timing);
 }
 
 void GiosApiClient::onFetchSensorsFinished(QNetworkReply *reply)
 {
+    AQM_TRACE_SCOPE("onFetchSensorsFinished", "net");
     QScopedPointer<QNetworkReply, QScopedPointerDeleteLater> replyGuard(reply);
     if (!reply) return;
 
@@ -86,184 +490,261 @@ void GiosApiClient::onFetchSensorsFinished(QNetworkReply *reply)
     QStringList parts = reply->url().path().split('/');
     if (!parts.isEmpty()) { bool ok; int id = parts.last().toInt(&ok); if (ok) stationIdFromUrl = id; }
     if(stationIdFromUrl == -1) qWarning() << "GiosApiClient: Nie można wyodrębnić ID stacji z URL:" << reply->url();
+    PendingRequest request = takeRequest(reply);
+    RequestTiming& timing = request.timing;
 
     if (reply->error() != QNetworkReply::NoError) {
         QString errorMsg = QString("Błąd sieciowy (sensory, URL: %1): %2")
                                .arg(reply->url().toString()).arg(reply->errorString());
         qWarning() << errorMsg;
-        emit networkError(errorMsg);
+        handleFailedReply(reply, request, errorMsg);
         return;
     }
+    markEndpointHealthy(request.endpoint);
 
     QByteArray jsonData = reply->readAll();
-    parseSensorsJson(jsonData, stationIdFromUrl);
+    timing.bytes = jsonData.size();
+    recordResponse(reply->url(), jsonData);
+    parseSensorsJson(jsonData, reply->url(), request.fetchId, stationIdFromUrl, timing);
+    requestMetrics.record(timing);
 }
 
 void GiosApiClient::onFetchMeasurementDataFinished(QNetworkReply *reply)
 {
+    AQM_TRACE_SCOPE("onFetchMeasurementDataFinished", "net");
     QScopedPointer<QNetworkReply, QScopedPointerDeleteLater> replyGuard(reply);
     if (!reply) return;
 
+    // Wyodrębnij ID sensora z URL (odbiorcy rozróżniają po nim odpowiedzi, np. tryb na żywo)
+    int sensorIdFromUrl = -1;
+    QStringList parts = reply->url().path().split('/');
+    if (!parts.isEmpty()) { bool ok; int id = parts.last().toInt(&ok); if (ok) sensorIdFromUrl = id; }
+    PendingRequest request = takeRequest(reply);
+    RequestTiming& timing = request.timing;
+
     if (reply->error() != QNetworkReply::NoError) {
         QString errorMsg = QString("Błąd sieciowy (dane pomiarowe, URL: %1): %2")
                                .arg(reply->url().toString()).arg(reply->errorString());
         qWarning() << errorMsg;
-        emit networkError(errorMsg);
+        handleFailedReply(reply, request, errorMsg);
         return;
     }
+    markEndpointHealthy(request.endpoint);
 
     QByteArray jsonData = reply->readAll();
-    parseMeasurementDataJson(jsonData);
+    timing.bytes = jsonData.size();
+    recordResponse(reply->url(), jsonData);
+    parseMeasurementDataJson(jsonData, reply->url(), request.fetchId, sensorIdFromUrl, timing);
+    requestMetrics.record(timing);
 }
 
 
-// === Prywatne metody parsowania JSON ===
+// === Dekodowanie JSON (bez efektów ubocznych, używane także przez benchmark) ===
 
-void GiosApiClient::parseStationsJson(const QByteArray& jsonData)
+bool GiosApiClient::parseJsonDocument(const QByteArray& jsonData, const QString& what, QJsonDocument& jsonDoc, QString* errorString)
 {
     QJsonParseError parseError;
-    QJsonDocument jsonDoc = QJsonDocument::fromJson(jsonData, &parseError);
-
+    jsonDoc = QJsonDocument::fromJson(jsonData, &parseError);
     if (parseError.error != QJsonParseError::NoError) {
-        QString errorMsg = "Błąd parsowania JSON (stacje): " + parseError.errorString();
-        qWarning() << errorMsg; emit networkError(errorMsg); return;
+        if (errorString) *errorString = QString("Błąd parsowania JSON (%1): %2").arg(what, parseError.errorString());
+        return false;
     }
-    if (!jsonDoc.isArray()) {
-        QString errorMsg = "Błąd formatu JSON (stacje): Oczekiwano tablicy.";
-        qWarning() << errorMsg; emit networkError(errorMsg); return;
+    return true;
+}
+
+bool GiosApiClient::decodeStations(const QByteArray& jsonData, QList<StationInfo>& stationsList, QString* errorString)
+{
+    stationsList.clear();
+    QJsonDocument jsonDoc;
+    return parseJsonDocument(jsonData, "stacje", jsonDoc, errorString)
+           && decodeStations(jsonDoc, stationsList, errorString);
+}
+
+bool GiosApiClient::decodeStations(const QJsonDocument& jsonDoc, QList<StationInfo>& stationsList, QString* errorString)
+{
+    stationsList.clear();
+    QJsonArray items;
+    if (jsonDoc.isArray()) items = jsonDoc.array();
+    else if (!jsonDoc.isObject() || !pageItems(jsonDoc.object(), items)) { // Strona: obiekt z tablicą rekordów
+        if (errorString) *errorString = "Błąd formatu JSON (stacje): Oczekiwano tablicy.";
+        return false;
     }
+    JsonDecoder::decodeArray(items, stationsList);
+    return true;
+}
 
-    QList<StationInfo> stationsList;
-    QJsonArray stationsArray = jsonDoc.array();
-    stationsList.reserve(stationsArray.count());
-
-    for (const QJsonValue &value : stationsArray) {
-        if (value.isObject()) {
-            QJsonObject stationObj = value.toObject();
-            StationInfo station;
-
-            if (stationObj.contains("id") && stationObj["id"].isDouble()) {
-                station.id = static_cast<int>(stationObj["id"].toDouble());
-            } else {
-                qWarning() << "GiosApiClient: Pomijam stację - brak/niepoprawne 'id'"; continue;
-            }
-
-            station.stationName = stationObj.value("stationName").toString(QString("Stacja bez nazwy (ID: %1)").arg(station.id));
-
-            if (stationObj.contains("city") && stationObj["city"].isObject()) {
-                station.cityName = stationObj["city"].toObject().value("name").toString("Nieznane");
-            } else {
-                station.cityName = "Nieznane";
-            }
-            stationsList.append(station);
-        }
+bool GiosApiClient::decodeSensors(const QByteArray& jsonData, int stationId, QList<SensorInfo>& sensorsList, QString* errorString)
+{
+    sensorsList.clear();
+    QJsonDocument jsonDoc;
+    return parseJsonDocument(jsonData, "sensory", jsonDoc, errorString)
+           && decodeSensors(jsonDoc, stationId, sensorsList, errorString);
+}
+
+bool GiosApiClient::decodeSensors(const QJsonDocument& jsonDoc, int stationId, QList<SensorInfo>& sensorsList, QString* errorString)
+{
+    sensorsList.clear();
+    QJsonArray items;
+    if (jsonDoc.isArray()) items = jsonDoc.array();
+    else if (jsonDoc.isNull()) return true; // Pusta odpowiedź - brak sensorów
+    else if (!jsonDoc.isObject() || !pageItems(jsonDoc.object(), items)) {
+        if (errorString) *errorString = "Błąd formatu JSON (sensory): Oczekiwano tablicy.";
+        return false;
     }
-    emit stationsFetched(stationsList);
+    SensorInfo init;
+    init.stationId = stationId;
+    JsonDecoder::decodeArray(items, sensorsList, init);
+    return true;
 }
 
-void GiosApiClient::parseSensorsJson(const QByteArray& jsonData, int stationId)
+bool GiosApiClient::decodeMeasurementData(const QByteArray& jsonData, MeasurementData& measurementData, QString* errorString)
 {
-    QJsonParseError parseError;
-    QJsonDocument jsonDoc = QJsonDocument::fromJson(jsonData, &parseError);
+    measurementData = MeasurementData();
+    QJsonDocument jsonDoc;
+    return parseJsonDocument(jsonData, "dane", jsonDoc, errorString)
+           && decodeMeasurementData(jsonDoc, measurementData, errorString);
+}
 
-    if (parseError.error != QJsonParseError::NoError) {
-        QString errorMsg = "Błąd parsowania JSON (sensory): " + parseError.errorString();
-        qWarning() << errorMsg; emit networkError(errorMsg); return;
-    }
-    if (!jsonDoc.isArray()) {
-        if (jsonDoc.isNull() || (jsonDoc.isArray() && jsonDoc.array().isEmpty())) {
-            emit sensorsFetched({}); return;
-        } else {
-            QString errorMsg = "Błąd formatu JSON (sensory): Oczekiwano tablicy.";
-            qWarning() << errorMsg; emit networkError(errorMsg); return;
-        }
+bool GiosApiClient::decodeMeasurementData(const QJsonDocument& jsonDoc, MeasurementData& measurementData, QString* errorString)
+{
+    measurementData = MeasurementData();
+    if (!jsonDoc.isObject()) {
+        if (errorString) *errorString = "Błąd formatu JSON (dane): Oczekiwano obiektu.";
+        return false;
     }
 
-    QList<SensorInfo> sensorsList;
-    QJsonArray sensorsArray = jsonDoc.array();
-    sensorsList.reserve(sensorsArray.count());
-
-    for (const QJsonValue &value : sensorsArray) {
-        if (value.isObject()) {
-            QJsonObject sensorObj = value.toObject();
-            SensorInfo sensor;
-            sensor.stationId = stationId;
-
-            if (sensorObj.contains("id") && sensorObj["id"].isDouble()) {
-                sensor.id = static_cast<int>(sensorObj["id"].toDouble());
-            } else {
-                qWarning() << "GiosApiClient: Pomijam sensor - brak/niepoprawne 'id' dla stacji" << stationId; continue;
-            }
-
-            if (sensorObj.contains("param") && sensorObj["param"].isObject()) {
-                QJsonObject paramObj = sensorObj["param"].toObject();
-                sensor.paramName = paramObj.value("paramName").toString("Brak nazwy");
-                sensor.paramFormula = paramObj.value("paramFormula").toString("?");
-                sensor.paramCode = paramObj.value("paramCode").toString("Brak kodu");
-                sensor.idParam = static_cast<int>(paramObj.value("idParam").toDouble(-1.0));
-            } else {
-                qWarning() << "GiosApiClient: Brak obiektu 'param' dla sensora id:" << sensor.id;
-                sensor.paramName = "Brak danych"; sensor.paramFormula = "?"; sensor.paramCode = "ERROR"; sensor.idParam = -1;
-            }
-            sensorsList.append(sensor);
-        }
+    JsonDecoder::decodeObject(jsonDoc.object(), measurementData); // Wszystkie pola opcjonalne
+    // Sortowanie
+    if (!measurementData.values.isEmpty()) {
+        std::sort(measurementData.values.begin(), measurementData.values.end(),
+                  [](const Measurement& a, const Measurement& b) { return a.date < b.date; });
     }
-    emit sensorsFetched(sensorsList);
+    return true;
 }
 
-void GiosApiClient::parseMeasurementDataJson(const QByteArray& jsonData)
+// === Prywatne metody parsowania JSON ===
+
+void GiosApiClient::parseStationsJson(const QByteArray& jsonData, const QUrl& url, quint64 fetchId, RequestTiming& timing)
 {
-    QJsonParseError parseError;
-    QJsonDocument jsonDoc = QJsonDocument::fromJson(jsonData, &parseError);
+    AQM_TRACE_SCOPE("parseStationsJson", "parse");
+    QList<StationInfo> stationsList;
+    QString errorMsg;
+    QJsonDocument jsonDoc;
+    bool ok = parseJsonDocument(jsonData, "stacje", jsonDoc, &errorMsg);
+    timing.jsonDoneNs = clock.nsecsElapsed();
+    ok = ok && decodeStations(jsonDoc, stationsList, &errorMsg);
+    timing.decodeDoneNs = clock.nsecsElapsed();
+    if (!ok) {
+        qWarning() << errorMsg;
+        if (abandonPagedFetch(url, fetchId)) emit networkError(errorMsg);
+        return;
+    }
+    timing.records = int(stationsList.size());
+    timing.ok = true;
+
+    const int pageCount = pageCountOf(jsonDoc);
+    if (pageCount <= 1 && pageOf(url) == 0) {
+        AQM_TRACE_SCOPE("emit stationsFetched", "ui");
+        emit stationsFetched(stationsList);
+        timing.deliveredNs = clock.nsecsElapsed();
+        return;
+    }
 
-    if (parseError.error != QJsonParseError::NoError) {
-        QString errorMsg = "Błąd parsowania JSON (dane): " + parseError.errorString();
-        qWarning() << errorMsg; emit networkError(errorMsg); return;
+    // Strona listy stacji: od razu do odbiorców, a po ostatniej - pełna lista w kolejności stron
+    PagedFetch *fetch = acceptPage(url, fetchId, pageCount, "stations", &GiosApiClient::onFetchStationsFinished);
+    if (!fetch) return;
+    const int page = pageOf(url);
+    const int pages = fetch->pageCount;
+    fetch->stations[page] = stationsList;
+    QList<StationInfo> all;
+    const bool complete = fetch->received == fetch->pageCount;
+    if (complete) {
+        for (const QList<StationInfo>& part : std::as_const(fetch->stations)) all.append(part);
+        pagedFetches.remove(fetchId); // Odbiorcy mogą od razu zacząć nowe pobieranie
     }
-    if (!jsonDoc.isObject()) {
-        QString errorMsg = "Błąd formatu JSON (dane): Oczekiwano obiektu.";
-        qWarning() << errorMsg; emit networkError(errorMsg); return;
-    }
-
-    QJsonObject mainObj = jsonDoc.object();
-    MeasurementData measurementData;
-    measurementData.key = mainObj.value("key").toString("Nieznany");
-
-    if (mainObj.contains("values") && mainObj["values"].isArray()) {
-        QJsonArray valuesArray = mainObj["values"].toArray();
-        measurementData.values.reserve(valuesArray.count());
-
-        for (const QJsonValue &value : valuesArray) {
-            if (value.isObject()) {
-                QJsonObject mObj = value.toObject();
-                Measurement m;
-
-                if (mObj.contains("date") && mObj["date"].isString()) {
-                    m.date = QDateTime::fromString(mObj["date"].toString(), "yyyy-MM-dd HH:mm:ss");
-                    if (!m.date.isValid()) {
-                        qWarning() << "GiosApiClient: Pomijam pomiar - niepoprawny format daty:" << mObj["date"].toString(); continue;
-                    }
-                } else continue; // Pomiń bez daty
-
-                if (mObj.contains("value")) {
-                    if (mObj["value"].isNull()) { m.value = QVariant(); }
-                    else if (mObj["value"].isDouble()) { m.value = mObj["value"].toDouble(); }
-                    else {
-                        qWarning() << "GiosApiClient: Pomiar - wartość nie jest double ani null, traktuję jako null. Typ:" << mObj["value"].type();
-                        m.value = QVariant();
-                    }
-                } else continue; // Pomiń bez wartości
-
-                measurementData.values.append(m);
-            }
-        }
-        // Sortowanie
-        if (!measurementData.values.isEmpty()) {
-            std::sort(measurementData.values.begin(), measurementData.values.end(),
-                      [](const Measurement& a, const Measurement& b) { return a.date < b.date; });
-        }
-    } else {
-        qWarning() << "GiosApiClient: Brak tablicy 'values' w danych pomiarowych dla klucza" << measurementData.key;
+    {
+        AQM_TRACE_SCOPE("emit stationsPageFetched", "ui");
+        emit stationsPageFetched(stationsList, page, pages);
+        if (complete) emit stationsFetched(all);
+    }
+    timing.deliveredNs = clock.nsecsElapsed();
+}
+
+void GiosApiClient::parseSensorsJson(const QByteArray& jsonData, const QUrl& url, quint64 fetchId, int stationId, RequestTiming& timing)
+{
+    AQM_TRACE_SCOPE("parseSensorsJson", "parse");
+    QList<SensorInfo> sensorsList;
+    QString errorMsg;
+    QJsonDocument jsonDoc;
+    bool ok = parseJsonDocument(jsonData, "sensory", jsonDoc, &errorMsg);
+    timing.jsonDoneNs = clock.nsecsElapsed();
+    ok = ok && decodeSensors(jsonDoc, stationId, sensorsList, &errorMsg);
+    timing.decodeDoneNs = clock.nsecsElapsed();
+    if (!ok) {
+        qWarning() << errorMsg;
+        if (abandonPagedFetch(url, fetchId)) emit networkError(errorMsg);
+        return;
+    }
+    timing.records = int(sensorsList.size());
+    timing.ok = true;
+
+    // Sensory stacji ze stron są składane w całość (odbiorcy oczekują pełnej listy stacji)
+    const int pageCount = pageCountOf(jsonDoc);
+    if (pageCount > 1 || pageOf(url) > 0) {
+        PagedFetch *fetch = acceptPage(url, fetchId, pageCount, "sensors", &GiosApiClient::onFetchSensorsFinished);
+        if (!fetch) return;
+        fetch->sensors[pageOf(url)] = sensorsList;
+        if (fetch->received < fetch->pageCount) return;
+        sensorsList.clear();
+        for (const QList<SensorInfo>& part : std::as_const(fetch->sensors)) sensorsList.append(part);
+        pagedFetches.remove(fetchId);
+    }
+    {
+        AQM_TRACE_SCOPE("emit sensorsFetched", "ui");
+        emit sensorsFetched(stationId, sensorsList);
+    }
+    timing.deliveredNs = clock.nsecsElapsed();
+}
+
+void GiosApiClient::parseMeasurementDataJson(const QByteArray& jsonData, const QUrl& url, quint64 fetchId, int sensorId, RequestTiming& timing)
+{
+    AQM_TRACE_SCOPE("parseMeasurementDataJson", "parse");
+    // Dekodowanie od razu do migawki - odbiorcy współdzielą ten egzemplarz bez kopiowania
+    const QSharedPointer<MeasurementData> measurementData = QSharedPointer<MeasurementData>::create();
+    QString errorMsg;
+    QJsonDocument jsonDoc;
+    bool ok = parseJsonDocument(jsonData, "dane", jsonDoc, &errorMsg);
+    timing.jsonDoneNs = clock.nsecsElapsed();
+    ok = ok && decodeMeasurementData(jsonDoc, *measurementData, &errorMsg);
+    timing.decodeDoneNs = clock.nsecsElapsed();
+    if (!ok) {
+        qWarning() << errorMsg;
+        if (abandonPagedFetch(url, fetchId)) emit networkError(errorMsg);
+        return;
+    }
+    measurementData->sensorId = sensorId;
+    measurementData->requestId = fetchId;
+    timing.records = int(measurementData->values.size());
+    timing.ok = true;
+
+    // Odczyty ze stron są łączone w jedną serię, posortowaną rosnąco po dacie
+    const int pageCount = pageCountOf(jsonDoc);
+    if (pageCount > 1 || pageOf(url) > 0) {
+        PagedFetch *fetch = acceptPage(url, fetchId, pageCount, "data", &GiosApiClient::onFetchMeasurementDataFinished);
+        if (!fetch) return;
+        fetch->values[pageOf(url)] = std::move(measurementData->values);
+        if (pageOf(url) == 0) fetch->key = measurementData->key;
+        if (fetch->received < fetch->pageCount) return;
+        measurementData->key = fetch->key;
+        measurementData->values.clear();
+        for (const QList<Measurement>& part : std::as_const(fetch->values)) measurementData->values.append(part);
+        pagedFetches.remove(fetchId);
+        std::sort(measurementData->values.begin(), measurementData->values.end(),
+                  [](const Measurement& a, const Measurement& b) { return a.date < b.date; });
+    }
+    {
+        AQM_TRACE_SCOPE("emit measurementDataFetched", "ui");
+        emit measurementDataFetched(measurementData);
     }
-    emit measurementDataFetched(measurementData);
+    timing.deliveredNs = clock.nsecsElapsed();
 }
@@ -6,12 +6,20 @@
 #include <QString>
 #include <QDateTime>
 #include <QVariant>
+#include <QUrl>
+#include <QHash>
+#include <QElapsedTimer>
+#include <QSharedPointer>
+#include <QtNumeric>
+#include "requestmetrics.h"
+#include "circuitbreaker.h"
 
 // === POTRZEBNE FORWARD DECLARATIONS ===
 class QNetworkAccessManager;
 class QNetworkReply;
 class QJsonObject;
 class QJsonArray;
+class QJsonDocument;
 class QByteArray;
 // =====================================
 
@@ -29,6 +37,11 @@ struct StationInfo {
     int id = -1;                ///< Unikalne ID stacji w systemie GIOŚ.
     QString stationName;        ///< Oficjalna nazwa stacji pomiarowej.
     QString cityName;           ///< Nazwa miejscowości, w której znajduje się stacja.
+    double latitude = qQNaN();  ///< Szerokość geograficzna (stopnie, WGS84; NaN = nieznana).
+    double longitude = qQNaN(); ///< Długość geograficzna (stopnie, WGS84; NaN = nieznana).
+
+    /** @brief Czy stacja ma znane współrzędne. */
+    bool hasLocation() const { return !qIsNaN(latitude) && !qIsNaN(longitude); }
 };
 
 /**
@@ -51,6 +64,10 @@ struct SensorInfo {
 struct Measurement {
     QDateTime date;             ///< Data i czas dokonania pomiaru.
     QVariant value;             ///< Zmierzona wartość. Może być typu double lub pusta (QVariant()), jeśli wartość była null.
+    quint8 flags = 0;           ///< Flagi jakości (FaultDetector::Flag); 0 = odczyt wiarygodny.
+
+    /** @brief Czy odczyt ma wartość do wykresów i statystyk (nie null i bez flag jakości). */
+    bool isUsable() const { return flags == 0 && !value.isNull(); }
 };
 
 /**
@@ -60,6 +77,30 @@ struct Measurement {
 struct MeasurementData {
     QString key;                ///< Klucz (kod) identyfikujący mierzony parametr (np. "PM10", "SO2").
     QList<Measurement> values;  ///< Lista odczytów (obiektów Measurement) dla tego parametru.
+    int sensorId = -1;          ///< ID sensora, z którego pochodzą dane (-1 dla danych z pliku).
+    quint64 requestId = 0;      ///< Żeton żądania, które zwróciło dane (0 dla danych z pliku).
+};
+
+/**
+ * @brief Niezmienna migawka danych pomiarowych współdzielona przez licznik referencji.
+ *
+ * Parser tworzy jeden egzemplarz, a sygnały (także między wątkami), wykres, tabela,
+ * analiza i zapis do pliku przekazują tylko wskaźnik. Nowe dane oznaczają nową migawkę,
+ * nigdy modyfikację istniejącej.
+ */
+using MeasurementDataPtr = QSharedPointer<const MeasurementData>;
+
+/**
+ * @struct RetryPolicy
+ * @brief Parametry ponawiania żądań i wyłącznika (circuit breaker) w GiosApiClient.
+ */
+struct RetryPolicy {
+    int maxAttempts = 4;              ///< Łączna liczba prób jednego żądania (1 = bez ponawiania).
+    int baseDelayMs = 250;            ///< Opóźnienie przed pierwszym ponowieniem; podwajane z każdą próbą.
+    int maxDelayMs = 8000;            ///< Górny limit opóźnienia między próbami.
+    int transferTimeoutMs = 30000;    ///< Limit czasu bez postępu transferu (0 = brak limitu).
+    int breakerFailureThreshold = 5;  ///< Liczba kolejnych błędów przejściowych otwierająca obwód endpointu.
+    int breakerOpenMs = 15000;        ///< Czas wstrzymania żądań do endpointu po otwarciu obwodu.
 };
 
 /**
@@ -71,6 +112,18 @@ struct MeasurementData {
  * asynchronicznie za pomocą QNetworkAccessManager. Wyniki zwracane są
  * poprzez sygnały. Klasa obsługuje również podstawowe błędy sieciowe
  * oraz błędy parsowania odpowiedzi JSON.
+ *
+ * Błędy przejściowe (timeout, odpowiedzi 5xx/429, zerwane połączenie) są ponawiane
+ * z wykładniczym opóźnieniem i losowym rozrzutem (jitter). Dla każdego endpointu działa
+ * osobny CircuitBreaker, który po serii błędów wstrzymuje żądania zamiast obciążać
+ * niedziałający serwer. Sygnał networkError() jest emitowany dopiero po wyczerpaniu prób.
+ *
+ * Nowsze API zwraca wyniki stronami: obiekt z tablicą rekordów i liczbą stron (totalPages
+ * lub odnośnik links.last). Po pierwszej stronie żądania wszystkich pozostałych stron są
+ * wysyłane naraz, więc czas wczytania zbliża się do czasu jednej strony. Strony listy stacji
+ * trafiają do odbiorców od razu (stationsPageFetched()); sensory i dane pomiarowe są
+ * składane w całość przed emisją zwykłych sygnałów. Odpowiedzi bez stron (tablica lub
+ * obiekt danych) są obsługiwane jak dotąd.
  */
 class GiosApiClient : public QObject
 {
@@ -83,6 +136,63 @@ public:
      */
     explicit GiosApiClient(QObject *parent = nullptr);
 
+    /** @brief Domyślny adres bazowy publicznego API GIOŚ PJP. */
+    static constexpr const char* DefaultBaseUrl = "https://api.gios.gov.pl/pjp-api/rest/";
+
+    // === Konfiguracja ===
+
+    /**
+     * @brief Ustawia adres bazowy API (np. lokalnego serwera testowego).
+     * Ścieżki endpointów (station/findAll, station/sensors/ID, data/getData/ID)
+     * są rozwiązywane względem tego adresu.
+     * @param baseUrl Adres bazowy; brakujący końcowy ukośnik zostanie dodany.
+     */
+    void setBaseUrl(const QUrl& baseUrl);
+
+    /** @brief Zwraca bieżący adres bazowy API. */
+    QUrl baseUrl() const { return apiBaseUrl; }
+
+    /**
+     * @brief Nawiązuje z wyprzedzeniem połączenie z serwerem API (DNS, TCP, TLS z ALPN h2).
+     * Wywoływane przy starcie, aby pierwsze żądanie (lista stacji) nie płaciło za uzgadnianie
+     * połączenia. Połączenie trafia do puli QNetworkAccessManager i jest ponownie używane.
+     */
+    void warmUpConnection();
+
+    /**
+     * @brief Włącza tryb nagrywania surowych odpowiedzi.
+     * Każda poprawna odpowiedź jest zapisywana jako plik `<katalog>/<ścieżka endpointu>.json`
+     * (np. `station/sensors/114.json`), który może odtworzyć serwer AirQualityMockServer.
+     * @param directory Katalog docelowy; pusty ciąg wyłącza nagrywanie.
+     */
+    void setRecordDirectory(const QString& directory);
+
+    /** @brief Zwraca katalog nagrywania odpowiedzi (pusty, jeśli nagrywanie wyłączone). */
+    QString recordDirectory() const { return recordDir; }
+
+    /** @brief Ustawia parametry ponawiania żądań i wyłączników (dotyczy nowych żądań). */
+    void setRetryPolicy(const RetryPolicy& newPolicy);
+
+    /** @brief Zwraca bieżące parametry ponawiania żądań. */
+    RetryPolicy retryPolicy() const { return policy; }
+
+    /**
+     * @brief Ustawia rozmiar strony wysyłany w parametrach page i size.
+     * @param size Liczba rekordów na stronę; 0 - żądania bez parametrów (rozmiar wybiera serwer).
+     */
+    void setPageSize(int size) { requestedPageSize = qMax(0, size); }
+    int pageSize() const { return requestedPageSize; }
+
+    /**
+     * @brief Zwraca zagregowane czasy faz żądań (połączenie, TTFB, pobieranie, JSON,
+     * budowa struktur, aktualizacja UI) wraz z rozmiarami odpowiedzi i liczbą rekordów.
+     */
+    RequestMetrics& metrics() { return requestMetrics; }
+    const RequestMetrics& metrics() const { return requestMetrics; }
+
+    /** @brief Liczba żądań w toku i zaplanowanych ponowień (do wskaźnika postępu). */
+    int pendingRequestCount() const { return int(inFlight.size()) + scheduledRetries; }
+
     // === Metody publiczne inicjujące żądania ===
 
     /**
@@ -102,8 +212,47 @@ public:
      * @brief Inicjuje pobranie danych pomiarowych z określonego sensora.
      * @param sensorId ID sensora, z którego dane mają zostać pobrane.
      * Po zakończeniu operacji emitowany jest sygnał measurementDataFetched() lub networkError().
+     * @return Żeton żądania, przekazywany w MeasurementData::requestId odpowiedzi.
+     */
+    quint64 fetchMeasurementData(int sensorId);
+
+    // === Dekodowanie odpowiedzi (bez sieci i sygnałów) ===
+
+    /**
+     * @brief Dekoduje odpowiedź JSON z listą stacji.
+     * @param jsonData Surowa odpowiedź endpointu station/findAll.
+     * @param stations Lista docelowa (nadpisywana).
+     * @param errorString Opcjonalny wskaźnik na komunikat błędu.
+     * @return true, jeśli odpowiedź miała poprawny format.
+     */
+    static bool decodeStations(const QByteArray& jsonData, QList<StationInfo>& stations, QString* errorString = nullptr);
+
+    /**
+     * @brief Dekoduje odpowiedź JSON z listą sensorów stacji.
+     * @param jsonData Surowa odpowiedź endpointu station/sensors.
+     * @param stationId ID stacji przypisywane do sensorów.
+     * @param sensors Lista docelowa (nadpisywana).
+     * @param errorString Opcjonalny wskaźnik na komunikat błędu.
+     * @return true, jeśli odpowiedź miała poprawny format (pusta odpowiedź oznacza brak sensorów).
+     */
+    static bool decodeSensors(const QByteArray& jsonData, int stationId, QList<SensorInfo>& sensors, QString* errorString = nullptr);
+
+    /**
+     * @brief Dekoduje odpowiedź JSON z danymi pomiarowymi i sortuje odczyty rosnąco po dacie.
+     * Brak pola 'key' daje klucz "Nieznany", brak tablicy 'values' - pustą serię (z ostrzeżeniem).
+     * @param jsonData Surowa odpowiedź endpointu data/getData.
+     * @param data Struktura docelowa (nadpisywana).
+     * @param errorString Opcjonalny wskaźnik na komunikat błędu.
+     * @return true, jeśli odpowiedź miała poprawny format.
      */
-    void fetchMeasurementData(int sensorId);
+    static bool decodeMeasurementData(const QByteArray& jsonData, MeasurementData& data, QString* errorString = nullptr);
+
+    /** @brief Wariant decodeStations() dla już sparsowanego dokumentu JSON. */
+    static bool decodeStations(const QJsonDocument& jsonDoc, QList<StationInfo>& stations, QString* errorString = nullptr);
+    /** @brief Wariant decodeSensors() dla już sparsowanego dokumentu JSON. */
+    static bool decodeSensors(const QJsonDocument& jsonDoc, int stationId, QList<SensorInfo>& sensors, QString* errorString = nullptr);
+    /** @brief Wariant decodeMeasurementData() dla już sparsowanego dokumentu JSON. */
+    static bool decodeMeasurementData(const QJsonDocument& jsonDoc, MeasurementData& data, QString* errorString = nullptr);
 
 signals:
     // === Sygnały informujące o wynikach ===
@@ -114,17 +263,28 @@ signals:
      */
     void stationsFetched(const QList<StationInfo>& stations);
 
+    /**
+     * @brief Emitowany dla każdej strony listy stacji z API stronicowanego, w kolejności nadejścia.
+     * Po ostatniej stronie emitowany jest także stationsFetched() z pełną listą w kolejności stron.
+     * @param stations Stacje strony.
+     * @param page Numer strony (od 0).
+     * @param pageCount Liczba stron.
+     */
+    void stationsPageFetched(const QList<StationInfo>& stations, int page, int pageCount);
+
     /**
      * @brief Emitowany po pomyślnym pobraniu i przetworzeniu listy sensorów dla stacji.
+     * @param stationId ID stacji z adresu żądania (-1, jeśli nie dało się go odczytać) - pusta lista
+     *        nie niesie ID stacji, więc odbiorcy nie muszą go zgadywać.
      * @param sensors Lista obiektów SensorInfo zawierająca dane sensorów.
      */
-    void sensorsFetched(const QList<SensorInfo>& sensors);
+    void sensorsFetched(int stationId, const QList<SensorInfo>& sensors);
 
     /**
      * @brief Emitowany po pomyślnym pobraniu i przetworzeniu danych pomiarowych.
-     * @param data Obiekt MeasurementData z kluczem parametru i listą odczytów.
+     * @param data Współdzielona migawka z kluczem parametru i listą odczytów (nigdy nullptr).
      */
-    void measurementDataFetched(const MeasurementData& data);
+    void measurementDataFetched(const MeasurementDataPtr& data);
 
     /**
      * @brief Emitowany, gdy wystąpi błąd podczas komunikacji sieciowej lub parsowania odpowiedzi.
@@ -132,6 +292,21 @@ signals:
      */
     void networkError(const QString& errorString);
 
+    /**
+     * @brief Emitowany, gdy żądanie zakończone błędem przejściowym zostało zaplanowane do ponowienia.
+     * @param endpoint Nazwa endpointu ("stations", "sensors", "data").
+     * @param attempt Numer następnej próby.
+     * @param delayMs Opóźnienie przed ponowieniem w ms.
+     */
+    void requestRetrying(const QString& endpoint, int attempt, int delayMs);
+
+    /**
+     * @brief Emitowany przy zmianie stanu wyłącznika endpointu.
+     * @param endpoint Nazwa endpointu.
+     * @param open true - żądania do endpointu są wstrzymane; false - endpoint znów odpowiada.
+     */
+    void circuitStateChanged(const QString& endpoint, bool open);
+
 private slots:
     /** @brief Slot wewnętrzny, odbiera sygnał finished() dla odpowiedzi na żądanie stacji. */
     void onFetchStationsFinished(QNetworkReply *reply);
@@ -142,15 +317,105 @@ private slots:
 
 private:
     // === Metody pomocnicze (parsowanie) ===
-    /** @brief Parsuje odpowiedź JSON zawierającą listę stacji. */
-    void parseStationsJson(const QByteArray& jsonData);
-    /** @brief Parsuje odpowiedź JSON zawierającą listę sensorów. */
-    void parseSensorsJson(const QByteArray& jsonData, int stationId);
-    /** @brief Parsuje odpowiedź JSON zawierającą dane pomiarowe. */
-    void parseMeasurementDataJson(const QByteArray& jsonData);
+    /** @brief Parsuje odpowiedź JSON zawierającą listę stacji. Uzupełnia fazy json/decode/ui w timing. */
+    void parseStationsJson(const QByteArray& jsonData, const QUrl& url, quint64 fetchId, RequestTiming& timing);
+    /** @brief Parsuje odpowiedź JSON zawierającą listę sensorów. Uzupełnia fazy json/decode/ui w timing. */
+    void parseSensorsJson(const QByteArray& jsonData, const QUrl& url, quint64 fetchId, int stationId, RequestTiming& timing);
+    /** @brief Parsuje odpowiedź JSON zawierającą dane pomiarowe. Uzupełnia fazy json/decode/ui w timing. */
+    void parseMeasurementDataJson(const QByteArray& jsonData, const QUrl& url, quint64 fetchId, int sensorId, RequestTiming& timing);
+    /** @brief Parsuje surowe dane do QJsonDocument; komunikat błędu zawiera nazwę danych (what). */
+    static bool parseJsonDocument(const QByteArray& jsonData, const QString& what, QJsonDocument& jsonDoc, QString* errorString);
+
+    // === Metody pomocnicze (żądania, ponawianie i pomiar faz) ===
+    /** @brief Slot obsługujący zakończenie żądania danego rodzaju. */
+    using FinishHandler = void (GiosApiClient::*)(QNetworkReply*);
+
+    /** @brief Żądanie w toku: dane potrzebne do ponowienia oraz pomiar faz. */
+    struct PendingRequest {
+        QUrl url;
+        QString endpoint;
+        FinishHandler handler = nullptr;
+        int attempt = 1;
+        quint64 fetchId = 0;        ///< Żeton logicznego żądania (wspólny dla ponowień i stron jednego pobierania).
+        bool timedOut = false;      ///< Przerwane przez limit transferTimeoutMs (a nie jawne abort()).
+        RequestTiming timing;
+    };
+
+    /**
+     * @brief Wysyła żądanie GET (jeśli pozwala na to wyłącznik endpointu) i zaczyna mierzyć jego fazy.
+     * Po zakończeniu wywoływany jest handler; odrzucone żądanie kończy się sygnałem networkError()
+     * (dla pobierania stronicowanego - jednym, przy pierwszej odrzuconej stronie).
+     * @param fetchId Żeton logicznego żądania (0 = nowe żądanie, dostaje nowy żeton).
+     * @return Żeton żądania.
+     */
+    quint64 sendRequest(const QUrl& url, const QString& endpoint, FinishHandler handler, int attempt = 1, quint64 fetchId = 0);
+    /** @brief Zapisuje bieżący czas w podanym polu RequestTiming (tylko przy pierwszym wywołaniu). */
+    void markPhase(QNetworkReply *reply, qint64 RequestTiming::*phase);
+    /** @brief Kończy pomiar sieciowej części żądania i zwraca żądanie wraz ze znacznikami czasu. */
+    PendingRequest takeRequest(QNetworkReply *reply);
+    /**
+     * @brief Obsługuje błąd odpowiedzi: aktualizuje metryki i wyłącznik, a błąd przejściowy
+     * ponawia z opóźnieniem. Gdy próby się wyczerpią, emituje networkError(errorMsg).
+     */
+    void handleFailedReply(QNetworkReply *reply, const PendingRequest& request, const QString& errorMsg);
+    /** @brief Rejestruje poprawną odpowiedź serwera w wyłączniku endpointu. */
+    void markEndpointHealthy(const QString& endpoint);
+    /**
+     * @brief Czy błąd odpowiedzi jest przejściowy (timeout, 5xx, 429, zerwane połączenie).
+     * @param timedOut Czy żądanie przerwał licznik bezczynności (tylko wtedy OperationCanceledError jest przejściowy).
+     */
+    static bool isTransientError(QNetworkReply *reply, bool timedOut);
+    /** @brief Opóźnienie przed kolejną próbą: wykładnicze z losowym rozrzutem, z uwzględnieniem Retry-After. */
+    int retryDelayMs(QNetworkReply *reply, int attempt) const;
+    /** @brief Zwraca wyłącznik endpointu (tworzony przy pierwszym użyciu). */
+    CircuitBreaker& breakerFor(const QString& endpoint);
+
+    /** @brief Buduje pełny adres endpointu względem adresu bazowego (z parametrami pierwszej strony, jeśli ustawiono rozmiar strony). */
+    QUrl endpointUrl(const QString& path) const;
+
+    /** @brief Stronicowane pobieranie w toku: zdekodowane strony czekające na skompletowanie całości. */
+    struct PagedFetch {
+        int pageCount = 0;
+        int received = 0;
+        QVector<bool> done;
+        QVector<QList<StationInfo>> stations;
+        QVector<QList<SensorInfo>> sensors;
+        QVector<QList<Measurement>> values;
+        QString key;                    ///< Klucz parametru (dane pomiarowe).
+    };
+    /** @brief Największa obsługiwana liczba stron jednego pobierania. */
+    static constexpr int MaxPages = 1000;
+
+    /**
+     * @brief Rejestruje stronę odpowiedzi stronicowanej. Strona 0 zakłada stan pobierania
+     * i wysyła naraz żądania pozostałych stron (z tym samym żetonem).
+     * @param fetchId Żeton pobierania - dwa równoległe pobierania tego samego endpointu się nie mieszają.
+     * @return Stan pobierania lub nullptr (strona porzuconego pobierania albo powtórzona).
+     */
+    PagedFetch* acceptPage(const QUrl& url, quint64 fetchId, int pageCount, const QString& endpoint, FinishHandler handler);
+    /** @brief Numer strony z parametru "page" adresu (0, jeśli brak). */
+    static int pageOf(const QUrl& url);
+    /**
+     * @brief Porzuca pobieranie stronicowane, do którego należy żądanie (po nieudanej stronie).
+     * @return false, jeśli pobieranie zostało już porzucone - błąd jest wtedy zgłaszany tylko raz.
+     */
+    bool abandonPagedFetch(const QUrl& url, quint64 fetchId);
+    /** @brief Zapisuje surową odpowiedź w katalogu nagrywania (jeśli włączony). */
+    void recordResponse(const QUrl& url, const QByteArray& body) const;
 
     // === Pola klasy ===
     QNetworkAccessManager *networkManager; ///< Manager Qt do obsługi operacji sieciowych.
+    QUrl apiBaseUrl;                       ///< Adres bazowy API (domyślnie DefaultBaseUrl).
+    QString recordDir;                     ///< Katalog nagrywania odpowiedzi (pusty = wyłączone).
+    QElapsedTimer clock;                   ///< Zegar monotoniczny dla znaczników czasu faz.
+    QHash<QNetworkReply*, PendingRequest> inFlight; ///< Żądania w toku.
+    int scheduledRetries = 0;              ///< Ponowienia czekające na swój termin.
+    RequestMetrics requestMetrics;         ///< Zagregowane metryki żądań.
+    RetryPolicy policy;                    ///< Parametry ponawiania i wyłączników.
+    QHash<QString, CircuitBreaker> breakers; ///< Wyłączniki poszczególnych endpointów.
+    QHash<quint64, PagedFetch> pagedFetches; ///< Pobierania stronicowane w toku (żeton -> stan).
+    quint64 lastFetchId = 0;               ///< Ostatnio nadany żeton logicznego żądania.
+    int requestedPageSize = 0;             ///< Rozmiar strony w żądaniach (0 = bez parametrów).
 };
 
 #endif // GIOSAPICLIENT_H
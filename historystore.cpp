@@ -0,0 +1,278 @@
+#include "historystore.h"
+#include "seriescodec.h"
+
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QSaveFile>
+#include <QTemporaryDir>
+#include <QVector>
+
+#include <algorithm>
+
+HistoryStore::HistoryStore() = default;
+
+HistoryStore::~HistoryStore() = default; // Katalog zrzutu jest usuwany razem z QTemporaryDir
+
+qint64 HistoryStore::estimateBytes(const MeasurementData& data)
+{
+    // QDateTime (czas lokalny/UTC) i QVariant z double mieszczą się w samej strukturze Measurement
+    return qint64(sizeof(MeasurementData)) + data.key.capacity() * qint64(sizeof(QChar))
+           + data.values.capacity() * qint64(sizeof(Measurement));
+}
+
+void HistoryStore::store(const MeasurementDataPtr& data, qsizetype unchangedPrefix)
+{
+    Entry& entry = entries[data->sensorId];
+    const bool incremental = entry.data && unchangedPrefix > 0;
+    entry.index = incremental ? SeriesIndexPtr::create(data, *entry.index, unchangedPrefix) : SeriesIndexPtr::create(data);
+    entry.rollup = incremental ? SeriesRollupPtr::create(data, *entry.rollup, unchangedPrefix) : SeriesRollupPtr::create(data);
+    entry.data = data;
+    if (entry.diskBytes > 0) QFile::remove(spillFileName(data->sensorId));
+    entry.compressed = QByteArray();
+    entry.diskBytes = 0;
+    entry.readings = data->values.size();
+    entry.bytes = estimateBytes(*data) + entry.index->memoryUsage() + entry.rollup->memoryUsage();
+    entry.lastUse = ++useClock;
+    enforceBudget();
+}
+
+HistoryStore::Entry* HistoryStore::use(int sensorId)
+{
+    auto it = entries.find(sensorId);
+    if (it == entries.end()) return nullptr;
+    it->lastUse = ++useClock;
+    if (it->data) return &*it;
+
+    const MeasurementDataPtr data = loadCold(sensorId, *it);
+    if (it->diskBytes > 0) QFile::remove(spillFileName(sensorId));
+    if (!data) {
+        qWarning() << "HistoryStore: Utracono historię sensora" << sensorId;
+        entries.erase(it);
+        return nullptr;
+    }
+    it->data = data;
+    it->index = SeriesIndexPtr::create(data);
+    it->compressed = QByteArray();
+    it->diskBytes = 0;
+    it->bytes = estimateBytes(*data) + it->index->memoryUsage() + it->rollup->memoryUsage();
+    ++reloads;
+    enforceBudget(); // Nie usuwa wpisów, więc wskaźnik pozostaje ważny
+    return &*it;
+}
+
+MeasurementDataPtr HistoryStore::loadCold(int sensorId, const Entry& entry) const
+{
+    QByteArray blob = entry.compressed;
+    if (entry.diskBytes > 0) {
+        QFile file(spillFileName(sensorId));
+        if (!file.open(QIODevice::ReadOnly)) {
+            qWarning() << "HistoryStore: Nie można odczytać zrzutu" << file.fileName() << ":" << file.errorString();
+            return MeasurementDataPtr();
+        }
+        blob = file.readAll();
+    }
+    QSharedPointer<MeasurementData> data = QSharedPointer<MeasurementData>::create();
+    QString errorString;
+    if (!SeriesCodec::decode(blob, *data, &errorString)) {
+        qWarning() << "HistoryStore: Uszkodzona seria sensora" << sensorId << ":" << errorString;
+        return MeasurementDataPtr();
+    }
+    data->sensorId = sensorId;
+    return data;
+}
+
+void HistoryStore::enforceBudget()
+{
+    if (budget <= 0) return;
+    qint64 total = 0;
+    QVector<QPair<quint64, int>> order; // (ostatnie użycie, ID sensora)
+    order.reserve(entries.size());
+    for (auto it = entries.cbegin(); it != entries.cend(); ++it) {
+        total += it->bytes;
+        order.append(qMakePair(it->lastUse, it.key()));
+    }
+    if (total <= budget || order.size() < 2) return;
+    std::sort(order.begin(), order.end());
+    order.removeLast(); // Najświeżej używana seria (zwykle wyświetlana) zostaje rozpakowana
+
+    // Etap 1: kompresja najdawniej używanych serii
+    for (const auto& [lastUse, sensorId] : order) {
+        if (total <= budget) return;
+        Entry& entry = entries[sensorId];
+        if (!entry.data) continue;
+        entry.compressed = SeriesCodec::encode(*entry.data);
+        entry.data.reset();
+        entry.index.reset();
+        const qint64 bytes = entry.compressed.size() + entry.rollup->memoryUsage();
+        total -= entry.bytes - bytes;
+        entry.bytes = bytes;
+        ++evictions;
+    }
+
+    // Etap 2: zrzut skompresowanych serii na dysk
+    if (!spillDir) return;
+    for (const auto& [lastUse, sensorId] : order) {
+        if (total <= budget) return;
+        Entry& entry = entries[sensorId];
+        if (entry.compressed.isEmpty()) continue;
+        QSaveFile file(spillFileName(sensorId));
+        if (!file.open(QIODevice::WriteOnly) || file.write(entry.compressed) != entry.compressed.size() || !file.commit()) {
+            qWarning() << "HistoryStore: Nie można zapisać zrzutu" << file.fileName() << ":" << file.errorString();
+            return;
+        }
+        entry.diskBytes = entry.compressed.size();
+        entry.compressed = QByteArray();
+        const qint64 bytes = entry.rollup->memoryUsage();
+        total -= entry.bytes - bytes;
+        entry.bytes = bytes;
+        ++evictions;
+    }
+}
+
+QString HistoryStore::spillFileName(int sensorId) const
+{
+    return spillDir ? spillDir->filePath(QString("sensor_%1.%2").arg(sensorId).arg(SeriesCodec::FileSuffix)) : QString();
+}
+
+void HistoryStore::setMemoryBudget(qint64 bytes)
+{
+    budget = qMax<qint64>(0, bytes);
+    enforceBudget();
+}
+
+bool HistoryStore::setSpillDirectory(const QString& parentDirectory)
+{
+    if (!QDir().mkpath(parentDirectory)) return false;
+    QScopedPointer<QTemporaryDir> dir(new QTemporaryDir(QDir(parentDirectory).filePath("history-XXXXXX")));
+    if (!dir->isValid()) {
+        qWarning() << "HistoryStore: Nie można utworzyć katalogu zrzutu:" << dir->errorString();
+        return false;
+    }
+    // Serie już zrzucone do poprzedniego katalogu wracają do pamięci
+    for (auto it = entries.begin(); it != entries.end(); ++it) {
+        if (it->diskBytes == 0) continue;
+        QFile file(spillFileName(it.key()));
+        if (file.open(QIODevice::ReadOnly)) it->compressed = file.readAll();
+        it->diskBytes = 0;
+        it->bytes = it->compressed.size() + it->rollup->memoryUsage();
+    }
+    spillDir.swap(dir);
+    enforceBudget();
+    return true;
+}
+
+HistoryStore::MemoryStats HistoryStore::memoryStats() const
+{
+    MemoryStats stats;
+    for (const Entry& entry : entries) {
+        if (entry.data) {
+            ++stats.hotSeries;
+            stats.hotBytes += entry.bytes;
+            continue;
+        }
+        if (entry.diskBytes > 0) ++stats.spilledSeries;
+        else ++stats.compressedSeries;
+        stats.coldBytes += entry.bytes;
+        stats.diskBytes += entry.diskBytes;
+    }
+    stats.evictions = evictions;
+    stats.reloads = reloads;
+    return stats;
+}
+
+void HistoryStore::clear()
+{
+    for (auto it = entries.cbegin(); it != entries.cend(); ++it) {
+        if (it->diskBytes > 0) QFile::remove(spillFileName(it.key()));
+    }
+    entries.clear();
+}
+
+MeasurementDataPtr HistoryStore::series(int sensorId)
+{
+    const Entry* entry = use(sensorId);
+    return entry ? entry->data : MeasurementDataPtr();
+}
+
+SeriesIndexPtr HistoryStore::index(int sensorId)
+{
+    const Entry* entry = use(sensorId);
+    return entry ? entry->index : SeriesIndexPtr();
+}
+
+MeasurementDataPtr HistoryStore::put(const MeasurementDataPtr& data)
+{
+    if (!data || data->sensorId < 0) return MeasurementDataPtr();
+    const MeasurementDataPtr previous = series(data->sensorId);
+    if (!previous || previous->values.isEmpty() || data->values.isEmpty()
+        || previous->values.first().date >= data->values.first().date) {
+        store(data, 0);
+        return data;
+    }
+
+    // Odczyty sprzed zakresu nowej odpowiedzi pozostają; nowsze zastępuje odpowiedź
+    const QDateTime newFirst = data->values.first().date;
+    const auto olderEnd = std::lower_bound(previous->values.cbegin(), previous->values.cend(), newFirst,
+                                           [](const Measurement& m, const QDateTime& date) { return m.date < date; });
+    const qsizetype olderCount = olderEnd - previous->values.cbegin();
+
+    QSharedPointer<MeasurementData> merged = QSharedPointer<MeasurementData>::create();
+    merged->key = data->key;
+    merged->sensorId = data->sensorId;
+    merged->values.reserve(olderCount + data->values.size());
+    merged->values.append(previous->values.mid(0, olderCount));
+    merged->values.append(data->values);
+    store(merged, olderCount);
+    return merged;
+}
+
+MeasurementDataPtr HistoryStore::merge(const MeasurementDataPtr& data)
+{
+    if (!data || data->sensorId < 0) return MeasurementDataPtr();
+    const MeasurementDataPtr previous = series(data->sensorId);
+    if (!previous || previous->values.isEmpty() || data->values.isEmpty()) {
+        if (!previous || !data->values.isEmpty()) store(data, 0);
+        return series(data->sensorId);
+    }
+
+    const QDateTime first = data->values.first().date;
+    const QDateTime last = data->values.last().date;
+    const auto before = std::lower_bound(previous->values.cbegin(), previous->values.cend(), first,
+                                         [](const Measurement& m, const QDateTime& date) { return m.date < date; });
+    const auto after = std::upper_bound(before, previous->values.cend(), last,
+                                        [](const QDateTime& date, const Measurement& m) { return date < m.date; });
+    const qsizetype beforeCount = before - previous->values.cbegin();
+    const qsizetype afterIndex = after - previous->values.cbegin();
+
+    QSharedPointer<MeasurementData> merged = QSharedPointer<MeasurementData>::create();
+    merged->key = previous->key.isEmpty() ? data->key : previous->key;
+    merged->sensorId = data->sensorId;
+    merged->values.reserve(beforeCount + data->values.size() + (previous->values.size() - afterIndex));
+    merged->values.append(previous->values.mid(0, beforeCount));
+    merged->values.append(data->values);
+    merged->values.append(previous->values.mid(afterIndex));
+    store(merged, beforeCount);
+    return merged;
+}
+
+QList<MeasurementDataPtr> HistoryStore::allSeries() const
+{
+    QList<int> ids = entries.keys();
+    std::sort(ids.begin(), ids.end());
+    QList<MeasurementDataPtr> result;
+    result.reserve(ids.size());
+    for (int id : ids) {
+        const Entry& entry = entries.constFind(id).value();
+        const MeasurementDataPtr data = entry.data ? entry.data : loadCold(id, entry);
+        if (data) result.append(data);
+    }
+    return result;
+}
+
+qint64 HistoryStore::readingCount() const
+{
+    qint64 count = 0;
+    for (const Entry& entry : entries) count += entry.readings;
+    return count;
+}
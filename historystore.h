@@ -0,0 +1,147 @@
+#ifndef HISTORYSTORE_H
+#define HISTORYSTORE_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QScopedPointer>
+#include "giosapiclient.h" // MeasurementData, MeasurementDataPtr
+#include "seriesindex.h"
+#include "seriesrollup.h"
+
+class QTemporaryDir;
+
+/**
+ * @file historystore.h
+ * @brief Definicja klasy HistoryStore - serii pomiarowych zebranych w trakcie sesji.
+ */
+
+/**
+ * @class HistoryStore
+ * @brief Przechowuje najnowszą migawkę serii każdego sensora, z którego pobrano dane.
+ *
+ * API zwraca tylko kilka ostatnich dni, więc kolejne pobrania tego samego sensora
+ * są łączone: odczyty starsze niż początek nowej odpowiedzi pozostają w serii.
+ * Dzięki temu w trakcie dłuższej sesji (np. w trybie na żywo) historia rośnie
+ * i może być eksportowana dla wielu sensorów naraz.
+ *
+ * Każda migawka ma blokowy indeks (SeriesIndex) do zapytań o zakres czasu oraz agregaty
+ * dobowe i miesięczne (SeriesRollup) do widoków długich zakresów; po połączeniu oba
+ * przejmują dane z niezmienionego początku serii.
+ *
+ * Pamięć historii jest ograniczona budżetem (setMemoryBudget()). Po jego przekroczeniu
+ * najdawniej używane serie są kompresowane (SeriesCodec, zwykle kilkanaście razy mniej
+ * pamięci), a jeśli to nie wystarcza - zrzucane do katalogu tymczasowego na dysku.
+ * Agregaty dobowe i miesięczne zostają w pamięci. Dostęp przez series() lub index()
+ * przywraca serię i jej indeks bez udziału wywołującego. Najświeżej używana seria
+ * nigdy nie jest usuwana z pamięci.
+ *
+ * Rozmiary są szacowane z pojemności list (Measurement nie alokuje dodatkowo dla dat
+ * i wartości double). Migawka, którą trzyma jeszcze ktoś inny (np. wykres), zwalnia
+ * pamięć dopiero po zwolnieniu ostatniego wskaźnika.
+ */
+class HistoryStore
+{
+public:
+    /** @brief Zużycie pamięci i liczniki usuwania serii. */
+    struct MemoryStats {
+        int hotSeries = 0;          ///< Serie rozpakowane w pamięci.
+        int compressedSeries = 0;   ///< Serie skompresowane w pamięci.
+        int spilledSeries = 0;      ///< Serie zrzucone na dysk.
+        qint64 hotBytes = 0;        ///< Rozpakowane serie z indeksami i agregatami.
+        qint64 coldBytes = 0;       ///< Skompresowane bloki oraz agregaty serii skompresowanych i zrzuconych.
+        qint64 diskBytes = 0;       ///< Rozmiar plików zrzutu.
+        qint64 evictions = 0;       ///< Liczba kompresji i zrzutów od początku sesji.
+        qint64 reloads = 0;         ///< Liczba przywróceń serii przy dostępie.
+        qint64 totalBytes() const { return hotBytes + coldBytes; }
+    };
+
+    /** @brief Domyślny budżet pamięci historii w aplikacji (bajty). */
+    static constexpr qint64 DefaultBudget = 256LL * 1024 * 1024;
+
+    HistoryStore();
+    ~HistoryStore();
+
+    /**
+     * @brief Zapisuje serię sensora, łącząc ją z wcześniejszą historią.
+     * @param data Migawka z ustawionym sensorId (serie bez ID, np. z pliku, są pomijane).
+     * @return Aktualna migawka sensora po połączeniu (nullptr dla serii bez ID).
+     */
+    MeasurementDataPtr put(const MeasurementDataPtr& data);
+
+    /**
+     * @brief Wstawia serię z zakresu historycznego (np. z archiwum): odczyty wcześniejszej historii
+     * z zakresu [pierwszy, ostatni] odczyt @p data są zastępowane, pozostałe zachowane.
+     * @return Aktualna migawka sensora po połączeniu (nullptr dla serii bez ID).
+     */
+    MeasurementDataPtr merge(const MeasurementDataPtr& data);
+
+    /** @brief Migawka serii sensora lub nullptr (seria skompresowana jest przywracana). */
+    MeasurementDataPtr series(int sensorId);
+    /** @brief Indeks aktualnej migawki sensora lub nullptr (seria skompresowana jest przywracana). */
+    SeriesIndexPtr index(int sensorId);
+    /** @brief Agregaty dobowe i miesięczne aktualnej migawki sensora lub nullptr (zawsze w pamięci). */
+    SeriesRollupPtr rollup(int sensorId) const { return entries.value(sensorId).rollup; }
+    /**
+     * @brief Migawki wszystkich sensorów, posortowane po ID sensora.
+     * Serie skompresowane są dekodowane do tymczasowych kopii (bez zmiany stanu historii),
+     * więc pamięć wraca po zwolnieniu listy.
+     */
+    QList<MeasurementDataPtr> allSeries() const;
+    bool contains(int sensorId) const { return entries.contains(sensorId); }
+    int sensorCount() const { return int(entries.size()); }
+    /** @brief Łączna liczba odczytów we wszystkich seriach. */
+    qint64 readingCount() const;
+    void clear();
+
+    /**
+     * @brief Ustawia budżet pamięci historii i od razu go egzekwuje.
+     * @param bytes Limit w bajtach (0 = bez limitu).
+     */
+    void setMemoryBudget(qint64 bytes);
+    qint64 memoryBudget() const { return budget; }
+
+    /**
+     * @brief Włącza zrzut skompresowanych serii na dysk, gdy kompresja nie wystarcza.
+     * Pliki trafiają do nowego katalogu tymczasowego w @p parentDirectory, usuwanego razem z historią.
+     * @return true, jeśli katalog utworzono.
+     */
+    bool setSpillDirectory(const QString& parentDirectory);
+
+    /** @brief Bieżące zużycie pamięci. */
+    MemoryStats memoryStats() const;
+
+    /** @brief Szacowany rozmiar serii w pamięci (bajty). */
+    static qint64 estimateBytes(const MeasurementData& data);
+
+private:
+    struct Entry {
+        MeasurementDataPtr data;    ///< nullptr, gdy seria jest skompresowana lub na dysku.
+        SeriesIndexPtr index;       ///< nullptr razem z data.
+        SeriesRollupPtr rollup;     ///< Zawsze w pamięci.
+        QByteArray compressed;      ///< Seria zakodowana SeriesCodec (gdy skompresowana w pamięci).
+        qint64 diskBytes = 0;       ///< Rozmiar pliku zrzutu (0 = seria nie jest na dysku).
+        qint64 bytes = 0;           ///< Szacowany rozmiar wpisu w pamięci w obecnej postaci.
+        qint64 readings = 0;        ///< Liczba odczytów serii.
+        quint64 lastUse = 0;        ///< Znacznik ostatniego użycia (rosnący licznik).
+    };
+
+    /** @brief Zapisuje migawkę z indeksem i agregatami zbudowanymi na podstawie poprzedniego wpisu. */
+    void store(const MeasurementDataPtr& data, qsizetype unchangedPrefix);
+    /** @brief Oznacza wpis jako użyty i w razie potrzeby przywraca serię; nullptr, jeśli nie ma serii. */
+    Entry* use(int sensorId);
+    /** @brief Dekoduje serię skompresowaną lub zrzuconą na dysk (nullptr przy błędzie). */
+    MeasurementDataPtr loadCold(int sensorId, const Entry& entry) const;
+    /** @brief Kompresuje, a następnie zrzuca na dysk najdawniej używane serie, aż zmieszczą się w budżecie. */
+    void enforceBudget();
+    QString spillFileName(int sensorId) const;
+
+    QHash<int, Entry> entries;  ///< ID sensora -> migawka serii i jej indeks.
+    quint64 useClock = 0;       ///< Licznik użyć (kolejność LRU).
+    qint64 budget = 0;          ///< Budżet pamięci (0 = bez limitu).
+    qint64 evictions = 0;
+    qint64 reloads = 0;
+    QScopedPointer<QTemporaryDir> spillDir; ///< Katalog zrzutu (nullptr = tylko kompresja).
+};
+
+#endif // HISTORYSTORE_H
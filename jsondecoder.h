@@ -0,0 +1,292 @@
+#ifndef JSONDECODER_H
+#define JSONDECODER_H
+
+#include <QDate>
+#include <QDateTime>
+#include <QDebug>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QJsonValue>
+#include <QLatin1String>
+#include <QList>
+#include <QString>
+#include <QTime>
+#include <QVariant>
+
+#include <array>
+#include <cstddef>
+#include <string_view>
+
+/**
+ * @file jsondecoder.h
+ * @brief Deklaratywny dekoder JSON sterowany schematem (tabelą pól znaną w czasie kompilacji).
+ *
+ * Każda struktura opisuje swoje pola w specjalizacji JsonSchema<T>:
+ * @code
+ * template<> struct JsonSchema<StationInfo> {
+ *     static constexpr const char* name = "stacja";
+ *     static constexpr std::array<JsonField<StationInfo>, 3> fields = {{
+ *         JsonField<StationInfo>::required("id", &JsonAssign::integer<StationInfo, &StationInfo::id>),
+ *         JsonField<StationInfo>::optional("stationName", &JsonAssign::string<StationInfo, &StationInfo::stationName>, ...),
+ *         JsonField<StationInfo>::optional("city.name", ...),
+ *     }};
+ * };
+ * @endcode
+ *
+ * Dekodowanie przechodzi jeden raz po kluczach obiektu (oraz jeden raz po kluczach
+ * obiektu zagnieżdżonego, np. "city" dla ścieżki "city.name"), bez par contains()/operator[]
+ * i bez kopiowania obiektów. Brakujące lub niepoprawne pola są obsługiwane jednolicie:
+ * pole wymagane odrzuca rekord, opcjonalne otrzymuje wartość domyślną. Wartości domyślne
+ * są ustawiane w kolejności tabeli, więc pole płaskie o nazwie prefiksu (np. "param",
+ * zapisane po "param.paramName") może nadpisać domyślne wartości pól zagnieżdżonych,
+ * gdy brakuje całego obiektu.
+ */
+
+/**
+ * @struct JsonField
+ * @brief Opis jednego pola struktury T: ścieżka w JSON, przypisanie i wartość domyślna.
+ */
+template<typename T>
+struct JsonField {
+    /** @brief Przypisuje wartość JSON do pola; false oznacza niepoprawny typ lub format. */
+    using Assign = bool (*)(T& target, const QJsonValue& value);
+    /** @brief Ustawia wartość domyślną (wywoływane po przejściu po kluczach, więc może korzystać z innych pól). */
+    using Default = void (*)(T& target);
+
+    std::string_view path;      ///< Klucz lub ścieżka z jednym poziomem zagnieżdżenia ("param.paramCode").
+    bool isRequired;            ///< Czy brak pola odrzuca cały rekord.
+    Assign assign;              ///< Funkcja przypisania.
+    Default applyDefault;       ///< Wartość domyślna (może być nullptr).
+
+    static constexpr JsonField required(std::string_view path, Assign assign) { return {path, true, assign, nullptr}; }
+    static constexpr JsonField optional(std::string_view path, Assign assign, Default applyDefault = nullptr)
+    {
+        return {path, false, assign, applyDefault};
+    }
+
+    /** @brief Klucz na poziomie bieżącego obiektu (np. "city" dla "city.name"). */
+    constexpr std::string_view head() const
+    {
+        const std::size_t dot = path.find('.');
+        return dot == std::string_view::npos ? path : path.substr(0, dot);
+    }
+    /** @brief Klucz w obiekcie zagnieżdżonym (pusty dla pól płaskich). */
+    constexpr std::string_view tail() const
+    {
+        const std::size_t dot = path.find('.');
+        return dot == std::string_view::npos ? std::string_view() : path.substr(dot + 1);
+    }
+};
+
+/**
+ * @brief Specjalizowana dla każdej dekodowanej struktury: `name` (do komunikatów)
+ * oraz `fields` - constexpr std::array<JsonField<T>, N>.
+ */
+template<typename T>
+struct JsonSchema;
+
+/**
+ * @namespace JsonAssign
+ * @brief Gotowe funkcje przypisania dla typowych pól (używane w tabelach JsonSchema).
+ */
+namespace JsonAssign {
+
+/** @brief Liczba całkowita zapisana w JSON jako liczba. */
+template<typename T, int T::*Member>
+bool integer(T& target, const QJsonValue& value)
+{
+    if (!value.isDouble()) return false;
+    target.*Member = static_cast<int>(value.toDouble());
+    return true;
+}
+
+/** @brief Liczba zmiennoprzecinkowa zapisana w JSON jako liczba. */
+template<typename T, double T::*Member>
+bool number(T& target, const QJsonValue& value)
+{
+    if (!value.isDouble()) return false;
+    target.*Member = value.toDouble();
+    return true;
+}
+
+/** @brief Liczba zapisana w JSON jako liczba lub tekst (np. współrzędne stacji GIOŚ). */
+template<typename T, double T::*Member>
+bool numberOrText(T& target, const QJsonValue& value)
+{
+    if (value.isDouble()) {
+        target.*Member = value.toDouble();
+        return true;
+    }
+    if (!value.isString()) return false;
+    bool ok = false;
+    const double parsed = value.toString().toDouble(&ok);
+    if (ok) target.*Member = parsed;
+    return ok;
+}
+
+/** @brief Tekst. */
+template<typename T, QString T::*Member>
+bool string(T& target, const QJsonValue& value)
+{
+    if (!value.isString()) return false;
+    target.*Member = value.toString();
+    return true;
+}
+
+/** @brief Liczba lub null (null i inne typy dają pusty QVariant). */
+template<typename T, QVariant T::*Member>
+bool nullableDouble(T& target, const QJsonValue& value)
+{
+    if (value.isDouble()) {
+        target.*Member = value.toDouble();
+    } else {
+        if (!value.isNull()) qWarning() << "JsonDecoder: Wartość nie jest liczbą ani null, traktuję jako null. Typ:" << value.type();
+        target.*Member = QVariant();
+    }
+    return true;
+}
+
+/**
+ * @brief Szybkie parsowanie daty "yyyy-MM-dd HH:mm:ss" (format API) lub "yyyy-MM-ddTHH:mm:ss" (ISO, pliki zapisu).
+ * Wynik w czasie lokalnym, jak QDateTime::fromString. Inne warianty ISO są obsługiwane przez Qt.
+ */
+inline QDateTime parseDateTime(const QString& text)
+{
+    if (text.size() == 19) {
+        const QChar *c = text.constData();
+        auto digits = [c](int from, int count, int& out) {
+            int v = 0;
+            for (int i = from; i < from + count; ++i) {
+                const ushort u = c[i].unicode();
+                if (u < '0' || u > '9') return false;
+                v = v * 10 + (u - '0');
+            }
+            out = v;
+            return true;
+        };
+        int y, mo, d, h, mi, s;
+        if (c[4] == u'-' && c[7] == u'-' && (c[10] == u' ' || c[10] == u'T') && c[13] == u':' && c[16] == u':'
+            && digits(0, 4, y) && digits(5, 2, mo) && digits(8, 2, d)
+            && digits(11, 2, h) && digits(14, 2, mi) && digits(17, 2, s)) {
+            const QDate date(y, mo, d);
+            const QTime time(h, mi, s);
+            if (date.isValid() && time.isValid()) return QDateTime(date, time);
+            return QDateTime();
+        }
+    }
+    return QDateTime::fromString(text, Qt::ISODate);
+}
+
+/** @brief Data i czas (patrz parseDateTime()). */
+template<typename T, QDateTime T::*Member>
+bool dateTime(T& target, const QJsonValue& value)
+{
+    if (!value.isString()) return false;
+    target.*Member = parseDateTime(value.toString());
+    return (target.*Member).isValid();
+}
+
+} // namespace JsonAssign
+
+namespace JsonDecoder {
+
+namespace detail {
+
+inline bool keyEquals(const QJsonObject::const_iterator& it, std::string_view key)
+{
+    const QLatin1String expected(key.data(), qsizetype(key.size()));
+#if QT_VERSION >= QT_VERSION_CHECK(6, 4, 0)
+    return QAnyStringView::compare(it.keyView(), expected) == 0; // Bez alokacji QString dla klucza
+#else
+    return it.key() == expected;
+#endif
+}
+
+} // namespace detail
+
+/**
+ * @brief Dekoduje jeden obiekt JSON do struktury T według tabeli JsonSchema<T>::fields.
+ * @param object Obiekt źródłowy.
+ * @param target Struktura docelowa (pola nieobecne w JSON otrzymują wartości domyślne).
+ * @param missingField Opcjonalnie: ścieżka pierwszego brakującego pola wymaganego.
+ * @return false, jeśli brakuje pola wymaganego lub ma ono niepoprawny typ.
+ */
+template<typename T>
+bool decodeObject(const QJsonObject& object, T& target, std::string_view* missingField = nullptr)
+{
+    constexpr auto& fields = JsonSchema<T>::fields;
+    constexpr std::size_t count = fields.size();
+    std::array<bool, count> assigned{};
+
+    // Jedno przejście po kluczach obiektu
+    for (auto it = object.constBegin(); it != object.constEnd(); ++it) {
+        for (std::size_t i = 0; i < count; ++i) {
+            if (assigned[i] || !detail::keyEquals(it, fields[i].head())) continue;
+            if (fields[i].tail().empty()) {
+                assigned[i] = fields[i].assign(target, it.value());
+                break;
+            }
+            // Obiekt zagnieżdżony - jedno przejście po jego kluczach dla wszystkich pól z tym prefiksem
+            const QJsonValue nestedValue = it.value();
+            if (nestedValue.isObject()) {
+                const QJsonObject nested = nestedValue.toObject();
+                for (auto nt = nested.constBegin(); nt != nested.constEnd(); ++nt) {
+                    for (std::size_t j = i; j < count; ++j) {
+                        if (!assigned[j] && fields[j].head() == fields[i].head() && detail::keyEquals(nt, fields[j].tail())) {
+                            assigned[j] = fields[j].assign(target, nt.value());
+                            break;
+                        }
+                    }
+                }
+            }
+            // Pole płaskie o nazwie prefiksu (zapisane po polach zagnieżdżonych) dostaje cały obiekt
+            for (std::size_t j = i + 1; j < count; ++j) {
+                if (!assigned[j] && fields[j].tail().empty() && fields[j].head() == fields[i].head())
+                    assigned[j] = fields[j].assign(target, nestedValue);
+            }
+            break;
+        }
+    }
+
+    // Walidacja i wartości domyślne - jednolicie dla wszystkich pól
+    for (std::size_t i = 0; i < count; ++i) {
+        if (assigned[i]) continue;
+        if (fields[i].isRequired) {
+            if (missingField) *missingField = fields[i].path;
+            return false;
+        }
+        if (fields[i].applyDefault) fields[i].applyDefault(target);
+    }
+    return true;
+}
+
+/**
+ * @brief Dekoduje tablicę obiektów; elementy niebędące obiektami lub bez pól wymaganych są pomijane.
+ * @param array Tablica źródłowa.
+ * @param out Lista docelowa (elementy są dopisywane).
+ * @param init Stan początkowy każdego elementu (np. z ustawionym ID stacji).
+ * @return Liczba pominiętych elementów.
+ */
+template<typename T>
+int decodeArray(const QJsonArray& array, QList<T>& out, const T& init = T())
+{
+    int skipped = 0;
+    out.reserve(out.size() + array.size());
+    for (const QJsonValue& value : array) {
+        if (!value.isObject()) { ++skipped; continue; }
+        T item = init;
+        std::string_view missing;
+        if (decodeObject(value.toObject(), item, &missing)) {
+            out.append(std::move(item));
+        } else {
+            ++skipped;
+            qWarning() << "JsonDecoder: Pomijam rekord" << JsonSchema<T>::name << "- brak/niepoprawne pole"
+                       << QLatin1String(missing.data(), qsizetype(missing.size()));
+        }
+    }
+    return skipped;
+}
+
+} // namespace JsonDecoder
+
+#endif // JSONDECODER_H
@@ -0,0 +1,181 @@
+#include "liverefresh.h"
+#include "tracing.h"
+
+#include <QDebug>
+#include <QTimer>
+
+#include <algorithm>
+
+namespace {
+
+/** @brief Indeks ostatniego odczytu z wartością lub -1. */
+int lastValueIndex(const QList<Measurement>& values)
+{
+    for (int i = int(values.size()) - 1; i >= 0; --i) {
+        if (!values.at(i).value.isNull() && values.at(i).date.isValid()) return i;
+    }
+    return -1;
+}
+
+/** @brief Początek godziny zawierającej @p time. */
+QDateTime hourStart(const QDateTime& time)
+{
+    return QDateTime(time.date(), QTime(time.time().hour(), 0));
+}
+
+} // namespace
+
+LiveRefresh::LiveRefresh(GiosApiClient *client, QObject *parent)
+    : QObject(parent)
+    , client(client)
+    , timer(new QTimer(this))
+{
+    timer->setSingleShot(true);
+    timer->setTimerType(Qt::VeryCoarseTimer); // Dokładność do sekundy w zupełności wystarcza
+    connect(timer, &QTimer::timeout, this, &LiveRefresh::pollNow);
+}
+
+void LiveRefresh::setPublicationOffsetMinutes(int minutes)
+{
+    offsetMinutes = qBound(0, minutes, 59);
+    scheduleNext();
+}
+
+void LiveRefresh::setRetryIntervalMinutes(int minutes)
+{
+    retryMinutes = qMax(1, minutes);
+    scheduleNext();
+}
+
+void LiveRefresh::setActive(bool enabled)
+{
+    if (active == enabled) return;
+    active = enabled;
+    pending.clear();
+    qDebug() << "LiveRefresh: Tryb na żywo" << (active ? "włączony" : "wyłączony") << "- obserwowane sensory:" << watched.size();
+    if (active) pollNow(); // Nadrobienie ewentualnych braków od razu, potem według harmonogramu
+    else scheduleNext();
+}
+
+void LiveRefresh::watch(const MeasurementDataPtr& data)
+{
+    if (!data || data->sensorId < 0) return;
+    const bool added = !watched.contains(data->sensorId);
+    watched.insert(data->sensorId, data);
+    if (added) scheduleNext();
+}
+
+void LiveRefresh::unwatch(int sensorId)
+{
+    watched.remove(sensorId);
+    pending.remove(sensorId);
+    scheduleNext();
+}
+
+void LiveRefresh::clear()
+{
+    watched.clear();
+    pending.clear();
+    scheduleNext();
+}
+
+bool LiveRefresh::isUpToDate(const MeasurementData& data, const QDateTime& now) const
+{
+    const int last = lastValueIndex(data.values);
+    if (last < 0) return false;
+    // Przed godziną publikacji oczekujemy jeszcze odczytu z poprzedniej godziny
+    QDateTime expected = hourStart(now);
+    if (now < expected.addSecs(offsetMinutes * 60)) expected = expected.addSecs(-3600);
+    return data.values.at(last).date >= expected;
+}
+
+QDateTime LiveRefresh::nextSlot(const QDateTime& now, int offsetMinutes)
+{
+    QDateTime slot = hourStart(now).addSecs(offsetMinutes * 60);
+    if (slot <= now) slot = slot.addSecs(3600);
+    return slot;
+}
+
+void LiveRefresh::pollNow()
+{
+    AQM_TRACE_SCOPE("LiveRefresh::pollNow", "net");
+    if (!active) return;
+    const QDateTime now = QDateTime::currentDateTime();
+    // Odpowiedzi na poprzednie zapytania, które nie dotarły (błąd sieci), nie blokują kolejnych
+    pending.clear();
+    for (auto it = watched.cbegin(); it != watched.cend(); ++it) {
+        if (isUpToDate(*it.value(), now)) continue;
+        pending.insert(it.key(), client->fetchMeasurementData(it.key()));
+    }
+    if (!pending.isEmpty()) qDebug() << "LiveRefresh: Odpytywanie" << pending.size() << "z" << watched.size() << "sensorów";
+    scheduleNext();
+}
+
+void LiveRefresh::scheduleNext()
+{
+    if (!active || watched.isEmpty()) {
+        timer->stop();
+        nextPoll = QDateTime();
+        return;
+    }
+    const QDateTime now = QDateTime::currentDateTime();
+    QDateTime next = nextSlot(now, offsetMinutes);
+    const bool anyStale = std::any_of(watched.cbegin(), watched.cend(),
+                                      [this, &now](const MeasurementDataPtr& data) { return !isUpToDate(*data, now); });
+    if (anyStale) next = qMin(next, now.addSecs(retryMinutes * 60));
+
+    nextPoll = next;
+    timer->start(int(qBound<qint64>(1000, now.msecsTo(next), 3600 * 1000)));
+    emit pollScheduled(nextPoll);
+}
+
+bool LiveRefresh::consumeResponse(const MeasurementDataPtr& fresh)
+{
+    if (!fresh || fresh->requestId == 0) return false;
+    const auto it = pending.constFind(fresh->sensorId);
+    if (it == pending.cend() || it.value() != fresh->requestId) return false;
+    pending.erase(it);
+    AQM_TRACE_SCOPE("LiveRefresh::consumeResponse", "parse");
+    const MeasurementDataPtr base = watched.value(fresh->sensorId);
+    if (!base) return true; // Sensor przestał być obserwowany w trakcie zapytania
+
+    MeasurementDataPtr merged;
+    int firstNewIndex = 0;
+    const int appended = appendNewer(base, *fresh, merged, firstNewIndex);
+    if (appended > 0) {
+        watched.insert(fresh->sensorId, merged);
+        qDebug() << "LiveRefresh: Sensor" << fresh->sensorId << "- nowe odczyty:" << appended;
+        emit measurementsAppended(merged, firstNewIndex, int(base->values.size()) - firstNewIndex);
+    }
+    return true;
+}
+
+int LiveRefresh::appendNewer(const MeasurementDataPtr& base, const MeasurementData& fresh,
+                             MeasurementDataPtr& merged, int& firstNewIndex)
+{
+    merged = base;
+    const int baseLast = lastValueIndex(base->values);
+    firstNewIndex = baseLast + 1;
+    const int freshLast = lastValueIndex(fresh.values);
+    if (freshLast < 0) return 0;
+
+    // Pierwszy odczyt późniejszy niż ostatni znany (dane są posortowane rosnąco)
+    auto begin = fresh.values.cbegin();
+    const auto end = fresh.values.cbegin() + freshLast + 1;
+    if (baseLast >= 0) {
+        const QDateTime lastKnown = base->values.at(baseLast).date;
+        begin = std::upper_bound(begin, end, lastKnown,
+                                 [](const QDateTime& date, const Measurement& m) { return date < m.date; });
+    }
+    const int appended = int(end - begin);
+    if (appended == 0) return 0;
+
+    QSharedPointer<MeasurementData> result = QSharedPointer<MeasurementData>::create();
+    result->key = base->key;
+    result->sensorId = base->sensorId;
+    result->values.reserve(firstNewIndex + appended);
+    result->values.append(base->values.mid(0, firstNewIndex));
+    for (auto it = begin; it != end; ++it) result->values.append(*it);
+    merged = result;
+    return appended;
+}
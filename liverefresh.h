@@ -0,0 +1,133 @@
+#ifndef LIVEREFRESH_H
+#define LIVEREFRESH_H
+
+#include <QObject>
+#include <QDateTime>
+#include <QHash>
+#include <QList>
+#include "giosapiclient.h" // MeasurementData, MeasurementDataPtr
+
+class QTimer;
+
+/**
+ * @file liverefresh.h
+ * @brief Definicja klasy LiveRefresh - trybu na żywo z dopisywaniem tylko nowych pomiarów.
+ */
+
+/**
+ * @class LiveRefresh
+ * @brief Okresowo odpytuje obserwowane sensory i publikuje wyłącznie nowe odczyty.
+ *
+ * GIOŚ publikuje wartość godzinową kilkanaście-kilkadziesiąt minut po pełnej godzinie,
+ * dlatego odpytywanie jest wyrównane do "pełna godzina + opóźnienie publikacji".
+ * Sensory, które mają już odczyt z bieżącej godziny, nie są odpytywane ponownie;
+ * dla pozostałych zapytanie jest powtarzane co retryIntervalMinutes aż do następnego slotu.
+ *
+ * Odpowiedź na zapytanie trybu na żywo nie zastępuje serii - z nowej odpowiedzi brane są
+ * tylko odczyty późniejsze niż ostatni znany (niepusty) odczyt, a odbiorcy dostają sygnał
+ * measurementsAppended() z indeksem pierwszego nowego elementu, aby dopisać same nowe punkty.
+ * Końcowe wartości null (jeszcze niepoliczone przez GIOŚ) nie są utrwalane - zostaną
+ * uzupełnione przy kolejnym zapytaniu.
+ */
+class LiveRefresh : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Konstruktor.
+     * @param client Klient API używany do odpytywania (współdzielony z oknem - te same połączenia i wyłączniki).
+     * @param parent Rodzic QObject.
+     */
+    explicit LiveRefresh(GiosApiClient *client, QObject *parent = nullptr);
+
+    /** @brief Opóźnienie publikacji danych po pełnej godzinie (domyślnie 20 min). */
+    void setPublicationOffsetMinutes(int minutes);
+    int publicationOffsetMinutes() const { return offsetMinutes; }
+
+    /** @brief Odstęp ponownych zapytań, gdy nowej wartości jeszcze nie ma (domyślnie 10 min). */
+    void setRetryIntervalMinutes(int minutes);
+    int retryIntervalMinutes() const { return retryMinutes; }
+
+    /** @brief Włącza lub wyłącza odpytywanie (lista obserwowanych sensorów jest zachowywana). */
+    void setActive(bool enabled);
+    bool isActive() const { return active; }
+
+    /**
+     * @brief Dodaje sensor do obserwowanych lub zastępuje jego znaną serię.
+     * @param data Pełna migawka danych z ustawionym sensorId (migawki bez ID są ignorowane).
+     */
+    void watch(const MeasurementDataPtr& data);
+    /** @brief Przestaje obserwować sensor. */
+    void unwatch(int sensorId);
+    /** @brief Usuwa wszystkie obserwowane sensory. */
+    void clear();
+
+    bool isWatching(int sensorId) const { return watched.contains(sensorId); }
+    QList<int> watchedSensors() const { return watched.keys(); }
+    /** @brief Aktualna seria obserwowanego sensora (nullptr, jeśli nie jest obserwowany). */
+    MeasurementDataPtr latest(int sensorId) const { return watched.value(sensorId); }
+    /** @brief Czas najbliższego zaplanowanego zapytania (niepoprawny, gdy tryb jest wyłączony). */
+    QDateTime nextPollTime() const { return nextPoll; }
+
+    /**
+     * @brief Przejmuje odpowiedź, jeśli jest wynikiem zapytania trybu na żywo.
+     * Odpowiedź jest rozpoznawana po żetonie żądania (MeasurementData::requestId) wysłanego
+     * w ostatnim odpytaniu, więc dane pobrane w inny sposób (np. kliknięcie sensora) nie są
+     * przejmowane, nawet gdy wcześniejsze zapytanie tego sensora nie dostało odpowiedzi.
+     * Nowe odczyty są dopisywane do znanej serii i ogłaszane sygnałem measurementsAppended().
+     * @param fresh Odpowiedź API (z ustawionym sensorId i requestId).
+     * @return true, jeśli odpowiedź została przejęta (odbiorca nie powinien przebudowywać widoku).
+     */
+    bool consumeResponse(const MeasurementDataPtr& fresh);
+
+    /**
+     * @brief Najbliższy slot publikacji (pełna godzina + opóźnienie) późniejszy niż @p now.
+     */
+    static QDateTime nextSlot(const QDateTime& now, int offsetMinutes);
+
+    /**
+     * @brief Tworzy nową migawkę: znana seria bez końcowych wartości null + odczyty z @p fresh
+     * późniejsze niż ostatni znany niepusty odczyt (również bez końcowych null).
+     * @param base Dotychczasowa seria (posortowana rosnąco po dacie).
+     * @param fresh Nowa odpowiedź API (posortowana rosnąco po dacie).
+     * @param merged Wynik; przy braku nowych odczytów pozostaje równy @p base.
+     * @param firstNewIndex Indeks pierwszego nowego odczytu w @p merged.
+     * @return Liczba dopisanych odczytów.
+     */
+    static int appendNewer(const MeasurementDataPtr& base, const MeasurementData& fresh,
+                           MeasurementDataPtr& merged, int& firstNewIndex);
+
+public slots:
+    /** @brief Odpytuje teraz sensory, którym brakuje odczytu z bieżącej godziny. */
+    void pollNow();
+
+signals:
+    /**
+     * @brief Emitowany po dopisaniu nowych odczytów do serii sensora.
+     * @param data Nowa migawka serii (data->sensorId identyfikuje sensor).
+     * @param firstNewIndex Indeks pierwszego nowego odczytu w data->values.
+     * @param droppedTail Liczba końcowych odczytów poprzedniej migawki (wartości null) zastąpionych nowymi.
+     */
+    void measurementsAppended(const MeasurementDataPtr& data, int firstNewIndex, int droppedTail);
+
+    /** @brief Emitowany po zaplanowaniu kolejnego zapytania. */
+    void pollScheduled(const QDateTime& when);
+
+private:
+    /** @brief Czy seria ma już odczyt oczekiwany o czasie @p now. */
+    bool isUpToDate(const MeasurementData& data, const QDateTime& now) const;
+    /** @brief Ustawia zegar na kolejny slot lub na ponowienie, jeśli brakuje bieżących wartości. */
+    void scheduleNext();
+
+    GiosApiClient *client;
+    QTimer *timer;
+    QHash<int, MeasurementDataPtr> watched;   ///< ID sensora -> aktualna seria.
+    QHash<int, quint64> pending;              ///< ID sensora -> żeton zapytania trybu na żywo bez odpowiedzi.
+    int offsetMinutes = 20;
+    int retryMinutes = 10;
+    bool active = false;
+    QDateTime nextPoll;
+};
+
+#endif // LIVEREFRESH_H
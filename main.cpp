@@ -1,10 +1,161 @@
 #include "mainwindow.h"
+#include "tracing.h"
+#include "alertengine.h"
+#include "catalogsnapshot.h"
+#include "reportrenderer.h"
 #include <QApplication>
+#include <QCommandLineParser>
+#include <QDebug>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <algorithm>
+
+namespace {
+
+/**
+ * @brief Tryb bez okna: pobiera pomiary wskazanych sensorów i zapisuje raport z wykresami.
+ * @param output Plik .pdf albo katalog na pliki PNG.
+ * @param sensorList ID sensorów po przecinku lub "all" (wszystkie sensory z zapisanego katalogu stacji).
+ * @param days Liczba ostatnich dni na wykresach.
+ * @param baseUrl Adres bazowy API (pusty - domyślny).
+ * @param pageSize Rozmiar strony API stronicowanego (0 - bez parametrów stron).
+ * @return Kod wyjścia procesu.
+ */
+int runReport(const QString& output, const QString& sensorList, int days, const QString& baseUrl, int pageSize)
+{
+    // Zapisany katalog stacji daje tytuły wykresów i listę sensorów dla "all"
+    CatalogSnapshot snapshot;
+    CatalogSnapshot::load(CatalogSnapshot::defaultFileName(), snapshot);
+    const StationCatalog& catalog = snapshot.catalog;
+    QList<int> sensorIds;
+    if (sensorList.compare("all", Qt::CaseInsensitive) == 0) {
+        for (int i = 0; i < catalog.stationCount(); ++i) {
+            for (const SensorInfo& sensor : catalog.sensorsForStation(catalog.stationId(i))) sensorIds.append(sensor.id);
+        }
+    } else {
+        for (const QString& part : sensorList.split(',', Qt::SkipEmptyParts)) {
+            bool ok = false;
+            const int id = part.trimmed().toInt(&ok);
+            if (ok) sensorIds.append(id);
+        }
+    }
+    if (sensorIds.isEmpty()) {
+        qCritical() << "Raport: brak sensorów (podaj --report-sensors lub zapisz wcześniej katalog stacji w aplikacji)";
+        return 2;
+    }
+
+    // Każde żądanie kończy się dokładnie jednym sygnałem: danymi albo błędem
+    GiosApiClient client;
+    if (!baseUrl.isEmpty()) client.setBaseUrl(QUrl(baseUrl));
+    client.setPageSize(pageSize);
+    QList<MeasurementDataPtr> series;
+    qsizetype pending = sensorIds.size();
+    QEventLoop loop;
+    QObject::connect(&client, &GiosApiClient::measurementDataFetched, &loop, [&](const MeasurementDataPtr& data) {
+        if (!data->values.isEmpty()) series.append(data);
+        if (--pending == 0) loop.quit();
+    });
+    QObject::connect(&client, &GiosApiClient::networkError, &loop, [&](const QString& errorString) {
+        qWarning() << "Raport:" << errorString;
+        if (--pending == 0) loop.quit();
+    });
+    for (int id : sensorIds) client.fetchMeasurementData(id);
+    loop.exec();
+    std::sort(series.begin(), series.end(),
+              [](const MeasurementDataPtr& a, const MeasurementDataPtr& b) { return a->sensorId < b->sensorId; });
+
+    ReportRenderer::Options options;
+    options.to = QDateTime::currentMSecsSinceEpoch();
+    options.from = options.to - qint64(qMax(1, days)) * 24 * 3600 * 1000;
+    for (const MeasurementDataPtr& data : series) {
+        const int index = catalog.indexOfStation(catalog.stationIdForSensor(data->sensorId));
+        if (index < 0) continue;
+        options.titles.insert(data->sensorId, QString("%1, %2 - %3 (sensor %4)")
+                                                  .arg(catalog.cityName(index), catalog.stationName(index), data->key)
+                                                  .arg(data->sensorId));
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    ReportRenderer::Result result;
+    if (output.endsWith(".pdf", Qt::CaseInsensitive)) {
+        QString errorString;
+        if (!ReportRenderer::renderPdf(series, output, options, &result, &errorString)) {
+            qCritical() << "Raport: nie można zapisać" << output << ":" << errorString;
+            return 1;
+        }
+    } else {
+        result = ReportRenderer::renderPngs(series, output, options);
+    }
+    qInfo().noquote() << QString("Raport: %1 z %2 sensorów, %3 błędów zapisu, renderowanie %4 ms -> %5")
+                             .arg(result.charts).arg(sensorIds.size()).arg(result.failed).arg(timer.elapsed()).arg(output);
+    return result.failed == 0 ? 0 : 1;
+}
+
+} // namespace
 
 int main(int argc, char *argv[])
 {
     QApplication a(argc, argv);
+
+    // Opcje pozwalające skierować aplikację na lokalny serwer testowy i nagrywać odpowiedzi
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    QCommandLineOption baseUrlOption("api-base-url", "Adres bazowy API GIOŚ (domyślnie publiczne API).", "url");
+    QCommandLineOption pageSizeOption("page-size", "Rozmiar strony dla API stronicowanego (parametry page i size; domyślnie wybiera serwer).", "n");
+    QCommandLineOption recordOption("record-dir", "Katalog, do którego nagrywane są surowe odpowiedzi API.", "katalog");
+    QCommandLineOption traceOption("trace", "Zapisz ślad działania (Trace Event JSON dla Perfetto/chrome://tracing).", "plik");
+    QCommandLineOption alertRulesOption("alert-rules", "Plik JSON z regułami alarmowymi (domyślnie progi informowania i alarmowe).", "plik");
+    QCommandLineOption alertLogOption("alert-log", "Plik dziennika alarmów (domyślnie alerts.log w katalogu danych aplikacji).", "plik");
+    // Raport bez okna, np. z crona: aqm -platform offscreen --report raport.pdf --report-sensors all
+    QCommandLineOption reportOption("report", "Zapisz raport z wykresami (plik .pdf lub katalog na PNG) i zakończ bez otwierania okna.", "wyjście");
+    QCommandLineOption reportSensorsOption("report-sensors", "ID sensorów raportu po przecinku lub \"all\" (sensory z zapisanego katalogu stacji).", "lista", "all");
+    QCommandLineOption reportDaysOption("report-days", "Liczba ostatnich dni na wykresach raportu (domyślnie 3).", "dni", "3");
+    QCommandLineOption memoryBudgetOption("memory-budget", QString("Budżet pamięci historii serii w MB; starsze serie są kompresowane lub zrzucane na dysk (domyślnie %1, 0 = bez limitu).")
+                                                               .arg(HistoryStore::DefaultBudget / (1024 * 1024)), "MB");
+    parser.addOptions({baseUrlOption, pageSizeOption, recordOption, traceOption, alertRulesOption, alertLogOption,
+                       reportOption, reportSensorsOption, reportDaysOption, memoryBudgetOption});
+    parser.process(a);
+
+    QString traceFile = parser.value(traceOption);
+    if (traceFile.isEmpty()) traceFile = qEnvironmentVariable("AQM_TRACE_FILE");
+    if (!traceFile.isEmpty()) Tracer::start(traceFile);
+
+    QString baseUrl = parser.value(baseUrlOption);
+    if (baseUrl.isEmpty()) baseUrl = qEnvironmentVariable("AQM_API_BASE_URL");
+    const int pageSize = parser.value(pageSizeOption).toInt();
+    if (parser.isSet(reportOption)) {
+        const int exitCode = runReport(parser.value(reportOption), parser.value(reportSensorsOption),
+                                       parser.value(reportDaysOption).toInt(), baseUrl, pageSize);
+        Tracer::stop();
+        return exitCode;
+    }
+
     mainWindow w;
+    if (!baseUrl.isEmpty()) w.client()->setBaseUrl(QUrl(baseUrl));
+    w.client()->setPageSize(pageSize);
+    if (parser.isSet(recordOption)) w.client()->setRecordDirectory(parser.value(recordOption));
+    if (parser.isSet(alertRulesOption)) {
+        QList<AlertRule> rules;
+        QString errorString;
+        if (AlertEngine::loadRules(parser.value(alertRulesOption), rules, &errorString)) w.alerts()->setRules(rules);
+        else qWarning() << "Nie można wczytać reguł alarmowych:" << errorString;
+    }
+    if (parser.isSet(alertLogOption)) w.alerts()->setLogFile(parser.value(alertLogOption));
+    QString memoryBudget = parser.value(memoryBudgetOption);
+    if (memoryBudget.isEmpty()) memoryBudget = qEnvironmentVariable("AQM_MEMORY_BUDGET_MB");
+    if (!memoryBudget.isEmpty()) {
+        bool ok = false;
+        const qint64 megabytes = memoryBudget.toLongLong(&ok);
+        if (ok && megabytes >= 0) w.historyStore()->setMemoryBudget(megabytes * 1024 * 1024);
+        else qWarning() << "Nieprawidłowy budżet pamięci:" << memoryBudget;
+    }
+    w.client()->warmUpConnection(); // DNS + TLS w tle, zanim użytkownik kliknie "Pobierz stacje"
+    w.restoreCatalogSnapshot();     // Lista stacji z dysku od razu, świeża kopia pobierana w tle
+
     w.show();
-    return a.exec();
+    const int exitCode = a.exec();
+    Tracer::stop(); // Zapis śladu (jeśli śledzenie było włączone)
+    return exitCode;
 }
@@ -1,5 +1,12 @@
 #include "mainwindow.h"
 #include "ui_mainwindow.h" // Ważny include
+#include "seriescodec.h"
+#include "catalogsnapshot.h"
+#include "stationcatalog.h"
+#include "liverefresh.h"
+#include "alertengine.h"
+#include "csvexporter.h"
+#include "tracing.h"
 
 // Includy Qt
 #include <QMessageBox>
@@ -16,10 +23,34 @@
 #include <QTextEdit>       // Potrzebne dla analysisResultsTextEdit
 #include <QPushButton>     // Potrzebne dla przycisku w QMessageBox
 #include <QFileInfo>       // Dla pobrania nazwy pliku w błędach
+#include <QDockWidget>
+#include <QPlainTextEdit>
+#include <QMenuBar>
+#include <QMenu>
+#include <QAction>
+#include <QTimer>
+#include <QVBoxLayout>
+#include <QFontDatabase>
+#include <QLabel>
+#include <QAbstractButton>
+#include <QElapsedTimer>
+#include <QLocale>
+#include <QSet>
+#include <QTextCursor>
+#include <QInputDialog>
+#include <QApplication>
+#include <QComboBox>
+#include <QDialog>
+#include <QScrollArea>
+#include <QPixmap>
+#include <QProgressBar>
+#include <QFutureWatcher>
+#include <QtConcurrent/QtConcurrentRun>
 
 // Includy QtCharts
 #include <QtCharts/QChartView>
 #include <QtCharts/QLineSeries>
+#include <QtCharts/QScatterSeries>
 #include <QtCharts/QDateTimeAxis>
 #include <QtCharts/QValueAxis>
 #include <QtCharts/QChart>
@@ -28,21 +59,80 @@
 #include <stdexcept>       // Dla std::exception i std::runtime_error
 #include <algorithm>       // Dla std::sort
 #include <string>          // Dla std::to_string
+#include <limits>
+#include <cmath>
+
+namespace {
+
+/** @brief Wspólna pusta migawka (brak danych) - unika osobnej alokacji przy każdym czyszczeniu. */
+MeasurementDataPtr emptyMeasurementData()
+{
+    static const MeasurementDataPtr empty = QSharedPointer<MeasurementData>::create();
+    return empty;
+}
+
+/** @brief Wiersz pola tekstowego z danymi (wspólny dla pełnego widoku i dopisywania w trybie na żywo). */
+QString measurementLine(const Measurement& m)
+{
+    QString valueStr = m.value.isNull() ? "[brak]" : QString::number(m.value.toDouble());
+    if (m.flags != 0) valueStr += QString(" [podejrzany: %1]").arg(FaultDetector::describe(m.flags));
+    return QString("%1: %2").arg(m.date.toString("yyyy-MM-dd HH:mm:ss")).arg(valueStr);
+}
+
+} // namespace
 
 // Konstruktor
 mainWindow::mainWindow(QWidget *parent)
     : QMainWindow(parent)
     , ui(new Ui::mainWindow) // Poprawna inicjalizacja UI
+    , currentMeasurementData(emptyMeasurementData())
+    , currentIndex(SeriesIndexPtr::create(emptyMeasurementData()))
+    , currentRollup(SeriesRollupPtr::create(emptyMeasurementData()))
 {
     ui->setupUi(this); // Konfiguracja UI z pliku .ui
 
     apiClient = new GiosApiClient(this);
+    liveRefresh = new LiveRefresh(apiClient, this);
+    alertEngine = new AlertEngine(this);
+    alertEngine->setRules(AlertEngine::defaultRules());
+    alertEngine->setLogFile(AlertEngine::defaultLogFileName());
+    // Serie usunięte z pamięci po przekroczeniu budżetu trafiają do katalogu podręcznego, nie do /tmp (często w RAM)
+    history.setMemoryBudget(HistoryStore::DefaultBudget);
+    history.setSpillDirectory(QStandardPaths::writableLocation(QStandardPaths::CacheLocation));
+    // Stan modeli prognoz z poprzedniej sesji - kolejne odczyty tylko go aktualizują
+    QString forecastError;
+    if (!forecaster.load(SeriesForecaster::defaultFileName(), &forecastError)) qDebug() << "Brak stanu prognoz:" << forecastError;
+    forecastSaveTimer = new QTimer(this);
+    forecastSaveTimer->setInterval(10 * 60 * 1000);
+    connect(forecastSaveTimer, &QTimer::timeout, this, &mainWindow::saveForecasterState);
+    forecastSaveTimer->start();
 
     // --- Połączenia sygnałów i slotów ---
-    connect(apiClient, &GiosApiClient::stationsFetched, this, &mainWindow::handleStationsFetched);
+    // Wyniki trafiają do widoku paczkami, najwyżej raz na klatkę (tak samo komunikaty paska stanu i postęp)
+    delivery = new ResultBatcher(this);
+    delivery->attach(apiClient);
+    connect(delivery, &ResultBatcher::stationsReady, this, &mainWindow::handleStationsFetched);
+    connect(delivery, &ResultBatcher::stationsPagesReady, this, &mainWindow::handleStationsPagesFetched);
+    connect(delivery, &ResultBatcher::sensorsReady, this, &mainWindow::handleSensorsBatch);
+    connect(delivery, &ResultBatcher::measurementDataReady, this, &mainWindow::handleMeasurementBatch);
+    connect(delivery, &ResultBatcher::statusReady, this, [this](const QString& text, int timeoutMs) {
+        if (statusBar()) statusBar()->showMessage(text, timeoutMs);
+    });
+    connect(delivery, &ResultBatcher::progressReady, this, [this](int value, int maximum) {
+        if (!loadProgress) return;
+        // Pojedyncze żądania nie migają wskaźnikiem
+        loadProgress->setVisible(maximum > 1 && value < maximum);
+        loadProgress->setRange(0, qMax(1, maximum));
+        loadProgress->setValue(value);
+    });
     connect(apiClient, &GiosApiClient::networkError, this, &mainWindow::handleNetworkError);
-    connect(apiClient, &GiosApiClient::sensorsFetched, this, &mainWindow::handleSensorsFetched);
-    connect(apiClient, &GiosApiClient::measurementDataFetched, this, &mainWindow::handleMeasurementDataFetched);
+    connect(apiClient, &GiosApiClient::requestRetrying, this, &mainWindow::handleRequestRetrying);
+    connect(apiClient, &GiosApiClient::circuitStateChanged, this, &mainWindow::handleCircuitStateChanged);
+    connect(liveRefresh, &LiveRefresh::measurementsAppended, this, &mainWindow::handleMeasurementsAppended);
+    connect(alertEngine, &AlertEngine::alertRaised, this, &mainWindow::handleAlertRaised);
+    connect(liveRefresh, &LiveRefresh::pollScheduled, this, [this](const QDateTime& when) {
+        if (liveModeAction) liveModeAction->setText(QString("Tryb na żywo (następne odświeżenie %1)").arg(when.toString("HH:mm")));
+    });
 
     if (ui->listWidget) {
         connect(ui->listWidget, &QListWidget::itemClicked, this, &mainWindow::on_listWidget_itemClicked);
@@ -60,7 +150,29 @@ mainWindow::mainWindow(QWidget *parent)
     if (!ui->analyzeButton) { qWarning() << "analyzeButton not found in UI."; }
     if (!ui->cityFilterLineEdit) { qWarning() << "cityFilterLineEdit not found in UI."; }
 
+    setupDiagnosticsPanel();
+
+    // Zakres czasu widoku - przy długiej historii wykres i analiza obejmują tylko wybrany fragment
+    rangeComboBox = new QComboBox(this);
+    rangeComboBox->addItem("Cały zakres", 0);
+    rangeComboBox->addItem("Ostatnie 24 h", 24);
+    rangeComboBox->addItem("Ostatnie 7 dni", 24 * 7);
+    rangeComboBox->addItem("Ostatnie 30 dni", 24 * 30);
+    rangeComboBox->addItem("Ostatni rok", 24 * 365);
+    rangeComboBox->addItem("Wybrany miesiąc...", -1);
+    rangeComboBox->setToolTip("Zakres wykresu, listy pomiarów i analizy (liczony od ostatniego pomiaru serii)");
+    ui->horizontalLayout->addWidget(rangeComboBox);
+    connect(rangeComboBox, QOverload<int>::of(&QComboBox::activated), this, &mainWindow::setDisplayedRange);
+
     if (statusBar()) {
+        networkStatusLabel = new QLabel(this);
+        networkStatusLabel->hide();
+        statusBar()->addPermanentWidget(networkStatusLabel);
+        loadProgress = new QProgressBar(this);
+        loadProgress->setMaximumWidth(160);
+        loadProgress->setTextVisible(false);
+        loadProgress->hide();
+        statusBar()->addPermanentWidget(loadProgress);
         statusBar()->showMessage("Aplikacja gotowa.", 3000);
     }
 }
@@ -68,9 +180,136 @@ mainWindow::mainWindow(QWidget *parent)
 // Destruktor
 mainWindow::~mainWindow()
 {
+    // Zapis oczekującej migawki katalogu przed zamknięciem
+    if (catalogSaveTimer && catalogSaveTimer->isActive()) saveCatalogSnapshot();
+    saveForecasterState();
     delete ui; // Usuwamy obiekt UI
 }
 
+namespace {
+
+/** @brief Tekst elementu listy stacji (wspólny dla pełnej przebudowy i aktualizacji różnicowej). */
+QString stationItemText(const StationCatalog& catalog, int index)
+{
+    return QString("%1 (%2) [ID: %3]").arg(catalog.stationName(index), catalog.cityName(index)).arg(catalog.stationId(index));
+}
+
+} // namespace
+
+void mainWindow::restoreCatalogSnapshot(const QString& fileName)
+{
+    AQM_TRACE_SCOPE("restoreCatalogSnapshot", "ui");
+    catalogFileName = fileName.isEmpty() ? CatalogSnapshot::defaultFileName() : fileName;
+    if (!catalogSaveTimer) {
+        catalogSaveTimer = new QTimer(this);
+        catalogSaveTimer->setSingleShot(true);
+        catalogSaveTimer->setInterval(2000);
+        connect(catalogSaveTimer, &QTimer::timeout, this, &mainWindow::saveCatalogSnapshot);
+    }
+
+    QElapsedTimer loadTimer;
+    loadTimer.start();
+    CatalogSnapshot snapshot;
+    QString errorMsg;
+    if (!CatalogSnapshot::load(catalogFileName, snapshot, &errorMsg)) {
+        qDebug() << "Brak migawki katalogu:" << catalogFileName << errorMsg;
+    } else if (snapshot.sourceUrl != apiClient->baseUrl()) {
+        qDebug() << "Migawka katalogu pochodzi z innego adresu API:" << snapshot.sourceUrl.toString();
+    } else if (!snapshot.catalog.isEmpty()) {
+        catalog = std::move(snapshot.catalog);
+        filterStationsByCity(ui->cityFilterLineEdit ? ui->cityFilterLineEdit->text() : QString());
+        qDebug() << "Wczytano migawkę katalogu:" << catalog.stationCount() << "stacji," << catalog.stringCount()
+                 << "napisów," << catalog.memoryUsage() / 1024 << "kB w" << loadTimer.elapsed() << "ms";
+        showStatus(QString("Wczytano %1 stacji z pamięci podręcznej (%2 ms, stan z %3) - odświeżanie...")
+                       .arg(catalog.stationCount()).arg(loadTimer.elapsed())
+                       .arg(QLocale().toString(snapshot.savedAt.toLocalTime(), QLocale::ShortFormat)));
+    }
+
+    // Rewalidacja w tle - wynik trafia do handleStationsFetched i jest nanoszony różnicowo
+    if (catalog.isEmpty()) showStatus("Pobieranie listy stacji...");
+    apiClient->fetchAllStations();
+}
+
+void mainWindow::scheduleCatalogSave()
+{
+    if (catalogSaveTimer && !catalogFileName.isEmpty()) catalogSaveTimer->start();
+}
+
+void mainWindow::saveCatalogSnapshot()
+{
+    AQM_TRACE_SCOPE("saveCatalogSnapshot", "io");
+    if (catalogFileName.isEmpty() || catalog.isEmpty()) return;
+    if (catalogSaveTimer) catalogSaveTimer->stop();
+
+    CatalogSnapshot snapshot;
+    snapshot.sourceUrl = apiClient->baseUrl();
+    snapshot.savedAt = QDateTime::currentDateTimeUtc();
+    snapshot.catalog = catalog;
+    QString errorMsg;
+    if (!snapshot.save(catalogFileName, &errorMsg))
+        qWarning() << "Nie można zapisać migawki katalogu:" << catalogFileName << errorMsg;
+}
+
+void mainWindow::syncStationList(const QString &cityText)
+{
+    AQM_TRACE_SCOPE("syncStationList", "ui");
+    if (!ui->listWidget) return;
+    QListWidget *list = ui->listWidget;
+    const QString filter = cityText.trimmed();
+
+    const QVector<int> visible = catalog.stationsMatchingCity(filter);
+    QSet<int> visibleIds;
+    visibleIds.reserve(visible.size());
+    for (int index : visible) visibleIds.insert(catalog.stationId(index));
+    if (visible.isEmpty()) {
+        filterStationsByCity(cityText); // Pełna przebudowa z komunikatem "Nie znaleziono"
+        return;
+    }
+
+    // Pierwszy widoczny element pozostaje u góry widoku mimo wstawień i usunięć powyżej
+    QListWidgetItem *anchor = list->itemAt(0, 0);
+    list->setUpdatesEnabled(false);
+
+    // Usuń elementy bez ID (komunikaty), duplikaty oraz stacje spoza nowej listy
+    QHash<int, QListWidgetItem*> existing;
+    for (int row = list->count() - 1; row >= 0; --row) {
+        QListWidgetItem *item = list->item(row);
+        bool idOk = false;
+        const int id = item->data(Qt::UserRole).toInt(&idOk);
+        if (!idOk || !visibleIds.contains(id) || existing.contains(id)) {
+            if (item == anchor) anchor = nullptr;
+            delete list->takeItem(row);
+        } else {
+            existing.insert(id, item);
+        }
+    }
+
+    // Wstaw nowe, popraw teksty zmienionych i (rzadko) przestaw elementy do kolejności z API
+    for (int i = 0; i < visible.size(); ++i) {
+        const int stationId = catalog.stationId(visible.at(i));
+        const QString text = stationItemText(catalog, visible.at(i));
+        QListWidgetItem *item = existing.value(stationId);
+        if (!item) {
+            item = new QListWidgetItem(text);
+            item->setData(Qt::UserRole, stationId);
+            list->insertItem(i, item);
+            continue;
+        }
+        if (list->item(i) != item) {
+            const bool wasCurrent = list->currentItem() == item;
+            const bool wasSelected = item->isSelected();
+            list->takeItem(list->row(item));
+            list->insertItem(i, item);
+            if (wasCurrent) list->setCurrentItem(item);
+            item->setSelected(wasSelected);
+        }
+        if (item->text() != text) item->setText(text);
+    }
+
+    list->setUpdatesEnabled(true);
+    if (anchor) list->scrollToItem(anchor, QAbstractItemView::PositionAtTop);
+}
+
 // === Funkcje Prywatne ===
 
 /**
@@ -82,35 +321,62 @@ mainWindow::~mainWindow()
  */
 void mainWindow::displayChart()
 {
+    AQM_TRACE_SCOPE("displayChart", "ui");
     if (!ui->chartView) {
         qWarning() << "Nie można wyświetlić wykresu - brak widgetu chartView.";
         return;
     }
 
+    const MeasurementData& data = *currentMeasurementData;
+
     // Tworzenie nowej serii
     QLineSeries *series = new QLineSeries();
-    series->setName(currentMeasurementData.key.isEmpty() ? "Dane" : currentMeasurementData.key);
-
-    // Wypełnianie serii poprawnymi danymi
-    int validPoints = 0;
-    for (const Measurement& m : currentMeasurementData.values) {
-        if (m.date.isValid() && !m.value.isNull()) {
-            series->append(m.date.toMSecsSinceEpoch(), m.value.toDouble());
-            validPoints++;
+    series->setName(data.key.isEmpty() ? "Dane" : data.key);
+
+    // Wypełnianie serii poprawnymi danymi - tylko z wybranego zakresu (wyszukiwanie w indeksie blokowym)
+    qint64 from = 0, to = 0;
+    selectedRange(from, to);
+    qsizetype first = 0, last = 0;
+    currentIndex->findRange(from, to, first, last);
+
+    // Długi zakres: średnie dobowe lub miesięczne z gotowych agregatów zamiast wszystkich odczytów
+    const qint64 span = qMin(to, currentIndex->lastTime()) - qMax(from, currentIndex->firstTime());
+    const SeriesRollup::Tier tier = SeriesRollup::chooseTier(last - first, span, viewResolution());
+    QList<QPointF> points;
+    QList<QPointF> suspectPoints; // Odczyty oznaczone przez FaultDetector - osobno, poza linią
+    if (tier == SeriesRollup::Tier::Raw) {
+        points.reserve(last - first);
+        for (qsizetype i = first; i < last; ++i) {
+            const Measurement& m = data.values.at(i);
+            if (!m.date.isValid() || m.value.isNull()) continue;
+            (m.flags == 0 ? points : suspectPoints).append(QPointF(m.date.toMSecsSinceEpoch(), m.value.toDouble()));
         }
+    } else {
+        for (const SeriesRollup::Bucket& bucket : currentRollup->buckets(tier, from, to)) {
+            if (bucket.count > 0) points.append(QPointF(bucket.start, bucket.average()));
+        }
+        series->setName(QString("%1 (%2)").arg(series->name(), tier == SeriesRollup::Tier::Daily ? "średnie dobowe" : "średnie miesięczne"));
     }
+    const int validPoints = int(points.size());
+    series->append(points); // Jedno dodanie zamiast sygnału na każdy punkt
+    // Prognoza tylko na końcu surowej serii (zakres obejmuje ostatni przyjęty odczyt)
+    const QList<QPointF> predicted = tier == SeriesRollup::Tier::Raw && !points.isEmpty() ? forecastPoints(points.last()) : QList<QPointF>();
 
     // Tworzenie nowego wykresu
     QChart *chart = new QChart(); // Nowy wykres przy każdym rysowaniu
-    chart->setTitle("Dane pomiarowe dla: " + currentMeasurementData.key);
+    chart->setTitle("Dane pomiarowe dla: " + data.key);
     chart->setAnimationOptions(QChart::SeriesAnimations); // Prosta animacja
 
     if (validPoints == 0) {
         // Jeśli nie ma punktów, wyświetl komunikat i pusty wykres
-        qWarning() << "Brak poprawnych danych do wyświetlenia na wykresie dla klucza:" << currentMeasurementData.key;
+        qWarning() << "Brak poprawnych danych do wyświetlenia na wykresie dla klucza:" << data.key;
         chart->setTitle("Brak poprawnych danych do wyświetlenia");
         delete series; // Usuń pustą serię, bo QChart jej nie przejmie na własność bez addSeries
+        chartSeries = nullptr;
+        forecastSeries = nullptr;
     } else {
+        // Tryb na żywo dopisuje odczyty do serii surowej zamiast rysować wykres od nowa
+        chartSeries = tier == SeriesRollup::Tier::Raw ? series : nullptr;
         // Jeśli są punkty, dodaj serię i osie
         chart->addSeries(series); // Chart przejmuje serię na własność
         chart->legend()->setVisible(true);
@@ -118,16 +384,42 @@ void mainWindow::displayChart()
 
         // Konfiguracja osi X (Data i Czas)
         QDateTimeAxis *axisX = new QDateTimeAxis;
-        axisX->setFormat("yyyy-MM-dd HH:mm");
+        axisX->setFormat(tier == SeriesRollup::Tier::Raw ? "yyyy-MM-dd HH:mm" : tier == SeriesRollup::Tier::Daily ? "yyyy-MM-dd" : "yyyy-MM");
         axisX->setTitleText("Data pomiaru");
         chart->addAxis(axisX, Qt::AlignBottom);
         series->attachAxis(axisX); // Powiąż serię z osią
 
         // Konfiguracja osi Y (Wartości)
         QValueAxis *axisY = new QValueAxis;
-        axisY->setTitleText("Wartość [" + currentMeasurementData.key + "]");
+        axisY->setTitleText("Wartość [" + data.key + "]");
         chart->addAxis(axisY, Qt::AlignLeft);
         series->attachAxis(axisY);
+
+        if (!suspectPoints.isEmpty()) {
+            QScatterSeries *suspects = new QScatterSeries();
+            suspects->setName(QString("Podejrzane odczyty (%1)").arg(suspectPoints.size()));
+            suspects->setColor(Qt::red);
+            suspects->setMarkerSize(7.0);
+            suspects->append(suspectPoints);
+            chart->addSeries(suspects);
+            suspects->attachAxis(axisX);
+            suspects->attachAxis(axisY);
+        }
+
+        forecastSeries = nullptr;
+        if (!predicted.isEmpty()) {
+            QLineSeries *forecast = new QLineSeries();
+            forecast->setName(QString("Prognoza (%1 h)").arg(predicted.size() - 1));
+            QPen pen(series->color());
+            pen.setStyle(Qt::DashLine);
+            pen.setWidthF(1.5);
+            forecast->setPen(pen);
+            forecast->append(predicted);
+            chart->addSeries(forecast);
+            forecast->attachAxis(axisX);
+            forecast->attachAxis(axisY);
+            forecastSeries = forecast;
+        }
     }
 
     // Ustawienie nowego wykresu w widoku QChartView
@@ -143,29 +435,24 @@ void mainWindow::displayChart()
  */
 void mainWindow::filterStationsByCity(const QString &cityText)
 {
+    AQM_TRACE_SCOPE("filterStationsByCity", "ui");
     if (!ui->listWidget) {
         qWarning() << "Cannot filter stations: listWidget is null.";
         return;
     }
 
     ui->listWidget->clear(); // Wyczyść listę przed filtrowaniem
-    QString filter = cityText.trimmed().toLower(); // Przygotuj filtr
+    QString filter = cityText.trimmed(); // Przygotuj filtr (wielkość liter ignoruje katalog)
     int itemsAdded = 0;
 
-    // Iteracja po pełnej liście stacji przechowywanej w allStationsList
-    for (const StationInfo& station : allStationsList) {
-        // Warunek dopasowania: filtr pusty LUB nazwa miasta zawiera filtr (ignorując wielkość liter)
-        bool match = filter.isEmpty() || (!station.cityName.isEmpty() && station.cityName.toLower().contains(filter));
-
-        if (match) {
-            // Utwórz nowy element listy
-            QListWidgetItem *item = new QListWidgetItem(QString("%1 (%2) [ID: %3]") // Użyj [] dla ID
-                                                            .arg(station.stationName, station.cityName)
-                                                            .arg(station.id));
-            item->setData(Qt::UserRole, station.id); // Zapisz ID stacji w danych elementu
-            ui->listWidget->addItem(item);
-            itemsAdded++;
-        }
+    // Dopasowanie filtra (pusty LUB nazwa miasta zawiera filtr, bez rozróżniania wielkości liter)
+    // liczone jest raz na miasto w katalogu, a stacje wybierane po ID miasta
+    for (int index : catalog.stationsMatchingCity(filter)) {
+        // Utwórz nowy element listy
+        QListWidgetItem *item = new QListWidgetItem(stationItemText(catalog, index));
+        item->setData(Qt::UserRole, catalog.stationId(index)); // Zapisz ID stacji w danych elementu
+        ui->listWidget->addItem(item);
+        itemsAdded++;
     }
 
     // Jeśli nic nie pasowało do filtra (a filtr nie był pusty), pokaż komunikat
@@ -182,10 +469,113 @@ void mainWindow::filterStationsByCity(const QString &cityText)
     }
 }
 
+/**
+ * @brief Tworzy panel "Diagnostyka" (QDockWidget) z podsumowaniem metryk żądań
+ * oraz menu "Widok" z akcjami pokazania panelu i zapisu metryk do pliku.
+ * Panel odświeża się co sekundę tylko wtedy, gdy jest widoczny.
+ */
+void mainWindow::setupDiagnosticsPanel()
+{
+    diagnosticsDock = new QDockWidget("Diagnostyka", this);
+    diagnosticsDock->setObjectName("diagnosticsDock");
+    QWidget *container = new QWidget(diagnosticsDock);
+    QVBoxLayout *layout = new QVBoxLayout(container);
+    diagnosticsText = new QPlainTextEdit(container);
+    diagnosticsText->setReadOnly(true);
+    diagnosticsText->setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
+    diagnosticsText->setLineWrapMode(QPlainTextEdit::NoWrap);
+    QPushButton *saveMetricsButton = new QPushButton("Zapisz metryki", container);
+    layout->addWidget(diagnosticsText);
+    layout->addWidget(saveMetricsButton);
+    diagnosticsDock->setWidget(container);
+    addDockWidget(Qt::BottomDockWidgetArea, diagnosticsDock);
+    diagnosticsDock->hide();
+
+    diagnosticsTimer = new QTimer(this);
+    diagnosticsTimer->setInterval(1000);
+    connect(diagnosticsTimer, &QTimer::timeout, this, &mainWindow::refreshDiagnostics);
+    connect(diagnosticsDock, &QDockWidget::visibilityChanged, this, [this](bool visible) {
+        if (visible) { refreshDiagnostics(); diagnosticsTimer->start(); }
+        else diagnosticsTimer->stop();
+    });
+    connect(saveMetricsButton, &QPushButton::clicked, this, &mainWindow::saveMetricsToFile);
+
+    if (menuBar()) {
+        QMenu *viewMenu = menuBar()->addMenu("Widok");
+        QAction *toggleAction = diagnosticsDock->toggleViewAction();
+        toggleAction->setText("Panel diagnostyczny");
+        viewMenu->addAction(toggleAction);
+        viewMenu->addAction("Zapisz metryki do pliku...", this, &mainWindow::saveMetricsToFile);
+        viewMenu->addSeparator();
+        liveModeAction = viewMenu->addAction("Tryb na żywo");
+        liveModeAction->setCheckable(true);
+        connect(liveModeAction, &QAction::toggled, this, &mainWindow::setLiveMode);
+        viewMenu->addAction("Przestań obserwować sensory", liveRefresh, &LiveRefresh::clear);
+        viewMenu->addSeparator();
+        viewMenu->addAction("Wczytaj reguły alarmowe...", this, &mainWindow::loadAlertRules);
+        viewMenu->addAction("Eksport zbiorczy CSV...", this, &mainWindow::exportHistoryCsv);
+        viewMenu->addAction("Import archiwum GIOŚ...", this, &mainWindow::importArchive);
+        viewMenu->addAction("Macierz korelacji...", this, &mainWindow::showCorrelationMatrix);
+        viewMenu->addAction("Mapa stężeń...", this, &mainWindow::showConcentrationMap);
+    }
+}
+
 // === Implementacje Slotów ===
 
+void mainWindow::refreshDiagnostics()
+{
+    if (!diagnosticsText) return;
+    constexpr double MB = 1024.0 * 1024.0;
+    const HistoryStore::MemoryStats stats = history.memoryStats();
+    const qint64 viewBytes = HistoryStore::estimateBytes(*currentMeasurementData) + currentIndex->memoryUsage()
+                             + currentRollup->memoryUsage();
+    const qint64 chartBytes = chartSeries ? chartSeries->count() * qint64(sizeof(QPointF)) : 0;
+    QString text = apiClient->metrics().summaryText();
+    text += "\n\n=== Pamięć (szacunek) ===\n";
+    text += QString("Katalog stacji:      %1 MB (%2 stacji)\n").arg(catalog.memoryUsage() / MB, 0, 'f', 2).arg(catalog.stationCount());
+    text += QString("Historia:            %1 / %2 MB budżetu\n").arg(stats.totalBytes() / MB, 0, 'f', 2)
+                .arg(history.memoryBudget() > 0 ? QString::number(history.memoryBudget() / MB, 'f', 0) : QString("bez limitu"));
+    text += QString("  rozpakowane:       %1 serii, %2 MB\n").arg(stats.hotSeries).arg(stats.hotBytes / MB, 0, 'f', 2);
+    text += QString("  skompresowane:     %1 serii, na dysku: %2 serii (%3 MB)\n").arg(stats.compressedSeries)
+                .arg(stats.spilledSeries).arg(stats.diskBytes / MB, 0, 'f', 2);
+    text += QString("  usunięcia/powroty: %1 / %2\n").arg(stats.evictions).arg(stats.reloads);
+    text += QString("Bieżąca seria:       %1 MB (%2 odczytów)\n").arg(viewBytes / MB, 0, 'f', 2).arg(currentMeasurementData->values.size());
+    text += QString("Punkty wykresu:      %1 MB\n").arg(chartBytes / MB, 0, 'f', 2);
+    text += QString("\n=== Jakość danych ===\nOcenione odczyty:    %1\nPodejrzane odczyty:  %2\n")
+                .arg(faultDetector.evaluatedReadings()).arg(faultDetector.flaggedReadings());
+    const ResultBatcher::Stats& deliveryStats = delivery->stats();
+    text += QString("\n=== Dostarczanie do widoku ===\nWyniki / paczki:     %1 / %2 (największa: %3)\n")
+                .arg(deliveryStats.results).arg(deliveryStats.batches).arg(deliveryStats.largestBatch);
+    text += QString("Połączone listy:     %1\nKomunikaty:          %2 pokazanych z %3\n")
+                .arg(deliveryStats.coalesced).arg(deliveryStats.statusShown).arg(deliveryStats.statusPosted);
+    diagnosticsText->setPlainText(text);
+}
+
+void mainWindow::saveMetricsToFile()
+{
+    QString defaultFileName = QString("metryki_%1.txt").arg(QDateTime::currentDateTime().toString("yyyyMMdd_HHmmss"));
+    QString documentsPath = QStandardPaths::writableLocation(QStandardPaths::DocumentsLocation);
+    QString fileName = QFileDialog::getSaveFileName(this, "Zapisz metryki", documentsPath + "/" + defaultFileName,
+                                                    "Pliki tekstowe (*.txt *.prom)");
+    if (fileName.isEmpty()) return; // Anulowano
+
+    QString errorMsg;
+    if (!apiClient->metrics().writeToFile(fileName, &errorMsg)) {
+        QMessageBox::critical(this, "Błąd Zapisu", QString("Nie można zapisać metryk:\n%1").arg(errorMsg));
+        return;
+    }
+    showStatus(QString("Metryki zapisano do: %1").arg(QFileInfo(fileName).fileName()), 5000);
+}
+
 void mainWindow::on_fetchStationsButton_clicked()
 {
+    // Lista już wyświetlona (np. z migawki) - odśwież ją w miejscu, zachowując wybór
+    if (!catalog.isEmpty()) {
+        showStatus("Odświeżanie listy stacji...");
+        apiClient->fetchAllStations();
+        return;
+    }
+
     // Wyczyszczenie kontrolek
     if (ui->listWidget) ui->listWidget->clear();
     if (ui->sensorsListWidget) ui->sensorsListWidget->clear();
@@ -197,39 +587,119 @@ void mainWindow::on_fetchStationsButton_clicked()
         ui->selectedStationLabel->setToolTip("");
     }
 
-    if (statusBar()) statusBar()->showMessage("Pobieranie listy stacji...");
+    showStatus("Pobieranie listy stacji...");
     apiClient->fetchAllStations(); // Wywołaj pobieranie
 }
 
 void mainWindow::handleStationsFetched(const QList<StationInfo>& stations)
 {
-    this->allStationsList = stations; // Zapisz pobraną listę jako pełną listę
-    if (statusBar()) statusBar()->showMessage(QString("Pobrano %1 stacji.").arg(stations.count()), 5000);
+    AQM_TRACE_SCOPE("handleStationsFetched", "ui");
+    // Policz różnice względem dotychczasowej listy (np. wczytanej z migawki; strony pierwszego wczytania się nie liczą)
+    const bool hadStations = !catalog.isEmpty() && !streamingStations;
+    streamingStations = false;
+    int added = 0, changed = 0, kept = 0;
+    for (const StationInfo& station : stations) {
+        const int index = catalog.indexOfStation(station.id);
+        if (index < 0) { ++added; continue; }
+        ++kept;
+        if (catalog.stationName(index) != station.stationName || catalog.cityName(index) != station.cityName) ++changed;
+    }
+    const int removed = catalog.stationCount() - kept;
+
+    catalog.setStations(stations); // Zapisz pobraną listę jako pełny katalog (sensory pozostałych stacji są zachowane)
+    for (LatestReading& reading : latestReadings) reading.point.stationId = -1; // Współrzędne ustalane ponownie przy rysowaniu mapy
+    if (!hadStations) showStatus(QString("Pobrano %1 stacji.").arg(stations.count()), 5000);
+    else if (added + removed + changed == 0) showStatus(QString("Lista stacji jest aktualna (%1 stacji).").arg(stations.count()), 5000);
+    else showStatus(QString("Zaktualizowano listę stacji: %1 nowych, %2 usuniętych, %3 zmienionych.")
+                        .arg(added).arg(removed).arg(changed), 5000);
 
-    // Pobierz aktualny tekst filtra i zastosuj filtrowanie
+    // Nanieś na widoczną listę tylko różnice, z uwzględnieniem bieżącego filtra
     QString currentFilterText = ui->cityFilterLineEdit ? ui->cityFilterLineEdit->text() : QString();
-    filterStationsByCity(currentFilterText);
+    if (hadStations) syncStationList(currentFilterText);
+    else filterStationsByCity(currentFilterText);
+    scheduleCatalogSave();
+}
+
+void mainWindow::handleStationsPagesFetched(const QList<StationInfo>& stations, int pagesReceived, int pageCount)
+{
+    AQM_TRACE_SCOPE("handleStationsPagesFetched", "ui");
+    delivery->postProgress(pagesReceived, pageCount);
+    if (!catalog.isEmpty() && !streamingStations) return; // Odświeżenie - różnice po skompletowaniu listy
+    streamingStations = true;
+    // Różnicowa aktualizacja listy zachowuje zaznaczenie i przewinięcie między stronami
+    if (catalog.addStations(stations) > 0) syncStationList(ui->cityFilterLineEdit ? ui->cityFilterLineEdit->text() : QString());
+    showStatus(QString("Wczytywanie listy stacji: strona %1 z %2 (%3 stacji)...")
+                   .arg(pagesReceived).arg(pageCount).arg(catalog.stationCount()));
+}
+
+void mainWindow::showStatus(const QString& text, int timeoutMs)
+{
+    delivery->postStatus(text, timeoutMs);
+}
+
+void mainWindow::reportDeliveryProgress(int delivered)
+{
+    // Seria żądań trwa, dopóki klient ma żądania w toku; postęp liczony od jej początku
+    deliveredInBurst += delivered;
+    const int pending = apiClient->pendingRequestCount();
+    delivery->postProgress(deliveredInBurst, deliveredInBurst + pending);
+    if (pending == 0) deliveredInBurst = 0;
 }
 
 void mainWindow::handleNetworkError(const QString& errorString)
 {
-    QString userMessage = "Wystąpił błąd sieci lub danych API:\n" + errorString;
-    if (statusBar()) statusBar()->showMessage("Błąd pobierania danych.", 5000);
+    ++unacknowledgedErrors;
+    showStatus("Błąd pobierania danych.", 5000);
+    updateNetworkStatusLabel();
+
+    // Jeden niemodalny komunikat dla wszystkich błędów - nie blokuje pętli zdarzeń,
+    // więc pozostałe odpowiedzi są dalej obsługiwane
+    if (!networkErrorBox) {
+        networkErrorBox = new QMessageBox(this);
+        networkErrorBox->setIcon(QMessageBox::Warning);
+        networkErrorBox->setWindowTitle("Błąd");
+        networkErrorBox->setWindowModality(Qt::NonModal);
+        networkErrorBox->addButton("OK", QMessageBox::AcceptRole); // Przycisk domyślny
+        QPushButton *loadButton = networkErrorBox->addButton("Wczytaj z pliku", QMessageBox::ActionRole);
+        connect(networkErrorBox, &QMessageBox::buttonClicked, this, [this, loadButton](QAbstractButton *button) {
+            unacknowledgedErrors = 0;
+            updateNetworkStatusLabel();
+            // Jeśli użytkownik kliknął "Wczytaj z pliku"
+            if (button == loadButton) on_loadDataButton_clicked();
+        });
+    }
 
-    // Pokaż okno błędu z opcją wczytania pliku
-    QMessageBox msgBox(this);
-    msgBox.setIcon(QMessageBox::Warning);
-    msgBox.setWindowTitle("Błąd");
-    msgBox.setText(userMessage + "\n\nCzy chcesz spróbować wczytać dane z pliku?");
-    msgBox.addButton("OK", QMessageBox::AcceptRole); // Przycisk domyślny
-    QPushButton *loadButton = msgBox.addButton("Wczytaj z pliku", QMessageBox::ActionRole);
+    QString userMessage = unacknowledgedErrors == 1
+                              ? "Wystąpił błąd sieci lub danych API:\n" + errorString
+                              : QString("Wystąpiło %1 błędów sieci lub danych API. Ostatni:\n%2").arg(unacknowledgedErrors).arg(errorString);
+    networkErrorBox->setText(userMessage + "\n\nCzy chcesz spróbować wczytać dane z pliku?");
+    if (!networkErrorBox->isVisible()) networkErrorBox->show();
+}
 
-    msgBox.exec(); // Wyświetl i czekaj na wybór
+void mainWindow::handleRequestRetrying(const QString& endpoint, int attempt, int delayMs)
+{
+    showStatus(QString("Ponawianie żądania (%1, próba %2) za %3 ms...").arg(endpoint).arg(attempt).arg(delayMs), 3000);
+}
 
-    // Jeśli użytkownik kliknął "Wczytaj z pliku"
-    if (msgBox.clickedButton() == loadButton) {
-        on_loadDataButton_clicked(); // Wywołaj slot wczytywania
+void mainWindow::handleCircuitStateChanged(const QString& endpoint, bool open)
+{
+    if (open) {
+        if (!openCircuits.contains(endpoint)) openCircuits.append(endpoint);
+    } else {
+        openCircuits.removeAll(endpoint);
+        showStatus(QString("Endpoint %1 znów odpowiada.").arg(endpoint), 5000);
     }
+    updateNetworkStatusLabel();
+}
+
+void mainWindow::updateNetworkStatusLabel()
+{
+    if (!networkStatusLabel) return;
+    QStringList parts;
+    if (!openCircuits.isEmpty()) parts << QString("Wstrzymano: %1").arg(openCircuits.join(", "));
+    if (unacknowledgedErrors > 0) parts << QString("Błędy sieci: %1").arg(unacknowledgedErrors);
+    networkStatusLabel->setText(parts.join(" | "));
+    networkStatusLabel->setVisible(!parts.isEmpty());
 }
 
 /**
@@ -240,6 +710,7 @@ void mainWindow::handleNetworkError(const QString& errorString)
  */
 void mainWindow::on_listWidget_itemClicked(QListWidgetItem *item)
 {
+    AQM_TRACE_SCOPE("on_listWidget_itemClicked", "ui");
     // Sprawdź, czy kliknięty element jest prawidłowy i aktywny
     if (!item || !item->flags().testFlag(Qt::ItemIsEnabled)) {
         // Jeśli kliknięto pusty obszar lub element nieaktywny,
@@ -276,7 +747,11 @@ void mainWindow::on_listWidget_itemClicked(QListWidgetItem *item)
         }
 
         // Wyczyść kontrolki związane z sensorami i danymi przed nowym zapytaniem
-        if (ui->sensorsListWidget) {
+        selectedStationId = stationId;
+        if (catalog.hasSensors(stationId)) {
+            // Sensory z katalogu są widoczne od razu; odpowiedź API tylko je zweryfikuje
+            showSensorList(catalog.sensorsForStation(stationId));
+        } else if (ui->sensorsListWidget) {
             ui->sensorsListWidget->clear();
             ui->sensorsListWidget->addItem("Pobieranie sensorów..."); // Pokaż status ładowania
             if(ui->sensorsListWidget->count() > 0)
@@ -295,9 +770,7 @@ void mainWindow::on_listWidget_itemClicked(QListWidgetItem *item)
         }
 
         // Poinformuj użytkownika na pasku statusu
-        if (statusBar()) {
-            statusBar()->showMessage(QString("Pobieranie sensorów dla stacji ID: %1...").arg(stationId));
-        }
+        showStatus(QString("Pobieranie sensorów dla stacji ID: %1...").arg(stationId));
         // Wywołaj metodę API do pobrania sensorów dla wybranej stacji
         apiClient->fetchSensorsForStation(stationId);
 
@@ -310,9 +783,7 @@ void mainWindow::on_listWidget_itemClicked(QListWidgetItem *item)
             ui->selectedStationLabel->setToolTip("");
         }
         // Pokaż błąd na pasku statusu
-        if (statusBar()) {
-            statusBar()->showMessage("Błąd: Nieprawidłowe dane dla wybranej stacji.", 3000);
-        }
+        showStatus("Błąd: Nieprawidłowe dane dla wybranej stacji.", 3000);
         if (ui->sensorsListWidget) ui->sensorsListWidget->clear();
         if (ui->chartView) ui->chartView->setChart(new QChart());
         if (ui->measurementDataTextEdit) ui->measurementDataTextEdit->clear();
@@ -320,11 +791,42 @@ void mainWindow::on_listWidget_itemClicked(QListWidgetItem *item)
     }
 }
 
-void mainWindow::handleSensorsFetched(const QList<SensorInfo>& sensors)
+void mainWindow::handleSensorsBatch(const QList<ResultBatcher::StationSensors>& batch)
+{
+    AQM_TRACE_SCOPE("handleSensorsBatch", "ui");
+    // Wszystkie listy trafiają do katalogu; pokazywana jest tylko lista wybranej stacji
+    const QList<SensorInfo> *shown = nullptr;
+    bool catalogChanged = false;
+    for (const ResultBatcher::StationSensors& entry : batch) {
+        // ID stacji pochodzi z adresu żądania - pusta lista innej stacji nie nadpisuje wybranej
+        const int stationId = entry.stationId;
+        const QList<SensorInfo>& sensors = entry.sensors;
+        if (stationId >= 0 && !(catalog.hasSensors(stationId) && catalog.sameSensors(stationId, sensors))) {
+            catalog.setSensors(stationId, sensors);
+            catalogChanged = true;
+        }
+        if (stationId >= 0 && stationId == selectedStationId) shown = &sensors;
+    }
+    if (catalogChanged) scheduleCatalogSave();
+    reportDeliveryProgress(int(batch.size()));
+    if (!shown) return;
+
+    showStatus(QString("Pobrano %1 sensorów.").arg(shown->count()), 5000);
+    showSensorList(*shown);
+}
+
+void mainWindow::showSensorList(const QList<SensorInfo>& sensors)
 {
-    if (statusBar()) statusBar()->showMessage(QString("Pobrano %1 sensorów.").arg(sensors.count()), 5000);
     if (!ui->sensorsListWidget) return;
 
+    // Lista już pokazuje te same sensory (np. z katalogu) - nie przebudowujemy jej, aby nie tracić zaznaczenia
+    if (!sensors.isEmpty() && ui->sensorsListWidget->count() == sensors.size()) {
+        bool same = true;
+        for (int i = 0; i < sensors.size() && same; ++i)
+            same = ui->sensorsListWidget->item(i)->data(Qt::UserRole).toInt() == sensors.at(i).id;
+        if (same) return;
+    }
+
     ui->sensorsListWidget->clear();
 
     if (sensors.isEmpty()) {
@@ -350,6 +852,7 @@ void mainWindow::handleSensorsFetched(const QList<SensorInfo>& sensors)
 
 void mainWindow::on_sensorsListWidget_itemClicked(QListWidgetItem *item)
 {
+    AQM_TRACE_SCOPE("on_sensorsListWidget_itemClicked", "ui");
     if (!item || !item->flags().testFlag(Qt::ItemIsEnabled)) return;
 
     bool ok;
@@ -364,125 +867,648 @@ void mainWindow::on_sensorsListWidget_itemClicked(QListWidgetItem *item)
         }
         if (ui->analysisResultsTextEdit) ui->analysisResultsTextEdit->clear();
 
-        if (statusBar()) statusBar()->showMessage(QString("Pobieranie danych dla sensora ID: %1...").arg(sensorId));
+        // Obserwowany sensor ma w trybie na żywo aktualną serię - bez ponownego pobierania
+        if (liveRefresh->isActive() && liveRefresh->isWatching(sensorId)) {
+            handleMeasurementDataFetched(liveRefresh->latest(sensorId));
+            return;
+        }
+
+        showStatus(QString("Pobieranie danych dla sensora ID: %1...").arg(sensorId));
         apiClient->fetchMeasurementData(sensorId);
     } else {
         qWarning() << "Nie udało się odczytać ID sensora z elementu:" << item->text();
-        if (statusBar()) statusBar()->showMessage("Błąd: Nieprawidłowe ID sensora.", 3000);
+        showStatus("Błąd: Nieprawidłowe ID sensora.", 3000);
     }
 }
 
-void mainWindow::handleMeasurementDataFetched(const MeasurementData& measurementResult)
+void mainWindow::handleMeasurementDataFetched(const MeasurementDataPtr& measurementResult)
 {
-    this->currentMeasurementData = measurementResult; // Zapisz aktualne dane
+    handleMeasurementBatch({measurementResult});
+}
 
-    if (statusBar()) {
-        statusBar()->showMessage(QString("Pobrano %1 pomiarów dla %2.")
-                                     .arg(currentMeasurementData.values.count())
-                                     .arg(currentMeasurementData.key), 5000);
+void mainWindow::handleMeasurementBatch(const QList<MeasurementDataPtr>& batch)
+{
+    AQM_TRACE_SCOPE("handleMeasurementBatch", "ui");
+    reportDeliveryProgress(int(batch.size()));
+    MeasurementDataPtr shown, shownReceived;
+    bool mapChanged = false;
+    int accepted = 0;
+    for (const MeasurementDataPtr& measurementResult : batch) {
+        // Odpowiedź na zapytanie trybu na żywo - nowe odczyty trafią do handleMeasurementsAppended()
+        if (liveRefresh->consumeResponse(measurementResult)) continue;
+
+        // Współdzielona migawka, kopiowany jest tylko wskaźnik (kopia tylko z nowymi flagami jakości)
+        const MeasurementDataPtr received = faultDetector.apply(measurementResult ? measurementResult : emptyMeasurementData());
+        if (liveRefresh->isActive()) liveRefresh->watch(received);
+        alertEngine->ingest(*received, catalog.stationIdForSensor(received->sensorId)); // Tylko odczyty nowsze niż już ocenione
+        forecaster.ingest(*received);
+
+        // Widok pokazuje serię połączoną z historią sesji (i zaimportowanym archiwum);
+        // dane z pliku (bez ID sensora) nie trafiają do historii i są indeksowane osobno
+        const MeasurementDataPtr merged = history.put(received);
+        if (merged) noteLatestReading(*merged);
+        if (concentrationMapDialog && received->key == concentrationMapKey) mapChanged = true;
+        shown = merged ? merged : received;
+        shownReceived = received;
+        ++accepted;
+    }
+    if (mapChanged) refreshConcentrationMap();
+    if (!shown) return;
+
+    // Widok jest przebudowywany raz na paczkę - dla ostatniej serii (jak przy kolejnych pojedynczych odpowiedziach)
+    setCurrentSeries(shown);
+    const MeasurementData& data = *currentMeasurementData;
+    if (accepted == 1) {
+        showStatus(QString("Pobrano %1 pomiarów dla %2.").arg(shownReceived->values.count()).arg(data.key), 5000);
+    } else {
+        showStatus(QString("Pobrano dane %1 sensorów (wyświetlane: %2).").arg(accepted).arg(data.key), 5000);
     }
 
-    // Aktualizuj wykres
+    // Aktualizuj wykres i pole tekstowe z danymi
     displayChart();
+    displayMeasurementText();
 
-    // Aktualizuj pole tekstowe z danymi
-    if (ui->measurementDataTextEdit) {
-        ui->measurementDataTextEdit->clear();
-        ui->measurementDataTextEdit->setPlaceholderText(""); // Usuń placeholder
-        // Użyj HTML dla pogrubienia tytułu
-        ui->measurementDataTextEdit->append(QString("<b>Dane dla: %1</b>").arg(currentMeasurementData.key));
-        ui->measurementDataTextEdit->append("------------------------------------");
-        if (currentMeasurementData.values.isEmpty()) {
-            ui->measurementDataTextEdit->append("Brak danych pomiarowych.");
-        } else {
-            for (const Measurement& m : currentMeasurementData.values) {
-                QString valueStr = m.value.isNull() ? "[brak]" : QString::number(m.value.toDouble());
-                ui->measurementDataTextEdit->append(QString("%1: %2")
-                                                        .arg(m.date.toString("yyyy-MM-dd HH:mm:ss"))
-                                                        .arg(valueStr));
+    // Wyczyść wyniki poprzedniej analizy przy ładowaniu nowych danych
+    if(ui->analysisResultsTextEdit) {
+        ui->analysisResultsTextEdit->clear();
+        ui->analysisResultsTextEdit->setPlaceholderText("Kliknij 'Analizuj Dane'"); // Dodaj placeholder
+    }
+}
+
+void mainWindow::handleMeasurementsAppended(const MeasurementDataPtr& liveData, int firstNewIndex, int droppedTail)
+{
+    AQM_TRACE_SCOPE("handleMeasurementsAppended", "ui");
+    const MeasurementDataPtr data = faultDetector.apply(liveData); // Te same indeksy odczytów, ewentualnie z flagami
+    MeasurementDataPtr merged;
+    if (data) {
+        merged = history.put(data);
+        if (merged) noteLatestReading(*merged);
+        alertEngine->ingest(*data, catalog.stationIdForSensor(data->sensorId));
+        forecaster.ingest(*data);
+        // Nowa godzina kilku stacji - mapa przelicza tylko kafelki wokół nich
+        if (concentrationMapDialog && data->key == concentrationMapKey) refreshConcentrationMap();
+    }
+    // Serie innych obserwowanych sensorów czekają w LiveRefresh do czasu ich wybrania
+    if (!merged || data->sensorId != currentMeasurementData->sensorId) return;
+    const bool canAppend = chartSeries && !currentMeasurementData->values.isEmpty();
+    setCurrentSeries(merged);
+    // Pusty widok (pełne wyświetlenie jest równie tanie) albo widok wybranego miesiąca
+    // (najwyżej ~750 punktów, nowe odczyty mogą leżeć poza nim). Seria jest już wchłonięta
+    // przez historię, alerty i prognozę - przerysowujemy tylko widok.
+    if (!canAppend || rangeComboBox->currentData().toInt() < 0) {
+        displayChart();
+        displayMeasurementText();
+        return;
+    }
+
+    // Seria z LiveRefresh stanowi koniec serii połączonej z historią
+    const int firstNew = int(merged->values.size() - data->values.size()) + firstNewIndex;
+
+    // Wykres: tylko nowe punkty (wartości null nie były rysowane, więc droppedTail ich nie dotyczy)
+    QList<QPointF> points;
+    double minY = 0.0, maxY = 0.0;
+    for (int i = firstNew; i < merged->values.size(); ++i) {
+        const Measurement& m = merged->values.at(i);
+        if (!m.date.isValid() || !m.isUsable()) continue;
+        const double y = m.value.toDouble();
+        if (points.isEmpty() || y < minY) minY = y;
+        if (points.isEmpty() || y > maxY) maxY = y;
+        points.append(QPointF(m.date.toMSecsSinceEpoch(), y));
+    }
+    if (!points.isEmpty()) {
+        chartSeries->append(points);
+        // Prognoza od nowego ostatniego odczytu zastępuje poprzednią (model już przyjął nowe odczyty)
+        const QList<QPointF> predicted = forecastSeries ? forecastPoints(points.last()) : QList<QPointF>();
+        if (forecastSeries) forecastSeries->replace(predicted);
+        for (const QPointF& p : predicted) maxY = qMax(maxY, p.y());
+        const qint64 lastX = qint64((predicted.isEmpty() ? points : predicted).last().x());
+        for (QAbstractAxis *axis : chartSeries->attachedAxes()) {
+            if (QDateTimeAxis *axisX = qobject_cast<QDateTimeAxis*>(axis)) {
+                axisX->setMax(qMax(axisX->max(), QDateTime::fromMSecsSinceEpoch(lastX)));
+            } else if (QValueAxis *axisY = qobject_cast<QValueAxis*>(axis)) {
+                axisY->setRange(qMin(axisY->min(), minY), qMax(axisY->max(), maxY));
             }
         }
+    }
+
+    // Pole tekstowe: usunięcie zastąpionych wierszy (null) i separatora, dopisanie nowych wierszy
+    if (ui->measurementDataTextEdit) {
+        QTextCursor cursor(ui->measurementDataTextEdit->document());
+        cursor.movePosition(QTextCursor::End);
+        cursor.movePosition(QTextCursor::PreviousBlock, QTextCursor::KeepAnchor, droppedTail + 1);
+        cursor.movePosition(QTextCursor::EndOfBlock, QTextCursor::KeepAnchor);
+        cursor.removeSelectedText();
+        for (int i = firstNew; i < merged->values.size(); ++i) ui->measurementDataTextEdit->append(measurementLine(merged->values.at(i)));
         ui->measurementDataTextEdit->append("------------------------------------");
+    }
+
+    showStatus(QString("Tryb na żywo: %1 nowych pomiarów dla %2.")
+                   .arg(data->values.size() - firstNewIndex).arg(data->key), 5000);
+}
+
+void mainWindow::handleAlertRaised(const Alert& alert)
+{
+    showStatus(QString("%1: %2 (stacja %3, %4) - %5, próg %6")
+                   .arg(alert.cleared ? "Ustąpienie" : "ALARM", alert.ruleName)
+                   .arg(alert.stationId).arg(alert.time.toString("yyyy-MM-dd HH:mm"))
+                   .arg(alert.value, 0, 'f', 1).arg(alert.threshold, 0, 'f', 1), 15000);
+}
+
+void mainWindow::loadAlertRules()
+{
+    QString documentsPath = QStandardPaths::writableLocation(QStandardPaths::DocumentsLocation);
+    QString fileName = QFileDialog::getOpenFileName(this, "Wczytaj reguły alarmowe", documentsPath, "Pliki JSON (*.json)");
+    if (fileName.isEmpty()) return; // Anulowano
+
+    QList<AlertRule> rules;
+    QString errorString;
+    if (!AlertEngine::loadRules(fileName, rules, &errorString)) {
+        QMessageBox::warning(this, "Reguły alarmowe", QString("Nie można wczytać reguł:\n%1").arg(errorString));
+        return;
+    }
+    alertEngine->setRules(rules);
+    if (currentMeasurementData->sensorId >= 0)
+        alertEngine->ingest(*currentMeasurementData, catalog.stationIdForSensor(currentMeasurementData->sensorId));
+    showStatus(QString("Wczytano %1 reguł alarmowych.").arg(rules.size()), 5000);
+}
+
+void mainWindow::exportHistoryCsv()
+{
+    if (history.sensorCount() == 0) {
+        QMessageBox::information(this, "Brak danych", "W tej sesji nie pobrano jeszcze danych żadnego sensora.");
+        return;
+    }
+
+    bool ok = false;
+    const QStringList layouts = {"Długi (wiersz na odczyt)", "Szeroki (kolumna na sensor)"};
+    const QString layout = QInputDialog::getItem(this, "Eksport CSV", QString("Sensory: %1, odczyty: %2.\nUkład pliku:")
+                                                     .arg(history.sensorCount()).arg(history.readingCount()),
+                                                 layouts, 0, false, &ok);
+    if (!ok) return;
+    const int days = QInputDialog::getInt(this, "Eksport CSV", "Liczba ostatnich dni (0 = całość):", 0, 0, 3650, 1, &ok);
+    if (!ok) return;
+
+    QString defaultFileName = QString("eksport_%1.csv").arg(QDateTime::currentDateTime().toString("yyyyMMdd_HHmmss"));
+    QString documentsPath = QStandardPaths::writableLocation(QStandardPaths::DocumentsLocation);
+    QString fileName = QFileDialog::getSaveFileName(this, "Eksport CSV", documentsPath + "/" + defaultFileName, "Pliki CSV (*.csv)");
+    if (fileName.isEmpty()) return; // Anulowano
+
+    CsvExporter::Options options;
+    options.layout = layout == layouts.at(1) ? CsvExporter::Layout::Wide : CsvExporter::Layout::Long;
+    if (days > 0) options.from = QDateTime::currentDateTime().addDays(-days);
+
+    QElapsedTimer exportTimer;
+    exportTimer.start();
+    CsvExporter::Result result;
+    QString errorString;
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    const bool exported = CsvExporter::exportToFile(history.allSeries(), fileName, options, &result, &errorString);
+    QApplication::restoreOverrideCursor();
+    if (!exported) {
+        QMessageBox::critical(this, "Błąd Zapisu", QString("Błąd eksportu do pliku '%1':\n%2").arg(QFileInfo(fileName).fileName(), errorString));
+        return;
+    }
+    showStatus(QString("Wyeksportowano %1 wierszy z %2 sensorów (%3 MB) w %4 ms.")
+                   .arg(result.rows).arg(result.sensors).arg(result.bytes / 1048576.0, 0, 'f', 1)
+                   .arg(exportTimer.elapsed()), 8000);
+}
+
+void mainWindow::importArchive()
+{
+    if (catalog.isEmpty()) {
+        QMessageBox::information(this, "Brak katalogu", "Najpierw pobierz listę stacji - dane archiwum są przypisywane do stacji i sensorów z katalogu.");
+        return;
+    }
+    QString documentsPath = QStandardPaths::writableLocation(QStandardPaths::DocumentsLocation);
+    if (archiveImporter.stationCodeCount() == 0) {
+        const QString metadataFile = QFileDialog::getOpenFileName(this, "Metadane stacji GIOŚ (CSV)", documentsPath,
+                                                                  "Pliki CSV (*.csv *.txt);;Wszystkie pliki (*)");
+        if (metadataFile.isEmpty()) return; // Anulowano
+        QString errorString;
+        const int mapped = archiveImporter.loadStationCodes(metadataFile, catalog, &errorString);
+        if (mapped <= 0) {
+            QMessageBox::warning(this, "Błąd Importu", mapped < 0 ? QString("Nie można odczytać pliku metadanych:\n%1").arg(errorString)
+                                                                   : QString("Nie dopasowano żadnej stacji z pliku metadanych."));
+            return;
+        }
+    }
+
+    const QStringList fileNames = QFileDialog::getOpenFileNames(this, "Import archiwum GIOŚ", documentsPath,
+                                                                "Pliki CSV (*.csv *.txt);;Wszystkie pliki (*)");
+    if (fileNames.isEmpty()) return; // Anulowano
+
+    QElapsedTimer importTimer;
+    importTimer.start();
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    const ArchiveImporter::Result result = archiveImporter.importFiles(fileNames, catalog, history);
+    QApplication::restoreOverrideCursor();
+
+    // Archiwum może zawierać odczyty nowsze niż pobrane z API (mapa stężeń)
+    for (int sensorId : result.sensorIds) {
+        const MeasurementDataPtr imported = history.series(sensorId);
+        if (imported) noteLatestReading(*imported);
+    }
+
+    // Wyświetlana seria mogła zostać uzupełniona danymi archiwalnymi
+    const MeasurementDataPtr updated = history.series(currentMeasurementData->sensorId);
+    if (updated && updated != currentMeasurementData) {
+        setCurrentSeries(updated);
+        displayChart();
+        displayMeasurementText();
+    }
+
+    showStatus(QString("Zaimportowano %1 odczytów (%2 serii z %3 plików) w %4 ms.")
+                   .arg(result.readings).arg(result.importedSeries).arg(result.files)
+                   .arg(importTimer.elapsed()), 8000);
+    QStringList notes;
+    if (!result.errors.isEmpty()) notes << "Błędy:\n" + result.errors.join('\n');
+    if (!result.skippedFiles.isEmpty()) notes << "Pominięte (tylko dane godzinne): " + result.skippedFiles.join(", ");
+    if (!result.unmappedColumns.isEmpty()) {
+        notes << QString("Kolumny bez sensora w katalogu: %1 (np. %2).\nSensory stacji muszą być wcześniej pobrane z API.")
+                     .arg(result.unmappedColumns.size()).arg(result.unmappedColumns.mid(0, 5).join(", "));
+    }
+    if (!notes.isEmpty()) QMessageBox::information(this, "Import archiwum", notes.join("\n\n"));
+}
+
+void mainWindow::showCorrelationMatrix()
+{
+    if (correlationRunning) {
+        showStatus("Macierz korelacji jest już liczona...", 3000);
+        return;
+    }
+    if (history.sensorCount() < 2) {
+        QMessageBox::information(this, "Brak danych", "Macierz korelacji wymaga serii co najmniej dwóch sensorów pobranych w tej sesji.");
+        return;
+    }
+    bool ok = false;
+    const QStringList methods = {"Pearsona", "Spearmana (rangi)"};
+    const QString method = QInputDialog::getItem(this, "Macierz korelacji", QString("Sensory: %1.\nKorelacja:").arg(history.sensorCount()),
+                                                 methods, 0, false, &ok);
+    if (!ok) return;
+    const int maxLag = QInputDialog::getInt(this, "Macierz korelacji", "Największe sprawdzane opóźnienie (godziny, 0 = bez przesunięć):",
+                                            0, 0, 72, 1, &ok);
+    if (!ok) return;
+
+    CorrelationMatrix::Options options;
+    options.method = method == methods.at(1) ? CorrelationMatrix::Method::Spearman : CorrelationMatrix::Method::Pearson;
+    options.maxLag = maxLag;
+    selectedRange(options.from, options.to); // Zakres widoku (okna liczone od ostatniego odczytu bieżącej serii)
+
+    // Obliczenia w tle; serie są migawkami, więc wątek roboczy nie dzieli stanu z oknem
+    const QList<MeasurementDataPtr> series = history.allSeries();
+    correlationRunning = true;
+    showStatus(QString("Liczenie macierzy korelacji (%1 sensorów)...").arg(series.size()));
+    QElapsedTimer timer;
+    timer.start();
+    auto *watcher = new QFutureWatcher<CorrelationMatrix::Result>(this);
+    connect(watcher, &QFutureWatcher<CorrelationMatrix::Result>::finished, this, [this, watcher, method, timer]() {
+        correlationRunning = false;
+        const qint64 elapsed = timer.elapsed();
+        showStatus(QString("Macierz korelacji policzona w %1 ms.").arg(elapsed), 5000);
+        showCorrelationResult(watcher->result(), method, elapsed);
+        watcher->deleteLater();
+    });
+    watcher->setFuture(QtConcurrent::run([series, options]() { return CorrelationMatrix::compute(series, options); }));
+}
+
+void mainWindow::showCorrelationResult(const CorrelationMatrix::Result& result, const QString& method, qint64 elapsed)
+{
+    QStringList labels;
+    for (int i = 0; i < result.size; ++i) {
+        const int stationIndex = catalog.indexOfStation(catalog.stationIdForSensor(result.sensorIds.at(i)));
+        labels.append(stationIndex >= 0 ? QString("%1 %2").arg(catalog.cityName(stationIndex), result.keys.at(i))
+                                        : QString("%1 [%2]").arg(result.keys.at(i)).arg(result.sensorIds.at(i)));
+    }
+
+    // Najsilniejsze pary (poza przekątną) jako uzupełnienie mapy
+    QVector<QPair<double, int>> pairs;
+    for (int i = 0; i < result.size; ++i) {
+        for (int j = i + 1; j < result.size; ++j) {
+            if (!std::isnan(result.at(i, j))) pairs.append(qMakePair(-std::abs(result.at(i, j)), i * result.size + j));
+        }
+    }
+    const int shown = int(qMin<qsizetype>(pairs.size(), 20));
+    std::partial_sort(pairs.begin(), pairs.begin() + shown, pairs.end());
+    QString summary;
+    for (int k = 0; k < shown; ++k) {
+        const int i = pairs.at(k).second / result.size, j = pairs.at(k).second % result.size;
+        summary += QString("%1  ~  %2:  r = %3, opóźnienie %4 h, wspólnych godzin %5\n")
+                       .arg(labels.at(i), labels.at(j)).arg(result.at(i, j), 0, 'f', 3)
+                       .arg(result.lag.at(i * result.size + j)).arg(result.overlap.at(i * result.size + j));
+    }
+
+    QDialog *dialog = new QDialog(this);
+    dialog->setAttribute(Qt::WA_DeleteOnClose);
+    dialog->setWindowTitle("Macierz korelacji");
+    QVBoxLayout *layout = new QVBoxLayout(dialog);
+    layout->addWidget(new QLabel(QString("Korelacja %1, %2 sensorów, %3 godzin wspólnej siatki, obliczenia %4 ms.")
+                                     .arg(method).arg(result.size).arg(result.hours).arg(elapsed), dialog));
+    QScrollArea *scrollArea = new QScrollArea(dialog);
+    QLabel *heatmapLabel = new QLabel(scrollArea);
+    heatmapLabel->setPixmap(QPixmap::fromImage(CorrelationMatrix::heatmap(result, labels)));
+    scrollArea->setWidget(heatmapLabel);
+    layout->addWidget(scrollArea, 1);
+    QPlainTextEdit *pairsText = new QPlainTextEdit(summary, dialog);
+    pairsText->setReadOnly(true);
+    pairsText->setMaximumHeight(150);
+    layout->addWidget(pairsText);
+    dialog->resize(1000, 900);
+    dialog->show();
+}
+
+void mainWindow::noteLatestReading(const MeasurementData& data)
+{
+    if (data.sensorId < 0) return;
+    const auto last = std::find_if(data.values.crbegin(), data.values.crend(),
+                                   [](const Measurement& m) { return m.date.isValid() && m.isUsable(); });
+    if (last == data.values.crend()) return;
+    LatestReading& reading = latestReadings[data.sensorId];
+    if (reading.date.isValid() && last->date < reading.date) return; // Starszy zakres (np. archiwum)
+    reading.key = data.key;
+    reading.date = last->date;
+    reading.point.value = last->value.toDouble();
+    if (reading.point.stationId < 0) locateReading(data.sensorId, reading);
+}
+
+bool mainWindow::locateReading(int sensorId, LatestReading& reading) const
+{
+    const int stationIndex = catalog.indexOfStation(catalog.stationIdForSensor(sensorId));
+    if (stationIndex < 0 || !catalog.hasLocation(stationIndex)) return false;
+    reading.point.stationId = catalog.stationId(stationIndex);
+    reading.point.latitude = catalog.latitude(stationIndex);
+    reading.point.longitude = catalog.longitude(stationIndex);
+    return true;
+}
+
+QVector<SpatialInterpolator::Point> mainWindow::latestReadingsFor(const QString& key)
+{
+    QVector<SpatialInterpolator::Point> points;
+    for (auto it = latestReadings.begin(); it != latestReadings.end(); ++it) {
+        if (it->key != key) continue;
+        // Stacja mogła trafić do katalogu (lub dostać współrzędne) po przyjęciu serii
+        if (it->point.stationId >= 0 || locateReading(it.key(), *it)) points.append(it->point);
+    }
+    return points;
+}
+
+void mainWindow::showConcentrationMap()
+{
+    QSet<QString> keySet;
+    for (auto it = latestReadings.begin(); it != latestReadings.end(); ++it) {
+        if (it->point.stationId >= 0 || locateReading(it.key(), *it)) keySet.insert(it->key);
+    }
+    if (keySet.isEmpty()) {
+        QMessageBox::information(this, "Brak danych", "Mapa stężeń wymaga serii pobranych w tej sesji dla stacji ze znanymi współrzędnymi.");
+        return;
+    }
+    QStringList keys(keySet.cbegin(), keySet.cend());
+    keys.sort();
+    bool ok = false;
+    const int current = qMax(0, int(keys.indexOf(concentrationMapKey.isEmpty() ? currentMeasurementData->key : concentrationMapKey)));
+    const QString key = QInputDialog::getItem(this, "Mapa stężeń", "Parametr:", keys, current, false, &ok);
+    if (!ok) return;
+    concentrationMapKey = key;
+
+    if (!concentrationMapDialog) {
+        QDialog *dialog = new QDialog(this);
+        dialog->setAttribute(Qt::WA_DeleteOnClose);
+        QVBoxLayout *layout = new QVBoxLayout(dialog);
+        concentrationMapInfo = new QLabel(dialog);
+        concentrationMapInfo->setWordWrap(true);
+        layout->addWidget(concentrationMapInfo);
+        QScrollArea *scrollArea = new QScrollArea(dialog);
+        concentrationMapImage = new QLabel(scrollArea);
+        scrollArea->setWidget(concentrationMapImage);
+        layout->addWidget(scrollArea, 1);
+        dialog->resize(800, 800);
+        concentrationMapDialog = dialog;
+    }
+    concentrationMapDialog->setWindowTitle(QString("Mapa stężeń - %1").arg(key));
+    refreshConcentrationMap();
+    concentrationMapDialog->show();
+    concentrationMapDialog->raise();
+}
+
+void mainWindow::refreshConcentrationMap()
+{
+    if (!concentrationMapDialog) return;
+    AQM_TRACE_SCOPE("refreshConcentrationMap", "ui");
+    QElapsedTimer timer;
+    timer.start();
+    const SpatialInterpolator::Stats stats = concentrationMap.update(latestReadingsFor(concentrationMapKey));
+    const qint64 elapsed = timer.elapsed();
+
+    const SpatialInterpolator::Options& options = concentrationMap.options();
+    concentrationMapImage->setPixmap(QPixmap::fromImage(concentrationMap.image()));
+    concentrationMapImage->adjustSize();
+    concentrationMapInfo->setText(QString("%1: %2 stacji, siatka %3 x %4 komórek po %5 km, skala 0 - %6 (zielony - fioletowy).\n"
+                                          "Przeliczono %7 z %8 kafelków (%9), %10 ms.")
+                                      .arg(concentrationMapKey).arg(stats.stations)
+                                      .arg(concentrationMap.width()).arg(concentrationMap.height()).arg(options.cellKm)
+                                      .arg(concentrationMap.maxValue(), 0, 'f', 1)
+                                      .arg(stats.recomputedTiles).arg(stats.totalTiles)
+                                      .arg(stats.fullRebuild ? "pełne przeliczenie" : QString("zmienione stacje: %1").arg(stats.changedStations))
+                                      .arg(elapsed));
+}
+
+void mainWindow::setCurrentSeries(const MeasurementDataPtr& data)
+{
+    // Seria z historii ma gotowy indeks i agregaty; dane z pliku są indeksowane osobno
+    const SeriesIndexPtr stored = history.index(data->sensorId);
+    if (stored && stored->data() == data) {
+        currentIndex = stored;
+        currentRollup = history.rollup(data->sensorId);
     } else {
-        qWarning() << "measurementDataTextEdit not found. Cannot display text data.";
+        currentIndex = SeriesIndexPtr::create(data);
+        currentRollup = SeriesRollupPtr::create(data);
     }
+    currentMeasurementData = data;
+}
 
-    // Wyczyść wyniki poprzedniej analizy przy ładowaniu nowych danych
-    if(ui->analysisResultsTextEdit) {
-        ui->analysisResultsTextEdit->clear();
-        ui->analysisResultsTextEdit->setPlaceholderText("Kliknij 'Analizuj Dane'"); // Dodaj placeholder
+int mainWindow::viewResolution() const
+{
+    return qMax(200, ui->chartView ? ui->chartView->width() : 800);
+}
+
+void mainWindow::selectedRange(qint64& from, qint64& to) const
+{
+    from = std::numeric_limits<qint64>::min();
+    to = std::numeric_limits<qint64>::max();
+    const int hours = rangeComboBox ? rangeComboBox->currentData().toInt() : 0;
+    if (hours < 0 && rangeMonth.isValid()) {
+        from = QDateTime(rangeMonth, QTime(0, 0)).toMSecsSinceEpoch();
+        to = QDateTime(rangeMonth.addMonths(1), QTime(0, 0)).toMSecsSinceEpoch() - 1;
+    } else if (hours > 0 && !currentIndex->isEmpty()) {
+        to = currentIndex->lastTime();
+        from = to - qint64(hours) * 3600 * 1000 + 1;
     }
 }
 
+QList<QPointF> mainWindow::forecastPoints(const QPointF& lastPoint) const
+{
+    const int sensorId = currentMeasurementData->sensorId;
+    if (!forecaster.isReady(sensorId) || forecaster.lastTime(sensorId) != qint64(lastPoint.x())) return {};
+    QList<QPointF> points{lastPoint};
+    points.append(forecaster.forecast(sensorId));
+    return points;
+}
+
+void mainWindow::saveForecasterState()
+{
+    if (!forecaster.isModified()) return;
+    QString errorMsg;
+    if (!forecaster.save(SeriesForecaster::defaultFileName(), &errorMsg)) qWarning() << "Nie udało się zapisać stanu prognoz:" << errorMsg;
+}
+
+void mainWindow::setDisplayedRange(int comboIndex)
+{
+    if (rangeComboBox->itemData(comboIndex).toInt() < 0) {
+        // Domyślnie miesiąc ostatniego pomiaru
+        const QDate suggested = rangeMonth.isValid() ? rangeMonth
+                                : currentIndex->isEmpty() ? QDate::currentDate()
+                                                          : QDateTime::fromMSecsSinceEpoch(currentIndex->lastTime()).date();
+        bool ok = false;
+        const QString text = QInputDialog::getText(this, "Zakres widoku", "Miesiąc (rrrr-MM):", QLineEdit::Normal,
+                                                   suggested.toString("yyyy-MM"), &ok);
+        const QDate month = ok ? QDate::fromString(text.trimmed() + "-01", "yyyy-MM-dd") : QDate();
+        if (ok && !month.isValid()) QMessageBox::warning(this, "Zakres widoku", QString("Niepoprawny miesiąc: '%1'.").arg(text));
+        if (month.isValid()) rangeMonth = month;
+        if (rangeMonth.isValid()) rangeComboBox->setItemText(comboIndex, QString("Miesiąc %1...").arg(rangeMonth.toString("yyyy-MM")));
+        else rangeComboBox->setCurrentIndex(0); // Bez wybranego miesiąca - cały zakres
+    }
+
+    displayChart();
+    displayMeasurementText();
+    if (ui->analysisResultsTextEdit) ui->analysisResultsTextEdit->clear();
+}
+
+void mainWindow::displayMeasurementText()
+{
+    if (!ui->measurementDataTextEdit) {
+        qWarning() << "measurementDataTextEdit not found. Cannot display text data.";
+        return;
+    }
+    const MeasurementData& data = *currentMeasurementData;
+    qint64 from = 0, to = 0;
+    selectedRange(from, to);
+    qsizetype first = 0, last = 0;
+    currentIndex->findRange(from, to, first, last);
+
+    ui->measurementDataTextEdit->clear();
+    ui->measurementDataTextEdit->setPlaceholderText(""); // Usuń placeholder
+    // Użyj HTML dla pogrubienia tytułu
+    ui->measurementDataTextEdit->append(QString("<b>Dane dla: %1</b>").arg(data.key));
+    ui->measurementDataTextEdit->append("------------------------------------");
+    if (first >= last) {
+        ui->measurementDataTextEdit->append("Brak danych pomiarowych.");
+    } else {
+        for (qsizetype i = first; i < last; ++i) ui->measurementDataTextEdit->append(measurementLine(data.values.at(i)));
+    }
+    ui->measurementDataTextEdit->append("------------------------------------");
+}
+
+void mainWindow::setLiveMode(bool enabled)
+{
+    if (enabled) liveRefresh->watch(currentMeasurementData); // Dane z pliku (bez ID sensora) są pomijane
+    liveRefresh->setActive(enabled);
+    if (liveModeAction && liveModeAction->isChecked() != enabled) liveModeAction->setChecked(enabled);
+    if (!enabled && liveModeAction) liveModeAction->setText("Tryb na żywo");
+    showStatus(enabled ? QString("Tryb na żywo włączony, obserwowane sensory: %1.").arg(liveRefresh->watchedSensors().size())
+               : QString("Tryb na żywo wyłączony."), 5000);
+}
+
 void mainWindow::on_saveDataButton_clicked()
 {
-    if (currentMeasurementData.key.isEmpty() || currentMeasurementData.values.isEmpty()) {
+    // Migawka jest niezmienna - zapis korzysta z tego samego egzemplarza co wykres i tabela
+    const MeasurementDataPtr snapshot = currentMeasurementData;
+    const MeasurementData& data = *snapshot;
+    if (data.key.isEmpty() || data.values.isEmpty()) {
         QMessageBox::information(this, "Brak danych", "Brak danych pomiarowych do zapisania.");
         return;
     }
 
     // Okno dialogowe wyboru pliku
-    QString defaultFileName = QString("dane_%1_%2.json").arg(currentMeasurementData.key).arg(QDateTime::currentDateTime().toString("yyyyMMdd_HHmmss"));
+    QString defaultFileName = QString("dane_%1_%2.json").arg(data.key).arg(QDateTime::currentDateTime().toString("yyyyMMdd_HHmmss"));
     QString documentsPath = QStandardPaths::writableLocation(QStandardPaths::DocumentsLocation);
-    QString fileName = QFileDialog::getSaveFileName(this, "Zapisz dane", documentsPath + "/" + defaultFileName, "Pliki JSON (*.json)");
+    QString fileName = QFileDialog::getSaveFileName(this, "Zapisz dane", documentsPath + "/" + defaultFileName,
+                                                    "Pliki JSON (*.json);;Skompresowane serie (*.aqs)");
 
     if (fileName.isEmpty()) return; // Anulowano
 
-    // Przygotowanie struktury JSON
-    QJsonObject rootObject;
-    rootObject["key"] = currentMeasurementData.key;
-    QJsonArray valuesArray;
-    for (const Measurement& m : currentMeasurementData.values) {
-        QJsonObject mObj;
-        mObj["date"] = m.date.toString(Qt::ISODate); // Zapisz w standardzie ISO
-        mObj["value"] = m.value.isNull() ? QJsonValue::Null : m.value.toDouble();
-        valuesArray.append(mObj);
+    QByteArray fileData;
+    if (QFileInfo(fileName).suffix().compare(SeriesCodec::FileSuffix, Qt::CaseInsensitive) == 0) {
+        // Zwarty format binarny (delta-of-delta + XOR), kilka bajtów na pomiar zamiast ~60
+        fileData = SeriesCodec::encode(data);
+    } else {
+        // Przygotowanie struktury JSON
+        QJsonObject rootObject;
+        rootObject["key"] = data.key;
+        QJsonArray valuesArray;
+        for (const Measurement& m : data.values) {
+            QJsonObject mObj;
+            mObj["date"] = m.date.toString(Qt::ISODate); // Zapisz w standardzie ISO
+            mObj["value"] = m.value.isNull() ? QJsonValue::Null : m.value.toDouble();
+            valuesArray.append(mObj);
+        }
+        rootObject["values"] = valuesArray;
+        fileData = QJsonDocument(rootObject).toJson();
     }
-    rootObject["values"] = valuesArray;
-    QJsonDocument jsonDoc(rootObject);
 
     // Zapis do pliku z obsługą wyjątków
     try {
         QFile file(fileName);
-        // Otwórz plik (rzuca wyjątek w razie błędu)
-        if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        // Otwórz plik (rzuca wyjątek w razie błędu); tryb binarny - format .aqs nie może podlegać konwersji końców linii
+        if (!file.open(QIODevice::WriteOnly)) {
             throw std::runtime_error(file.errorString().toStdString());
         }
         // Zapisz (rzuca wyjątek w razie błędu)
-        if (file.write(jsonDoc.toJson()) == -1) {
+        if (file.write(fileData) == -1) {
             file.close(); // Zamknij przed rzuceniem
             throw std::runtime_error(file.errorString().toStdString());
         }
         file.close(); // Zamknij po udanym zapisie
-        if (statusBar()) statusBar()->showMessage(QString("Dane zapisano do: %1").arg(QFileInfo(fileName).fileName()), 5000);
+        showStatus(QString("Dane zapisano do: %1").arg(QFileInfo(fileName).fileName()), 5000);
 
     } catch (const std::exception &e) {
         QString errorMsg = QString("Błąd zapisu do pliku '%1':\n%2")
                                .arg(QFileInfo(fileName).fileName()).arg(QString::fromStdString(e.what()));
         qWarning() << "Wyjątek podczas zapisu pliku:" << e.what();
         QMessageBox::critical(this, "Błąd Zapisu", errorMsg);
-        if (statusBar()) statusBar()->showMessage("Błąd zapisu pliku.", 5000);
+        showStatus("Błąd zapisu pliku.", 5000);
     } catch (...) { // Łapanie nieznanych wyjątków
         QMessageBox::critical(this, "Nieznany Błąd", "Wystąpił nieznany błąd podczas zapisu pliku.");
-        if (statusBar()) statusBar()->showMessage("Nieznany błąd zapisu.", 5000);
+        showStatus("Nieznany błąd zapisu.", 5000);
     }
 }
 
 void mainWindow::on_loadDataButton_clicked()
 {
     QString documentsPath = QStandardPaths::writableLocation(QStandardPaths::DocumentsLocation);
-    QString fileName = QFileDialog::getOpenFileName(this, "Wczytaj dane", documentsPath, "Pliki JSON (*.json)");
+    QString fileName = QFileDialog::getOpenFileName(this, "Wczytaj dane", documentsPath,
+                                                    "Dane pomiarowe (*.json *.aqs);;Pliki JSON (*.json);;Skompresowane serie (*.aqs)");
     if (fileName.isEmpty()) return; // Anulowano
 
     try {
         // Otwarcie i odczyt pliku
         QFile file(fileName);
-        if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        if (!file.open(QIODevice::ReadOnly)) {
             throw std::runtime_error("Nie można otworzyć pliku: " + file.errorString().toStdString());
         }
         QByteArray jsonData = file.readAll();
         file.close();
 
+        // Format binarny rozpoznajemy po nagłówku, niezależnie od rozszerzenia
+        if (SeriesCodec::isEncodedSeries(jsonData)) {
+            const QSharedPointer<MeasurementData> decodedData = QSharedPointer<MeasurementData>::create();
+            QString decodeError;
+            if (!SeriesCodec::decode(jsonData, *decodedData, &decodeError)) {
+                throw std::runtime_error("Błąd dekodowania serii: " + decodeError.toStdString());
+            }
+            handleMeasurementDataFetched(decodedData);
+            showStatus(QString("Dane wczytano z: %1").arg(QFileInfo(fileName).fileName()), 5000);
+            return;
+        }
+
         // Parsowanie JSON
         QJsonParseError parseError;
         QJsonDocument jsonDoc = QJsonDocument::fromJson(jsonData, &parseError);
@@ -490,110 +1516,97 @@ void mainWindow::on_loadDataButton_clicked()
             throw std::runtime_error("Błąd parsowania JSON: " + parseError.errorString().toStdString() + " (pozycja: " + std::to_string(parseError.offset) + ")");
         }
         if (!jsonDoc.isObject()) { throw std::runtime_error("Nieprawidłowy format JSON (oczekiwano obiektu)."); }
-
-        QJsonObject rootObject = jsonDoc.object();
-        MeasurementData loadedData;
-
-        // Odczyt klucza
-        if (rootObject.contains("key") && rootObject["key"].isString()) {
-            loadedData.key = rootObject["key"].toString();
-        } else { throw std::runtime_error("Brak/niepoprawny klucz 'key' w JSON."); }
-
-        // Odczyt wartości
-        if (rootObject.contains("values") && rootObject["values"].isArray()) {
-            QJsonArray valuesArray = rootObject["values"].toArray();
-            loadedData.values.reserve(valuesArray.count()); // Optymalizacja
-            for(const QJsonValue& val : valuesArray) {
-                if (!val.isObject()) { qWarning() << "Pomijam element niebędący obiektem w tablicy 'values'"; continue; }
-                QJsonObject mObj = val.toObject();
-                Measurement m;
-                // Data (oczekiwany format ISO)
-                if (mObj.contains("date") && mObj["date"].isString()) {
-                    m.date = QDateTime::fromString(mObj["date"].toString(), Qt::ISODate); // Wczytaj ISO
-                    if (!m.date.isValid()) { qWarning() << "Pomijam pomiar - niepoprawny format daty ISO:" << mObj["date"].toString(); continue; }
-                } else { qWarning() << "Pomijam pomiar - brak pola 'date'"; continue; }
-                // Wartość (null lub double)
-                if (mObj.contains("value")) {
-                    if (mObj["value"].isNull()) { m.value = QVariant(); }
-                    else if (mObj["value"].isDouble()) { m.value = mObj["value"].toDouble(); }
-                    else { qWarning() << "Pomijam pomiar - wartość nie jest double ani null. Typ:" << mObj["value"].type(); m.value = QVariant(); }
-                } else { qWarning() << "Pomijam pomiar - brak pola 'value'"; continue; }
-                loadedData.values.append(m);
-            }
-            // Sortowanie
-            if(!loadedData.values.isEmpty()) {
-                std::sort(loadedData.values.begin(), loadedData.values.end(),
-                          [](const Measurement& a, const Measurement& b) { return a.date < b.date; });
-            }
-        } else { throw std::runtime_error("Brak/niepoprawna tablica 'values' w JSON."); }
+        // Plik zapisu musi mieć oba pola (dekoder API dopuszcza ich brak)
+        const QJsonObject rootObject = jsonDoc.object();
+        if (!rootObject.value("key").isString()) { throw std::runtime_error("Brak/niepoprawny klucz 'key' w JSON."); }
+        if (!rootObject.value("values").isArray()) { throw std::runtime_error("Brak/niepoprawna tablica 'values' w JSON."); }
+
+        // Ten sam dekoder co dla odpowiedzi API (daty w formacie ISO lub API, wartości liczbowe lub null)
+        const QSharedPointer<MeasurementData> loadedData = QSharedPointer<MeasurementData>::create();
+        QString decodeError;
+        if (!GiosApiClient::decodeMeasurementData(jsonDoc, *loadedData, &decodeError)) {
+            throw std::runtime_error(decodeError.toStdString());
+        }
 
         // Aktualizacja danych i UI
-        currentMeasurementData = loadedData;
-        handleMeasurementDataFetched(currentMeasurementData); // Wywołaj slot do aktualizacji UI
+        handleMeasurementDataFetched(loadedData); // Wywołaj slot do aktualizacji UI
 
-        if (statusBar()) statusBar()->showMessage(QString("Dane wczytano z: %1").arg(QFileInfo(fileName).fileName()), 5000);
+        showStatus(QString("Dane wczytano z: %1").arg(QFileInfo(fileName).fileName()), 5000);
 
     } catch (const std::exception &e) {
         QString errorMsg = QString("Błąd wczytywania pliku '%1':\n%2")
                                .arg(QFileInfo(fileName).fileName()).arg(QString::fromStdString(e.what()));
         qWarning() << "Wyjątek podczas wczytywania pliku:" << e.what();
         QMessageBox::critical(this, "Błąd Wczytywania", errorMsg);
-        if (statusBar()) statusBar()->showMessage("Błąd wczytywania pliku.", 5000);
+        showStatus("Błąd wczytywania pliku.", 5000);
         // Wyczyść dane w przypadku błędu
-        currentMeasurementData = MeasurementData();
-        handleMeasurementDataFetched(currentMeasurementData); // Aktualizuj UI
+        handleMeasurementDataFetched(emptyMeasurementData()); // Aktualizuj UI
     } catch (...) {
         QMessageBox::critical(this, "Nieznany Błąd", "Wystąpił nieznany błąd podczas wczytywania pliku.");
-        if (statusBar()) statusBar()->showMessage("Nieznany błąd wczytywania.", 5000);
+        showStatus("Nieznany błąd wczytywania.", 5000);
         // Wyczyść dane w przypadku błędu
-        currentMeasurementData = MeasurementData();
-        handleMeasurementDataFetched(currentMeasurementData);
+        handleMeasurementDataFetched(emptyMeasurementData());
     }
 }
 
 
 void mainWindow::on_analyzeButton_clicked()
 {
-    if (currentMeasurementData.values.isEmpty()) {
+    AQM_TRACE_SCOPE("on_analyzeButton_clicked", "analysis");
+    const MeasurementData& data = *currentMeasurementData;
+    if (data.values.isEmpty()) {
         QMessageBox::information(this, "Brak danych", "Brak danych pomiarowych do analizy.");
         // Użyj pola tekstowego do wyświetlenia komunikatu
         if (ui->analysisResultsTextEdit) ui->analysisResultsTextEdit->setPlainText("Brak danych do analizy.");
         return;
     }
 
-    // Zmienne i logika obliczeń
-    double minValue = 1e100, maxValue = -1e100, sum = 0.0;
-    int validCount = 0;
-    QDateTime minDate, maxDate, firstValidDate, lastValidDate;
-    double firstValidValue = 0.0, lastValidValue = 0.0;
-    bool isFirstValidFound = false;
-
-    // Iteracja tylko po poprawnych danych
-    for (const Measurement& m : currentMeasurementData.values) {
-        if (m.date.isValid() && !m.value.isNull()) {
-            double currentValue = m.value.toDouble();
-            validCount++;
-            sum += currentValue;
-            if (currentValue < minValue) { minValue = currentValue; minDate = m.date; }
-            if (currentValue > maxValue) { maxValue = currentValue; maxDate = m.date; }
-            if (!isFirstValidFound) { firstValidValue = currentValue; firstValidDate = m.date; isFirstValidFound = true; }
-            lastValidValue = currentValue; lastValidDate = m.date;
-        }
-    }
+    // Agregaty wybranego zakresu z podsumowań bloków indeksu (przeglądane są tylko bloki brzegowe)
+    qint64 from = 0, to = 0;
+    selectedRange(from, to);
+    const SeriesIndex::Summary summary = currentIndex->summarize(from, to);
+    const int validCount = summary.count;
 
     // Formatowanie wyników jako HTML
     QString analysisHtmlText;
     if (validCount > 0) {
-        double average = sum / validCount; // Oblicz średnią
-        analysisHtmlText = QString("<b>Analiza dla: %1</b><br>").arg(currentMeasurementData.key);
+        const double minValue = summary.min, maxValue = summary.max;
+        const QDateTime minDate = data.values.at(summary.minIndex).date, maxDate = data.values.at(summary.maxIndex).date;
+        QDateTime firstValidDate = data.values.at(summary.firstIndex).date, lastValidDate = data.values.at(summary.lastIndex).date;
+        double firstValidValue = data.values.at(summary.firstIndex).value.toDouble();
+        double lastValidValue = data.values.at(summary.lastIndex).value.toDouble();
+        double average = summary.average(); // Oblicz średnią
+
+        // Trend długiego zakresu z poziomu agregacji dobranego jak dla wykresu (średnie dobowe lub miesięczne)
+        QString firstLabel = "Pierwszy pomiar", lastLabel = "Ostatni pomiar", trendDateFormat = "yy-MM-dd HH:mm";
+        const SeriesRollup::Tier tier = SeriesRollup::chooseTier(summary.count, lastValidDate.toMSecsSinceEpoch() - firstValidDate.toMSecsSinceEpoch(),
+                                                                 viewResolution());
+        if (tier != SeriesRollup::Tier::Raw) {
+            const QVector<SeriesRollup::Bucket> buckets = currentRollup->buckets(tier, from, to);
+            const auto firstBucket = std::find_if(buckets.cbegin(), buckets.cend(), [](const SeriesRollup::Bucket& b) { return b.count > 0; });
+            const auto lastBucket = std::find_if(buckets.crbegin(), buckets.crend(), [](const SeriesRollup::Bucket& b) { return b.count > 0; });
+            if (firstBucket != buckets.cend()) {
+                const bool monthly = tier == SeriesRollup::Tier::Monthly;
+                firstLabel = monthly ? "Pierwsza średnia miesięczna" : "Pierwsza średnia dobowa";
+                lastLabel = monthly ? "Ostatnia średnia miesięczna" : "Ostatnia średnia dobowa";
+                trendDateFormat = monthly ? "yyyy-MM" : "yy-MM-dd";
+                firstValidDate = QDateTime::fromMSecsSinceEpoch(firstBucket->start);
+                firstValidValue = firstBucket->average();
+                lastValidDate = QDateTime::fromMSecsSinceEpoch(lastBucket->start);
+                lastValidValue = lastBucket->average();
+            }
+        }
+        analysisHtmlText = QString("<b>Analiza dla: %1</b><br>").arg(data.key);
         analysisHtmlText += QString("Liczba pomiarów: %1<br>").arg(validCount);
         analysisHtmlText += QString("Min: %1 (%2)<br>").arg(minValue).arg(minDate.toString("yyyy-MM-dd HH:mm"));
         analysisHtmlText += QString("Max: %1 (%2)<br>").arg(maxValue).arg(maxDate.toString("yyyy-MM-dd HH:mm"));
         analysisHtmlText += QString("Średnia: %1<br>").arg(average);
+        if (summary.flagged > 0)
+            analysisHtmlText += QString("Pominięte podejrzane odczyty: %1<br>").arg(summary.flagged);
         if (validCount > 1) { // Oblicz trend tylko jeśli są co najmniej 2 punkty
             analysisHtmlText += "<br>"; // Odstęp
-            analysisHtmlText += QString("Pierwszy pomiar (%1): %2<br>").arg(firstValidDate.toString("yy-MM-dd HH:mm")).arg(firstValidValue);
-            analysisHtmlText += QString("Ostatni pomiar (%1): %2<br>").arg(lastValidDate.toString("yy-MM-dd HH:mm")).arg(lastValidValue);
+            analysisHtmlText += QString("%1 (%2): %3<br>").arg(firstLabel, firstValidDate.toString(trendDateFormat)).arg(firstValidValue);
+            analysisHtmlText += QString("%1 (%2): %3<br>").arg(lastLabel, lastValidDate.toString(trendDateFormat)).arg(lastValidValue);
             if (lastValidValue > firstValidValue) analysisHtmlText += "<b>Trend: Wzrostowy</b>";
             else if (lastValidValue < firstValidValue) analysisHtmlText += "<b>Trend: Spadkowy</b>";
             else analysisHtmlText += "<b>Trend: Stabilny</b>";
@@ -4,10 +4,36 @@
 #include <QMainWindow>
 #include <QList>
 #include <QString>
+#include <QStringList>
+#include <QHash>
+#include <QPointer>
+#include <QDate>
+#include <QDateTime>
 #include "giosapiclient.h" // Dołącz definicje struktur (StationInfo itp.)
+#include "stationcatalog.h"
+#include "historystore.h"
+#include "faultdetector.h"
+#include "seriesforecaster.h"
+#include "spatialinterpolator.h"
+#include "archiveimporter.h"
+#include "resultbatcher.h"
+#include "correlationmatrix.h"
 
 // === POTRZEBNE FORWARD DECLARATIONS ===
 class QListWidgetItem;
+class QDockWidget;
+class QPlainTextEdit;
+class QTimer;
+class QLabel;
+class QMessageBox;
+class QAction;
+class QComboBox;
+class QDialog;
+class QProgressBar;
+class QLineSeries;
+class LiveRefresh;
+class AlertEngine;
+struct Alert;
 namespace Ui { class mainWindow; } // Deklaracja wyprzedzająca dla UI
 // Deklaracje z QtCharts (jeśli nie używasz using namespace w cpp)
 namespace QtCharts {
@@ -50,6 +76,30 @@ public:
      */
     ~mainWindow();
 
+    /**
+     * @brief Zwraca klienta API używanego przez okno (np. do konfiguracji adresu bazowego).
+     */
+    GiosApiClient* client() const { return apiClient; }
+
+    /**
+     * @brief Zwraca silnik reguł alarmowych (np. do wczytania reguł z pliku podanego w wierszu poleceń).
+     */
+    AlertEngine* alerts() const { return alertEngine; }
+
+    /**
+     * @brief Zwraca historię serii sesji (np. do ustawienia budżetu pamięci z wiersza poleceń).
+     */
+    HistoryStore* historyStore() { return &history; }
+
+    /**
+     * @brief Wczytuje synchronicznie ostatni katalog stacji i sensorów z lokalnej migawki,
+     * a następnie uruchamia pobranie świeżej listy stacji w tle (zmiany nanoszone są różnicowo).
+     * Od tego wywołania katalog jest też zapisywany do migawki po każdej aktualizacji.
+     * Wywoływane po skonfigurowaniu klienta API (migawka z innego adresu bazowego jest pomijana).
+     * @param fileName Ścieżka pliku migawki (domyślnie w katalogu danych aplikacji).
+     */
+    void restoreCatalogSnapshot(const QString& fileName = QString());
+
 private slots:
     // === SLOTY OBSŁUGUJĄCE INTERAKCJĘ UŻYTKOWNIKA ===
     // Te sloty są prawdopodobnie połączone automatycznie przez mechanizm `connectSlotsByName`
@@ -77,20 +127,74 @@ private slots:
      */
     void handleStationsFetched(const QList<StationInfo>& stations);
     /**
-     * @brief Odbiera listę sensorów z GiosApiClient i aktualizuje widok listy sensorów.
-     * @param sensors Lista informacji o sensorach.
+     * @brief Dopisuje strony listy stacji z API stronicowanego (tylko przy pierwszym wczytaniu,
+     * gdy lista jest pusta - odświeżenie istniejącej listy czeka na całość i nanosi różnice).
+     * @param stations Stacje ze stron odebranych w jednej klatce.
+     * @param pagesReceived Strony odebrane do tej pory.
+     * @param pageCount Liczba stron.
+     */
+    void handleStationsPagesFetched(const QList<StationInfo>& stations, int pagesReceived, int pageCount);
+    /**
+     * @brief Zapisuje w katalogu listy sensorów z jednej klatki i pokazuje tylko listę wybranej stacji
+     * (listy innych stacji trafiają wyłącznie do katalogu).
+     * @param batch Listy sensorów (po jednej na stację, z ID stacji z adresu żądania).
      */
-    void handleSensorsFetched(const QList<SensorInfo>& sensors);
+    void handleSensorsBatch(const QList<ResultBatcher::StationSensors>& batch);
     /**
-      * @brief Odbiera dane pomiarowe z GiosApiClient, zapisuje je i aktualizuje wykres oraz pole tekstowe.
-      * @param measurementResult Dane pomiarowe dla jednego parametru.
+     * @brief Przyjmuje serie z jednej klatki (historia, alarmy, prognozy) i przebudowuje widok raz,
+     * dla ostatniej z nich. Odpowiedzi trybu na żywo trafiają do handleMeasurementsAppended().
+     * @param batch Serie w kolejności nadejścia.
+     */
+    void handleMeasurementBatch(const QList<MeasurementDataPtr>& batch);
+    /**
+      * @brief Przyjmuje jedną serię i aktualizuje wykres oraz pole tekstowe (jak paczka z jedną serią).
+      * @param measurementResult Współdzielona migawka danych dla jednego parametru (nullptr = brak danych).
       */
-    void handleMeasurementDataFetched(const MeasurementData& measurementResult);
+    void handleMeasurementDataFetched(const MeasurementDataPtr& measurementResult);
+    /**
+     * @brief Dopisuje do wykresu i pola tekstowego tylko nowe odczyty z trybu na żywo
+     * (bez przebudowy widoku). Serie innych obserwowanych sensorów są tylko zapamiętywane.
+     * @param data Nowa migawka serii sensora.
+     * @param firstNewIndex Indeks pierwszego nowego odczytu.
+     * @param droppedTail Liczba końcowych odczytów poprzedniej migawki zastąpionych nowymi.
+     */
+    void handleMeasurementsAppended(const MeasurementDataPtr& data, int firstNewIndex, int droppedTail);
+    /** @brief Pokazuje zgłoszony alarm (lub jego ustąpienie) na pasku stanu. */
+    void handleAlertRaised(const Alert& alert);
+    /** @brief Wczytuje reguły alarmowe z wybranego pliku JSON. */
+    void loadAlertRules();
+    /** @brief Eksportuje do CSV serie wszystkich sensorów pobranych w tej sesji (układ i zakres wybiera użytkownik). */
+    void exportHistoryCsv();
+    /** @brief Importuje do historii wybrane pliki archiwum GIOŚ (przy pierwszym użyciu prosi o metadane stacji). */
+    void importArchive();
+    /** @brief Liczy w tle macierz korelacji serii z historii (metodę i opóźnienia wybiera użytkownik) i pokazuje mapę cieplną. */
+    void showCorrelationMatrix();
+    /** @brief Pokazuje mapę stężeń wybranego parametru interpolowaną z ostatnich odczytów stacji (odświeżaną w trybie na żywo). */
+    void showConcentrationMap();
+    /** @brief Włącza/wyłącza tryb na żywo (wyświetlany sensor jest dodawany do obserwowanych). */
+    void setLiveMode(bool enabled);
     /**
-     * @brief Odbiera informację o błędzie z GiosApiClient, wyświetla komunikat i oferuje wczytanie danych.
+     * @brief Zmienia zakres czasu widoku (wykres, lista pomiarów, analiza) na wybrany w `rangeComboBox`.
+     * Dla pozycji "Wybrany miesiąc..." pyta o miesiąc.
+     * @param comboIndex Indeks wybranej pozycji.
+     */
+    void setDisplayedRange(int comboIndex);
+    /**
+     * @brief Odbiera informację o błędzie z GiosApiClient i dolicza go do zbiorczego, niemodalnego komunikatu
+     * z opcją wczytania danych z pliku. Kolejne błędy aktualizują ten sam komunikat zamiast otwierać nowe okna.
      * @param errorString Tekst błędu.
      */
     void handleNetworkError(const QString& errorString);
+    /** @brief Informuje na pasku stanu o zaplanowanym ponowieniu żądania. */
+    void handleRequestRetrying(const QString& endpoint, int attempt, int delayMs);
+    /** @brief Pokazuje na pasku stanu, które endpointy są wstrzymane przez wyłącznik. */
+    void handleCircuitStateChanged(const QString& endpoint, bool open);
+
+    // === SLOTY PANELU DIAGNOSTYCZNEGO ===
+    /** @brief Odświeża treść panelu diagnostycznego metrykami z GiosApiClient. */
+    void refreshDiagnostics();
+    /** @brief Zapisuje metryki żądań do pliku tekstowego (format Prometheus). */
+    void saveMetricsToFile();
 
 
 private:
@@ -101,17 +205,142 @@ private:
      */
     void displayChart();
 
+    /** @brief Wypełnia pole tekstowe odczytami bieżącej serii z wybranego zakresu czasu. */
+    void displayMeasurementText();
+
+    /**
+     * @brief Wybrany zakres czasu widoku w ms od epoki (okna "ostatnie N godzin" liczone od ostatniego odczytu serii).
+     * @param from Początek zakresu (włącznie).
+     * @param to Koniec zakresu (włącznie).
+     */
+    void selectedRange(qint64& from, qint64& to) const;
+
+    /**
+     * @brief Punkty prognozy bieżącego sensora, poprzedzone ostatnim punktem wykresu (ciągłość linii).
+     * @param lastPoint Ostatni narysowany odczyt.
+     * @return Pusta lista, jeśli model nie jest gotowy lub nie kończy się na tym odczycie.
+     */
+    QList<QPointF> forecastPoints(const QPointF& lastPoint) const;
+
+    /** @brief Zapisuje stan modeli prognoz, jeśli zmienił się od ostatniego zapisu. */
+    void saveForecasterState();
+
+    /** @brief Ostatni wiarygodny odczyt sensora - wejście mapy stężeń utrzymywane przy przyjmowaniu serii. */
+    struct LatestReading {
+        QString key;                        ///< Kod parametru (np. "PM10").
+        QDateTime date;                     ///< Czas odczytu.
+        SpatialInterpolator::Point point;   ///< stationId == -1, dopóki stacja sensora nie ma w katalogu współrzędnych.
+    };
+
+    /** @brief Zapamiętuje ostatni wiarygodny odczyt serii, jeśli jest nowszy od znanego (serie bez ID sensora są pomijane). */
+    void noteLatestReading(const MeasurementData& data);
+    /** @brief Uzupełnia stację i współrzędne odczytu z katalogu; false, jeśli są nieznane. */
+    bool locateReading(int sensorId, LatestReading& reading) const;
+    /** @brief Ostatnie odczyty parametru ze stacji o znanych współrzędnych (bez sięgania do historii). */
+    QVector<SpatialInterpolator::Point> latestReadingsFor(const QString& key);
+
+    /**
+     * @brief Pokazuje macierz korelacji policzoną w tle (mapa cieplna i najsilniejsze pary).
+     * @param result Wynik CorrelationMatrix::compute().
+     * @param method Nazwa wybranej metody (do opisu).
+     * @param elapsed Czas obliczeń (ms).
+     */
+    void showCorrelationResult(const CorrelationMatrix::Result& result, const QString& method, qint64 elapsed);
+
+    /** @brief Aktualizuje siatkę i obraz otwartej mapy stężeń (przyrostowo, gdy zmieniły się tylko wartości). */
+    void refreshConcentrationMap();
+
+    /**
+     * @brief Ustawia wyświetlaną serię wraz z jej indeksem i agregatami (z historii lub budowanymi dla danych z pliku).
+     * @param data Migawka serii (nie nullptr).
+     */
+    void setCurrentSeries(const MeasurementDataPtr& data);
+
+    /** @brief Liczba punktów, powyżej której wykres i analiza przechodzą na średnie dobowe/miesięczne. */
+    int viewResolution() const;
+
     /**
      * @brief Filtruje listę stacji (ui->listWidget) na podstawie podanego tekstu.
-     * Używa pełnej listy stacji przechowywanej w `allStationsList`.
+     * Używa pełnego katalogu stacji przechowywanego w `catalog`.
      * @param cityText Tekst do filtrowania nazw miejscowości.
      */
     void filterStationsByCity(const QString &cityText);
 
+    /**
+     * @brief Tworzy dokowany panel diagnostyczny z metrykami żądań oraz menu "Widok".
+     */
+    void setupDiagnosticsPanel();
+
+    /**
+     * @brief Nanosi na widoczną listę stacji tylko różnice względem katalogu `catalog`
+     * (dodane, usunięte, zmienione stacje), zachowując zaznaczenie i pozycję przewinięcia.
+     * @param cityText Bieżący tekst filtra miejscowości.
+     */
+    void syncStationList(const QString &cityText);
+
+    /** @brief Planuje zapis migawki katalogu (z opóźnieniem, aby połączyć serię zmian). */
+    void scheduleCatalogSave();
+    /** @brief Zapisuje katalog stacji i sensorów do pliku migawki. */
+    void saveCatalogSnapshot();
+
+    /** @brief Aktualizuje stały wskaźnik błędów sieci na pasku stanu. */
+    void updateNetworkStatusLabel();
+
+    /** @brief Pokazuje listę sensorów stacji (bez przebudowy, jeśli lista już pokazuje te same sensory). */
+    void showSensorList(const QList<SensorInfo>& sensors);
+
+    /**
+     * @brief Komunikat paska stanu dławiony do jednego na klatkę (pokazywany jest ostatni).
+     * @param text Treść komunikatu.
+     * @param timeoutMs Czas wyświetlania (0 = do następnego komunikatu).
+     */
+    void showStatus(const QString& text, int timeoutMs = 0);
+
+    /**
+     * @brief Dolicza dostarczone wyniki do postępu bieżącej serii żądań (wskaźnik znika,
+     * gdy klient nie ma już żądań w toku).
+     */
+    void reportDeliveryProgress(int delivered);
+
     // === POLA KLASY ===
     Ui::mainWindow *ui;              ///< Wskaźnik na obiekt UI zarządzający widgetami z pliku .ui.
     GiosApiClient *apiClient;        ///< Obiekt odpowiedzialny za pobieranie danych z API.
-    MeasurementData currentMeasurementData; ///< Bufor na ostatnio pobrane lub wczytane dane pomiarowe.
-    QList<StationInfo> allStationsList; ///< Pełna lista stacji pobrana z API (używana do filtrowania).
+    ResultBatcher *delivery = nullptr;          ///< Dostarczanie wyników, komunikatów i postępu paczkami (raz na klatkę).
+    QProgressBar *loadProgress = nullptr;       ///< Postęp pobierania na pasku stanu (ukryty, gdy nic się nie pobiera).
+    int deliveredInBurst = 0;                   ///< Wyniki dostarczone od początku bieżącej serii żądań.
+    MeasurementDataPtr currentMeasurementData; ///< Migawka ostatnio pobranych lub wczytanych danych (nigdy nullptr).
+    SeriesIndexPtr currentIndex;                ///< Blokowy indeks `currentMeasurementData` (nigdy nullptr).
+    SeriesRollupPtr currentRollup;              ///< Agregaty dobowe i miesięczne `currentMeasurementData` (nigdy nullptr).
+    QComboBox *rangeComboBox = nullptr;         ///< Wybór zakresu czasu widoku.
+    QDate rangeMonth;                           ///< Miesiąc dla pozycji "Wybrany miesiąc...".
+    QPointer<QLineSeries> chartSeries;          ///< Seria bieżącego wykresu (do dopisywania punktów w trybie na żywo).
+    QPointer<QLineSeries> forecastSeries;       ///< Przerywana prognoza na końcu wykresu (zastępowana w trybie na żywo).
+    LiveRefresh *liveRefresh = nullptr;         ///< Harmonogram odpytywania obserwowanych sensorów.
+    AlertEngine *alertEngine = nullptr;         ///< Przyrostowa ocena progów dla każdej przyjętej serii.
+    HistoryStore history;                       ///< Serie wszystkich sensorów pobranych w sesji (do eksportu zbiorczego).
+    FaultDetector faultDetector;                ///< Oznaczanie podejrzanych odczytów przy przyjmowaniu danych z API.
+    SeriesForecaster forecaster;                ///< Przyrostowe prognozy godzinowe dla każdego sensora (stan zapisywany).
+    QTimer *forecastSaveTimer = nullptr;        ///< Okresowy zapis stanu prognoz.
+    SpatialInterpolator concentrationMap;       ///< Siatka mapy stężeń (zachowywana dla aktualizacji przyrostowych).
+    QString concentrationMapKey;                ///< Parametr pokazywany na mapie (np. "PM10").
+    QPointer<QDialog> concentrationMapDialog;   ///< Okno mapy (nullptr = zamknięte).
+    QPointer<QLabel> concentrationMapImage;
+    QPointer<QLabel> concentrationMapInfo;
+    QHash<int, LatestReading> latestReadings;   ///< ID sensora -> ostatni wiarygodny odczyt (dla mapy stężeń).
+    bool correlationRunning = false;            ///< Macierz korelacji jest liczona w tle.
+    ArchiveImporter archiveImporter;            ///< Import archiwów GIOŚ (zachowuje mapowanie kodów stacji).
+    QAction *liveModeAction = nullptr;          ///< Przełącznik trybu na żywo w menu "Widok".
+    StationCatalog catalog;          ///< Pełny katalog stacji z API i pobranych sensorów (używany do filtrowania).
+    int selectedStationId = -1;                 ///< ID stacji, dla której pobierane są sensory.
+    bool streamingStations = false;             ///< Lista stacji jest wypełniana kolejnymi stronami z API.
+    QString catalogFileName;                    ///< Plik migawki katalogu (pusty = migawka wyłączona).
+    QTimer *catalogSaveTimer = nullptr;         ///< Opóźniony zapis migawki katalogu.
+    QDockWidget *diagnosticsDock = nullptr;     ///< Panel diagnostyczny (domyślnie ukryty).
+    QPlainTextEdit *diagnosticsText = nullptr;  ///< Pole z podsumowaniem metryk.
+    QTimer *diagnosticsTimer = nullptr;         ///< Odświeżanie panelu, gdy jest widoczny.
+    QLabel *networkStatusLabel = nullptr;       ///< Stały wskaźnik błędów sieci na pasku stanu.
+    QMessageBox *networkErrorBox = nullptr;     ///< Niemodalny, zbiorczy komunikat o błędach (tworzony raz).
+    int unacknowledgedErrors = 0;               ///< Błędy od ostatniego zamknięcia komunikatu.
+    QStringList openCircuits;                   ///< Endpointy z otwartym wyłącznikiem.
 };
 #endif // MAINWINDOW_H
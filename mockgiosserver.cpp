@@ -0,0 +1,412 @@
+/**
+ * @file mockgiosserver.cpp
+ * @brief Lokalny serwer HTTP imitujący API GIOŚ PJP (do testów obciążeniowych offline).
+ *
+ * Obsługuje endpointy station/findAll, station/sensors/ID oraz data/getData/ID
+ * pod dowolnym prefiksem ścieżki. Odpowiedzi są odtwarzane z katalogu nagrań
+ * (zapisanych przez GiosApiClient::setRecordDirectory) lub generowane syntetycznie.
+ * Opóźnienie, przepustowość, odsetek błędów i rozmiar odpowiedzi są konfigurowalne,
+ * a generator losowy ma stałe ziarno - przebiegi są powtarzalne.
+ *
+ * Z --page-size (lub gdy żądanie ma parametry page/size) odpowiedzi są stronicowane:
+ * listy jako {"items": [...], "page": p, "totalPages": n}, dane sensora z podzieloną
+ * tablicą "values" i polem totalPages. Nagranie strony ("station/findAll.page2.json")
+ * ma pierwszeństwo przed dzieleniem nagrania całej odpowiedzi.
+ *
+ * Przykład: AirQualityMockServer --port 8080 --latency-ms 40 --bandwidth-kbps 2000 --error-rate 0.02
+ * a następnie: AirQualityMonitoring --api-base-url http://127.0.0.1:8080/pjp-api/rest/
+ */
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QPointer>
+#include <QRandomGenerator>
+#include <QRegularExpression>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTimer>
+#include <QUrlQuery>
+
+#include <cmath>
+#include <memory>
+
+namespace {
+
+/** @brief Parametry pracy serwera. */
+struct MockConfig {
+    QString replayDir;          ///< Katalog nagrań (pusty = tylko synteza).
+    bool synthesize = true;     ///< Czy generować odpowiedzi, których brak w nagraniach.
+    int latencyMs = 0;          ///< Stałe opóźnienie przed odpowiedzią.
+    int jitterMs = 0;           ///< Losowy dodatek do opóźnienia (0..jitterMs).
+    int bandwidthKbps = 0;      ///< Limit przepustowości na połączenie (0 = bez limitu).
+    double errorRate = 0.0;     ///< Odsetek żądań kończonych błędem (0..1).
+    int stations = 270;         ///< Liczba stacji w syntetycznym katalogu.
+    int sensorsPerStation = 5;  ///< Liczba sensorów na stację.
+    int hours = 72;             ///< Liczba godzinnych odczytów w danych sensora.
+    int pageSize = 0;           ///< Domyślny rozmiar strony (0 = bez stronicowania, o ile żądanie nie poda size).
+};
+
+const QStringList Params[] = {
+    {"pył zawieszony PM10", "PM10", "PM10", "3"},
+    {"pył zawieszony PM2.5", "PM2.5", "PM2.5", "69"},
+    {"dwutlenek azotu", "NO2", "NO2", "6"},
+    {"ozon", "O3", "O3", "5"},
+    {"dwutlenek siarki", "SO2", "SO2", "1"},
+    {"benzen", "C6H6", "C6H6", "10"},
+    {"tlenek węgla", "CO", "CO", "8"},
+};
+const int ParamCount = int(sizeof(Params) / sizeof(Params[0]));
+
+/** @brief Wycina stronę z odpowiedzi: tablicę rekordów albo tablicę "values" obiektu danych. */
+QByteArray pageOf(const QByteArray& body, int page, int size)
+{
+    const QJsonDocument doc = QJsonDocument::fromJson(body);
+    const bool isList = doc.isArray();
+    QJsonObject object = isList ? QJsonObject() : doc.object();
+    const QJsonArray all = isList ? doc.array() : object.value("values").toArray();
+    if (!isList && !object.contains("values")) return body; // Nie wiadomo, co dzielić
+
+    const int totalPages = qMax(1, int((all.size() + size - 1) / size));
+    QJsonArray items;
+    for (qsizetype i = qsizetype(page) * size; i < qMin(all.size(), qsizetype(page + 1) * size); ++i) items.append(all.at(i));
+    object.insert(isList ? "items" : "values", items);
+    object.insert("page", page);
+    object.insert("totalPages", totalPages);
+    return QJsonDocument(object).toJson(QJsonDocument::Compact);
+}
+
+QByteArray synthStations(const MockConfig& cfg)
+{
+    QJsonArray arr;
+    for (int i = 0; i < cfg.stations; ++i) {
+        const QString city = QString("Miasto %1").arg(i / 3);
+        arr.append(QJsonObject{{"id", 100 + i},
+                               {"stationName", QString("%1 - ul. Pomiarowa %2").arg(city).arg(i)},
+                               {"gegrLat", QString::number(49.2 + (i * 37 % 100) * 0.05, 'f', 6)},
+                               {"gegrLon", QString::number(14.3 + (i * 53 % 100) * 0.09, 'f', 6)},
+                               {"city", QJsonObject{{"id", 1000 + i / 3}, {"name", city}}},
+                               {"addressStreet", QString("ul. Pomiarowa %1").arg(i)}});
+    }
+    return QJsonDocument(arr).toJson(QJsonDocument::Compact);
+}
+
+QByteArray synthSensors(const MockConfig& cfg, int stationId)
+{
+    QJsonArray arr;
+    for (int s = 0; s < cfg.sensorsPerStation; ++s) {
+        const QStringList& p = Params[s % ParamCount];
+        arr.append(QJsonObject{{"id", stationId * 100 + s},
+                               {"stationId", stationId},
+                               {"param", QJsonObject{{"paramName", p.at(0)}, {"paramFormula", p.at(1)},
+                                                     {"paramCode", p.at(2)}, {"idParam", p.at(3).toInt()}}}});
+    }
+    return QJsonDocument(arr).toJson(QJsonDocument::Compact);
+}
+
+QByteArray synthData(const MockConfig& cfg, int sensorId)
+{
+    // Ziarno zależne od sensora - te same dane przy każdym uruchomieniu
+    QRandomGenerator rng(quint32(sensorId));
+    const QStringList& p = Params[(sensorId % 100) % ParamCount];
+    QDateTime t = QDateTime::currentDateTime();
+    t.setTime(QTime(t.time().hour(), 0));
+    QJsonArray values;
+    for (int i = 0; i < cfg.hours; ++i) {
+        QJsonObject v;
+        v["date"] = t.addSecs(-3600LL * i).toString("yyyy-MM-dd HH:mm:ss");
+        if (i == 0 || rng.bounded(100) < 3) v["value"] = QJsonValue::Null; // Ostatnia godzina często jeszcze pusta
+        else v["value"] = std::round((20.0 + 15.0 * std::sin(i / 3.82) + rng.generateDouble() * 8.0) * 10000.0) / 10000.0;
+        values.append(v);
+    }
+    return QJsonDocument(QJsonObject{{"key", p.at(2)}, {"values", values}}).toJson(QJsonDocument::Compact);
+}
+
+/**
+ * @brief Serwer HTTP/1.1 z obsługą keep-alive i potokowania żądań.
+ *
+ * Wszystkie kompletne żądania z bufora połączenia są parsowane od razu, a odpowiedzi
+ * czekają w kolejce połączenia i są wysyłane pojedynczo, w kolejności żądań: opóźnienie
+ * (z rozrzutem) kolejnej odpowiedzi liczy się dopiero po wysłaniu poprzedniej, więc
+ * rozrzut nie może zamienić kolejności odpowiedzi na tym samym połączeniu.
+ */
+class MockServer
+{
+public:
+    explicit MockServer(const MockConfig& config) : cfg(config), rng(20250504) {}
+
+    bool listen(quint16 port)
+    {
+        QObject::connect(&server, &QTcpServer::newConnection, &server, [this]() {
+            while (QTcpSocket *socket = server.nextPendingConnection()) {
+                QObject::connect(socket, &QTcpSocket::readyRead, socket, [this, socket]() { onReadyRead(socket); });
+                QObject::connect(socket, &QTcpSocket::disconnected, socket, [this, socket]() {
+                    connections.remove(socket);
+                    socket->deleteLater();
+                });
+            }
+        });
+        return server.listen(QHostAddress::Any, port);
+    }
+
+    QString errorString() const { return server.errorString(); }
+    quint16 port() const { return server.serverPort(); }
+
+    quint64 requests = 0;
+    quint64 errors = 0;
+    quint64 bytesSent = 0;
+
+private:
+    /** @brief Odpowiedź czekająca w kolejce połączenia. */
+    struct Reply {
+        int status = 200;
+        QByteArray reason;
+        QByteArray body;
+        bool keepAlive = true;
+        bool drop = false;      ///< Zerwanie połączenia zamiast odpowiedzi (symulowany błąd).
+    };
+
+    /** @brief Stan połączenia: nieprzetworzone bajty i odpowiedzi w kolejności żądań. */
+    struct Connection {
+        QByteArray buffer;
+        QList<Reply> replies;
+        bool busy = false;      ///< Odpowiedź w toku (opóźnienie lub dławiona wysyłka).
+    };
+
+    void onReadyRead(QTcpSocket *socket)
+    {
+        Connection& connection = connections[socket];
+        connection.buffer.append(socket->readAll());
+        // Klient może wysłać kilka żądań naraz (potokowanie) - przetwarzamy wszystkie kompletne
+        for (;;) {
+            const qsizetype headerEnd = connection.buffer.indexOf("\r\n\r\n");
+            if (headerEnd < 0) break; // Nagłówki jeszcze niekompletne
+
+            const QByteArray head = connection.buffer.left(headerEnd);
+            const QByteArray lowerHead = head.toLower();
+            qsizetype bodyLength = 0;
+            const qsizetype lengthAt = lowerHead.indexOf("content-length:");
+            if (lengthAt >= 0) {
+                const qsizetype valueAt = lengthAt + 15; // Za "content-length:"
+                const qsizetype lineEnd = lowerHead.indexOf('\n', valueAt);
+                bodyLength = qMax<qsizetype>(0, lowerHead.mid(valueAt, lineEnd < 0 ? -1 : lineEnd - valueAt).trimmed().toLongLong());
+            }
+            if (connection.buffer.size() < headerEnd + 4 + bodyLength) break; // Treść jeszcze niekompletna
+            connection.buffer.remove(0, headerEnd + 4 + bodyLength);
+
+            connection.replies.append(handleRequest(head, !lowerHead.contains("connection: close")));
+        }
+        sendNext(socket);
+    }
+
+    /** @brief Przygotowuje odpowiedź na jedno żądanie (treść liczona od razu, wysyłka w kolejce). */
+    Reply handleRequest(const QByteArray& head, bool keepAlive)
+    {
+        const QList<QByteArray> lines = head.split('\n');
+        const QList<QByteArray> requestLine = lines.value(0).trimmed().split(' ');
+        ++requests;
+
+        Reply reply;
+        reply.keepAlive = keepAlive;
+        if (requestLine.size() < 2 || requestLine.at(0) != "GET") {
+            reply.status = 405;
+            reply.reason = "Method Not Allowed";
+            reply.body = "{\"error\":\"Tylko GET\"}";
+            return reply;
+        }
+        const QString target = QString::fromUtf8(requestLine.at(1));
+        const QString path = target.section('?', 0, 0);
+        const QUrlQuery query(target.section('?', 1));
+
+        // Wstrzykiwanie błędów: połowa jako 503, połowa jako zerwane połączenie
+        if (cfg.errorRate > 0.0 && rng.generateDouble() < cfg.errorRate) {
+            ++errors;
+            if (rng.bounded(2) == 0) {
+                reply.status = 503;
+                reply.reason = "Service Unavailable";
+                reply.body = "{\"error\":\"Symulowany błąd\"}";
+            } else {
+                reply.drop = true;
+            }
+            return reply;
+        }
+
+        reply.body = route(path, query, &reply.status);
+        reply.reason = reply.status == 200 ? "OK" : "Not Found";
+        return reply;
+    }
+
+    /** @brief Wysyła następną odpowiedź z kolejki połączenia, jeśli poprzednia została już wysłana. */
+    void sendNext(QTcpSocket *socket)
+    {
+        const auto it = connections.find(socket);
+        if (it == connections.end() || it->busy || it->replies.isEmpty()) return;
+        it->busy = true;
+        const Reply reply = it->replies.takeFirst();
+        delayed(socket, [this, socket, reply]() {
+            if (reply.drop) {
+                socket->abort(); // disconnected() usuwa stan połączenia
+                return;
+            }
+            respond(socket, reply.status, reply.reason, reply.body, reply.keepAlive);
+        });
+    }
+
+    /** @brief Kończy wysyłkę odpowiedzi: zamyka połączenie albo przechodzi do następnej w kolejce. */
+    void responseSent(QTcpSocket *socket, bool keepAlive)
+    {
+        if (!keepAlive) {
+            connections.remove(socket); // Żądania po "Connection: close" nie dostają odpowiedzi
+            socket->disconnectFromHost();
+            return;
+        }
+        const auto it = connections.find(socket);
+        if (it == connections.end()) return;
+        it->busy = false;
+        sendNext(socket);
+    }
+
+    /**
+     * @brief Zwraca treść odpowiedzi dla ścieżki: najpierw z nagrań, potem synteza.
+     *
+     * Przy stronicowaniu (--page-size albo parametry page/size żądania) zwracana jest
+     * strona - z nagrania strony, jeśli istnieje, w przeciwnym razie wycięta z całości.
+     */
+    QByteArray route(const QString& path, const QUrlQuery& query, int *status)
+    {
+        static const QRegularExpression re("(station/findAll|station/sensors/(\\d+)|data/getData/(\\d+))/?$");
+        const QRegularExpressionMatch m = re.match(path);
+        if (!m.hasMatch()) { *status = 404; return "{\"error\":\"Nieznany endpoint\"}"; }
+
+        const int size = query.hasQueryItem("size") ? query.queryItemValue("size").toInt() : cfg.pageSize;
+        const int page = qMax(0, query.queryItemValue("page").toInt());
+        const bool paged = size > 0 && (cfg.pageSize > 0 || query.hasQueryItem("page"));
+
+        QByteArray body;
+        if (!cfg.replayDir.isEmpty()) {
+            const QString relative = m.captured(1);
+            if (paged) {
+                QFile recordedPage(QDir(cfg.replayDir).filePath(QString("%1.page%2.json").arg(relative).arg(page)));
+                if (recordedPage.open(QIODevice::ReadOnly)) return recordedPage.readAll();
+            }
+            QFile recorded(QDir(cfg.replayDir).filePath(relative + ".json"));
+            if (recorded.open(QIODevice::ReadOnly)) body = recorded.readAll();
+        }
+        if (body.isEmpty()) {
+            if (!cfg.synthesize) { *status = 404; return "{\"error\":\"Brak nagrania\"}"; }
+            if (!m.captured(2).isEmpty()) {
+                body = synthSensors(cfg, m.captured(2).toInt());
+            } else if (!m.captured(3).isEmpty()) {
+                body = synthData(cfg, m.captured(3).toInt());
+            } else {
+                if (stationsCache.isEmpty()) stationsCache = synthStations(cfg);
+                body = stationsCache;
+            }
+        }
+        return paged ? pageOf(body, page, size) : body;
+    }
+
+    template <typename F>
+    void delayed(QTcpSocket *socket, F action)
+    {
+        const int delay = cfg.latencyMs + (cfg.jitterMs > 0 ? int(rng.bounded(cfg.jitterMs + 1)) : 0);
+        QPointer<QTcpSocket> guard(socket);
+        QTimer::singleShot(delay, socket, [guard, action]() { if (guard) action(); });
+    }
+
+    void respond(QTcpSocket *socket, int status, const QByteArray& reason, const QByteArray& body, bool keepAlive)
+    {
+        QByteArray response = "HTTP/1.1 " + QByteArray::number(status) + ' ' + reason + "\r\n"
+                              "Content-Type: application/json;charset=UTF-8\r\n"
+                              "Content-Length: " + QByteArray::number(body.size()) + "\r\n"
+                              "Connection: " + (keepAlive ? "keep-alive" : "close") + "\r\n\r\n" + body;
+        bytesSent += quint64(response.size());
+
+        if (cfg.bandwidthKbps <= 0) {
+            socket->write(response);
+            responseSent(socket, keepAlive);
+            return;
+        }
+        // Dławienie: porcje wysyłane co 10 ms zgodnie z limitem przepustowości
+        const qsizetype chunk = qMax<qsizetype>(1, qsizetype(cfg.bandwidthKbps) * 1000 / 8 / 100);
+        QTimer *timer = new QTimer(socket);
+        auto offset = std::make_shared<qsizetype>(0);
+        QObject::connect(timer, &QTimer::timeout, socket, [this, socket, timer, response, chunk, offset, keepAlive]() {
+            socket->write(response.constData() + *offset, qMin(chunk, response.size() - *offset));
+            *offset += chunk;
+            if (*offset >= response.size()) {
+                timer->stop();
+                timer->deleteLater();
+                responseSent(socket, keepAlive);
+            }
+        });
+        timer->start(10);
+    }
+
+    MockConfig cfg;
+    QRandomGenerator rng;
+    QTcpServer server;
+    QHash<QTcpSocket*, Connection> connections;
+    QByteArray stationsCache;
+};
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("AirQualityMockServer");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Lokalny serwer imitujący API GIOŚ (nagrania lub dane syntetyczne).");
+    parser.addHelpOption();
+    QCommandLineOption portOpt("port", "Port nasłuchu.", "port", "8080");
+    QCommandLineOption replayOpt("replay-dir", "Katalog nagrań odpowiedzi (z --record-dir aplikacji).", "katalog");
+    QCommandLineOption noSynthOpt("no-synth", "Nie generuj odpowiedzi spoza nagrań (zwracaj 404).");
+    QCommandLineOption latencyOpt("latency-ms", "Opóźnienie odpowiedzi w ms.", "ms", "0");
+    QCommandLineOption jitterOpt("jitter-ms", "Losowy dodatek do opóźnienia w ms.", "ms", "0");
+    QCommandLineOption bandwidthOpt("bandwidth-kbps", "Limit przepustowości na połączenie w kbit/s (0 = brak).", "kbps", "0");
+    QCommandLineOption errorOpt("error-rate", "Odsetek żądań kończonych błędem (0..1).", "p", "0");
+    QCommandLineOption stationsOpt("stations", "Liczba syntetycznych stacji.", "n", "270");
+    QCommandLineOption sensorsOpt("sensors-per-station", "Liczba sensorów na stację.", "n", "5");
+    QCommandLineOption pageSizeOpt("page-size", "Stronicowanie odpowiedzi (rekordów na stronę, 0 = bez stron).", "n", "0");
+    QCommandLineOption hoursOpt("hours", "Liczba godzin danych w odpowiedzi getData (rozmiar odpowiedzi).", "n", "72");
+    parser.addOptions({portOpt, replayOpt, noSynthOpt, latencyOpt, jitterOpt, bandwidthOpt, errorOpt,
+                       stationsOpt, sensorsOpt, hoursOpt, pageSizeOpt});
+    parser.process(app);
+
+    MockConfig cfg;
+    cfg.replayDir = parser.value(replayOpt);
+    cfg.synthesize = !parser.isSet(noSynthOpt);
+    cfg.latencyMs = parser.value(latencyOpt).toInt();
+    cfg.jitterMs = parser.value(jitterOpt).toInt();
+    cfg.bandwidthKbps = parser.value(bandwidthOpt).toInt();
+    cfg.errorRate = qBound(0.0, parser.value(errorOpt).toDouble(), 1.0);
+    cfg.stations = parser.value(stationsOpt).toInt();
+    cfg.sensorsPerStation = parser.value(sensorsOpt).toInt();
+    cfg.hours = parser.value(hoursOpt).toInt();
+    cfg.pageSize = qMax(0, parser.value(pageSizeOpt).toInt());
+
+    MockServer server(cfg);
+    if (!server.listen(quint16(parser.value(portOpt).toUInt()))) {
+        qCritical() << "Nie można uruchomić serwera:" << server.errorString();
+        return 1;
+    }
+    qInfo().noquote() << QString("Serwer testowy GIOŚ nasłuchuje: http://127.0.0.1:%1/pjp-api/rest/").arg(server.port());
+
+    // Okresowe podsumowanie ruchu
+    QTimer statsTimer;
+    QObject::connect(&statsTimer, &QTimer::timeout, &app, [&server]() {
+        qInfo() << "Żądania:" << server.requests << "błędy:" << server.errors << "wysłane bajty:" << server.bytesSent;
+    });
+    statsTimer.start(10000);
+
+    return app.exec();
+}
@@ -0,0 +1,305 @@
+#include "reportrenderer.h"
+#include "tracing.h"
+
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QFileInfo>
+#include <QPageSize>
+#include <QPainter>
+#include <QPdfWriter>
+#include <QPicture>
+#include <QPolygonF>
+#include <QRegularExpression>
+#include <QSaveFile>
+#include <QtConcurrent/QtConcurrentMap>
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+/** @brief "Ładny" krok osi (1, 2 lub 5 razy potęga 10) nie mniejszy niż podany. */
+double niceStep(double rawStep)
+{
+    if (rawStep <= 0.0) return 1.0;
+    const double magnitude = std::pow(10.0, std::floor(std::log10(rawStep)));
+    const double fraction = rawStep / magnitude;
+    return (fraction <= 1.0 ? 1.0 : fraction <= 2.0 ? 2.0 : fraction <= 5.0 ? 5.0 : 10.0) * magnitude;
+}
+
+/** @brief Format etykiet osi czasu dobrany do długości zakresu. */
+QString timeLabelFormat(qint64 spanMs)
+{
+    constexpr qint64 day = 24LL * 3600 * 1000;
+    if (spanMs <= 2 * day) return "MM-dd HH:mm";
+    if (spanMs <= 120 * day) return "yyyy-MM-dd";
+    return "yyyy-MM";
+}
+
+/**
+ * @brief Decymacja do kolumn pikseli: dla każdej kolumny pierwszy, min, max i ostatni punkt
+ * w kolejności czasu. Wartości null przerywają linię.
+ */
+class ColumnDecimator
+{
+public:
+    explicit ColumnDecimator(QPainter& painter) : painter(painter) {}
+
+    void add(int column, double x, double y)
+    {
+        if (column != currentColumn) flushColumn();
+        if (count == 0) { first = last = minPoint = maxPoint = QPointF(x, y); minOrder = maxOrder = 0; }
+        else {
+            if (y < minPoint.y()) { minPoint = QPointF(x, y); minOrder = count; }
+            if (y > maxPoint.y()) { maxPoint = QPointF(x, y); maxOrder = count; }
+            last = QPointF(x, y);
+        }
+        currentColumn = column;
+        ++count;
+    }
+
+    /** @brief Przerwa w danych - kończy bieżącą linię. */
+    void gap()
+    {
+        flushColumn();
+        flushLine();
+    }
+
+    void finish() { gap(); }
+
+private:
+    void flushColumn()
+    {
+        if (count == 0) return;
+        line.append(first);
+        if (count > 2) {
+            // Oś Y ekranu jest odwrócona, ale kolejność punktów zależy tylko od czasu
+            if (minOrder <= maxOrder) { line.append(minPoint); line.append(maxPoint); }
+            else { line.append(maxPoint); line.append(minPoint); }
+        }
+        if (count > 1) line.append(last);
+        count = 0;
+        currentColumn = -1;
+    }
+
+    void flushLine()
+    {
+        if (line.size() == 1) painter.drawPoint(line.first());
+        else if (line.size() > 1) painter.drawPolyline(line);
+        line.clear();
+    }
+
+    QPainter& painter;
+    QPolygonF line;
+    QPointF first, last, minPoint, maxPoint;
+    int minOrder = 0, maxOrder = 0;
+    int count = 0;
+    int currentColumn = -1;
+};
+
+} // namespace
+
+void ReportRenderer::paintChart(QPainter& painter, const QRect& rect, const MeasurementData& data, const Options& options)
+{
+    painter.save();
+    painter.setRenderHint(QPainter::Antialiasing);
+    painter.fillRect(rect, Qt::white);
+
+    // Odczyty z zakresu (seria jest posortowana po dacie)
+    const QList<Measurement>& values = data.values;
+    const auto begin = std::lower_bound(values.cbegin(), values.cend(), options.from,
+                                        [](const Measurement& m, qint64 t) { return m.date.toMSecsSinceEpoch() < t; });
+    const auto end = std::upper_bound(begin, values.cend(), options.to,
+                                      [](qint64 t, const Measurement& m) { return t < m.date.toMSecsSinceEpoch(); });
+    int count = 0;
+    double minY = 0.0, maxY = 0.0, sum = 0.0;
+    qint64 minX = 0, maxX = 0;
+    for (auto it = begin; it != end; ++it) {
+        if (!it->date.isValid() || !it->isUsable()) continue;
+        const double y = it->value.toDouble();
+        const qint64 x = it->date.toMSecsSinceEpoch();
+        if (count == 0) { minY = maxY = y; minX = x; }
+        minY = qMin(minY, y);
+        maxY = qMax(maxY, y);
+        maxX = x;
+        sum += y;
+        ++count;
+    }
+
+    QFont font = painter.font();
+    font.setPixelSize(qMax(10, rect.height() / 36));
+    painter.setFont(font);
+    const int lineHeight = painter.fontMetrics().height();
+
+    // Tytuł
+    QFont titleFont = font;
+    titleFont.setBold(true);
+    titleFont.setPixelSize(font.pixelSize() + 4);
+    painter.setFont(titleFont);
+    painter.setPen(Qt::black);
+    const QString title = options.titles.value(data.sensorId, QString("%1 [sensor %2]").arg(data.key).arg(data.sensorId));
+    painter.drawText(QRect(rect.left() + 10, rect.top() + 5, rect.width() - 20, lineHeight * 2),
+                     Qt::AlignLeft | Qt::AlignVCenter, title);
+    painter.setFont(font);
+
+    const QRect plot = rect.adjusted(painter.fontMetrics().horizontalAdvance("00000.0") + 20, lineHeight * 2 + 15,
+                                     -20, -(lineHeight * 3 + 10));
+    if (count == 0) {
+        painter.setPen(Qt::darkGray);
+        painter.drawRect(plot);
+        painter.drawText(plot, Qt::AlignCenter, "Brak danych w wybranym zakresie");
+        painter.restore();
+        return;
+    }
+
+    // Osie: zaokrąglony zakres Y, oś X od pierwszego do ostatniego odczytu
+    if (maxY - minY < 1e-9) { minY -= 1.0; maxY += 1.0; }
+    const double step = niceStep((maxY - minY) / 5.0);
+    const double yLow = std::floor(minY / step) * step;
+    const double yHigh = std::ceil(maxY / step) * step;
+    if (maxX == minX) { minX -= 1800 * 1000; maxX += 1800 * 1000; }
+    const double xScale = double(plot.width()) / double(maxX - minX);
+    const double yScale = double(plot.height()) / (yHigh - yLow);
+    auto mapX = [&](qint64 t) { return plot.left() + (t - minX) * xScale; };
+    auto mapY = [&](double v) { return plot.bottom() - (v - yLow) * yScale; };
+
+    const QPen gridPen(QColor(225, 225, 225), 1);
+    const QPen axisPen(Qt::darkGray, 1);
+    for (double y = yLow; y <= yHigh + step / 2; y += step) {
+        const double py = mapY(y);
+        painter.setPen(gridPen);
+        painter.drawLine(QPointF(plot.left(), py), QPointF(plot.right(), py));
+        painter.setPen(axisPen);
+        painter.drawText(QRectF(rect.left(), py - lineHeight / 2.0, plot.left() - rect.left() - 6, lineHeight),
+                         Qt::AlignRight | Qt::AlignVCenter, QString::number(y, 'g', 6));
+    }
+    const QString format = timeLabelFormat(maxX - minX);
+    constexpr int xTicks = 6;
+    for (int i = 0; i <= xTicks; ++i) {
+        const qint64 t = minX + (maxX - minX) * i / xTicks;
+        const double px = mapX(t);
+        painter.setPen(gridPen);
+        painter.drawLine(QPointF(px, plot.top()), QPointF(px, plot.bottom()));
+        painter.setPen(axisPen);
+        const QString label = QDateTime::fromMSecsSinceEpoch(t).toString(format);
+        const int width = painter.fontMetrics().horizontalAdvance(label);
+        painter.drawText(QRectF(px - width / 2.0 - 2, plot.bottom() + 4, width + 4, lineHeight), Qt::AlignCenter, label);
+    }
+    painter.setPen(axisPen);
+    painter.drawRect(plot);
+
+    // Przebieg (decymowany do kolumn pikseli)
+    painter.setClipRect(plot.adjusted(-1, -1, 1, 1));
+    painter.setPen(QPen(QColor(31, 119, 180), 1.5));
+    ColumnDecimator decimator(painter);
+    for (auto it = begin; it != end; ++it) {
+        if (!it->date.isValid() || !it->isUsable()) {
+            decimator.gap();
+            continue;
+        }
+        const double px = mapX(it->date.toMSecsSinceEpoch());
+        decimator.add(int(px), px, mapY(it->value.toDouble()));
+    }
+    decimator.finish();
+    painter.setClipping(false);
+
+    // Stopka z podsumowaniem
+    painter.setPen(Qt::black);
+    painter.drawText(QRect(plot.left(), plot.bottom() + lineHeight + 8, plot.width(), lineHeight + 4), Qt::AlignRight | Qt::AlignVCenter,
+                     QString("min %1   średnia %2   max %3   (%4 pomiarów)")
+                         .arg(minY, 0, 'f', 1).arg(sum / count, 0, 'f', 1).arg(maxY, 0, 'f', 1).arg(count));
+    painter.restore();
+}
+
+QImage ReportRenderer::renderImage(const MeasurementData& data, const Options& options)
+{
+    QImage image(options.chartSize, QImage::Format_ARGB32_Premultiplied);
+    QPainter painter(&image);
+    paintChart(painter, image.rect(), data, options);
+    painter.end();
+    return image;
+}
+
+ReportRenderer::Result ReportRenderer::renderPngs(const QList<MeasurementDataPtr>& series, const QString& directory, const Options& options)
+{
+    AQM_TRACE_SCOPE("ReportRenderer::renderPngs", "report");
+    QList<MeasurementDataPtr> used;
+    for (const MeasurementDataPtr& data : series) {
+        if (data) used.append(data);
+    }
+    QDir dir(directory);
+    dir.mkpath(".");
+
+    // Każde zadanie ma własny obraz i QPainter - rysowanie i kompresja PNG równolegle
+    const QStringList saved = QtConcurrent::blockingMapped<QStringList>(used, [&dir, &options](const MeasurementDataPtr& data) {
+        AQM_TRACE_SCOPE("ReportRenderer::chart", "report");
+        QString key = data->key;
+        key.replace(QRegularExpression("[^A-Za-z0-9.]"), "_");
+        const QString fileName = dir.filePath(QString("sensor_%1_%2.png").arg(data->sensorId).arg(key));
+        return renderImage(*data, options).save(fileName, "PNG") ? fileName : QString();
+    });
+
+    Result result;
+    result.charts = int(used.size());
+    for (const QString& fileName : saved) {
+        if (fileName.isEmpty()) ++result.failed;
+        else result.files.append(fileName);
+    }
+    qDebug() << "ReportRenderer: Zapisano" << result.files.size() << "wykresów PNG w" << dir.absolutePath();
+    return result;
+}
+
+bool ReportRenderer::renderPdf(const QList<MeasurementDataPtr>& series, const QString& fileName, const Options& options,
+                               Result* result, QString* errorString)
+{
+    AQM_TRACE_SCOPE("ReportRenderer::renderPdf", "report");
+    QList<MeasurementDataPtr> used;
+    for (const MeasurementDataPtr& data : series) {
+        if (data) used.append(data);
+    }
+
+    // Nagrywanie wykresów (wektorowo) równolegle; QPdfWriter obsługuje tylko jeden wątek
+    const QRect chartRect(QPoint(0, 0), options.chartSize);
+    const QList<QPicture> pictures = QtConcurrent::blockingMapped<QList<QPicture>>(used, [&chartRect, &options](const MeasurementDataPtr& data) {
+        AQM_TRACE_SCOPE("ReportRenderer::chart", "report");
+        QPicture picture;
+        QPainter painter(&picture);
+        paintChart(painter, chartRect, *data, options);
+        painter.end();
+        return picture;
+    });
+
+    QDir().mkpath(QFileInfo(fileName).absolutePath());
+    QSaveFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly)) {
+        if (errorString) *errorString = file.errorString();
+        return false;
+    }
+    {
+        // Strona o rozmiarze wykresu: 96 dpi, bez marginesów
+        QPdfWriter writer(&file);
+        writer.setResolution(96);
+        writer.setPageSize(QPageSize(QSizeF(options.chartSize) * 72.0 / 96.0, QPageSize::Point));
+        writer.setPageMargins(QMarginsF(0, 0, 0, 0));
+        writer.setTitle("Raport jakości powietrza");
+        QPainter painter(&writer);
+        for (int i = 0; i < pictures.size(); ++i) {
+            if (i > 0) writer.newPage();
+            painter.drawPicture(0, 0, pictures.at(i));
+        }
+        painter.end();
+    }
+    if (!file.commit()) {
+        if (errorString) *errorString = file.errorString();
+        return false;
+    }
+    if (result) {
+        result->charts = int(pictures.size());
+        result->failed = 0;
+        result->files = QStringList{fileName};
+    }
+    if (errorString) errorString->clear();
+    qDebug() << "ReportRenderer: Zapisano" << pictures.size() << "stron PDF do" << fileName;
+    return true;
+}
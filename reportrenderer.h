@@ -0,0 +1,84 @@
+#ifndef REPORTRENDERER_H
+#define REPORTRENDERER_H
+
+#include <QHash>
+#include <QImage>
+#include <QList>
+#include <QRect>
+#include <QSize>
+#include <QString>
+#include <QStringList>
+#include <limits>
+#include "giosapiclient.h" // MeasurementData, MeasurementDataPtr
+
+class QPainter;
+
+/**
+ * @file reportrenderer.h
+ * @brief Definicja klasy ReportRenderer - renderowania raportów z wykresami wielu sensorów poza GUI.
+ */
+
+/**
+ * @class ReportRenderer
+ * @brief Rysuje wykresy serii o stałym układzie prostym QPainterem do obrazów PNG lub stron PDF.
+ *
+ * W przeciwieństwie do interaktywnego QChartView (wątek GUI, jeden wykres naraz) rysowanie
+ * korzysta tylko z QPainter na QImage/QPicture, więc wykresy wielu sensorów są renderowane
+ * równolegle w puli wątków (QtConcurrent). Dla PDF wykresy są nagrywane równolegle do
+ * QPicture (grafika wektorowa), a strony są składane w kolejności w jednym wątku.
+ *
+ * Gęste serie są decymowane do szerokości wykresu: w każdej kolumnie pikseli rysowany jest
+ * pierwszy, najmniejszy, największy i ostatni odczyt, więc kształt przebiegu jest zachowany.
+ */
+class ReportRenderer
+{
+public:
+    /** @brief Układ i zakres wykresów. */
+    struct Options {
+        QSize chartSize{1200, 500};                             ///< Rozmiar wykresu (px; w PDF - jedna strona).
+        qint64 from = std::numeric_limits<qint64>::min();       ///< Początek zakresu (ms od epoki, włącznie).
+        qint64 to = std::numeric_limits<qint64>::max();         ///< Koniec zakresu (ms od epoki, włącznie).
+        QHash<int, QString> titles;                             ///< ID sensora -> tytuł (domyślnie klucz i ID).
+    };
+
+    /** @brief Podsumowanie renderowania. */
+    struct Result {
+        int charts = 0;             ///< Wyrenderowane wykresy.
+        int failed = 0;             ///< Wykresy, których nie udało się zapisać.
+        QStringList files;          ///< Zapisane pliki.
+    };
+
+    /**
+     * @brief Rysuje wykres serii w prostokącie (bezpieczne w dowolnym wątku dla własnego urządzenia rysowania).
+     * @param painter Aktywny QPainter.
+     * @param rect Obszar wykresu.
+     * @param data Seria posortowana rosnąco po dacie.
+     * @param options Zakres i tytuły.
+     */
+    static void paintChart(QPainter& painter, const QRect& rect, const MeasurementData& data, const Options& options);
+
+    /** @brief Renderuje wykres serii do obrazu o rozmiarze Options::chartSize. */
+    static QImage renderImage(const MeasurementData& data, const Options& options);
+
+    /**
+     * @brief Renderuje równolegle wykresy do plików PNG (`sensor_<ID>_<klucz>.png`) w katalogu.
+     * @param series Serie (puste wskaźniki są pomijane).
+     * @param directory Katalog docelowy (tworzony w razie potrzeby).
+     * @param options Układ i zakres.
+     */
+    static Result renderPngs(const QList<MeasurementDataPtr>& series, const QString& directory, const Options& options);
+
+    /**
+     * @brief Renderuje wykresy do pliku PDF, po jednym na stronę (zapis atomowy przez QSaveFile).
+     * @param series Serie (puste wskaźniki są pomijane).
+     * @param fileName Plik docelowy.
+     * @param options Układ i zakres.
+     * @param result Opcjonalne podsumowanie.
+     * @param errorString Opcjonalny komunikat błędu.
+     * @return true, jeśli zapis się powiódł.
+     */
+    static bool renderPdf(const QList<MeasurementDataPtr>& series, const QString& fileName, const Options& options,
+                          Result* result = nullptr, QString* errorString = nullptr);
+};
+
+#endif // REPORTRENDERER_H
@@ -0,0 +1,197 @@
+#include "requestmetrics.h"
+
+#include <QFile>
+#include <QMutexLocker>
+#include <QTextStream>
+
+namespace {
+
+/** @brief Różnica znaczników w ms lub -1, jeśli któryś nie został ustawiony. */
+double spanMs(qint64 fromNs, qint64 toNs)
+{
+    if (fromNs <= 0 || toNs <= 0 || toNs < fromNs) return -1.0;
+    return double(toNs - fromNs) / 1e6;
+}
+
+} // namespace
+
+const QVector<QString>& RequestMetrics::phaseNames()
+{
+    static const QVector<QString> names = {"queue", "connect", "ttfb", "download", "json", "decode", "ui", "total"};
+    return names;
+}
+
+const QVector<double>& RequestMetrics::bucketBounds()
+{
+    static const QVector<double> bounds = {0.1, 0.25, 0.5, 1, 2.5, 5, 10, 25, 50, 100, 250, 500, 1000, 2500, 5000, 10000};
+    return bounds;
+}
+
+void RequestMetrics::Histogram::add(double ms)
+{
+    const QVector<double>& bounds = bucketBounds();
+    if (buckets.isEmpty()) buckets.resize(bounds.size() + 1);
+    int i = 0;
+    while (i < bounds.size() && ms > bounds.at(i)) ++i;
+    ++buckets[i];
+    ++count;
+    sumMs += ms;
+}
+
+double RequestMetrics::Histogram::quantile(double q) const
+{
+    if (count == 0) return 0.0;
+    const QVector<double>& bounds = bucketBounds();
+    const double target = q * double(count);
+    quint64 cumulative = 0;
+    for (int i = 0; i < buckets.size(); ++i) {
+        const quint64 previous = cumulative;
+        cumulative += buckets.at(i);
+        if (double(cumulative) >= target) {
+            // Interpolacja liniowa wewnątrz przedziału
+            const double lower = i == 0 ? 0.0 : bounds.at(i - 1);
+            const double upper = i < bounds.size() ? bounds.at(i) : bounds.last() * 2;
+            const double inBucket = double(buckets.at(i));
+            return inBucket > 0 ? lower + (upper - lower) * (target - double(previous)) / inBucket : lower;
+        }
+    }
+    return bounds.last();
+}
+
+void RequestMetrics::record(const RequestTiming& t)
+{
+    QMutexLocker locker(&mutex);
+    EndpointStats& s = endpoints[t.endpoint];
+    ++s.requests;
+    if (!t.ok) ++s.errors;
+    s.bytes += quint64(qMax<qint64>(0, t.bytes));
+    s.records += quint64(qMax(0, t.records));
+    if (t.connectStartNs > 0) ++s.newConnections;
+    if (t.http2) ++s.http2;
+    if (t.attempt > 1) ++s.retries;
+
+    // Gdy połączenie pochodzi z puli, faza connect nie występuje, a queue trwa do wysłania żądania
+    const qint64 queueEnd = t.connectStartNs > 0 ? t.connectStartNs : t.requestSentNs;
+    const double spans[] = {
+        spanMs(t.startNs, queueEnd),
+        spanMs(t.connectStartNs, t.requestSentNs),
+        spanMs(t.requestSentNs > 0 ? t.requestSentNs : t.startNs, t.headersNs),
+        spanMs(t.headersNs, t.finishedNs),
+        spanMs(t.finishedNs, t.jsonDoneNs),
+        spanMs(t.jsonDoneNs, t.decodeDoneNs),
+        spanMs(t.decodeDoneNs, t.deliveredNs),
+        spanMs(t.startNs, t.deliveredNs > 0 ? t.deliveredNs : t.finishedNs),
+    };
+    const QVector<QString>& names = phaseNames();
+    for (int i = 0; i < names.size(); ++i) {
+        if (spans[i] >= 0.0) s.phases[names.at(i)].add(spans[i]);
+    }
+}
+
+void RequestMetrics::reset()
+{
+    QMutexLocker locker(&mutex);
+    endpoints.clear();
+}
+
+RequestMetrics::ConnectionTotals RequestMetrics::connectionTotals() const
+{
+    QMutexLocker locker(&mutex);
+    ConnectionTotals totals;
+    for (const EndpointStats& s : endpoints) {
+        totals.requests += s.requests;
+        totals.newConnections += s.newConnections;
+        totals.http2 += s.http2;
+    }
+    return totals;
+}
+
+QString RequestMetrics::summaryText() const
+{
+    QMutexLocker locker(&mutex);
+    QString text;
+    QTextStream out(&text);
+    if (endpoints.isEmpty()) {
+        out << "Brak zarejestrowanych żądań.\n";
+        return text;
+    }
+    for (auto it = endpoints.cbegin(); it != endpoints.cend(); ++it) {
+        const EndpointStats& s = it.value();
+        const double reusePercent = s.requests > 0 ? 100.0 * double(s.requests - qMin(s.requests, s.newConnections)) / double(s.requests) : 0.0;
+        out << QString("== %1: %2 żądań, %3 błędów, %4 kB, %5 rekordów, nowe połączenia: %6 (ponowne użycie %7%), HTTP/2: %8, ponowienia: %9\n")
+                   .arg(it.key()).arg(s.requests).arg(s.errors).arg(s.bytes / 1024.0, 0, 'f', 1)
+                   .arg(s.records).arg(s.newConnections).arg(reusePercent, 0, 'f', 0).arg(s.http2).arg(s.retries);
+        out << QString("   %1 %2 %3 %4 %5\n").arg("faza", -9).arg("liczba", 7).arg("śr. ms", 9).arg("p50 ms", 9).arg("p95 ms", 9);
+        for (const QString& phase : phaseNames()) {
+            const auto h = s.phases.constFind(phase);
+            if (h == s.phases.cend() || h->count == 0) continue;
+            out << QString("   %1 %2 %3 %4 %5\n").arg(phase, -9).arg(h->count, 7)
+                       .arg(h->sumMs / double(h->count), 9, 'f', 2)
+                       .arg(h->quantile(0.50), 9, 'f', 2)
+                       .arg(h->quantile(0.95), 9, 'f', 2);
+        }
+    }
+    return text;
+}
+
+QString RequestMetrics::toPrometheusText() const
+{
+    QMutexLocker locker(&mutex);
+    QString text;
+    QTextStream out(&text);
+    const QVector<double>& bounds = bucketBounds();
+
+    out << "# HELP aqm_requests_total Liczba zakończonych żądań do API.\n# TYPE aqm_requests_total counter\n";
+    for (auto it = endpoints.cbegin(); it != endpoints.cend(); ++it)
+        out << "aqm_requests_total{endpoint=\"" << it.key() << "\"} " << it->requests << "\n";
+    out << "# HELP aqm_request_errors_total Liczba żądań zakończonych błędem.\n# TYPE aqm_request_errors_total counter\n";
+    for (auto it = endpoints.cbegin(); it != endpoints.cend(); ++it)
+        out << "aqm_request_errors_total{endpoint=\"" << it.key() << "\"} " << it->errors << "\n";
+    out << "# HELP aqm_response_bytes_total Łączny rozmiar odpowiedzi.\n# TYPE aqm_response_bytes_total counter\n";
+    for (auto it = endpoints.cbegin(); it != endpoints.cend(); ++it)
+        out << "aqm_response_bytes_total{endpoint=\"" << it.key() << "\"} " << it->bytes << "\n";
+    out << "# HELP aqm_records_total Liczba zdekodowanych rekordów.\n# TYPE aqm_records_total counter\n";
+    for (auto it = endpoints.cbegin(); it != endpoints.cend(); ++it)
+        out << "aqm_records_total{endpoint=\"" << it.key() << "\"} " << it->records << "\n";
+    out << "# HELP aqm_new_connections_total Żądania wymagające nowego połączenia.\n# TYPE aqm_new_connections_total counter\n";
+    for (auto it = endpoints.cbegin(); it != endpoints.cend(); ++it)
+        out << "aqm_new_connections_total{endpoint=\"" << it.key() << "\"} " << it->newConnections << "\n";
+    out << "# HELP aqm_http2_requests_total Żądania obsłużone przez HTTP/2.\n# TYPE aqm_http2_requests_total counter\n";
+    for (auto it = endpoints.cbegin(); it != endpoints.cend(); ++it)
+        out << "aqm_http2_requests_total{endpoint=\"" << it.key() << "\"} " << it->http2 << "\n";
+    out << "# HELP aqm_request_retries_total Ponowienia żądań po błędach przejściowych.\n# TYPE aqm_request_retries_total counter\n";
+    for (auto it = endpoints.cbegin(); it != endpoints.cend(); ++it)
+        out << "aqm_request_retries_total{endpoint=\"" << it.key() << "\"} " << it->retries << "\n";
+
+    out << "# HELP aqm_request_phase_ms Czas fazy żądania w milisekundach.\n# TYPE aqm_request_phase_ms histogram\n";
+    for (auto it = endpoints.cbegin(); it != endpoints.cend(); ++it) {
+        for (const QString& phase : phaseNames()) {
+            const auto h = it->phases.constFind(phase);
+            if (h == it->phases.cend() || h->count == 0) continue;
+            const QString labels = QString("endpoint=\"%1\",phase=\"%2\"").arg(it.key(), phase);
+            quint64 cumulative = 0;
+            for (int i = 0; i < h->buckets.size(); ++i) {
+                cumulative += h->buckets.at(i);
+                const QString le = i < bounds.size() ? QString::number(bounds.at(i)) : QString("+Inf");
+                out << "aqm_request_phase_ms_bucket{" << labels << ",le=\"" << le << "\"} " << cumulative << "\n";
+            }
+            out << "aqm_request_phase_ms_sum{" << labels << "} " << QString::number(h->sumMs, 'f', 3) << "\n";
+            out << "aqm_request_phase_ms_count{" << labels << "} " << h->count << "\n";
+        }
+    }
+    return text;
+}
+
+bool RequestMetrics::writeToFile(const QString& fileName, QString* errorString) const
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        if (errorString) *errorString = file.errorString();
+        return false;
+    }
+    if (file.write(toPrometheusText().toUtf8()) == -1) {
+        if (errorString) *errorString = file.errorString();
+        return false;
+    }
+    return true;
+}
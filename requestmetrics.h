@@ -0,0 +1,116 @@
+#ifndef REQUESTMETRICS_H
+#define REQUESTMETRICS_H
+
+#include <QMap>
+#include <QMutex>
+#include <QString>
+#include <QVector>
+
+/**
+ * @file requestmetrics.h
+ * @brief Definicja struktur pomiaru czasu żądań oraz klasy RequestMetrics.
+ */
+
+/**
+ * @struct RequestTiming
+ * @brief Znaczniki czasu kolejnych faz jednego żądania do API (ns zegara monotonicznego).
+ *
+ * Wartość 0 oznacza, że faza nie wystąpiła (np. brak nawiązywania połączenia,
+ * gdy użyto istniejącego połączenia z puli).
+ */
+struct RequestTiming {
+    QString endpoint;           ///< Nazwa endpointu ("stations", "sensors", "data").
+    qint64 startNs = 0;         ///< Wysłanie żądania (QNetworkAccessManager::get).
+    qint64 connectStartNs = 0;  ///< Rozpoczęcie nawiązywania połączenia (DNS + TCP + TLS).
+    qint64 requestSentNs = 0;   ///< Żądanie wysłane do serwera.
+    qint64 headersNs = 0;       ///< Odebrane nagłówki odpowiedzi (time-to-first-byte).
+    qint64 finishedNs = 0;      ///< Pobrana cała treść odpowiedzi.
+    qint64 jsonDoneNs = 0;      ///< Zakończone QJsonDocument::fromJson.
+    qint64 decodeDoneNs = 0;    ///< Zbudowane struktury wynikowe.
+    qint64 deliveredNs = 0;     ///< Zakończona emisja sygnału z wynikiem (aktualizacja UI).
+    qint64 bytes = 0;           ///< Rozmiar treści odpowiedzi w bajtach.
+    int records = 0;            ///< Liczba zdekodowanych rekordów (stacji, sensorów, odczytów).
+    int attempt = 1;            ///< Numer próby (większy od 1 dla ponowień po błędzie przejściowym).
+    bool ok = false;            ///< Czy żądanie zakończyło się sukcesem.
+    bool http2 = false;         ///< Czy odpowiedź przyszła przez HTTP/2.
+};
+
+/**
+ * @class RequestMetrics
+ * @brief Agreguje czasy faz żądań w histogramy osobno dla każdego endpointu.
+ *
+ * Fazy: queue (oczekiwanie na połączenie), connect (nawiązanie połączenia),
+ * ttfb (od wysłania żądania do nagłówków), download, json, decode, ui oraz total.
+ * Histogramy mają stałe przedziały w milisekundach, więc pamięć nie rośnie
+ * z liczbą żądań. Metody są bezpieczne wątkowo.
+ */
+class RequestMetrics
+{
+public:
+    /** @brief Nazwy faz w kolejności raportowania. */
+    static const QVector<QString>& phaseNames();
+
+    /**
+     * @brief Dodaje zakończone żądanie do statystyk.
+     * @param timing Znaczniki czasu żądania.
+     */
+    void record(const RequestTiming& timing);
+
+    /** @brief Czyści wszystkie statystyki. */
+    void reset();
+
+    /** @brief Liczniki połączeń zsumowane po endpointach. */
+    struct ConnectionTotals {
+        quint64 requests = 0;
+        quint64 newConnections = 0;  ///< Żądania, które musiały nawiązać nowe połączenie.
+        quint64 http2 = 0;           ///< Żądania obsłużone przez HTTP/2 (Http2WasUsedAttribute).
+    };
+    ConnectionTotals connectionTotals() const;
+
+    /**
+     * @brief Zwraca czytelne podsumowanie (liczniki, średnie i percentyle z histogramów).
+     */
+    QString summaryText() const;
+
+    /**
+     * @brief Zwraca metryki w formacie tekstowym Prometheus (do zapisu w pliku metryk).
+     */
+    QString toPrometheusText() const;
+
+    /**
+     * @brief Zapisuje metryki w formacie Prometheus do pliku.
+     * @param fileName Ścieżka pliku docelowego.
+     * @param errorString Opcjonalny wskaźnik na komunikat błędu.
+     * @return true, jeśli zapis się powiódł.
+     */
+    bool writeToFile(const QString& fileName, QString* errorString = nullptr) const;
+
+private:
+    /** @brief Histogram o stałych przedziałach (górne granice w ms). */
+    struct Histogram {
+        QVector<quint64> buckets;   ///< Liczności przedziałów (ostatni = +Inf).
+        quint64 count = 0;
+        double sumMs = 0.0;
+        void add(double ms);
+        double quantile(double q) const;
+    };
+
+    /** @brief Statystyki jednego endpointu. */
+    struct EndpointStats {
+        quint64 requests = 0;
+        quint64 errors = 0;
+        quint64 bytes = 0;
+        quint64 records = 0;
+        quint64 newConnections = 0;  ///< Żądania, które musiały nawiązać nowe połączenie.
+        quint64 http2 = 0;           ///< Żądania obsłużone przez HTTP/2.
+        quint64 retries = 0;         ///< Ponowienia po błędach przejściowych.
+        QMap<QString, Histogram> phases;
+    };
+
+    static const QVector<double>& bucketBounds();
+
+    mutable QMutex mutex;
+    QMap<QString, EndpointStats> endpoints;
+};
+
+#endif // REQUESTMETRICS_H
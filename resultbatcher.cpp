@@ -0,0 +1,124 @@
+#include "resultbatcher.h"
+#include "tracing.h"
+
+#include <utility>
+
+ResultBatcher::ResultBatcher(QObject *parent)
+    : QObject(parent)
+{
+    flushTimer.setSingleShot(true);
+    connect(&flushTimer, &QTimer::timeout, this, &ResultBatcher::flush);
+    sinceFlush.start();
+}
+
+void ResultBatcher::attach(GiosApiClient *client)
+{
+    connect(client, &GiosApiClient::stationsPageFetched, this, &ResultBatcher::addStationsPage);
+    connect(client, &GiosApiClient::stationsFetched, this, &ResultBatcher::addStations);
+    connect(client, &GiosApiClient::sensorsFetched, this, &ResultBatcher::addSensors);
+    connect(client, &GiosApiClient::measurementDataFetched, this, &ResultBatcher::addMeasurementData);
+}
+
+bool ResultBatcher::hasPending() const
+{
+    return stationPagesQueued > 0 || !sensorLists.isEmpty() || !measurements.isEmpty() || statusPending || progressPending;
+}
+
+void ResultBatcher::schedule()
+{
+    if (flushTimer.isActive()) return;
+    // Po przerwie dłuższej niż klatka - w najbliższym obiegu pętli (łączy wyniki z jednego obiegu)
+    flushTimer.start(int(qMax<qint64>(0, intervalMs - sinceFlush.elapsed())));
+}
+
+void ResultBatcher::addStationsPage(const QList<StationInfo>& stations, int page, int pageCount)
+{
+    if (page == 0) stationPagesReceived = 0; // Strona 0 zawsze przychodzi pierwsza (podaje liczbę stron)
+    stationPages.append(stations);
+    ++stationPagesQueued;
+    ++stationPagesReceived;
+    stationPageCount = pageCount;
+    ++counters.results;
+    schedule();
+}
+
+void ResultBatcher::addStations(const QList<StationInfo>& stations)
+{
+    flush();
+    stationPagesReceived = 0;
+    emit stationsReady(stations);
+}
+
+void ResultBatcher::addSensors(int stationId, const QList<SensorInfo>& sensors)
+{
+    ++counters.results;
+    // Listy bez ID stacji (nieczytelny adres) nie są łączone
+    const auto it = stationId >= 0 ? sensorListIndex.constFind(stationId) : sensorListIndex.cend();
+    if (it != sensorListIndex.cend()) {
+        sensorLists[it.value()].sensors = sensors;
+        ++counters.coalesced;
+    } else {
+        if (stationId >= 0) sensorListIndex.insert(stationId, int(sensorLists.size()));
+        sensorLists.append(StationSensors{stationId, sensors});
+    }
+    schedule();
+}
+
+void ResultBatcher::addMeasurementData(const MeasurementDataPtr& data)
+{
+    ++counters.results;
+    measurements.append(data);
+    schedule();
+}
+
+void ResultBatcher::postStatus(const QString& text, int timeoutMs)
+{
+    ++counters.statusPosted;
+    statusPending = true;
+    statusText = text;
+    statusTimeoutMs = timeoutMs;
+    schedule();
+}
+
+void ResultBatcher::postProgress(int value, int maximum)
+{
+    progressPending = true;
+    progressValue = value;
+    progressMaximum = maximum;
+    schedule();
+}
+
+void ResultBatcher::flush()
+{
+    flushTimer.stop();
+    if (!hasPending()) return;
+    AQM_TRACE_SCOPE("ResultBatcher::flush", "ui");
+
+    // Kolejka jest przejmowana przed emisją - odbiorcy mogą od razu dodawać nowe wyniki
+    const QList<StationInfo> pages = std::exchange(stationPages, {});
+    const int pagesQueued = std::exchange(stationPagesQueued, 0);
+    const QList<StationSensors> sensors = std::exchange(sensorLists, {});
+    sensorListIndex.clear();
+    const QList<MeasurementDataPtr> data = std::exchange(measurements, {});
+
+    const int batchSize = pagesQueued + int(sensors.size()) + int(data.size());
+    if (batchSize > 0) {
+        ++counters.batches;
+        counters.largestBatch = qMax(counters.largestBatch, batchSize);
+    }
+    if (pagesQueued > 0) emit stationsPagesReady(pages, stationPagesReceived, stationPageCount);
+    if (!sensors.isEmpty()) emit sensorsReady(sensors);
+    if (!data.isEmpty()) emit measurementDataReady(data);
+
+    // Komunikat i postęp na końcu: obejmują też te wystawione przez odbiorców paczek
+    if (progressPending) {
+        progressPending = false;
+        emit progressReady(progressValue, progressMaximum);
+    }
+    if (statusPending) {
+        statusPending = false;
+        ++counters.statusShown;
+        emit statusReady(statusText, statusTimeoutMs);
+    }
+    sinceFlush.restart();
+}
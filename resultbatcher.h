@@ -0,0 +1,132 @@
+#ifndef RESULTBATCHER_H
+#define RESULTBATCHER_H
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QList>
+#include <QObject>
+#include <QString>
+#include <QTimer>
+#include "giosapiclient.h" // StationInfo, SensorInfo, MeasurementDataPtr
+
+/**
+ * @file resultbatcher.h
+ * @brief Definicja klasy ResultBatcher - etapu dostarczania wyników z klienta API do interfejsu w paczkach.
+ */
+
+/**
+ * @class ResultBatcher
+ * @brief Zbiera wyniki z GiosApiClient i przekazuje je do interfejsu paczkami, najwyżej raz na klatkę.
+ *
+ * Przy zbiorczym pobieraniu każda odpowiedź emituje osobny sygnał, a każdy sygnał przebudowywał
+ * widok. Tutaj wyniki są kolejkowane, a kolejka jest opróżniana jednym sygnałem na rodzaj wyniku,
+ * nie częściej niż co interval() ms (domyślnie 16 ms, czyli jedna klatka przy 60 Hz). Pierwszy wynik
+ * po przerwie jest dostarczany w najbliższym obiegu pętli zdarzeń, więc pojedyncze żądania nie
+ * czekają. Między opróżnieniami pętla zdarzeń obsługuje wejście użytkownika i rysowanie.
+ *
+ * Sensory tej samej stacji z jednej klatki są łączone (zostaje najnowsza lista), strony listy
+ * stacji - sklejane. Dane pomiarowe są przekazywane wszystkie, w kolejności nadejścia.
+ * Komunikaty paska stanu i postęp są dławione tak samo: z jednej klatki pokazywany jest tylko
+ * ostatni, po obsłużeniu paczek danych (komunikaty wystawione przez odbiorców paczki trafiają
+ * do tej samej klatki). Pełna lista stacji jest przekazywana od razu, ale dopiero po opróżnieniu
+ * kolejki, aby odbiorcy widzieli wyniki w kolejności nadejścia.
+ */
+class ResultBatcher : public QObject
+{
+    Q_OBJECT
+
+public:
+    /** @brief Domyślny odstęp między opróżnieniami kolejki (ms). */
+    static constexpr int DefaultIntervalMs = 16;
+
+    /** @brief Lista sensorów stacji (ID z adresu żądania, także dla pustej listy). */
+    struct StationSensors {
+        int stationId = -1;
+        QList<SensorInfo> sensors;
+    };
+
+    /** @brief Liczniki dostarczania (do panelu diagnostycznego i testów obciążeniowych). */
+    struct Stats {
+        quint64 results = 0;        ///< Przyjęte wyniki (strony stacji, listy sensorów, serie).
+        quint64 batches = 0;        ///< Opróżnienia kolejki, które przekazały dane.
+        quint64 coalesced = 0;      ///< Listy sensorów zastąpione nowszą listą tej samej stacji.
+        quint64 statusPosted = 0;   ///< Wystawione komunikaty paska stanu.
+        quint64 statusShown = 0;    ///< Komunikaty faktycznie przekazane do pokazania.
+        int largestBatch = 0;       ///< Najwięcej wyników w jednym opróżnieniu.
+    };
+
+    explicit ResultBatcher(QObject *parent = nullptr);
+
+    /** @brief Podłącza sygnały wyników klienta do kolejki (stationsFetched, stationsPageFetched, sensorsFetched, measurementDataFetched). */
+    void attach(GiosApiClient *client);
+
+    /** @brief Ustawia minimalny odstęp między opróżnieniami (0 = w najbliższym obiegu pętli zdarzeń). */
+    void setInterval(int ms) { intervalMs = qMax(0, ms); }
+    int interval() const { return intervalMs; }
+
+    /** @brief Czy kolejka zawiera wyniki, komunikat lub postęp czekające na opróżnienie. */
+    bool hasPending() const;
+    const Stats& stats() const { return counters; }
+
+public slots:
+    void addStationsPage(const QList<StationInfo>& stations, int page, int pageCount);
+    /** @brief Opróżnia kolejkę i od razu przekazuje pełną listę stacji. */
+    void addStations(const QList<StationInfo>& stations);
+    void addSensors(int stationId, const QList<SensorInfo>& sensors);
+    void addMeasurementData(const MeasurementDataPtr& data);
+
+    /**
+     * @brief Wystawia komunikat paska stanu (z jednej klatki pokazywany jest ostatni).
+     * @param text Treść komunikatu.
+     * @param timeoutMs Czas wyświetlania (0 = do następnego komunikatu).
+     */
+    void postStatus(const QString& text, int timeoutMs = 0);
+
+    /**
+     * @brief Wystawia stan postępu (z jednej klatki przekazywany jest ostatni).
+     * @param value Wykonane kroki.
+     * @param maximum Wszystkie kroki (value >= maximum - koniec, wskaźnik można ukryć).
+     */
+    void postProgress(int value, int maximum);
+
+    /** @brief Przekazuje od razu całą zawartość kolejki. */
+    void flush();
+
+signals:
+    /** @brief Strony listy stacji z jednej klatki (sklejone) i liczba stron odebranych do tej pory. */
+    void stationsPagesReady(const QList<StationInfo>& stations, int pagesReceived, int pageCount);
+    void stationsReady(const QList<StationInfo>& stations);
+    /** @brief Listy sensorów z jednej klatki (po jednej na stację). */
+    void sensorsReady(const QList<ResultBatcher::StationSensors>& batch);
+    /** @brief Serie pomiarowe z jednej klatki, w kolejności nadejścia. */
+    void measurementDataReady(const QList<MeasurementDataPtr>& batch);
+    void statusReady(const QString& text, int timeoutMs);
+    void progressReady(int value, int maximum);
+
+private:
+    /** @brief Planuje opróżnienie kolejki (najwcześniej interval() ms po poprzednim). */
+    void schedule();
+
+    int intervalMs = DefaultIntervalMs;
+    QTimer flushTimer;
+    QElapsedTimer sinceFlush;                   ///< Czas od końca ostatniego opróżnienia.
+
+    QList<StationInfo> stationPages;            ///< Stacje ze stron z bieżącej klatki.
+    int stationPagesQueued = 0;
+    int stationPagesReceived = 0;               ///< Strony odebrane w bieżącym wczytywaniu listy.
+    int stationPageCount = 0;
+    QList<StationSensors> sensorLists;
+    QHash<int, int> sensorListIndex;            ///< ID stacji -> pozycja w sensorLists.
+    QList<MeasurementDataPtr> measurements;
+
+    bool statusPending = false;
+    QString statusText;
+    int statusTimeoutMs = 0;
+    bool progressPending = false;
+    int progressValue = 0;
+    int progressMaximum = 0;
+
+    Stats counters;
+};
+
+#endif // RESULTBATCHER_H
@@ -0,0 +1,410 @@
+#include "seriescodec.h"
+
+#include <QtAlgorithms>  // Dla qCountLeadingZeroBits / qCountTrailingZeroBits
+#include <cstring>       // Dla std::memcpy
+
+namespace {
+
+const char SeriesMagic[4] = {'A', 'Q', 'S', '1'};
+const qint64 ExpectedStepSecs = 3600; // Dane GIOŚ są godzinowe - bazowa delta dla pierwszego punktu
+
+// === Zapis/odczyt bitów ===
+
+/** @brief Dopisuje kolejne bity (od najstarszego) do bufora bajtów. */
+class BitWriter
+{
+public:
+    void write(quint64 value, int bits)
+    {
+        while (bits > 0) {
+            const int freeBits = 8 - fill;
+            const int take = qMin(freeBits, bits);
+            const quint8 chunk = quint8((value >> (bits - take)) & ((1u << take) - 1));
+            current = quint8(current | (chunk << (freeBits - take)));
+            fill += take;
+            bits -= take;
+            if (fill == 8) { bytes.append(char(current)); current = 0; fill = 0; }
+        }
+    }
+    void writeBit(bool bit) { write(bit ? 1 : 0, 1); }
+    QByteArray finish()
+    {
+        if (fill > 0) { bytes.append(char(current)); current = 0; fill = 0; }
+        return bytes;
+    }
+
+private:
+    QByteArray bytes;
+    quint8 current = 0;
+    int fill = 0;
+};
+
+/** @brief Odczytuje bity zapisane przez BitWriter. Przekroczenie bufora ustawia flagę failed. */
+class BitReader
+{
+public:
+    BitReader(const uchar* data, qsizetype size) : data(data), size(size) {}
+
+    quint64 read(int bits)
+    {
+        quint64 value = 0;
+        while (bits > 0) {
+            const qsizetype byteIndex = pos >> 3;
+            if (byteIndex >= size) { failed = true; return 0; }
+            const int available = 8 - int(pos & 7);
+            const int take = qMin(available, bits);
+            const quint8 chunk = quint8((data[byteIndex] >> (available - take)) & ((1u << take) - 1));
+            value = (value << take) | chunk;
+            pos += take;
+            bits -= take;
+        }
+        return value;
+    }
+    bool readBit() { return read(1) != 0; }
+
+    bool failed = false;
+
+private:
+    const uchar* data;
+    qsizetype size;
+    qsizetype pos = 0;
+};
+
+// === Varinty (LEB128) ===
+
+void writeVarint(QByteArray& out, quint64 value)
+{
+    while (value >= 0x80) {
+        out.append(char((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    out.append(char(value));
+}
+
+bool readVarint(const QByteArray& in, qsizetype& pos, quint64& value)
+{
+    value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (pos >= in.size()) return false;
+        const quint8 byte = quint8(in.at(pos++));
+        value |= quint64(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) return true;
+    }
+    return false;
+}
+
+quint64 zigZag(qint64 v) { return (quint64(v) << 1) ^ quint64(v >> 63); }
+qint64 unZigZag(quint64 v) { return qint64(v >> 1) ^ -qint64(v & 1); }
+
+quint64 doubleBits(double d) { quint64 bits; std::memcpy(&bits, &d, sizeof bits); return bits; }
+double bitsDouble(quint64 bits) { double d; std::memcpy(&d, &bits, sizeof d); return d; }
+
+// === Strumień znaczników czasu (delta-of-delta) ===
+
+void writeDeltaOfDelta(BitWriter& w, qint64 dod)
+{
+    if (dod == 0) {
+        w.writeBit(false);
+    } else if (dod >= -63 && dod <= 64) {
+        w.write(0b10, 2); w.write(quint64(dod + 63), 7);
+    } else if (dod >= -255 && dod <= 256) {
+        w.write(0b110, 3); w.write(quint64(dod + 255), 9);
+    } else if (dod >= -2047 && dod <= 2048) {
+        w.write(0b1110, 4); w.write(quint64(dod + 2047), 12);
+    } else {
+        w.write(0b1111, 4); w.write(quint64(dod), 64);
+    }
+}
+
+qint64 readDeltaOfDelta(BitReader& r)
+{
+    if (!r.readBit()) return 0;
+    if (!r.readBit()) return qint64(r.read(7)) - 63;
+    if (!r.readBit()) return qint64(r.read(9)) - 255;
+    if (!r.readBit()) return qint64(r.read(12)) - 2047;
+    return qint64(r.read(64));
+}
+
+// === Strumień wartości (XOR) ===
+
+/** @brief Stan kodera/dekodera XOR: poprzednia wartość i okno znaczących bitów. */
+struct XorState {
+    quint64 previous = 0;
+    int leading = -1;  ///< -1 oznacza brak poprzedniego okna.
+    int trailing = 0;
+    bool first = true;
+};
+
+void writeXorValue(BitWriter& w, XorState& s, double value)
+{
+    const quint64 bits = doubleBits(value);
+    if (s.first) {
+        w.write(bits, 64);
+        s.previous = bits;
+        s.first = false;
+        return;
+    }
+    const quint64 x = bits ^ s.previous;
+    s.previous = bits;
+    if (x == 0) { w.writeBit(false); return; }
+
+    const int leading = qMin(int(qCountLeadingZeroBits(x)), 31);
+    const int trailing = int(qCountTrailingZeroBits(x));
+    if (s.leading >= 0 && leading >= s.leading && trailing >= s.trailing) {
+        // Mieści się w poprzednim oknie - zapisujemy tylko bity znaczące
+        const int meaningful = 64 - s.leading - s.trailing;
+        w.write(0b10, 2);
+        w.write(x >> s.trailing, meaningful);
+    } else {
+        const int meaningful = 64 - leading - trailing;
+        w.write(0b11, 2);
+        w.write(quint64(leading), 5);
+        w.write(quint64(meaningful - 1), 6);
+        w.write(x >> trailing, meaningful);
+        s.leading = leading;
+        s.trailing = trailing;
+    }
+}
+
+double readXorValue(BitReader& r, XorState& s)
+{
+    if (s.first) {
+        s.previous = r.read(64);
+        s.first = false;
+        return bitsDouble(s.previous);
+    }
+    if (!r.readBit()) return bitsDouble(s.previous);
+
+    if (!r.readBit()) {
+        if (s.leading < 0) { r.failed = true; return 0.0; }
+        const int meaningful = 64 - s.leading - s.trailing;
+        s.previous ^= r.read(meaningful) << s.trailing;
+    } else {
+        s.leading = int(r.read(5));
+        const int meaningful = int(r.read(6)) + 1;
+        s.trailing = 64 - s.leading - meaningful;
+        if (s.trailing < 0) { r.failed = true; return 0.0; }
+        s.previous ^= r.read(meaningful) << s.trailing;
+    }
+    return bitsDouble(s.previous);
+}
+
+void setError(QString* errorString, const QString& message)
+{
+    if (errorString) *errorString = message;
+}
+
+/**
+ * @brief Wspólna pętla dekodowania. Dla każdego punktu wywołuje
+ * sink(sekundyOdEpoki, czyWartośćObecna, wartość).
+ */
+template <typename Sink>
+bool decodeSeries(const QByteArray& blob, QString& key, quint64& count, Sink&& sink, QString* errorString,
+                  QList<QPair<quint64, quint8>>* flags = nullptr)
+{
+    if (!SeriesCodec::isEncodedSeries(blob)) {
+        setError(errorString, "Nieprawidłowy nagłówek serii (oczekiwano AQS1).");
+        return false;
+    }
+
+    qsizetype pos = sizeof(SeriesMagic);
+    quint64 keyLength = 0;
+    if (!readVarint(blob, pos, keyLength) || keyLength > quint64(blob.size() - pos)) {
+        setError(errorString, "Uszkodzony nagłówek serii (klucz).");
+        return false;
+    }
+    key = QString::fromUtf8(blob.constData() + pos, qsizetype(keyLength));
+    pos += qsizetype(keyLength);
+
+    if (!readVarint(blob, pos, count)) {
+        setError(errorString, "Uszkodzony nagłówek serii (liczba punktów).");
+        return false;
+    }
+    if (count == 0) return true;
+
+    quint64 firstTsZz = 0;
+    if (!readVarint(blob, pos, firstTsZz)) {
+        setError(errorString, "Uszkodzony nagłówek serii (pierwszy znacznik czasu).");
+        return false;
+    }
+
+    // Trzy strumienie poprzedzone długościami
+    QByteArray streams[3];
+    for (QByteArray& stream : streams) {
+        quint64 length = 0;
+        if (!readVarint(blob, pos, length) || length > quint64(blob.size() - pos)) {
+            setError(errorString, "Uszkodzona seria (niepoprawna długość strumienia).");
+            return false;
+        }
+        stream = QByteArray::fromRawData(blob.constData() + pos, qsizetype(length));
+        pos += qsizetype(length);
+    }
+    // Każdy znacznik czasu zajmuje co najmniej 1 bit - chroni przed absurdalną rezerwacją pamięci
+    if (count > quint64(streams[0].size()) * 8 + 1) {
+        setError(errorString, "Uszkodzona seria (liczba punktów większa niż dane).");
+        return false;
+    }
+
+    BitReader tsReader(reinterpret_cast<const uchar*>(streams[0].constData()), streams[0].size());
+    BitReader valueReader(reinterpret_cast<const uchar*>(streams[2].constData()), streams[2].size());
+    XorState xorState;
+    qsizetype runPos = 0;
+    quint64 runRemaining = 0;
+    bool runPresent = false; // Pierwsza seria (obecne) wczytywana w pętli po zamianie flagi
+
+    qint64 timestamp = unZigZag(firstTsZz);
+    qint64 delta = ExpectedStepSecs;
+    for (quint64 i = 0; i < count; ++i) {
+        if (i > 0) {
+            delta += readDeltaOfDelta(tsReader);
+            timestamp += delta;
+        }
+        while (runRemaining == 0) {
+            if (!readVarint(streams[1], runPos, runRemaining)) {
+                setError(errorString, "Uszkodzona seria (strumień wartości pustych).");
+                return false;
+            }
+            runPresent = !runPresent;
+        }
+        --runRemaining;
+
+        double value = 0.0;
+        if (runPresent) value = readXorValue(valueReader, xorState);
+        if (tsReader.failed || valueReader.failed) {
+            setError(errorString, "Uszkodzona seria (przedwczesny koniec danych).");
+            return false;
+        }
+        sink(timestamp, runPresent, value);
+    }
+
+    // Sekcja flag jakości (tylko gdy jakiś punkt był oznaczony)
+    if (flags && pos < blob.size()) {
+        quint64 flaggedCount = 0, index = 0;
+        if (!readVarint(blob, pos, flaggedCount) || flaggedCount > count) {
+            setError(errorString, "Uszkodzona seria (sekcja flag).");
+            return false;
+        }
+        for (quint64 k = 0; k < flaggedCount; ++k) {
+            quint64 delta = 0;
+            if (!readVarint(blob, pos, delta) || pos >= blob.size() || (index += delta) >= count) {
+                setError(errorString, "Uszkodzona seria (sekcja flag).");
+                return false;
+            }
+            flags->append(qMakePair(index, quint8(blob.at(pos++))));
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+QByteArray SeriesCodec::encode(const MeasurementData& data)
+{
+    QByteArray out;
+    out.append(SeriesMagic, sizeof(SeriesMagic));
+    const QByteArray keyUtf8 = data.key.toUtf8();
+    writeVarint(out, quint64(keyUtf8.size()));
+    out.append(keyUtf8);
+
+    quint64 count = 0;
+    for (const Measurement& m : data.values) if (m.date.isValid()) ++count;
+    writeVarint(out, count);
+    if (count == 0) return out;
+
+    BitWriter tsWriter, valueWriter;
+    QByteArray nullRuns;
+    XorState xorState;
+
+    bool first = true;
+    qint64 previousTs = 0, previousDelta = ExpectedStepSecs;
+    bool runPresent = true; // Serie zaczynają się od "obecnych" (mogą mieć długość 0)
+    quint64 runLength = 0;
+
+    for (const Measurement& m : data.values) {
+        if (!m.date.isValid()) continue;
+        const qint64 ts = m.date.toSecsSinceEpoch();
+        if (first) {
+            writeVarint(out, zigZag(ts));
+            first = false;
+        } else {
+            const qint64 delta = ts - previousTs;
+            writeDeltaOfDelta(tsWriter, delta - previousDelta);
+            previousDelta = delta;
+        }
+        previousTs = ts;
+
+        const bool present = !m.value.isNull();
+        if (present != runPresent) {
+            writeVarint(nullRuns, runLength);
+            runPresent = present;
+            runLength = 0;
+        }
+        ++runLength;
+        if (present) writeXorValue(valueWriter, xorState, m.value.toDouble());
+    }
+    writeVarint(nullRuns, runLength);
+
+    const QByteArray streams[3] = { tsWriter.finish(), nullRuns, valueWriter.finish() };
+    for (const QByteArray& stream : streams) {
+        writeVarint(out, quint64(stream.size()));
+        out.append(stream);
+    }
+
+    // Opcjonalna sekcja flag jakości: liczba oznaczonych punktów, potem (różnica indeksu, flagi);
+    // starsze dekodery kończą odczyt po trzech strumieniach i ją ignorują
+    QByteArray flagSection;
+    quint64 flaggedCount = 0, index = 0, previousIndex = 0;
+    for (const Measurement& m : data.values) {
+        if (!m.date.isValid()) continue;
+        if (m.flags != 0) {
+            writeVarint(flagSection, index - previousIndex);
+            flagSection.append(char(m.flags));
+            previousIndex = index;
+            ++flaggedCount;
+        }
+        ++index;
+    }
+    if (flaggedCount > 0) {
+        writeVarint(out, flaggedCount);
+        out.append(flagSection);
+    }
+    return out;
+}
+
+bool SeriesCodec::decode(const QByteArray& blob, MeasurementData& out, QString* errorString)
+{
+    out = MeasurementData();
+    quint64 count = 0;
+    QList<Measurement> values;
+    QList<QPair<quint64, quint8>> flags;
+    const bool ok = decodeSeries(blob, out.key, count, [&values, &count](qint64 secs, bool present, double value) {
+        if (values.isEmpty()) values.reserve(qsizetype(count));
+        Measurement m;
+        m.date = QDateTime::fromSecsSinceEpoch(secs);
+        if (present) m.value = value;
+        values.append(m);
+    }, errorString, &flags);
+    if (!ok) { out = MeasurementData(); return false; }
+    for (const auto& [index, flag] : flags) values[qsizetype(index)].flags = flag;
+    out.values = std::move(values);
+    return true;
+}
+
+bool SeriesCodec::decodePoints(const QByteArray& blob, QList<QPointF>& points, QString* errorString)
+{
+    points.clear();
+    QString key;
+    quint64 count = 0;
+    const bool ok = decodeSeries(blob, key, count, [&points, &count](qint64 secs, bool present, double value) {
+        if (points.isEmpty()) points.reserve(qsizetype(count));
+        if (present) points.append(QPointF(double(secs) * 1000.0, value));
+    }, errorString);
+    if (!ok) points.clear();
+    return ok;
+}
+
+bool SeriesCodec::isEncodedSeries(const QByteArray& blob)
+{
+    return blob.size() >= qsizetype(sizeof(SeriesMagic))
+           && std::memcmp(blob.constData(), SeriesMagic, sizeof(SeriesMagic)) == 0;
+}
@@ -0,0 +1,73 @@
+#ifndef SERIESCODEC_H
+#define SERIESCODEC_H
+
+#include <QByteArray>
+#include <QList>
+#include <QPointF>
+#include <QString>
+#include "giosapiclient.h" // Struktury Measurement i MeasurementData
+
+/**
+ * @file seriescodec.h
+ * @brief Definicja klasy SeriesCodec - kompaktowego kodeka serii pomiarowych.
+ */
+
+/**
+ * @class SeriesCodec
+ * @brief Koduje i dekoduje serie pomiarowe w zwartym formacie binarnym (w stylu Gorilla).
+ *
+ * Format składa się z nagłówka (magia "AQS1", klucz, liczba punktów, pierwszy znacznik czasu)
+ * oraz trzech strumieni:
+ * - znaczniki czasu jako delta-of-delta w sekundach (typowy krok +3600 s zajmuje 1 bit),
+ * - długości naprzemiennych serii wartości obecnych/pustych (null) jako varinty,
+ * - wartości double (tylko obecne) kodowane XOR względem poprzedniej wartości.
+ *
+ * Jeśli któryś punkt ma flagi jakości (Measurement::flags), po strumieniach następuje
+ * opcjonalna sekcja flag (rzadka lista: różnica indeksu i bajt flag).
+ *
+ * Wynik jest zwykłym QByteArray, więc nadaje się zarówno do plików na dysku,
+ * jak i do pamięci podręcznej odpowiedzi czy przechowywania "zimnych" danych w pamięci.
+ */
+class SeriesCodec
+{
+public:
+    /**
+     * @brief Koduje serię pomiarową do postaci binarnej.
+     * Punkty z niepoprawną datą są pomijane. Zakłada serię posortowaną rosnąco po dacie
+     * (inna kolejność jest poprawnie kodowana, ale mniej wydajnie).
+     * @param data Seria do zakodowania.
+     * @return Zakodowany blok bajtów.
+     */
+    static QByteArray encode(const MeasurementData& data);
+
+    /**
+     * @brief Dekoduje serię zapisaną przez encode().
+     * @param blob Zakodowane dane.
+     * @param out Struktura docelowa (nadpisywana).
+     * @param errorString Opcjonalny wskaźnik na komunikat błędu.
+     * @return true, jeśli dekodowanie się powiodło.
+     */
+    static bool decode(const QByteArray& blob, MeasurementData& out, QString* errorString = nullptr);
+
+    /**
+     * @brief Dekoduje serię bezpośrednio do punktów wykresu (ms od epoki, wartość).
+     * Wartości puste są pomijane (flagi jakości nie są odczytywane). Nie tworzy obiektów QDateTime ani QVariant,
+     * dzięki czemu może zasilać QLineSeries::replace() bez kroku pośredniego.
+     * @param blob Zakodowane dane.
+     * @param points Lista docelowa (nadpisywana).
+     * @param errorString Opcjonalny wskaźnik na komunikat błędu.
+     * @return true, jeśli dekodowanie się powiodło.
+     */
+    static bool decodePoints(const QByteArray& blob, QList<QPointF>& points, QString* errorString = nullptr);
+
+    /**
+     * @brief Sprawdza, czy blok bajtów zaczyna się od nagłówka formatu SeriesCodec.
+     * @param blob Dane do sprawdzenia.
+     */
+    static bool isEncodedSeries(const QByteArray& blob);
+
+    /** @brief Zalecane rozszerzenie plików z zakodowanymi seriami. */
+    static constexpr const char* FileSuffix = "aqs";
+};
+
+#endif // SERIESCODEC_H
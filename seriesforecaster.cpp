@@ -0,0 +1,185 @@
+#include "seriesforecaster.h"
+#include "tracing.h"
+
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+#include <algorithm>
+
+namespace {
+
+const quint32 ForecastMagic = 0x41514631; // "AQF1"
+const quint16 ForecastVersion = 1;
+constexpr qint64 HourMs = 3600LL * 1000;
+// Wersja strumienia dostępna w budowanym Qt (Qt 5 nie zna Qt_6_0)
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+constexpr QDataStream::Version StreamVersion = QDataStream::Qt_6_0;
+#else
+constexpr QDataStream::Version StreamVersion = QDataStream::Qt_5_15;
+#endif
+
+} // namespace
+
+int SeriesForecaster::slotOf(qint64 time)
+{
+    return int(((time / HourMs) % Season + Season) % Season);
+}
+
+void SeriesForecaster::update(State& state, qint64 time, double value) const
+{
+    // Inicjalizacja: pierwszy pełny sezon daje poziom i składniki sezonowe
+    if (state.warmup < Season) {
+        if (state.warmup > 0 && time - state.lastTime > MaxGapHours * HourMs) state = State();
+        const int slot = slotOf(time);
+        state.season[slot] = value;
+        state.filled |= 1u << slot;
+        state.warmupSum += value;
+        state.lastTime = time;
+        if (++state.warmup == Season) {
+            const double mean = state.warmupSum / Season;
+            state.level = mean;
+            state.trend = 0.0;
+            for (int i = 0; i < Season; ++i) state.season[i] = (state.filled & (1u << i)) ? state.season[i] - mean : 0.0;
+        }
+        return;
+    }
+
+    const qint64 gap = (time - state.lastTime) / HourMs;
+    if (gap > MaxGapHours) {
+        state = State();
+        update(state, time, value);
+        return;
+    }
+    // Godziny bez odczytu: sam krok modelu (tłumiony trend), bez zmiany sezonowości
+    for (qint64 k = 1; k < gap; ++k) {
+        state.level += params.phi * state.trend;
+        state.trend *= params.phi;
+    }
+
+    const int slot = slotOf(time);
+    const double previousLevel = state.level;
+    const double seasonal = state.season[slot];
+    state.level = params.alpha * (value - seasonal) + (1.0 - params.alpha) * (previousLevel + params.phi * state.trend);
+    state.trend = params.beta * (state.level - previousLevel) + (1.0 - params.beta) * params.phi * state.trend;
+    state.season[slot] = params.gamma * (value - state.level) + (1.0 - params.gamma) * seasonal;
+    state.lastTime = time;
+}
+
+int SeriesForecaster::ingest(const MeasurementData& data)
+{
+    if (data.sensorId < 0 || data.values.isEmpty()) return 0;
+    AQM_TRACE_SCOPE("SeriesForecaster::ingest", "analysis");
+    State& state = states[data.sensorId];
+
+    // Tylko odczyty nowsze niż ostatnio przyjęty (wyszukiwanie binarne)
+    auto begin = data.values.cbegin();
+    if (state.lastTime != 0) {
+        begin = std::upper_bound(data.values.cbegin(), data.values.cend(), state.lastTime,
+                                 [](qint64 t, const Measurement& m) { return t < m.date.toMSecsSinceEpoch(); });
+    }
+    int absorbed = 0;
+    for (auto it = begin; it != data.values.cend(); ++it) {
+        if (!it->date.isValid() || !it->isUsable()) continue;
+        const qint64 time = it->date.toMSecsSinceEpoch();
+        if (time <= state.lastTime) continue;
+        update(state, time, it->value.toDouble());
+        ++absorbed;
+    }
+    if (absorbed > 0) modified = true;
+    return absorbed;
+}
+
+bool SeriesForecaster::isReady(int sensorId) const
+{
+    const auto it = states.constFind(sensorId);
+    return it != states.cend() && it->warmup >= Season;
+}
+
+QVector<QPointF> SeriesForecaster::forecast(int sensorId, int hours) const
+{
+    QVector<QPointF> points;
+    const auto it = states.constFind(sensorId);
+    if (it == states.cend() || it->warmup < Season) return points;
+    const State& state = it.value();
+    points.reserve(hours);
+    double damping = 0.0, phiPower = 1.0;
+    for (int h = 1; h <= hours; ++h) {
+        phiPower *= params.phi;
+        damping += phiPower;
+        const qint64 time = state.lastTime + h * HourMs;
+        const double value = state.level + damping * state.trend + state.season[slotOf(time)];
+        points.append(QPointF(double(time), qMax(0.0, value)));
+    }
+    return points;
+}
+
+QString SeriesForecaster::defaultFileName()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/forecast.state";
+}
+
+bool SeriesForecaster::load(const QString& fileName, QString* errorString)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        if (errorString) *errorString = file.errorString();
+        return false;
+    }
+    QDataStream in(&file);
+    in.setVersion(StreamVersion);
+    quint32 magic = 0, count = 0;
+    quint16 version = 0;
+    in >> magic >> version >> count;
+    if (magic != ForecastMagic || version != ForecastVersion) {
+        if (errorString) *errorString = "Nieobsługiwany format pliku stanu prognoz.";
+        return false;
+    }
+
+    QHash<int, State> loaded;
+    loaded.reserve(count);
+    for (quint32 i = 0; i < count && in.status() == QDataStream::Ok; ++i) {
+        qint32 sensorId = 0, warmup = 0;
+        State state;
+        in >> sensorId >> state.lastTime >> state.level >> state.trend;
+        for (double& seasonal : state.season) in >> seasonal;
+        in >> warmup >> state.filled >> state.warmupSum;
+        state.warmup = qBound(0, int(warmup), int(Season));
+        loaded.insert(sensorId, state);
+    }
+    if (in.status() != QDataStream::Ok) {
+        if (errorString) *errorString = "Uszkodzony plik stanu prognoz.";
+        return false;
+    }
+    states = std::move(loaded);
+    modified = false;
+    return true;
+}
+
+bool SeriesForecaster::save(const QString& fileName, QString* errorString)
+{
+    QDir().mkpath(QFileInfo(fileName).absolutePath());
+    QSaveFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly)) {
+        if (errorString) *errorString = file.errorString();
+        return false;
+    }
+    QDataStream out(&file);
+    out.setVersion(StreamVersion);
+    out << ForecastMagic << ForecastVersion << quint32(states.size());
+    for (auto it = states.cbegin(); it != states.cend(); ++it) {
+        const State& state = it.value();
+        out << qint32(it.key()) << state.lastTime << state.level << state.trend;
+        for (double seasonal : state.season) out << seasonal;
+        out << qint32(state.warmup) << state.filled << state.warmupSum;
+    }
+    if (!file.commit()) {
+        if (errorString) *errorString = file.errorString();
+        return false;
+    }
+    modified = false;
+    return true;
+}
@@ -0,0 +1,101 @@
+#ifndef SERIESFORECASTER_H
+#define SERIESFORECASTER_H
+
+#include <QHash>
+#include <QPointF>
+#include <QString>
+#include <QVector>
+#include "giosapiclient.h" // MeasurementData
+
+/**
+ * @file seriesforecaster.h
+ * @brief Definicja klasy SeriesForecaster - przyrostowej prognozy krótkoterminowej dla każdego sensora.
+ */
+
+/**
+ * @class SeriesForecaster
+ * @brief Utrzymuje dla każdego sensora model Holta-Wintersa (addytywny, z tłumionym trendem
+ * i sezonowością dobową) i prognozuje kolejne godziny.
+ *
+ * Stan modelu to poziom, trend i 24 składniki sezonowe (godzina doby UTC). Każdy nowy odczyt
+ * godzinowy aktualizuje stan w O(1), bez ponownego przeglądania historii; luki do MaxGapHours
+ * są przechodzone krokami bez obserwacji, dłuższe zaczynają model od nowa. Pierwsze 24 odczyty
+ * inicjalizują poziom (średnia) i sezonowość (odchylenia od średniej).
+ *
+ * Podobnie jak AlertEngine i FaultDetector model przyjmuje tylko odczyty nowsze niż ostatnio
+ * przyjęty (odczyty oznaczone jako podejrzane są pomijane). Stan wszystkich sensorów jest
+ * zapisywany w zwartym pliku binarnym (QDataStream, magia "AQF1").
+ */
+class SeriesForecaster
+{
+public:
+    /** @brief Długość sezonu (godziny). */
+    static constexpr int Season = 24;
+    /** @brief Najdłuższa luka (godziny) przechodzona bez restartu modelu. */
+    static constexpr int MaxGapHours = 48;
+
+    /** @brief Stałe wygładzania. */
+    struct Parameters {
+        double alpha = 0.4;     ///< Poziom.
+        double beta = 0.02;     ///< Trend.
+        double gamma = 0.15;    ///< Sezonowość.
+        double phi = 0.9;       ///< Tłumienie trendu (prognoza nie "ucieka" w długim horyzoncie).
+    };
+
+    void setParameters(const Parameters& newParameters) { params = newParameters; }
+    const Parameters& parameters() const { return params; }
+
+    /**
+     * @brief Przyjmuje odczyty sensora nowsze niż ostatnio przyjęty.
+     * @param data Seria posortowana rosnąco po dacie (serie bez ID sensora są pomijane).
+     * @return Liczba przyjętych odczytów.
+     */
+    int ingest(const MeasurementData& data);
+
+    /** @brief Czy model sensora jest zainicjalizowany (przyjął pełny sezon). */
+    bool isReady(int sensorId) const;
+
+    /**
+     * @brief Prognoza kolejnych godzin po ostatnim przyjętym odczycie.
+     * @param sensorId ID sensora.
+     * @param hours Horyzont (godziny).
+     * @return Punkty (ms od epoki, wartość nieujemna); pusta lista, jeśli model nie jest gotowy.
+     */
+    QVector<QPointF> forecast(int sensorId, int hours = 24) const;
+
+    /** @brief Czas ostatniego przyjętego odczytu sensora (ms od epoki; 0 = brak). */
+    qint64 lastTime(int sensorId) const { return states.value(sensorId).lastTime; }
+
+    int sensorCount() const { return int(states.size()); }
+    /** @brief Czy stan zmienił się od ostatniego zapisu lub wczytania. */
+    bool isModified() const { return modified; }
+    void clear() { states.clear(); modified = true; }
+
+    /** @brief Domyślna ścieżka pliku stanu w katalogu danych aplikacji (AppDataLocation). */
+    static QString defaultFileName();
+    /** @brief Wczytuje stan modeli (zastępuje bieżący). */
+    bool load(const QString& fileName, QString* errorString = nullptr);
+    /** @brief Zapisuje stan modeli atomowo (QSaveFile). */
+    bool save(const QString& fileName, QString* errorString = nullptr);
+
+private:
+    struct State {
+        qint64 lastTime = 0;        ///< Ostatni przyjęty odczyt (ms; 0 = brak).
+        double level = 0.0;
+        double trend = 0.0;
+        double season[Season] = {}; ///< Składniki sezonowe wg godziny doby UTC.
+        int warmup = 0;             ///< Odczyty inicjalizacji (Season = model gotowy).
+        quint32 filled = 0;         ///< Maska godzin doby, które dostały odczyt w inicjalizacji.
+        double warmupSum = 0.0;
+    };
+
+    /** @brief Aktualizuje stan jednym odczytem (czas w ms, wyrównany do godziny). */
+    void update(State& state, qint64 time, double value) const;
+    static int slotOf(qint64 time);
+
+    Parameters params;
+    QHash<int, State> states;       ///< ID sensora -> stan modelu.
+    bool modified = false;
+};
+
+#endif // SERIESFORECASTER_H
@@ -0,0 +1,149 @@
+#include "seriesindex.h"
+
+#include <algorithm>
+
+namespace {
+
+bool hasValue(const Measurement& m)
+{
+    return m.date.isValid() && m.isUsable();
+}
+
+/** @brief Czy odczyt ma wartość, ale został oznaczony jako podejrzany. */
+bool isFlagged(const Measurement& m)
+{
+    return m.flags != 0 && !m.value.isNull();
+}
+
+/** @brief Dołącza pojedynczą wartość do agregatów. */
+void addReading(SeriesIndex::Summary& summary, double value, int index)
+{
+    if (summary.count == 0 || value < summary.min) { summary.min = value; summary.minIndex = index; }
+    if (summary.count == 0 || value > summary.max) { summary.max = value; summary.maxIndex = index; }
+    if (summary.firstIndex < 0) summary.firstIndex = index;
+    summary.lastIndex = index;
+    summary.sum += value;
+    ++summary.count;
+}
+
+/** @brief Dołącza podsumowanie całego bloku do agregatów. */
+void addBlock(SeriesIndex::Summary& summary, const SeriesIndex::Block& block)
+{
+    summary.flagged += block.flagged;
+    if (block.count == 0) return;
+    if (summary.count == 0 || block.min < summary.min) { summary.min = block.min; summary.minIndex = block.minIndex; }
+    if (summary.count == 0 || block.max > summary.max) { summary.max = block.max; summary.maxIndex = block.maxIndex; }
+    if (summary.firstIndex < 0) summary.firstIndex = block.firstIndex;
+    summary.lastIndex = block.lastIndex;
+    summary.sum += block.sum;
+    summary.count += block.count;
+}
+
+} // namespace
+
+SeriesIndex::SeriesIndex(const MeasurementDataPtr& data)
+    : series(data ? data : MeasurementDataPtr::create())
+{
+    buildFrom(0);
+}
+
+SeriesIndex::SeriesIndex(const MeasurementDataPtr& data, const SeriesIndex& previous, qsizetype unchangedPrefix)
+    : series(data ? data : MeasurementDataPtr::create())
+{
+    // Bloki leżące w całości w niezmienionym początku serii są przejmowane bez przeglądania odczytów
+    unchangedPrefix = qMin(unchangedPrefix, qMin(series->values.size(), previous.series->values.size()));
+    const int reused = int(qMin<qsizetype>(unchangedPrefix / BlockSize, previous.blockList.size()));
+    blockList = previous.blockList.mid(0, reused);
+    buildFrom(reused);
+}
+
+void SeriesIndex::buildFrom(int firstBlock)
+{
+    const QList<Measurement>& values = series->values;
+    const qsizetype blockCount = (values.size() + BlockSize - 1) / BlockSize;
+    blockList.resize(firstBlock);
+    blockList.reserve(blockCount);
+    for (qsizetype b = firstBlock; b < blockCount; ++b) {
+        const int begin = int(b * BlockSize);
+        const int end = int(qMin<qsizetype>(begin + BlockSize, values.size()));
+        Block block;
+        block.firstTime = values.at(begin).date.toMSecsSinceEpoch();
+        block.lastTime = values.at(end - 1).date.toMSecsSinceEpoch();
+        Summary summary;
+        for (int i = begin; i < end; ++i) {
+            if (hasValue(values.at(i))) addReading(summary, values.at(i).value.toDouble(), i);
+            else if (isFlagged(values.at(i))) ++summary.flagged;
+        }
+        block.count = summary.count;
+        block.sum = summary.sum;
+        block.min = summary.min;
+        block.max = summary.max;
+        block.minIndex = summary.minIndex;
+        block.maxIndex = summary.maxIndex;
+        block.firstIndex = summary.firstIndex;
+        block.lastIndex = summary.lastIndex;
+        block.flagged = summary.flagged;
+        blockList.append(block);
+    }
+}
+
+void SeriesIndex::findRange(qint64 from, qint64 to, qsizetype& first, qsizetype& last) const
+{
+    const QList<Measurement>& values = series->values;
+    first = last = 0;
+    if (blockList.isEmpty() || from > to) return;
+
+    // Pierwszy blok, który kończy się nie wcześniej niż from; dalej wyszukiwanie w bloku
+    const auto firstBlock = std::lower_bound(blockList.cbegin(), blockList.cend(), from,
+                                             [](const Block& block, qint64 t) { return block.lastTime < t; });
+    if (firstBlock == blockList.cend()) {
+        first = last = values.size();
+        return;
+    }
+    qsizetype begin = (firstBlock - blockList.cbegin()) * BlockSize;
+    first = std::lower_bound(values.cbegin() + begin, values.cbegin() + qMin<qsizetype>(begin + BlockSize, values.size()), from,
+                             [](const Measurement& m, qint64 t) { return m.date.toMSecsSinceEpoch() < t; })
+            - values.cbegin();
+
+    // Ostatni blok, który zaczyna się nie później niż to
+    const auto lastBlockEnd = std::upper_bound(blockList.cbegin(), blockList.cend(), to,
+                                               [](qint64 t, const Block& block) { return t < block.firstTime; });
+    if (lastBlockEnd == blockList.cbegin()) {
+        last = first = 0;
+        return;
+    }
+    begin = (lastBlockEnd - blockList.cbegin() - 1) * BlockSize;
+    last = std::upper_bound(values.cbegin() + begin, values.cbegin() + qMin<qsizetype>(begin + BlockSize, values.size()), to,
+                            [](qint64 t, const Measurement& m) { return t < m.date.toMSecsSinceEpoch(); })
+           - values.cbegin();
+    if (last < first) last = first;
+}
+
+SeriesIndex::Summary SeriesIndex::summarize(qint64 from, qint64 to) const
+{
+    Summary summary;
+    qsizetype first = 0, last = 0;
+    findRange(from, to, first, last);
+    if (first >= last) return summary;
+
+    const QList<Measurement>& values = series->values;
+    const int firstBlock = int(first / BlockSize);
+    const int lastBlock = int((last - 1) / BlockSize);
+    for (int b = firstBlock; b <= lastBlock; ++b) {
+        const qsizetype blockBegin = qsizetype(b) * BlockSize;
+        const qsizetype blockEnd = qMin<qsizetype>(blockBegin + BlockSize, values.size());
+        if (first <= blockBegin && blockEnd <= last) {
+            addBlock(summary, blockList.at(b));
+            continue;
+        }
+        // Blok brzegowy - tylko odczyty z zakresu
+        const qsizetype begin = qMax(first, blockBegin);
+        const qsizetype end = qMin(last, blockEnd);
+        for (qsizetype i = begin; i < end; ++i) {
+            if (hasValue(values.at(i))) addReading(summary, values.at(i).value.toDouble(), int(i));
+            else if (isFlagged(values.at(i))) ++summary.flagged;
+        }
+        summary.scannedReadings += int(end - begin);
+    }
+    return summary;
+}
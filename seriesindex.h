@@ -0,0 +1,103 @@
+#ifndef SERIESINDEX_H
+#define SERIESINDEX_H
+
+#include <QSharedPointer>
+#include <QVector>
+#include "giosapiclient.h" // MeasurementData, MeasurementDataPtr
+
+/**
+ * @file seriesindex.h
+ * @brief Definicja klasy SeriesIndex - blokowego indeksu serii pomiarowej do zapytań o zakres czasu.
+ */
+
+/**
+ * @class SeriesIndex
+ * @brief Dzieli posortowaną serię na bloki stałej liczby odczytów i przechowuje podsumowanie każdego bloku.
+ *
+ * Podsumowanie bloku: czas pierwszego i ostatniego odczytu, liczba wartości, suma, minimum
+ * i maksimum (z indeksami odczytów). Zapytanie o zakres czasu wyszukuje binarnie bloki
+ * brzegowe; bloki w całości mieszczące się w zakresie są agregowane z podsumowań,
+ * a przeglądane są tylko odczyty bloków brzegowych. Koszt: O(log n + liczba bloków w zakresie).
+ *
+ * Indeks jest niemodyfikowalny i współdzielony (SeriesIndexPtr) razem z migawką serii.
+ * Nowy indeks serii, która zachowała początek poprzedniej, przejmuje podsumowania
+ * niezmienionych bloków.
+ */
+class SeriesIndex
+{
+public:
+    /** @brief Liczba odczytów w bloku. */
+    static constexpr int BlockSize = 256;
+
+    /** @brief Podsumowanie bloku (wartości liczone tylko z odczytów z poprawną datą i wartością). */
+    struct Block {
+        qint64 firstTime = 0;       ///< Czas pierwszego odczytu bloku (ms od epoki).
+        qint64 lastTime = 0;        ///< Czas ostatniego odczytu bloku (ms od epoki).
+        int count = 0;              ///< Liczba wartości (bez null i odczytów oznaczonych jako podejrzane).
+        double sum = 0.0;
+        double min = 0.0;
+        double max = 0.0;
+        int minIndex = -1;          ///< Indeks odczytu z minimum (-1 = brak wartości).
+        int maxIndex = -1;
+        int firstIndex = -1;        ///< Indeks pierwszego odczytu z wartością.
+        int lastIndex = -1;         ///< Indeks ostatniego odczytu z wartością.
+        int flagged = 0;            ///< Odczyty z wartością oznaczone jako podejrzane (pominięte w agregatach).
+    };
+
+    /** @brief Agregaty zakresu czasu. */
+    struct Summary {
+        int count = 0;
+        double sum = 0.0;
+        double min = 0.0;
+        double max = 0.0;
+        int minIndex = -1;          ///< Indeks odczytu z minimum (-1 = brak wartości w zakresie).
+        int maxIndex = -1;
+        int firstIndex = -1;        ///< Pierwszy odczyt z wartością w zakresie.
+        int lastIndex = -1;         ///< Ostatni odczyt z wartością w zakresie.
+        int flagged = 0;            ///< Odczyty z wartością oznaczone jako podejrzane (pominięte).
+        int scannedReadings = 0;    ///< Odczyty przejrzane w blokach brzegowych (diagnostyka).
+        double average() const { return count > 0 ? sum / count : 0.0; }
+    };
+
+    /** @brief Buduje indeks serii (posortowanej rosnąco po dacie). */
+    explicit SeriesIndex(const MeasurementDataPtr& data);
+
+    /**
+     * @brief Buduje indeks serii, przejmując bloki poprzedniego indeksu.
+     * @param data Nowa migawka serii.
+     * @param previous Indeks poprzedniej migawki.
+     * @param unchangedPrefix Liczba początkowych odczytów identycznych w obu migawkach.
+     */
+    SeriesIndex(const MeasurementDataPtr& data, const SeriesIndex& previous, qsizetype unchangedPrefix);
+
+    /** @brief Indeksowana migawka serii (nigdy nullptr). */
+    const MeasurementDataPtr& data() const { return series; }
+    const QVector<Block>& blocks() const { return blockList; }
+    bool isEmpty() const { return blockList.isEmpty(); }
+    /** @brief Szacowany rozmiar indeksu w pamięci (bajty, bez samej serii). */
+    qsizetype memoryUsage() const { return sizeof(*this) + blockList.capacity() * qsizetype(sizeof(Block)); }
+    /** @brief Czas pierwszego odczytu (0 dla pustej serii). */
+    qint64 firstTime() const { return blockList.isEmpty() ? 0 : blockList.first().firstTime; }
+    /** @brief Czas ostatniego odczytu (0 dla pustej serii). */
+    qint64 lastTime() const { return blockList.isEmpty() ? 0 : blockList.last().lastTime; }
+
+    /**
+     * @brief Zakres indeksów [first, last) odczytów z czasem w przedziale [from, to] (ms od epoki).
+     */
+    void findRange(qint64 from, qint64 to, qsizetype& first, qsizetype& last) const;
+
+    /** @brief Agregaty wartości z przedziału [from, to] (ms od epoki). */
+    Summary summarize(qint64 from, qint64 to) const;
+
+private:
+    /** @brief Buduje podsumowania bloków od podanego bloku do końca serii. */
+    void buildFrom(int firstBlock);
+
+    MeasurementDataPtr series;
+    QVector<Block> blockList;
+};
+
+/** @brief Współdzielony, niemodyfikowalny indeks serii. */
+using SeriesIndexPtr = QSharedPointer<const SeriesIndex>;
+
+#endif // SERIESINDEX_H
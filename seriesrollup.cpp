@@ -0,0 +1,106 @@
+#include "seriesrollup.h"
+
+#include <algorithm>
+
+namespace {
+
+/** @brief Pierwszy dzień przedziału zawierającego datę. */
+QDate bucketDate(SeriesRollup::Tier tier, const QDate& date)
+{
+    return tier == SeriesRollup::Tier::Monthly ? QDate(date.year(), date.month(), 1) : date;
+}
+
+} // namespace
+
+SeriesRollup::SeriesRollup(const MeasurementDataPtr& data)
+{
+    if (!data) return;
+    readings = data->values.size();
+    buildFrom(Tier::Daily, data->values, 0);
+    buildFrom(Tier::Monthly, data->values, 0);
+}
+
+SeriesRollup::SeriesRollup(const MeasurementDataPtr& data, const SeriesRollup& previous, qsizetype unchangedPrefix)
+{
+    if (!data) return;
+    const QList<Measurement>& values = data->values;
+    readings = values.size();
+    unchangedPrefix = qMin(unchangedPrefix, qMin(values.size(), previous.readings));
+    for (Tier tier : {Tier::Daily, Tier::Monthly}) {
+        if (unchangedPrefix == 0) {
+            buildFrom(tier, values, 0);
+            continue;
+        }
+        // Przedział ostatniego niezmienionego odczytu może dostać nowe odczyty - przeliczany jest od początku
+        const qint64 boundary = bucketStart(tier, values.at(unchangedPrefix - 1).date.toMSecsSinceEpoch());
+        const QVector<Bucket>& old = previous.buckets(tier);
+        const auto kept = std::lower_bound(old.cbegin(), old.cend(), boundary,
+                                           [](const Bucket& bucket, qint64 t) { return bucket.start < t; });
+        tierBuckets(tier) = old.mid(0, kept - old.cbegin());
+        const auto firstReading = std::lower_bound(values.cbegin(), values.cbegin() + unchangedPrefix, boundary,
+                                                   [](const Measurement& m, qint64 t) { return m.date.toMSecsSinceEpoch() < t; });
+        buildFrom(tier, values, firstReading - values.cbegin());
+    }
+}
+
+qint64 SeriesRollup::bucketStart(Tier tier, qint64 msecs)
+{
+    const QDate date = bucketDate(tier, QDateTime::fromMSecsSinceEpoch(msecs).date());
+    return QDateTime(date, QTime(0, 0)).toMSecsSinceEpoch();
+}
+
+void SeriesRollup::buildFrom(Tier tier, const QList<Measurement>& values, qsizetype firstReading)
+{
+    QVector<Bucket>& out = tierBuckets(tier);
+    QDate currentKey;
+    Bucket current;
+    for (qsizetype i = firstReading; i < values.size(); ++i) {
+        const Measurement& m = values.at(i);
+        if (!m.date.isValid()) continue;
+        const QDate key = bucketDate(tier, m.date.date());
+        if (key != currentKey) {
+            if (currentKey.isValid()) out.append(current);
+            current = Bucket();
+            current.start = QDateTime(key, QTime(0, 0)).toMSecsSinceEpoch();
+            currentKey = key;
+        }
+        if (!m.isUsable()) continue;
+        const double value = m.value.toDouble();
+        if (current.count == 0 || value < current.min) current.min = value;
+        if (current.count == 0 || value > current.max) current.max = value;
+        current.sum += value;
+        ++current.count;
+    }
+    if (currentKey.isValid()) out.append(current);
+}
+
+const QVector<SeriesRollup::Bucket>& SeriesRollup::buckets(Tier tier) const
+{
+    static const QVector<Bucket> none;
+    switch (tier) {
+    case Tier::Daily: return daily;
+    case Tier::Monthly: return monthly;
+    case Tier::Raw: break;
+    }
+    return none;
+}
+
+QVector<SeriesRollup::Bucket> SeriesRollup::buckets(Tier tier, qint64 from, qint64 to) const
+{
+    const QVector<Bucket>& all = buckets(tier);
+    if (all.isEmpty() || from > to) return {};
+    // Przedział nachodzi na zakres, jeśli zaczyna się nie wcześniej niż przedział zawierający from
+    const qint64 firstStart = from <= all.first().start ? all.first().start : bucketStart(tier, from);
+    const auto begin = std::lower_bound(all.cbegin(), all.cend(), firstStart,
+                                        [](const Bucket& bucket, qint64 t) { return bucket.start < t; });
+    const auto end = std::upper_bound(begin, all.cend(), to,
+                                      [](qint64 t, const Bucket& bucket) { return t < bucket.start; });
+    return all.mid(begin - all.cbegin(), end - begin);
+}
+
+SeriesRollup::Tier SeriesRollup::chooseTier(qsizetype rawReadings, qint64 spanMs, int maxPoints)
+{
+    if (rawReadings <= maxPoints) return Tier::Raw;
+    if (spanMs / (24LL * 3600 * 1000) <= maxPoints) return Tier::Daily;
+    return Tier::Monthly;
+}
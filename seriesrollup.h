@@ -0,0 +1,87 @@
+#ifndef SERIESROLLUP_H
+#define SERIESROLLUP_H
+
+#include <QSharedPointer>
+#include <QVector>
+#include "giosapiclient.h" // MeasurementData, MeasurementDataPtr
+
+/**
+ * @file seriesrollup.h
+ * @brief Definicja klasy SeriesRollup - agregatów dobowych i miesięcznych serii pomiarowej.
+ */
+
+/**
+ * @class SeriesRollup
+ * @brief Przechowuje poziomy agregacji serii: dobowy i miesięczny (liczba, suma, minimum, maksimum).
+ *
+ * Przedziały odpowiadają dniom i miesiącom kalendarzowym czasu lokalnego. Poziomy są
+ * utrzymywane przyrostowo: nowy agregat serii, która zachowała początek poprzedniej,
+ * przejmuje przedziały sprzed ostatniego niezmienionego dnia (miesiąca) i przelicza tylko
+ * resztę. Widok długiego zakresu czyta więc kilkaset przedziałów zamiast dziesiątek
+ * tysięcy odczytów godzinnych.
+ *
+ * Agregat jest niemodyfikowalny i współdzielony (SeriesRollupPtr) razem z migawką serii.
+ * Nie trzyma samej serii, więc może pozostać w pamięci, gdy seria jest skompresowana
+ * lub zapisana na dysk (HistoryStore).
+ */
+class SeriesRollup
+{
+public:
+    /** @brief Poziom szczegółowości. */
+    enum class Tier { Raw, Daily, Monthly };
+
+    /** @brief Przedział agregacji (przedziały bez wartości oznaczają przerwę w danych). */
+    struct Bucket {
+        qint64 start = 0;           ///< Początek dnia lub miesiąca (ms od epoki).
+        int count = 0;              ///< Liczba wartości (bez null i odczytów oznaczonych jako podejrzane).
+        double sum = 0.0;
+        double min = 0.0;
+        double max = 0.0;
+        double average() const { return count > 0 ? sum / count : 0.0; }
+    };
+
+    /** @brief Buduje oba poziomy dla serii (posortowanej rosnąco po dacie). */
+    explicit SeriesRollup(const MeasurementDataPtr& data);
+
+    /**
+     * @brief Buduje poziomy, przejmując przedziały poprzedniego agregatu.
+     * @param data Nowa migawka serii.
+     * @param previous Agregat poprzedniej migawki.
+     * @param unchangedPrefix Liczba początkowych odczytów identycznych w obu migawkach.
+     */
+    SeriesRollup(const MeasurementDataPtr& data, const SeriesRollup& previous, qsizetype unchangedPrefix);
+
+    /** @brief Wszystkie przedziały poziomu (dla Tier::Raw - pusta lista). */
+    const QVector<Bucket>& buckets(Tier tier) const;
+
+    /** @brief Przedziały poziomu nachodzące na zakres [from, to] (ms od epoki). */
+    QVector<Bucket> buckets(Tier tier, qint64 from, qint64 to) const;
+
+    /**
+     * @brief Wybiera najdokładniejszy poziom, który mieści się w zadanej liczbie punktów.
+     * @param rawReadings Liczba odczytów w zakresie.
+     * @param spanMs Długość zakresu (ms).
+     * @param maxPoints Rozdzielczość widoku (np. szerokość wykresu w pikselach).
+     */
+    static Tier chooseTier(qsizetype rawReadings, qint64 spanMs, int maxPoints);
+
+    /** @brief Szacowany rozmiar agregatów w pamięci (bajty, bez samej serii). */
+    qsizetype memoryUsage() const { return sizeof(*this) + (daily.capacity() + monthly.capacity()) * qsizetype(sizeof(Bucket)); }
+
+    /** @brief Początek dnia lub miesiąca zawierającego podany czas (ms od epoki). */
+    static qint64 bucketStart(Tier tier, qint64 msecs);
+
+private:
+    /** @brief Przelicza przedziały poziomu od odczytu o podanym indeksie do końca serii. */
+    void buildFrom(Tier tier, const QList<Measurement>& values, qsizetype firstReading);
+    QVector<Bucket>& tierBuckets(Tier tier) { return tier == Tier::Daily ? daily : monthly; }
+
+    qsizetype readings = 0;     ///< Liczba odczytów serii, z której zbudowano agregat.
+    QVector<Bucket> daily;
+    QVector<Bucket> monthly;
+};
+
+/** @brief Współdzielony, niemodyfikowalny agregat serii. */
+using SeriesRollupPtr = QSharedPointer<const SeriesRollup>;
+
+#endif // SERIESROLLUP_H
@@ -0,0 +1,253 @@
+#include "spatialinterpolator.h"
+#include "tracing.h"
+
+#include <QPainter>
+#include <QVarLengthArray>
+#include <QtConcurrent/QtConcurrentMap>
+#include <QtMath>
+#include <QtNumeric>
+
+#include <algorithm>
+#include <cmath>
+
+void SpatialInterpolator::setOptions(const Options& newOptions)
+{
+    opts = newOptions;
+    opts.cellKm = qBound(0.25, opts.cellKm, 50.0); // 0,25 km nad Polską to ok. 7 mln komórek
+    opts.power = qBound(0.5, opts.power, 8.0);
+    opts.neighbours = qBound(1, opts.neighbours, int(MaxNeighbours));
+    opts.maxDistanceKm = qMax(opts.cellKm, opts.maxDistanceKm);
+    if (opts.maxLatitude <= opts.minLatitude) std::swap(opts.minLatitude, opts.maxLatitude);
+    if (opts.maxLongitude <= opts.minLongitude) std::swap(opts.minLongitude, opts.maxLongitude);
+    optionsChanged = true;
+}
+
+double SpatialInterpolator::maxValue() const
+{
+    double result = 0.0;
+    for (const Point& p : stations) result = qMax(result, p.value);
+    return result;
+}
+
+QPointF SpatialInterpolator::toGrid(double latitude, double longitude) const
+{
+    return QPointF((longitude - opts.minLongitude) * kmPerLongitude / opts.cellKm,
+                   (opts.maxLatitude - latitude) * kmPerLatitude / opts.cellKm);
+}
+
+void SpatialInterpolator::rebuild(const QVector<Point>& unique)
+{
+    optionsChanged = false;
+    stations = unique;
+    stationIndex.clear();
+    stationIndex.reserve(stations.size());
+    for (int i = 0; i < stations.size(); ++i) stationIndex.insert(stations.at(i).stationId, i);
+
+    const double middleLatitude = 0.5 * (opts.minLatitude + opts.maxLatitude);
+    kmPerLongitude = 111.32 * std::cos(qDegreesToRadians(middleLatitude));
+    const double widthKm = (opts.maxLongitude - opts.minLongitude) * kmPerLongitude;
+    const double heightKm = (opts.maxLatitude - opts.minLatitude) * kmPerLatitude;
+    gridWidth = qMax(1, int(std::ceil(widthKm / opts.cellKm)));
+    gridHeight = qMax(1, int(std::ceil(heightKm / opts.cellKm)));
+    cells.fill(qQNaN(), qsizetype(gridWidth) * gridHeight);
+
+    stationX.resize(stations.size());
+    stationY.resize(stations.size());
+    for (int i = 0; i < stations.size(); ++i) {
+        const QPointF p = toGrid(stations.at(i).latitude, stations.at(i).longitude);
+        stationX[i] = p.x() * opts.cellKm;
+        stationY[i] = p.y() * opts.cellKm;
+    }
+
+    // Indeks kubełkowy: średnio ok. 2 stacje na kubełek (sortowanie przez zliczanie)
+    bucketKm = qMax(opts.cellKm, std::sqrt(widthKm * heightKm * 2.0 / qMax<qsizetype>(1, stations.size())));
+    bucketColumns = qMax(1, int(std::ceil(widthKm / bucketKm)));
+    bucketRows = qMax(1, int(std::ceil(heightKm / bucketKm)));
+    auto bucketOf = [this](int i) {
+        // Stacje spoza obszaru trafiają do kubełków brzegowych (są wtedy tylko dalej, niż wskazuje kubełek)
+        const int column = qBound(0, int(stationX.at(i) / bucketKm), bucketColumns - 1);
+        const int row = qBound(0, int(stationY.at(i) / bucketKm), bucketRows - 1);
+        return row * bucketColumns + column;
+    };
+    bucketStart.fill(0, bucketColumns * bucketRows + 1);
+    for (int i = 0; i < stations.size(); ++i) ++bucketStart[bucketOf(i) + 1];
+    for (int b = 0; b < bucketColumns * bucketRows; ++b) bucketStart[b + 1] += bucketStart[b];
+    bucketItems.resize(stations.size());
+    QVector<int> fill(bucketStart.cbegin(), bucketStart.cend() - 1);
+    for (int i = 0; i < stations.size(); ++i) bucketItems[fill[bucketOf(i)]++] = i;
+
+    tiles.clear();
+    for (int y = 0; y < gridHeight; y += TileSize) {
+        for (int x = 0; x < gridWidth; x += TileSize) {
+            Tile tile;
+            tile.x0 = x;
+            tile.y0 = y;
+            tile.x1 = qMin(gridWidth, x + TileSize);
+            tile.y1 = qMin(gridHeight, y + TileSize);
+            tiles.append(tile);
+        }
+    }
+}
+
+void SpatialInterpolator::computeTile(Tile& tile, float* out) const
+{
+    const int k = opts.neighbours;
+    const double maxDistance2 = opts.maxDistanceKm * opts.maxDistanceKm;
+    const int maxRing = qMax(bucketColumns, bucketRows);
+    const bool inverseSquare = opts.power == 2.0;
+    QVarLengthArray<char, 1024> usedMask(stations.size());
+    std::fill(usedMask.begin(), usedMask.end(), 0);
+    double nearestDistance2[MaxNeighbours];
+    int nearest[MaxNeighbours];
+
+    for (int y = tile.y0; y < tile.y1; ++y) {
+        const double cy = (y + 0.5) * opts.cellKm;
+        const int by = qBound(0, int(cy / bucketKm), bucketRows - 1);
+        for (int x = tile.x0; x < tile.x1; ++x) {
+            const double cx = (x + 0.5) * opts.cellKm;
+            const int bx = qBound(0, int(cx / bucketKm), bucketColumns - 1);
+
+            // Pierścienie kubełków wokół komórki; kubełki pierścienia r są dalej niż (r - 1) * bucketKm
+            int found = 0;
+            for (int ring = 0; ring <= maxRing; ++ring) {
+                const double ringDistance = (ring - 1) * bucketKm;
+                if (ring > 0 && ringDistance > opts.maxDistanceKm) break;
+                if (found == k && nearestDistance2[k - 1] <= ringDistance * ringDistance) break;
+                for (int dy = -ring; dy <= ring; ++dy) {
+                    const int row = by + dy;
+                    if (row < 0 || row >= bucketRows) continue;
+                    const bool edgeRow = dy == -ring || dy == ring;
+                    for (int dx = -ring; dx <= ring; dx += edgeRow ? 1 : 2 * ring) {
+                        const int column = bx + dx;
+                        if (column < 0 || column >= bucketColumns) continue;
+                        const int bucket = row * bucketColumns + column;
+                        for (int i = bucketStart.at(bucket); i < bucketStart.at(bucket + 1); ++i) {
+                            const int s = bucketItems.at(i);
+                            const double ddx = stationX.at(s) - cx, ddy = stationY.at(s) - cy;
+                            const double d2 = ddx * ddx + ddy * ddy;
+                            if (d2 > maxDistance2 || (found == k && d2 >= nearestDistance2[k - 1])) continue;
+                            int pos = found < k ? found++ : k - 1;
+                            while (pos > 0 && nearestDistance2[pos - 1] > d2) {
+                                nearestDistance2[pos] = nearestDistance2[pos - 1];
+                                nearest[pos] = nearest[pos - 1];
+                                --pos;
+                            }
+                            nearestDistance2[pos] = d2;
+                            nearest[pos] = s;
+                        }
+                    }
+                }
+            }
+
+            float value = qQNaN();
+            if (found > 0) {
+                if (nearestDistance2[0] < 1e-9) {
+                    value = float(stations.at(nearest[0]).value); // Komórka na stacji
+                } else {
+                    double weights = 0.0, weighted = 0.0;
+                    for (int i = 0; i < found; ++i) {
+                        const double w = inverseSquare ? 1.0 / nearestDistance2[i] : std::pow(nearestDistance2[i], -0.5 * opts.power);
+                        weights += w;
+                        weighted += w * stations.at(nearest[i]).value;
+                    }
+                    value = float(weighted / weights);
+                }
+                for (int i = 0; i < found; ++i) usedMask[nearest[i]] = 1;
+            }
+            out[qsizetype(y) * gridWidth + x] = value;
+        }
+    }
+
+    tile.used.clear();
+    for (int i = 0; i < usedMask.size(); ++i) {
+        if (usedMask.at(i)) tile.used.append(i);
+    }
+}
+
+SpatialInterpolator::Stats SpatialInterpolator::update(const QVector<Point>& points)
+{
+    AQM_TRACE_SCOPE("SpatialInterpolator::update", "analysis");
+    QVector<Point> unique;
+    unique.reserve(points.size());
+    QHash<int, int> seen;
+    for (const Point& p : points) {
+        if (!std::isfinite(p.latitude) || !std::isfinite(p.longitude) || !std::isfinite(p.value)) continue;
+        if (seen.contains(p.stationId)) continue;
+        seen.insert(p.stationId, int(unique.size()));
+        unique.append(p);
+    }
+
+    Stats stats;
+    stats.stations = int(unique.size());
+
+    // Te same stacje w tych samych miejscach - przeliczane są tylko kafelki zmienionych stacji
+    bool sameLayout = !optionsChanged && unique.size() == stations.size();
+    QVector<char> changed(stations.size(), 0);
+    for (int i = 0; sameLayout && i < unique.size(); ++i) {
+        const Point& p = unique.at(i);
+        const int index = stationIndex.value(p.stationId, -1);
+        if (index < 0 || stations.at(index).latitude != p.latitude || stations.at(index).longitude != p.longitude) {
+            sameLayout = false;
+        } else if (stations.at(index).value != p.value) {
+            changed[index] = 1;
+            ++stats.changedStations;
+        }
+    }
+
+    QVector<int> work;
+    if (!sameLayout) {
+        rebuild(unique);
+        stats.fullRebuild = true;
+        stats.changedStations = stats.stations;
+        work.resize(tiles.size());
+        for (int t = 0; t < tiles.size(); ++t) work[t] = t;
+    } else if (stats.changedStations > 0) {
+        for (const Point& p : unique) stations[stationIndex.value(p.stationId)].value = p.value;
+        for (int t = 0; t < tiles.size(); ++t) {
+            const QVector<int>& used = tiles.at(t).used;
+            if (std::any_of(used.cbegin(), used.cend(), [&changed](int s) { return changed.at(s) != 0; })) work.append(t);
+        }
+    }
+    stats.totalTiles = int(tiles.size());
+    stats.recomputedTiles = int(work.size());
+    if (work.isEmpty()) return stats;
+
+    // Kafelki są rozłączne - każdy wątek pisze tylko do swoich komórek i swojego kafelka
+    Tile* tileData = tiles.data();
+    float* out = cells.data();
+    QtConcurrent::blockingMap(work, [this, tileData, out](const int& t) { computeTile(tileData[t], out); });
+    return stats;
+}
+
+QRgb SpatialInterpolator::colorFor(double fraction)
+{
+    static const QRgb stops[] = {qRgb(0, 160, 60), qRgb(250, 220, 0), qRgb(230, 40, 30), qRgb(120, 0, 120)};
+    const double t = qBound(0.0, fraction, 1.0) * 3.0;
+    const int i = qMin(2, int(t));
+    const double f = t - i;
+    auto mix = [f](int a, int b) { return int(a + (b - a) * f + 0.5); };
+    return qRgb(mix(qRed(stops[i]), qRed(stops[i + 1])), mix(qGreen(stops[i]), qGreen(stops[i + 1])),
+                mix(qBlue(stops[i]), qBlue(stops[i + 1])));
+}
+
+QImage SpatialInterpolator::image(double scaleMax) const
+{
+    if (cells.isEmpty()) return QImage();
+    const double top = scaleMax > 0.0 ? scaleMax : maxValue();
+    const double scale = top > 0.0 ? 1.0 / top : 1.0;
+
+    QImage result(gridWidth, gridHeight, QImage::Format_ARGB32);
+    for (int y = 0; y < gridHeight; ++y) {
+        QRgb *line = reinterpret_cast<QRgb*>(result.scanLine(y));
+        const float *row = cells.constData() + qsizetype(y) * gridWidth;
+        for (int x = 0; x < gridWidth; ++x) line[x] = qIsNaN(row[x]) ? qRgba(0, 0, 0, 0) : colorFor(row[x] * scale);
+    }
+
+    QPainter painter(&result);
+    painter.setRenderHint(QPainter::Antialiasing);
+    painter.setPen(QPen(Qt::black, 1.0));
+    painter.setBrush(Qt::white);
+    const double radius = qMax(2.0, gridWidth / 250.0);
+    for (const Point& p : stations) painter.drawEllipse(toGrid(p.latitude, p.longitude), radius, radius);
+    return result;
+}
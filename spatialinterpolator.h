@@ -0,0 +1,123 @@
+#ifndef SPATIALINTERPOLATOR_H
+#define SPATIALINTERPOLATOR_H
+
+#include <QHash>
+#include <QImage>
+#include <QPointF>
+#include <QVector>
+
+/**
+ * @file spatialinterpolator.h
+ * @brief Definicja klasy SpatialInterpolator - siatki stężeń interpolowanych z pomiarów stacji.
+ */
+
+/**
+ * @class SpatialInterpolator
+ * @brief Interpoluje wartości ze stacji na regularną siatkę (odwrotne ważenie odległością, IDW).
+ *
+ * Współrzędne są rzutowane na płaszczyznę (kilometry, rzut równoodległościowy względem środka
+ * obszaru - dla obszaru Polski błąd odległości to kilka procent). Komórka dostaje średnią ważoną
+ * 1/d^power z najbliższych stacji w promieniu maxDistanceKm; komórki bez stacji w promieniu
+ * mają wartość NaN. Sąsiedzi są wyszukiwani w kubełkowym indeksie stacji (pierścienie kubełków
+ * wokół komórki, aż dalsze nie mogą już zawierać bliższych stacji).
+ *
+ * Siatka jest dzielona na kafelki TileSize x TileSize liczone równolegle (QtConcurrent).
+ * Każdy kafelek pamięta stacje, których użył. Jeśli zbiór stacji i ich położenia się nie
+ * zmieniły, a zmieniły się tylko wartości, przeliczane są tylko kafelki używające zmienionych
+ * stacji (wybór sąsiadów zależy wyłącznie od położeń).
+ */
+class SpatialInterpolator
+{
+public:
+    /** @brief Bok kafelka (komórki). */
+    static constexpr int TileSize = 64;
+    /** @brief Największa liczba sąsiadów komórki. */
+    static constexpr int MaxNeighbours = 32;
+
+    /** @brief Stacja z wartością. */
+    struct Point {
+        int stationId = -1;
+        double latitude = 0.0;      ///< Stopnie (WGS84).
+        double longitude = 0.0;
+        double value = 0.0;
+    };
+
+    /** @brief Parametry siatki i interpolacji (domyślnie obszar Polski, komórki 1 km). */
+    struct Options {
+        double cellKm = 1.0;            ///< Bok komórki (km).
+        double power = 2.0;             ///< Wykładnik wag 1/d^power.
+        int neighbours = 8;             ///< Liczba najbliższych stacji (1..MaxNeighbours).
+        double maxDistanceKm = 80.0;    ///< Stacje dalsze nie wpływają na komórkę.
+        double minLatitude = 49.0;
+        double maxLatitude = 54.9;
+        double minLongitude = 14.1;
+        double maxLongitude = 24.2;
+    };
+
+    /** @brief Podsumowanie ostatniej aktualizacji. */
+    struct Stats {
+        int stations = 0;               ///< Stacje użyte w siatce.
+        int changedStations = 0;        ///< Stacje ze zmienioną wartością (aktualizacja przyrostowa).
+        int recomputedTiles = 0;
+        int totalTiles = 0;
+        bool fullRebuild = false;       ///< Zmiana zbioru stacji, położeń lub parametrów.
+    };
+
+    /** @brief Ustawia parametry (następna aktualizacja przelicza całą siatkę). */
+    void setOptions(const Options& newOptions);
+    const Options& options() const { return opts; }
+
+    /**
+     * @brief Aktualizuje siatkę dla podanych stacji.
+     * @param points Stacje z wartościami (powtórzone ID stacji są pomijane).
+     * @return Zakres wykonanej pracy.
+     */
+    Stats update(const QVector<Point>& points);
+
+    int width() const { return gridWidth; }
+    int height() const { return gridHeight; }
+    /** @brief Wartości komórek w układzie wierszowym, od północy (NaN = brak stacji w promieniu). */
+    const QVector<float>& values() const { return cells; }
+    float valueAt(int x, int y) const { return cells.at(y * gridWidth + x); }
+    /** @brief Największa wartość wśród stacji (skala domyślna obrazu). */
+    double maxValue() const;
+    /** @brief Położenie punktu na siatce (komórki, może wypaść poza siatkę). */
+    QPointF toGrid(double latitude, double longitude) const;
+
+    /**
+     * @brief Rysuje siatkę jako mapę cieplną (komórka = piksel) z zaznaczonymi stacjami.
+     * @param scaleMax Wartość odpowiadająca końcowi skali (0 = maxValue()).
+     */
+    QImage image(double scaleMax = 0.0) const;
+
+    /** @brief Kolor ułamka skali 0..1 (zielony - żółty - czerwony - fioletowy). */
+    static QRgb colorFor(double fraction);
+
+private:
+    struct Tile {
+        int x0 = 0, y0 = 0, x1 = 0, y1 = 0;     ///< Zakres komórek [x0, x1) x [y0, y1).
+        QVector<int> used;                      ///< Indeksy stacji użytych w kafelku (rosnąco).
+    };
+
+    /** @brief Przelicza wymiary siatki, położenia stacji i indeks kubełkowy. */
+    void rebuild(const QVector<Point>& unique);
+    /** @brief Liczy komórki kafelka (wywoływane równolegle dla rozłącznych kafelków). */
+    void computeTile(Tile& tile, float* out) const;
+
+    Options opts;
+    bool optionsChanged = true;
+    QVector<Point> stations;                    ///< Stacje bieżącej siatki.
+    QHash<int, int> stationIndex;               ///< ID stacji -> indeks w stations.
+    QVector<double> stationX, stationY;         ///< Położenie stacji (km od lewego górnego rogu).
+    double kmPerLongitude = 0.0;
+    double kmPerLatitude = 111.2;
+    int gridWidth = 0, gridHeight = 0;
+    QVector<float> cells;
+    QVector<Tile> tiles;
+    double bucketKm = 1.0;                      ///< Bok kubełka indeksu stacji.
+    int bucketColumns = 0, bucketRows = 0;
+    QVector<int> bucketStart;                   ///< Początki list stacji kubełków (bucketColumns * bucketRows + 1).
+    QVector<int> bucketItems;                   ///< Indeksy stacji kolejnych kubełków.
+};
+
+#endif // SPATIALINTERPOLATOR_H
@@ -0,0 +1,374 @@
+#include "stationcatalog.h"
+
+#include <QDataStream>
+
+namespace {
+
+/** @brief Przybliżony rozmiar danych napisu na stercie (nagłówek QArrayData + znaki UTF-16). */
+qsizetype stringHeapBytes(const QString& text)
+{
+    return text.isEmpty() ? 0 : 16 + 2 * (text.capacity() + 1);
+}
+
+// Przybliżony narzut jednego węzła QHash (wpis + fragment tablicy kubełków)
+const qsizetype HashNodeOverhead = 16;
+
+} // namespace
+
+void StationCatalog::clear()
+{
+    strings.clear();
+    stringIds.clear();
+    stationRecords.clear();
+    sensorRecords.clear();
+    stationIndex.clear();
+    sensorStation.clear();
+    deadSensors = 0;
+}
+
+quint32 StationCatalog::intern(const QString& text)
+{
+    const auto it = stringIds.constFind(text);
+    if (it != stringIds.cend()) return it.value();
+    const quint32 id = quint32(strings.size());
+    strings.append(text);
+    stringIds.insert(text, id);
+    return id;
+}
+
+void StationCatalog::setStations(const QList<StationInfo>& stations)
+{
+    QVector<StationRecord> previous;
+    previous.swap(stationRecords);
+    const QHash<int, int> previousIndex = stationIndex;
+    QVector<SensorRecord> previousSensors;
+    previousSensors.swap(sensorRecords);
+
+    stationIndex.clear();
+    stationIndex.reserve(stations.size());
+    stationRecords.reserve(stations.size());
+    sensorRecords.reserve(previousSensors.size());
+
+    for (const StationInfo& info : stations) {
+        if (stationIndex.contains(info.id)) continue; // Duplikat ID w odpowiedzi API
+        StationRecord record;
+        record.id = info.id;
+        record.nameId = intern(info.stationName);
+        record.cityId = intern(info.cityName);
+        record.latitude = float(info.latitude);
+        record.longitude = float(info.longitude);
+
+        // Przenieś sensory stacji, która była już w katalogu
+        const int oldIndex = previousIndex.value(info.id, -1);
+        if (oldIndex >= 0 && previous.at(oldIndex).sensorCount >= 0) {
+            const StationRecord& old = previous.at(oldIndex);
+            record.firstSensor = int(sensorRecords.size());
+            record.sensorCount = old.sensorCount;
+            for (int i = 0; i < old.sensorCount; ++i) sensorRecords.append(previousSensors.at(old.firstSensor + i));
+        }
+        stationIndex.insert(info.id, int(stationRecords.size()));
+        stationRecords.append(record);
+    }
+    deadSensors = 0;
+    rebuildSensorIndex(); // Indeksy stacji się zmieniły
+}
+
+int StationCatalog::addStations(const QList<StationInfo>& stations)
+{
+    int added = 0;
+    stationRecords.reserve(stationRecords.size() + stations.size());
+    for (const StationInfo& info : stations) {
+        if (stationIndex.contains(info.id)) continue;
+        StationRecord record;
+        record.id = info.id;
+        record.nameId = intern(info.stationName);
+        record.cityId = intern(info.cityName);
+        record.latitude = float(info.latitude);
+        record.longitude = float(info.longitude);
+        stationIndex.insert(info.id, int(stationRecords.size()));
+        stationRecords.append(record);
+        ++added;
+    }
+    return added;
+}
+
+void StationCatalog::setSensors(int stationId, const QList<SensorInfo>& sensors)
+{
+    const int index = indexOfStation(stationId);
+    if (index < 0) return;
+    StationRecord& station = stationRecords[index];
+    for (int i = 0; i < station.sensorCount; ++i) {
+        const int oldId = sensorRecords.at(station.firstSensor + i).id;
+        if (sensorStation.value(oldId, -1) == index) sensorStation.remove(oldId);
+    }
+
+    // Ten sam rozmiar - nadpisujemy zakres w miejscu; inaczej nowy zakres na końcu tablicy
+    if (station.sensorCount != int(sensors.size())) {
+        if (station.sensorCount > 0) deadSensors += station.sensorCount;
+        station.firstSensor = int(sensorRecords.size());
+        station.sensorCount = int(sensors.size());
+        sensorRecords.resize(sensorRecords.size() + sensors.size());
+    }
+    for (int i = 0; i < sensors.size(); ++i) {
+        const SensorInfo& info = sensors.at(i);
+        SensorRecord& record = sensorRecords[station.firstSensor + i];
+        record.id = info.id;
+        record.idParam = info.idParam;
+        record.paramNameId = intern(info.paramName);
+        record.formulaId = intern(info.paramFormula);
+        record.codeId = intern(info.paramCode);
+        sensorStation.insert(info.id, index);
+    }
+
+    if (deadSensors > sensorRecords.size() / 2) compactSensors();
+}
+
+void StationCatalog::compactSensors()
+{
+    QVector<SensorRecord> compacted;
+    compacted.reserve(sensorRecords.size() - deadSensors);
+    for (StationRecord& station : stationRecords) {
+        if (station.sensorCount <= 0) continue;
+        const int first = int(compacted.size());
+        for (int i = 0; i < station.sensorCount; ++i) compacted.append(sensorRecords.at(station.firstSensor + i));
+        station.firstSensor = first;
+    }
+    sensorRecords.swap(compacted);
+    deadSensors = 0;
+    rebuildSensorIndex();
+}
+
+void StationCatalog::rebuildSensorIndex()
+{
+    sensorStation.clear();
+    sensorStation.reserve(sensorRecords.size() - deadSensors);
+    for (int index = 0; index < stationRecords.size(); ++index) {
+        const StationRecord& station = stationRecords.at(index);
+        for (int i = 0; i < station.sensorCount; ++i) {
+            const int sensorId = sensorRecords.at(station.firstSensor + i).id;
+            if (!sensorStation.contains(sensorId)) sensorStation.insert(sensorId, index); // Jak dawniej: pierwsza stacja wygrywa
+        }
+    }
+}
+
+StationInfo StationCatalog::station(int index) const
+{
+    const StationRecord& record = stationRecords.at(index);
+    StationInfo info;
+    info.id = record.id;
+    info.stationName = strings.at(record.nameId);
+    info.cityName = strings.at(record.cityId);
+    info.latitude = record.latitude;
+    info.longitude = record.longitude;
+    return info;
+}
+
+QList<StationInfo> StationCatalog::stations() const
+{
+    QList<StationInfo> list;
+    list.reserve(stationRecords.size());
+    for (int i = 0; i < stationRecords.size(); ++i) list.append(station(i));
+    return list;
+}
+
+bool StationCatalog::hasSensors(int stationId) const
+{
+    const int index = indexOfStation(stationId);
+    return index >= 0 && stationRecords.at(index).sensorCount >= 0;
+}
+
+SensorInfo StationCatalog::sensorInfo(int stationId, const SensorRecord& record) const
+{
+    SensorInfo info;
+    info.id = record.id;
+    info.stationId = stationId;
+    info.idParam = record.idParam;
+    info.paramName = strings.at(record.paramNameId);
+    info.paramFormula = strings.at(record.formulaId);
+    info.paramCode = strings.at(record.codeId);
+    return info;
+}
+
+QList<SensorInfo> StationCatalog::sensorsForStation(int stationId) const
+{
+    QList<SensorInfo> list;
+    const int index = indexOfStation(stationId);
+    if (index < 0) return list;
+    const StationRecord& station = stationRecords.at(index);
+    list.reserve(qMax(0, station.sensorCount));
+    for (int i = 0; i < station.sensorCount; ++i) list.append(sensorInfo(stationId, sensorRecords.at(station.firstSensor + i)));
+    return list;
+}
+
+bool StationCatalog::sameSensors(int stationId, const QList<SensorInfo>& sensors) const
+{
+    const int index = indexOfStation(stationId);
+    if (index < 0) return false;
+    const StationRecord& station = stationRecords.at(index);
+    if (station.sensorCount != int(sensors.size())) return false;
+    for (int i = 0; i < station.sensorCount; ++i) {
+        const SensorRecord& record = sensorRecords.at(station.firstSensor + i);
+        const SensorInfo& info = sensors.at(i);
+        if (record.id != info.id || record.idParam != info.idParam
+            || strings.at(record.paramNameId) != info.paramName || strings.at(record.formulaId) != info.paramFormula
+            || strings.at(record.codeId) != info.paramCode) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int StationCatalog::stationIdForSensor(int sensorId) const
+{
+    const int index = sensorStation.value(sensorId, -1);
+    return index >= 0 ? stationRecords.at(index).id : -1;
+}
+
+int StationCatalog::stationsWithSensors() const
+{
+    int count = 0;
+    for (const StationRecord& station : stationRecords) count += station.sensorCount >= 0 ? 1 : 0;
+    return count;
+}
+
+QVector<int> StationCatalog::stationsMatchingCity(const QString& filter) const
+{
+    QVector<int> result;
+    result.reserve(stationRecords.size());
+    if (filter.isEmpty()) {
+        for (int i = 0; i < stationRecords.size(); ++i) result.append(i);
+        return result;
+    }
+
+    // Dopasowanie tekstu raz na napis miasta (0 = nie sprawdzono, 1 = pasuje, 2 = nie pasuje)
+    QVector<quint8> cityMatch(strings.size(), 0);
+    for (int i = 0; i < stationRecords.size(); ++i) {
+        const quint32 city = stationRecords.at(i).cityId;
+        quint8& match = cityMatch[city];
+        if (match == 0) {
+            const QString& name = strings.at(city);
+            match = !name.isEmpty() && name.contains(filter, Qt::CaseInsensitive) ? 1 : 2;
+        }
+        if (match == 1) result.append(i);
+    }
+    return result;
+}
+
+QVector<int> StationCatalog::stationsMeasuring(const QString& paramCode) const
+{
+    QVector<int> result;
+    const auto code = stringIds.constFind(paramCode);
+    if (code == stringIds.cend()) return result;
+    const quint32 codeId = code.value();
+    for (int i = 0; i < stationRecords.size(); ++i) {
+        const StationRecord& station = stationRecords.at(i);
+        for (int s = 0; s < station.sensorCount; ++s) {
+            if (sensorRecords.at(station.firstSensor + s).codeId == codeId) {
+                result.append(i);
+                break;
+            }
+        }
+    }
+    return result;
+}
+
+qsizetype StationCatalog::memoryUsage() const
+{
+    qsizetype bytes = sizeof(*this);
+    bytes += stationRecords.capacity() * qsizetype(sizeof(StationRecord));
+    bytes += sensorRecords.capacity() * qsizetype(sizeof(SensorRecord));
+    bytes += strings.capacity() * qsizetype(sizeof(QString));
+    for (const QString& text : strings) bytes += stringHeapBytes(text);
+    // Klucze stringIds współdzielą dane z tablicą napisów
+    bytes += stringIds.size() * (qsizetype(sizeof(QString) + sizeof(quint32)) + HashNodeOverhead);
+    bytes += (stationIndex.size() + sensorStation.size()) * (qsizetype(2 * sizeof(int)) + HashNodeOverhead);
+    return bytes;
+}
+
+qsizetype StationCatalog::memoryUsage(const QList<StationInfo>& stations, const QHash<int, QList<SensorInfo>>& sensors)
+{
+    qsizetype bytes = stations.capacity() * qsizetype(sizeof(StationInfo));
+    for (const StationInfo& station : stations)
+        bytes += stringHeapBytes(station.stationName) + stringHeapBytes(station.cityName);
+    for (auto it = sensors.cbegin(); it != sensors.cend(); ++it) {
+        bytes += qsizetype(sizeof(int) + sizeof(QList<SensorInfo>)) + HashNodeOverhead + 16;
+        bytes += it->capacity() * qsizetype(sizeof(SensorInfo));
+        for (const SensorInfo& sensor : it.value())
+            bytes += stringHeapBytes(sensor.paramName) + stringHeapBytes(sensor.paramFormula) + stringHeapBytes(sensor.paramCode);
+    }
+    return bytes;
+}
+
+void StationCatalog::write(QDataStream& out) const
+{
+    out << quint32(strings.size());
+    for (const QString& text : strings) out << text;
+
+    out << quint32(stationRecords.size());
+    for (const StationRecord& station : stationRecords)
+        out << qint32(station.id) << station.nameId << station.cityId << station.latitude << station.longitude
+            << qint32(station.sensorCount);
+    // Sensory w kolejności stacji - po odczycie zakresy są od razu zwarte
+    for (const StationRecord& station : stationRecords) {
+        for (int i = 0; i < station.sensorCount; ++i) {
+            const SensorRecord& sensor = sensorRecords.at(station.firstSensor + i);
+            out << qint32(sensor.id) << qint32(sensor.idParam) << sensor.paramNameId << sensor.formulaId << sensor.codeId;
+        }
+    }
+}
+
+bool StationCatalog::read(QDataStream& in)
+{
+    clear();
+    quint32 stringCount = 0;
+    in >> stringCount;
+    strings.reserve(qsizetype(qMin<quint32>(stringCount, 1000000)));
+    for (quint32 i = 0; i < stringCount && in.status() == QDataStream::Ok; ++i) {
+        QString text;
+        in >> text;
+        stringIds.insert(text, quint32(strings.size()));
+        strings.append(text);
+    }
+
+    auto validString = [stringCount](quint32 id) { return id < stringCount; };
+    quint32 stationCount = 0;
+    in >> stationCount;
+    stationRecords.reserve(qsizetype(qMin<quint32>(stationCount, 1000000)));
+    int totalSensors = 0;
+    for (quint32 i = 0; i < stationCount && in.status() == QDataStream::Ok; ++i) {
+        StationRecord station;
+        qint32 id = -1, sensorCount = -1;
+        in >> id >> station.nameId >> station.cityId >> station.latitude >> station.longitude >> sensorCount;
+        if (!validString(station.nameId) || !validString(station.cityId) || sensorCount < -1) {
+            in.setStatus(QDataStream::ReadCorruptData);
+            break;
+        }
+        station.id = id;
+        station.sensorCount = sensorCount;
+        station.firstSensor = totalSensors;
+        totalSensors += qMax(0, sensorCount);
+        stationIndex.insert(station.id, int(stationRecords.size()));
+        stationRecords.append(station);
+    }
+
+    sensorRecords.reserve(qMin(totalSensors, 10000000));
+    for (int i = 0; i < totalSensors && in.status() == QDataStream::Ok; ++i) {
+        SensorRecord sensor;
+        qint32 id = -1, idParam = -1;
+        in >> id >> idParam >> sensor.paramNameId >> sensor.formulaId >> sensor.codeId;
+        if (!validString(sensor.paramNameId) || !validString(sensor.formulaId) || !validString(sensor.codeId)) {
+            in.setStatus(QDataStream::ReadCorruptData);
+            break;
+        }
+        sensor.id = id;
+        sensor.idParam = idParam;
+        sensorRecords.append(sensor);
+    }
+
+    if (in.status() != QDataStream::Ok) {
+        clear();
+        return false;
+    }
+    rebuildSensorIndex();
+    return true;
+}
@@ -0,0 +1,159 @@
+#ifndef STATIONCATALOG_H
+#define STATIONCATALOG_H
+
+#include <QHash>
+#include <QList>
+#include <QString>
+#include <QVector>
+#include "giosapiclient.h" // Struktury StationInfo i SensorInfo
+
+class QDataStream;
+
+/**
+ * @file stationcatalog.h
+ * @brief Definicja klasy StationCatalog - zwartego katalogu stacji i sensorów.
+ */
+
+/**
+ * @class StationCatalog
+ * @brief Katalog stacji i sensorów z internowanymi napisami i płaskimi tablicami rekordów.
+ *
+ * Powtarzające się napisy (miasta, nazwy, wzory i kody parametrów) są przechowywane
+ * raz w tablicy napisów, a rekordy stacji i sensorów odwołują się do nich przez
+ * małe identyfikatory całkowite. Sensory jednej stacji zajmują ciągły zakres tablicy
+ * sensorów. Filtrowanie i złączenia porównują identyfikatory zamiast napisów.
+ *
+ * Indeks stacji (0..stationCount()-1) odpowiada kolejności z API.
+ */
+class StationCatalog
+{
+public:
+    // === Budowa katalogu ===
+
+    /** @brief Usuwa wszystkie stacje, sensory i napisy. */
+    void clear();
+
+    /**
+     * @brief Zastępuje listę stacji. Sensory stacji, które pozostały w katalogu, są zachowywane.
+     * @param stations Lista stacji w kolejności z API.
+     */
+    void setStations(const QList<StationInfo>& stations);
+
+    /**
+     * @brief Dopisuje stacje na końcu katalogu (np. kolejną stronę listy z API). Stacje już obecne są pomijane.
+     * @param stations Stacje do dopisania.
+     * @return Liczba dopisanych stacji.
+     */
+    int addStations(const QList<StationInfo>& stations);
+
+    /**
+     * @brief Zapisuje sensory stacji (zastępuje poprzednie). Stacje spoza katalogu są pomijane.
+     * @param stationId ID stacji.
+     * @param sensors Lista sensorów (może być pusta - stacja bez sensorów).
+     */
+    void setSensors(int stationId, const QList<SensorInfo>& sensors);
+
+    // === Stacje ===
+
+    int stationCount() const { return int(stationRecords.size()); }
+    bool isEmpty() const { return stationRecords.isEmpty(); }
+    /** @brief Indeks stacji o podanym ID lub -1. */
+    int indexOfStation(int stationId) const { return stationIndex.value(stationId, -1); }
+    int stationId(int index) const { return stationRecords.at(index).id; }
+    const QString& stationName(int index) const { return strings.at(stationRecords.at(index).nameId); }
+    const QString& cityName(int index) const { return strings.at(stationRecords.at(index).cityId); }
+    /** @brief Identyfikator napisu miasta (równe ID = to samo miasto). */
+    quint32 cityId(int index) const { return stationRecords.at(index).cityId; }
+    /** @brief Szerokość geograficzna stacji (stopnie; NaN = nieznana). */
+    double latitude(int index) const { return stationRecords.at(index).latitude; }
+    /** @brief Długość geograficzna stacji (stopnie; NaN = nieznana). */
+    double longitude(int index) const { return stationRecords.at(index).longitude; }
+    bool hasLocation(int index) const { return !qIsNaN(stationRecords.at(index).latitude) && !qIsNaN(stationRecords.at(index).longitude); }
+    /** @brief Odtwarza strukturę StationInfo dla stacji o podanym indeksie. */
+    StationInfo station(int index) const;
+    /** @brief Odtwarza pełną listę stacji w kolejności katalogu. */
+    QList<StationInfo> stations() const;
+
+    // === Sensory ===
+
+    /** @brief Czy sensory stacji zostały już pobrane (także pusta lista). */
+    bool hasSensors(int stationId) const;
+    /** @brief Odtwarza listę sensorów stacji (pusta, jeśli nieznane). */
+    QList<SensorInfo> sensorsForStation(int stationId) const;
+    /** @brief Czy zapisane sensory stacji są identyczne z podanymi (bez tworzenia kopii). */
+    bool sameSensors(int stationId, const QList<SensorInfo>& sensors) const;
+    /** @brief ID stacji, do której należy sensor (-1, jeśli sensor nie jest znany); O(1). */
+    int stationIdForSensor(int sensorId) const;
+    /** @brief Liczba stacji ze znanymi sensorami. */
+    int stationsWithSensors() const;
+
+    // === Zapytania ===
+
+    /**
+     * @brief Indeksy stacji, których miasto zawiera podany tekst (bez rozróżniania wielkości liter).
+     * Dopasowanie tekstu jest liczone raz na miasto, a stacje są filtrowane po ID miasta.
+     * @param filter Tekst filtra; pusty zwraca wszystkie stacje.
+     */
+    QVector<int> stationsMatchingCity(const QString& filter) const;
+
+    /**
+     * @brief Indeksy stacji (ze znanymi sensorami), które mierzą parametr o podanym kodzie (np. "PM10").
+     */
+    QVector<int> stationsMeasuring(const QString& paramCode) const;
+
+    // === Pamięć i serializacja ===
+
+    /** @brief Szacowany rozmiar katalogu w pamięci (bajty). */
+    qsizetype memoryUsage() const;
+
+    /** @brief Szacowany rozmiar tych samych danych w postaci list struktur z osobnymi napisami. */
+    static qsizetype memoryUsage(const QList<StationInfo>& stations, const QHash<int, QList<SensorInfo>>& sensors);
+
+    /** @brief Liczba unikalnych napisów w tablicy. */
+    int stringCount() const { return int(strings.size()); }
+
+    /** @brief Zapisuje katalog (tablica napisów + tablice rekordów) do strumienia. */
+    void write(QDataStream& out) const;
+
+    /**
+     * @brief Odczytuje katalog zapisany przez write().
+     * @return false przy uszkodzonych danych (katalog zostaje wtedy wyczyszczony).
+     */
+    bool read(QDataStream& in);
+
+private:
+    struct StationRecord {
+        int id = -1;
+        quint32 nameId = 0;
+        quint32 cityId = 0;
+        float latitude = qQNaN();   ///< Pojedyncza precyzja wystarcza (ok. 1 m).
+        float longitude = qQNaN();
+        int firstSensor = 0;
+        int sensorCount = -1;   ///< -1 = sensory nieznane.
+    };
+    struct SensorRecord {
+        int id = -1;
+        int idParam = -1;
+        quint32 paramNameId = 0;
+        quint32 formulaId = 0;
+        quint32 codeId = 0;
+    };
+
+    /** @brief Zwraca identyfikator napisu, dodając go do tablicy przy pierwszym wystąpieniu. */
+    quint32 intern(const QString& text);
+    /** @brief Usuwa z tablicy sensorów zakresy nieużywane po zastąpieniu sensorów stacji. */
+    void compactSensors();
+    /** @brief Odbudowuje sensorStation z bieżących rekordów (po zmianie indeksów stacji lub zakresów sensorów). */
+    void rebuildSensorIndex();
+    SensorInfo sensorInfo(int stationId, const SensorRecord& record) const;
+
+    QVector<QString> strings;                 ///< Tablica unikalnych napisów.
+    QHash<QString, quint32> stringIds;        ///< Napis -> identyfikator.
+    QVector<StationRecord> stationRecords;    ///< Stacje w kolejności z API.
+    QVector<SensorRecord> sensorRecords;      ///< Sensory, ciągłymi zakresami na stację.
+    QHash<int, int> stationIndex;             ///< ID stacji -> indeks w stationRecords.
+    QHash<int, int> sensorStation;            ///< ID sensora -> indeks stacji w stationRecords.
+    int deadSensors = 0;                      ///< Rekordy sensorów w nieużywanych zakresach.
+};
+
+#endif // STATIONCATALOG_H
@@ -0,0 +1,162 @@
+#include "tracing.h"
+
+#include <QCoreApplication>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QList>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QThread>
+#include <QVector>
+
+#include <memory>
+
+namespace {
+
+/** @brief Pojedyncze zdarzenie śledzenia. Nazwa i kategoria to literały. */
+struct TraceEvent {
+    const char* name;
+    const char* category;
+    qint64 tsUs;
+    qint64 durUs;
+    char phase;
+    QString detail;
+};
+
+/** @brief Bufor zdarzeń jednego wątku. Blokada jest praktycznie zawsze wolna (czyta ją tylko stop()). */
+struct ThreadBuffer {
+    int tid = 0;
+    QString threadName;
+    QMutex mutex;
+    QVector<TraceEvent> events;
+};
+
+/** @brief Wspólny stan śledzenia (inicjalizowany przy pierwszym użyciu). */
+struct TraceRegistry {
+    QMutex mutex;
+    QList<std::shared_ptr<ThreadBuffer>> buffers;
+    QString fileName;
+    QElapsedTimer clock;
+    int nextTid = 1;
+    TraceRegistry() { clock.start(); }
+};
+
+// Limit zdarzeń na wątek - chroni przed nieograniczonym wzrostem pamięci przy długich sesjach
+const int MaxEventsPerThread = 1000000;
+
+TraceRegistry& registry()
+{
+    static TraceRegistry instance;
+    return instance;
+}
+
+thread_local std::shared_ptr<ThreadBuffer> threadBuffer;
+
+ThreadBuffer& currentBuffer()
+{
+    if (!threadBuffer) {
+        auto buffer = std::make_shared<ThreadBuffer>();
+        QThread *thread = QThread::currentThread();
+        buffer->threadName = thread && !thread->objectName().isEmpty()
+                                 ? thread->objectName()
+                                 : (thread && QCoreApplication::instance() && thread == QCoreApplication::instance()->thread()
+                                        ? QString("main") : QString("thread"));
+        TraceRegistry& reg = registry();
+        QMutexLocker locker(&reg.mutex);
+        buffer->tid = reg.nextTid++;
+        reg.buffers.append(buffer);
+        threadBuffer = buffer;
+    }
+    return *threadBuffer;
+}
+
+void appendEvent(TraceEvent&& event)
+{
+    ThreadBuffer& buffer = currentBuffer();
+    QMutexLocker locker(&buffer.mutex);
+    if (buffer.events.size() < MaxEventsPerThread) buffer.events.append(std::move(event));
+}
+
+} // namespace
+
+void Tracer::start(const QString& fileName)
+{
+    TraceRegistry& reg = registry();
+    {
+        QMutexLocker locker(&reg.mutex);
+        reg.fileName = fileName;
+        for (const auto& buffer : reg.buffers) {
+            QMutexLocker bufferLocker(&buffer->mutex);
+            buffer->events.clear();
+        }
+    }
+    enabledFlag.store(true, std::memory_order_relaxed);
+    qDebug() << "Tracer: Śledzenie włączone, plik:" << fileName;
+}
+
+bool Tracer::stop(QString* errorString)
+{
+    if (!enabledFlag.exchange(false)) return true;
+
+    TraceRegistry& reg = registry();
+    QMutexLocker locker(&reg.mutex);
+    QFile file(reg.fileName);
+    if (!file.open(QIODevice::WriteOnly)) {
+        if (errorString) *errorString = file.errorString();
+        qWarning() << "Tracer: Nie można zapisać śladu:" << reg.fileName << file.errorString();
+        return false;
+    }
+
+    // Zapis strumieniowy - pełny dokument w pamięci byłby kilkukrotnie większy niż bufory
+    file.write("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    bool first = true;
+    auto writeObject = [&file, &first](const QJsonObject& obj) {
+        if (!first) file.write(",\n");
+        first = false;
+        file.write(QJsonDocument(obj).toJson(QJsonDocument::Compact));
+    };
+
+    writeObject(QJsonObject{{"name", "process_name"}, {"ph", "M"}, {"pid", 1},
+                            {"args", QJsonObject{{"name", QCoreApplication::applicationName()}}}});
+    qsizetype total = 0;
+    for (const auto& buffer : reg.buffers) {
+        QMutexLocker bufferLocker(&buffer->mutex);
+        if (buffer->events.isEmpty()) continue;
+        writeObject(QJsonObject{{"name", "thread_name"}, {"ph", "M"}, {"pid", 1}, {"tid", buffer->tid},
+                                {"args", QJsonObject{{"name", buffer->threadName}}}});
+        for (const TraceEvent& e : buffer->events) {
+            QJsonObject obj{{"name", QString::fromLatin1(e.name)}, {"cat", QString::fromLatin1(e.category)},
+                            {"ph", QString(QChar(e.phase))}, {"ts", double(e.tsUs)},
+                            {"pid", 1}, {"tid", buffer->tid}};
+            if (e.phase == 'X') obj["dur"] = double(e.durUs);
+            if (e.phase == 'i') obj["s"] = "t";
+            if (!e.detail.isEmpty()) obj["args"] = QJsonObject{{"detail", e.detail}};
+            writeObject(obj);
+        }
+        total += buffer->events.size();
+        buffer->events.clear();
+    }
+    file.write("\n]}\n");
+    qDebug() << "Tracer: Zapisano" << total << "zdarzeń do" << reg.fileName;
+    return true;
+}
+
+qint64 Tracer::nowUs()
+{
+    return registry().clock.nsecsElapsed() / 1000;
+}
+
+void Tracer::addCompleteEvent(const char* name, const char* category, qint64 startUs, qint64 durationUs, const QString& detail)
+{
+    if (!isEnabled()) return;
+    appendEvent(TraceEvent{name, category, startUs, qMax<qint64>(0, durationUs), 'X', detail});
+}
+
+void Tracer::addInstantEvent(const char* name, const char* category, const QString& detail)
+{
+    if (!isEnabled()) return;
+    appendEvent(TraceEvent{name, category, nowUs(), 0, 'i', detail});
+}
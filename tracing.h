@@ -0,0 +1,113 @@
+#ifndef TRACING_H
+#define TRACING_H
+
+#include <QString>
+#include <atomic>
+
+/**
+ * @file tracing.h
+ * @brief Opcjonalne śledzenie (tracing) w formacie Trace Event JSON (Perfetto, chrome://tracing).
+ *
+ * Przykład użycia w funkcji:
+ * @code
+ * void GiosApiClient::parseSensorsJson(...)
+ * {
+ *     AQM_TRACE_SCOPE("parseSensorsJson", "parse");
+ *     ...
+ * }
+ * @endcode
+ *
+ * Gdy śledzenie jest wyłączone, zakres kosztuje jeden odczyt zmiennej atomowej
+ * (memory_order_relaxed) i jedno porównanie, więc może pozostać w wersji produkcyjnej.
+ * Zdefiniowanie AQM_DISABLE_TRACING usuwa makra całkowicie na etapie kompilacji.
+ */
+
+/**
+ * @class Tracer
+ * @brief Globalny rejestrator zdarzeń śledzenia, bezpieczny wątkowo.
+ *
+ * Każdy wątek zapisuje zdarzenia do własnego bufora (bez rywalizacji o blokadę),
+ * a stop() scala bufory i zapisuje plik JSON.
+ */
+class Tracer
+{
+public:
+    /** @brief Czy śledzenie jest aktywne. Bardzo tani test wywoływany w każdym zakresie. */
+    static bool isEnabled() noexcept { return enabledFlag.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Włącza śledzenie. Zdarzenia zostaną zapisane do pliku przy stop().
+     * @param fileName Ścieżka pliku wynikowego (.json).
+     */
+    static void start(const QString& fileName);
+
+    /**
+     * @brief Wyłącza śledzenie i zapisuje zebrane zdarzenia do pliku podanego w start().
+     * @param errorString Opcjonalny wskaźnik na komunikat błędu.
+     * @return true, jeśli zapis się powiódł (lub śledzenie nie było aktywne).
+     */
+    static bool stop(QString* errorString = nullptr);
+
+    /** @brief Bieżący czas zegara śledzenia w mikrosekundach. */
+    static qint64 nowUs();
+
+    /**
+     * @brief Dodaje zdarzenie o znanym początku i czasie trwania (faza "X").
+     * @param name Nazwa zdarzenia - musi być literałem (przechowywany jest tylko wskaźnik).
+     * @param category Kategoria zdarzenia - również literał.
+     * @param startUs Początek w mikrosekundach (zegar nowUs()).
+     * @param durationUs Czas trwania w mikrosekundach.
+     * @param detail Opcjonalny opis zapisywany w polu args.detail.
+     */
+    static void addCompleteEvent(const char* name, const char* category, qint64 startUs, qint64 durationUs,
+                                 const QString& detail = QString());
+
+    /** @brief Dodaje zdarzenie chwilowe (faza "i") w bieżącym wątku. */
+    static void addInstantEvent(const char* name, const char* category, const QString& detail = QString());
+
+private:
+    inline static std::atomic<bool> enabledFlag{false};
+};
+
+/**
+ * @class TraceScope
+ * @brief Mierzy czas życia zakresu i zapisuje go jako zdarzenie "X" (RAII).
+ */
+class TraceScope
+{
+public:
+    TraceScope(const char* name, const char* category)
+        : scopeName(name), scopeCategory(category), startUs(Tracer::isEnabled() ? Tracer::nowUs() : -1) {}
+    ~TraceScope()
+    {
+        if (startUs >= 0) Tracer::addCompleteEvent(scopeName, scopeCategory, startUs, Tracer::nowUs() - startUs, scopeDetail);
+    }
+    /** @brief Ustawia opis zdarzenia (np. ID stacji). */
+    void setDetail(const QString& detail) { scopeDetail = detail; }
+
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+private:
+    const char* scopeName;
+    const char* scopeCategory;
+    qint64 startUs;
+    QString scopeDetail;
+};
+
+#define AQM_TRACE_CONCAT_INNER(a, b) a##b
+#define AQM_TRACE_CONCAT(a, b) AQM_TRACE_CONCAT_INNER(a, b)
+
+#ifndef AQM_DISABLE_TRACING
+/** @brief Śledzi bieżący zakres pod podaną nazwą i kategorią. */
+#define AQM_TRACE_SCOPE(name, category) TraceScope AQM_TRACE_CONCAT(aqmTraceScope_, __LINE__)(name, category)
+/** @brief Jak AQM_TRACE_SCOPE, z opisem; wyrażenie detail jest obliczane tylko przy włączonym śledzeniu. */
+#define AQM_TRACE_SCOPE_DETAIL(name, category, detail) \
+    TraceScope AQM_TRACE_CONCAT(aqmTraceScope_, __LINE__)(name, category); \
+    if (Tracer::isEnabled()) AQM_TRACE_CONCAT(aqmTraceScope_, __LINE__).setDetail(detail)
+#else
+#define AQM_TRACE_SCOPE(name, category) do {} while (false)
+#define AQM_TRACE_SCOPE_DETAIL(name, category, detail) do {} while (false)
+#endif
+
+#endif // TRACING_H